@@ -3,8 +3,10 @@
 #include "can.h"
 #include "FreeRTOS.h"
 #include "cmsis_gcc.h"
+#include "cmsis_os.h"
+#include "task.h"
 #include "dwt.h"
-#include "semphr.h"
+#include "dwt_prof.h"
 #include "stm32f4xx_hal_def.h"
 
 #define LOG_TAG "bsp_can"
@@ -12,53 +14,205 @@
 
 /* 总线管理器实例 */
 static CANBusManager can_bus[] = {
-    {.hcan = NULL, .tx_mutex = NULL },  // CAN1总线
-    {.hcan = NULL, .tx_mutex = NULL },    // CAN2总线
+    {.hcan = NULL},  // CAN1总线
+    {.hcan = NULL},  // CAN2总线
 };
 
+/* rx_id到设备的直接查找表,保存devices数组下标+1,0表示该ID没有注册设备 */
+static uint8_t rx_id_map[2][CAN_STD_ID_NUM];
+
+#if CAN_RX_DEFERRED
+static osThreadId canRxTaskHandle;
+static void CAN_RxTask(const void *parameter);
+#endif
+
 void canbus_init(void) {
     can_bus[0].hcan = &hcan1;
-    can_bus[0].tx_mutex = xSemaphoreCreateBinary();
-    xSemaphoreGive(can_bus[0].tx_mutex);
     HAL_CAN_ActivateNotification(&hcan1, CAN_IT_RX_FIFO0_MSG_PENDING);
     HAL_CAN_ActivateNotification(&hcan1, CAN_IT_RX_FIFO1_MSG_PENDING);
+    HAL_CAN_ActivateNotification(&hcan1, CAN_IT_TX_MAILBOX_EMPTY); // 邮箱空出时从发送队列补充
+    HAL_CAN_ActivateNotification(&hcan1, CAN_IT_ERROR_WARNING | CAN_IT_ERROR_PASSIVE | CAN_IT_BUSOFF | CAN_IT_ERROR);
 
     log_i("CAN1 bus initialized");
 
     can_bus[1].hcan = &hcan2;
-    can_bus[1].tx_mutex = xSemaphoreCreateBinary();
-    xSemaphoreGive(can_bus[1].tx_mutex);
     HAL_CAN_ActivateNotification(&hcan2, CAN_IT_RX_FIFO0_MSG_PENDING);
     HAL_CAN_ActivateNotification(&hcan2, CAN_IT_RX_FIFO1_MSG_PENDING);
+    HAL_CAN_ActivateNotification(&hcan2, CAN_IT_TX_MAILBOX_EMPTY);
+    HAL_CAN_ActivateNotification(&hcan2, CAN_IT_ERROR_WARNING | CAN_IT_ERROR_PASSIVE | CAN_IT_BUSOFF | CAN_IT_ERROR);
     log_i("CAN2 bus initialized");
+
+#if CAN_RX_DEFERRED
+    // 解码任务优先级高于电机控制任务,保证控制任务读到的反馈不会是解码了一半的数据
+    osThreadDef(canRxTask, CAN_RxTask, osPriorityHigh, 0, 256);
+    canRxTaskHandle = osThreadCreate(osThread(canRxTask), NULL);
+    if (canRxTaskHandle == NULL) {
+        log_e("Failed to create CAN rx task");
+    }
+#endif
 }
 
-static void CANAddFilter(Can_Device *device)
+/****************** 过滤器分配 ******************/
+/* 已注册的rx_id被拆分成若干块,每块的ID连续、起始ID按块大小对齐、块大小为2的幂,
+   因此可以用一个掩码精确匹配,不会收到未注册的ID.大小>=4的块用16位掩码模式(每组2个),
+   其余的ID用16位列表模式(每组4个).最坏情况下每条总线需要的组数: */
+_Static_assert(MAX_DEVICES_PER_BUS / 4 + 2 <= CAN_FILTER_BANKS_PER_BUS, "too many CAN devices for filter banks");
+
+#define CAN_FILTER_STD(id)    ((uint32_t)(id) << 5)       // 16位过滤器格式,STID在[15:5],RTR和IDE为0
+#define CAN_FILTER_STD_MASK(size) ((((~((uint32_t)(size) - 1)) & 0x7FF) << 5) | 0x18) // 同时要求RTR和IDE为0
+
+typedef struct {
+    uint16_t base;  // 块的起始ID
+    uint16_t size;  // 块内ID数量
+    uint32_t rate;  // 块内设备预期帧率之和
+    uint8_t fifo;
+} CanFilterBlock_t;
+
+static void CAN_WriteFilterBank(CANBusManager *bus, uint8_t bank, uint32_t mode, uint8_t fifo, const uint16_t regs[4])
 {
-    CAN_FilterTypeDef can_filter_conf;
-    static uint8_t can1_filter_idx = 0, can2_filter_idx = 14; // 0-13给can1用,14-27给can2用
-
-    can_filter_conf.FilterMode = CAN_FILTERMODE_IDLIST;                                                       // 使用id list模式,即只有将rxid添加到过滤器中才会接收到,其他报文会被过滤
-    can_filter_conf.FilterScale = CAN_FILTERSCALE_16BIT;                                                      // 使用16位id模式,即只有低16位有效
-    can_filter_conf.FilterFIFOAssignment = (device->tx_id & 1) ? CAN_RX_FIFO0 : CAN_RX_FIFO1;              // 奇数id的模块会被分配到FIFO0,偶数id的模块会被分配到FIFO1
-    can_filter_conf.SlaveStartFilterBank = 14;                                                                // 从第14个过滤器开始配置从机过滤器(在STM32的BxCAN控制器中CAN2是CAN1的从机)
-    can_filter_conf.FilterIdLow = device->rx_id << 5;                                                      // 过滤器寄存器的低16位,因为使用STDID,所以只有低11位有效,高5位要填0
-    can_filter_conf.FilterBank = device->can_handle == &hcan1 ? (can1_filter_idx++) : (can2_filter_idx++); // 根据can_handle判断是CAN1还是CAN2,然后自增
-    can_filter_conf.FilterActivation = CAN_FILTER_ENABLE;                                                     // 启用过滤器
-
-    HAL_CAN_ConfigFilter(device->can_handle, &can_filter_conf);
+    CAN_FilterTypeDef conf = {
+        .FilterIdLow = regs[0],
+        .FilterIdHigh = regs[1],
+        .FilterMaskIdLow = regs[2],
+        .FilterMaskIdHigh = regs[3],
+        .FilterFIFOAssignment = fifo ? CAN_RX_FIFO1 : CAN_RX_FIFO0,
+        .FilterBank = CAN_BusIndex(bus->hcan) * CAN_FILTER_BANKS_PER_BUS + bank,
+        .FilterMode = mode,
+        .FilterScale = CAN_FILTERSCALE_16BIT,
+        .FilterActivation = CAN_FILTER_ENABLE,
+        .SlaveStartFilterBank = CAN_FILTER_BANKS_PER_BUS, // 在STM32的bxCAN中CAN2是CAN1的从机,过滤器组共用
+    };
+    HAL_CAN_ConfigFilter(bus->hcan, &conf);
 }
 
-static bool check_device_id_conflict(CANBusManager *bus, uint16_t tx_id, uint16_t rx_id) {
-    for(uint8_t i = 0; i < MAX_DEVICES_PER_BUS; i++) {
-        if(bus->devices[i].can_handle != NULL) {  // 使用can_handle判断设备是否存在
-            if(bus->devices[i].rx_id == rx_id) {
-                log_e("Device ID conflict: new(tx:0x%03X, rx:0x%03X) with existing(tx:0x%03X, rx:0x%03X)", 
-                    (unsigned int)tx_id, (unsigned int)rx_id,
-                    (unsigned int)bus->devices[i].tx_id, (unsigned int)bus->devices[i].rx_id);
-                return true;
+/**
+ * @brief 根据总线上所有已注册设备重新分配过滤器组,设备注册和注销时调用
+ *        高帧率的块优先分配,每次放入当前总帧率较低的FIFO,使两个FIFO负载接近,降低溢出的概率
+ */
+static void CAN_RebuildFilters(CANBusManager *bus)
+{
+    uint16_t ids[MAX_DEVICES_PER_BUS];
+    uint32_t rates[MAX_DEVICES_PER_BUS];
+    uint8_t n = 0;
+
+    /* 收集rx_id并按升序插入排序 */
+    for (uint8_t i = 0; i < MAX_DEVICES_PER_BUS; i++) {
+        Can_Device *dev = &bus->devices[i];
+        if (dev->can_handle == NULL) {
+            continue;
+        }
+        uint8_t j = n++;
+        for (; j > 0 && ids[j - 1] > dev->rx_id; j--) {
+            ids[j] = ids[j - 1];
+            rates[j] = rates[j - 1];
+        }
+        ids[j] = dev->rx_id;
+        rates[j] = dev->rx_rate_hz ? dev->rx_rate_hz : CAN_DEFAULT_RX_RATE_HZ;
+    }
+
+    /* 拆分成对齐的连续块,如0x201-0x20B拆为0x201,0x202-0x203,0x204-0x207,0x208-0x20B */
+    CanFilterBlock_t blocks[MAX_DEVICES_PER_BUS];
+    uint8_t block_count = 0;
+    for (uint8_t i = 0; i < n;) {
+        uint16_t size = 1;
+        while (!(ids[i] & (size * 2 - 1)) && i + size * 2 <= n && ids[i + size * 2 - 1] == ids[i] + size * 2 - 1) {
+            size *= 2;
+        }
+        CanFilterBlock_t *blk = &blocks[block_count++];
+        blk->base = ids[i];
+        blk->size = size;
+        blk->rate = 0;
+        for (uint16_t k = 0; k < size; k++) {
+            blk->rate += rates[i + k];
+        }
+        i += size;
+    }
+
+    /* 按帧率从高到低排序后贪心分配FIFO */
+    for (uint8_t i = 1; i < block_count; i++) {
+        CanFilterBlock_t tmp = blocks[i];
+        uint8_t j = i;
+        for (; j > 0 && blocks[j - 1].rate < tmp.rate; j--) {
+            blocks[j] = blocks[j - 1];
+        }
+        blocks[j] = tmp;
+    }
+    uint32_t load[2] = {0, 0};
+    for (uint8_t i = 0; i < block_count; i++) {
+        blocks[i].fifo = load[1] < load[0] ? 1 : 0;
+        load[blocks[i].fifo] += blocks[i].rate;
+    }
+
+    /* 每个FIFO分别打包,列表组不足4个ID、掩码组不足2个块时重复最后一项填充 */
+    uint8_t bank = 0;
+    for (uint8_t fifo = 0; fifo < 2; fifo++) {
+        uint16_t regs[4];
+        uint8_t filled = 0;
+        for (uint8_t i = 0; i < block_count; i++) {
+            if (blocks[i].fifo != fifo || blocks[i].size >= 4) {
+                continue;
+            }
+            for (uint16_t k = 0; k < blocks[i].size; k++) {
+                regs[filled++] = CAN_FILTER_STD(blocks[i].base + k);
+                if (filled == 4) {
+                    CAN_WriteFilterBank(bus, bank++, CAN_FILTERMODE_IDLIST, fifo, regs);
+                    filled = 0;
+                }
             }
         }
+        if (filled) {
+            for (uint8_t k = filled; k < 4; k++) {
+                regs[k] = regs[filled - 1];
+            }
+            CAN_WriteFilterBank(bus, bank++, CAN_FILTERMODE_IDLIST, fifo, regs);
+        }
+
+        // 掩码模式寄存器顺序: IdLow/MaskIdLow为第一对,IdHigh/MaskIdHigh为第二对
+        filled = 0;
+        for (uint8_t i = 0; i < block_count; i++) {
+            if (blocks[i].fifo != fifo || blocks[i].size < 4) {
+                continue;
+            }
+            regs[filled] = CAN_FILTER_STD(blocks[i].base);
+            regs[filled + 2] = CAN_FILTER_STD_MASK(blocks[i].size);
+            if (++filled == 2) {
+                CAN_WriteFilterBank(bus, bank++, CAN_FILTERMODE_IDMASK, fifo, regs);
+                filled = 0;
+            }
+        }
+        if (filled) {
+            regs[1] = regs[0];
+            regs[3] = regs[2];
+            CAN_WriteFilterBank(bus, bank++, CAN_FILTERMODE_IDMASK, fifo, regs);
+        }
+    }
+
+    /* 关闭上一次分配多出来的组 */
+    for (uint8_t i = bank; i < bus->filter_banks_used; i++) {
+        CAN_FilterTypeDef conf = {
+            .FilterBank = CAN_BusIndex(bus->hcan) * CAN_FILTER_BANKS_PER_BUS + i,
+            .FilterMode = CAN_FILTERMODE_IDLIST,
+            .FilterScale = CAN_FILTERSCALE_16BIT,
+            .FilterActivation = CAN_FILTER_DISABLE,
+            .SlaveStartFilterBank = CAN_FILTER_BANKS_PER_BUS,
+        };
+        HAL_CAN_ConfigFilter(bus->hcan, &conf);
+    }
+    bus->filter_banks_used = bank;
+}
+
+static bool check_device_id_conflict(CANBusManager *bus, uint16_t tx_id, uint16_t rx_id) {
+    if (rx_id >= CAN_STD_ID_NUM) {
+        log_e("Device rx_id 0x%03X is not a standard id", (unsigned int)rx_id);
+        return true;
+    }
+    uint8_t slot = rx_id_map[CAN_BusIndex(bus->hcan)][rx_id];
+    if (slot) {
+        Can_Device *dev = &bus->devices[slot - 1];
+        log_e("Device ID conflict: new(tx:0x%03X, rx:0x%03X) with existing(tx:0x%03X, rx:0x%03X)", 
+            (unsigned int)tx_id, (unsigned int)rx_id,
+            (unsigned int)dev->tx_id, (unsigned int)dev->rx_id);
+        return true;
     }
     return false;
 }
@@ -102,7 +256,9 @@ Can_Device* BSP_CAN_Device_Init(Can_Device_Init_Config_s *config) {
             bus->devices[i].rx_id = config->rx_id;
             bus->devices[i].tx_mode = config->tx_mode;
             bus->devices[i].rx_mode = config->rx_mode;
+            bus->devices[i].rx_rate_hz = config->rx_rate_hz;
             bus->devices[i].can_callback = config->can_callback;
+            bus->devices[i].id = config->id;
             
             /* 发送配置初始化 */
             bus->devices[i].txconf.StdId = config->tx_id;
@@ -111,7 +267,8 @@ Can_Device* BSP_CAN_Device_Init(Can_Device_Init_Config_s *config) {
             bus->devices[i].txconf.DLC = 8;
             bus->devices[i].txconf.TransmitGlobalTime = DISABLE;
             
-            CANAddFilter(&bus->devices[i]); // 添加过滤器
+            CAN_RebuildFilters(bus); // 重新打包过滤器,新设备加入后ID块和FIFO分配都可能变化
+            rx_id_map[CAN_BusIndex(bus->hcan)][config->rx_id] = i + 1; // 登记到查找表,中断中直接索引
             
             bus->device_count++;
 
@@ -132,49 +289,133 @@ Can_Device* BSP_CAN_Device_Init(Can_Device_Init_Config_s *config) {
 }
 
 /****************** 发送函数 ******************/
-uint8_t CAN_SendMessage(Can_Device *device, uint8_t len) {
-    uint32_t start_time;
-    uint32_t timeout_cycles = CAN_SEND_TIMEOUT_US * 168; // 168MHz下的周期数
-    uint8_t retry_cnt = CAN_SEND_RETRY_CNT;
-
-    while (retry_cnt--) {
-        start_time = DWT->CYCCNT;
-        // 快速检查邮箱
-        if (HAL_CAN_GetTxMailboxesFreeLevel(device->can_handle) > 0) {
-            device->txconf.DLC = len;
-            HAL_CAN_AddTxMessage(device->can_handle, 
-                                      &device->txconf,
-                                      device->tx_buff,
-                                      &device->tx_mailbox);
+/**
+ * @brief 把队列中的报文按优先级写入空邮箱,调用者需要处于临界区
+ */
+static void CAN_TxDrain(CANBusManager *bus) {
+    uint32_t mailbox;
+    while (bus->tx_stats.queue_len && HAL_CAN_GetTxMailboxesFreeLevel(bus->hcan) > 0) {
+        // 选出priority最小的报文,同优先级选先入队的,保持CAN_SchedFlush()排好的顺序
+        uint8_t best = 0;
+        for (uint8_t i = 1; i < bus->tx_stats.queue_len; i++) {
+            CanTxFrame_t *f = &bus->tx_queue[i], *b = &bus->tx_queue[best];
+            if (f->priority < b->priority || (f->priority == b->priority && (int32_t)(f->seq - b->seq) < 0)) {
+                best = i;
+            }
+        }
+        CanTxFrame_t *frame = &bus->tx_queue[best];
+        CAN_TxHeaderTypeDef header = {
+            .StdId = frame->std_id,
+            .IDE = CAN_ID_STD,
+            .RTR = CAN_RTR_DATA,
+            .DLC = frame->dlc,
+            .TransmitGlobalTime = DISABLE,
+        };
+        if (HAL_CAN_AddTxMessage(bus->hcan, &header, frame->data, &mailbox) != HAL_OK) {
+            break; // 外设状态异常,等下一次发送或中断再试
+        }
+        bus->tx_stats.tx_count++;
+        bus->tx_stats.tx_bytes += frame->dlc;
+        // 队列不要求有序,用最后一个元素填补空位
+        *frame = bus->tx_queue[--bus->tx_stats.queue_len];
+    }
+}
+
+static uint8_t CAN_Enqueue(CAN_HandleTypeDef *hcan, uint32_t std_id, const uint8_t *data, uint8_t len, uint8_t priority,
+                           uint32_t *pTxMailbox) {
+    CANBusManager *bus = &can_bus[CAN_BusIndex(hcan)];
+    uint8_t ret = HAL_OK;
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR(); // 任务和中断中都可能发送,FROM_ISR版本在两者中都可以使用
+
+    if (bus->tx_stats.queue_len == 0 && HAL_CAN_GetTxMailboxesFreeLevel(hcan) > 0) {
+        // 没有排队的报文,直接写入邮箱
+        CAN_TxHeaderTypeDef header = {
+            .StdId = std_id,
+            .IDE = CAN_ID_STD,
+            .RTR = CAN_RTR_DATA,
+            .DLC = len,
+            .TransmitGlobalTime = DISABLE,
+        };
+        uint32_t mailbox;
+        if (HAL_CAN_AddTxMessage(hcan, &header, data, pTxMailbox ? pTxMailbox : &mailbox) == HAL_OK) {
+            bus->tx_stats.tx_count++;
+            bus->tx_stats.tx_bytes += len;
+            taskEXIT_CRITICAL_FROM_ISR(mask);
             return HAL_OK;
         }
-        
-        // 短时等待
-        while ((DWT->CYCCNT - start_time) < timeout_cycles);
     }
-    return HAL_TIMEOUT;
+    if (bus->tx_stats.queue_len >= CAN_TX_QUEUE_LEN) {
+        bus->tx_stats.drop_count++;
+        ret = HAL_BUSY;
+    } else {
+        CanTxFrame_t *frame = &bus->tx_queue[bus->tx_stats.queue_len++];
+        frame->std_id = std_id;
+        frame->seq = bus->tx_seq++;
+        frame->priority = priority;
+        frame->dlc = len;
+        memcpy(frame->data, data, len);
+        if (bus->tx_stats.queue_len > bus->tx_stats.queue_max) {
+            bus->tx_stats.queue_max = bus->tx_stats.queue_len;
+        }
+        CAN_TxDrain(bus); // 排队期间可能已经有邮箱空出
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return ret;
+}
+
+uint8_t CAN_SendMessage(Can_Device *device, uint8_t len) {
+    device->txconf.DLC = len;
+    return CAN_Enqueue(device->can_handle, device->txconf.StdId, device->tx_buff, len, 0, &device->tx_mailbox);
 }
 
 uint8_t CAN_SendMessage_hcan(CAN_HandleTypeDef *hcan, CAN_TxHeaderTypeDef *pHeader,
     const uint8_t aData[], uint32_t *pTxMailbox, uint8_t len) {
-    uint32_t start_time;
-    uint32_t timeout_cycles = CAN_SEND_TIMEOUT_US * 168; // 168MHz下的周期数
-    uint8_t retry_cnt = CAN_SEND_RETRY_CNT;
-
-    while (retry_cnt--) {
-        start_time = DWT->CYCCNT;
-        // 快速检查邮箱
-        if (HAL_CAN_GetTxMailboxesFreeLevel(hcan) > 0) {
-            pHeader->DLC = len;
-            HAL_CAN_AddTxMessage(hcan, pHeader, aData, pTxMailbox);
-            return HAL_OK;
-        }
-        
-        // 短时等待
-        while ((DWT->CYCCNT - start_time) < timeout_cycles);
+    pHeader->DLC = len;
+    return CAN_Enqueue(hcan, pHeader->StdId, aData, len, 0, pTxMailbox);
+}
+
+uint8_t CAN_SendMessage_prio(CAN_HandleTypeDef *hcan, uint32_t std_id, const uint8_t *data, uint8_t len,
+                             uint8_t priority) {
+    return CAN_Enqueue(hcan, std_id, data, len, priority, NULL);
+}
+
+void CAN_GetTxStats(CAN_HandleTypeDef *hcan, CAN_TxStats_t *stats) {
+    *stats = can_bus[CAN_BusIndex(hcan)].tx_stats;
+}
+
+void CAN_GetRxStats(CAN_HandleTypeDef *hcan, CAN_RxStats_t *stats) {
+    *stats = can_bus[CAN_BusIndex(hcan)].rx_stats;
+}
+
+void CAN_GetErrStats(CAN_HandleTypeDef *hcan, CAN_ErrStats_t *stats) {
+    *stats = can_bus[CAN_BusIndex(hcan)].err_stats;
+}
+
+void CAN_ErrorStateSync(CAN_HandleTypeDef *hcan) {
+    CAN_ErrStats_t *stats = &can_bus[CAN_BusIndex(hcan)].err_stats;
+    // 只清除已经退出的状态,新进入的状态留给错误中断计数
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    stats->esr_state &= hcan->Instance->ESR;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+uint8_t CAN_BusRecover(CAN_HandleTypeDef *hcan) {
+    CANBusManager *bus = &can_bus[CAN_BusIndex(hcan)];
+    bus->err_stats.recover_count++;
+    // 邮箱中是离线前的旧报文,直接丢弃
+    HAL_CAN_AbortTxRequest(hcan, CAN_TX_MAILBOX0 | CAN_TX_MAILBOX1 | CAN_TX_MAILBOX2);
+    // 重新进入初始化模式再退出,TEC/REC清零,退出时硬件会等待128次11个隐性位
+    HAL_CAN_Stop(hcan);
+    if (hcan->State == HAL_CAN_STATE_ERROR) {
+        hcan->State = HAL_CAN_STATE_READY; // 上一次恢复超时,HAL会停在ERROR状态,不复位就无法再次启动
+    }
+    uint8_t ret = HAL_CAN_Start(hcan);
+    if (ret == HAL_OK) {
+        UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+        CAN_TxDrain(bus); // 离线期间积压的报文
+        taskEXIT_CRITICAL_FROM_ISR(mask);
     }
-    
-    return HAL_TIMEOUT;
+    return ret;
 }
 
 void BSP_CAN_Device_DeInit(Can_Device *dev) {
@@ -186,9 +427,11 @@ void BSP_CAN_Device_DeInit(Can_Device *dev) {
         for(uint8_t i=0; i<MAX_DEVICES_PER_BUS; i++) {
             // 通过比较内存地址来查找设备
             if(&(can_bus[bus].devices[i]) == dev) {
+                rx_id_map[bus][dev->rx_id] = 0;
                 // 清零设备结构体
                 memset(&can_bus[bus].devices[i], 0, sizeof(Can_Device));
                 can_bus[bus].device_count--;
+                CAN_RebuildFilters(&can_bus[bus]);
                 log_i("CAN device deinitialized: bus=%d, index=%d", bus, i);
                 return;
             }
@@ -198,93 +441,177 @@ void BSP_CAN_Device_DeInit(Can_Device *dev) {
 }
 
 /****************** 中断处理 ******************/
-void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) {
-    static CAN_RxHeaderTypeDef rx_header;
-    static uint8_t data[8];
+/* 邮箱发送完成(或被中止)后,从发送队列补充报文 */
+static void CAN_TxMailboxFreeHandler(CAN_HandleTypeDef *hcan) {
+    PROF_BEGIN(CAN_TX_ISR);
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    CAN_TxDrain(&can_bus[CAN_BusIndex(hcan)]);
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    PROF_END(CAN_TX_ISR);
+}
 
-    while (HAL_CAN_GetRxFifoFillLevel(hcan, CAN_RX_FIFO0)) {
-        if(HAL_CAN_GetRxMessage(hcan, CAN_RX_FIFO0, &rx_header, data) == HAL_OK) {
-            CANBusManager *bus = NULL;
-            for(uint8_t i=0; i<2; i++) {
-                if(can_bus[i].hcan == hcan) {
-                    bus = &can_bus[i];
-                    break;
-                }
-            }
-            if(!bus) return;
-
-            // 遍历设备查找匹配ID
-            for(uint8_t i=0; i<MAX_DEVICES_PER_BUS; i++) {
-                if(bus->devices[i].can_handle != NULL && 
-                   rx_header.StdId == bus->devices[i].rx_id && 
-                   bus->devices[i].can_handle == hcan) 
-                {
-                    __disable_irq();
-                    memcpy(bus->devices[i].rx_buff, data, rx_header.DLC);
-                    bus->devices[i].rx_len = rx_header.DLC;
-                    if(bus->devices[i].can_callback) {
-                        bus->devices[i].can_callback(bus->devices[i].can_handle, rx_header.StdId);
+void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan) { CAN_TxMailboxFreeHandler(hcan); }
+void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan) { CAN_TxMailboxFreeHandler(hcan); }
+void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan) { CAN_TxMailboxFreeHandler(hcan); }
+void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan) { CAN_TxMailboxFreeHandler(hcan); }
+void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan) { CAN_TxMailboxFreeHandler(hcan); }
+void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan) { CAN_TxMailboxFreeHandler(hcan); }
+
+/* 把收到的报文交给设备,调用设备回调 */
+static void CAN_RxDispatch(CANBusManager *bus, uint8_t bus_idx, uint32_t std_id, const uint8_t *data, uint8_t dlc,
+                           uint64_t stamp) {
+    uint8_t slot = rx_id_map[bus_idx][std_id & (CAN_STD_ID_NUM - 1)];
+    if (!slot) {
+        return; // 未注册的ID
+    }
+    Can_Device *device = &bus->devices[slot - 1];
+    memcpy(device->rx_buff, data, dlc);
+    device->rx_len = dlc;
+    device->rx_stamp = stamp;
+    if(device->can_callback) {
+        device->can_callback(device);
+    }
+}
+
+#if CAN_RX_DEFERRED
+/**
+ * @brief 两个FIFO共用的接收中断处理,只打时间戳并放入环形缓冲区,然后通知解码任务
+ */
+static void CAN_RxFifoHandler(CAN_HandleTypeDef *hcan, uint32_t fifo) {
+    CAN_RxHeaderTypeDef rx_header;
+    uint64_t stamp = DWT_GetCycle64(); // 同一次中断取出的报文共用入口时间戳
+    uint32_t enter = (uint32_t)stamp;
+    uint8_t bus_idx = CAN_BusIndex(hcan);
+    CANBusManager *bus = &can_bus[bus_idx];
+    CanRxRing_t *ring = &bus->rx_ring[fifo == CAN_RX_FIFO0 ? 0 : 1];
+
+    while (HAL_CAN_GetRxFifoFillLevel(hcan, fifo)) {
+        uint32_t head = ring->head;
+        CanRxFrame_t *frame = &ring->frames[head & (CAN_RX_RING_LEN - 1)];
+        if (head - ring->tail >= CAN_RX_RING_LEN) {
+            // 缓冲区满,读出报文丢弃,否则FIFO不会被释放
+            uint8_t discard[8];
+            HAL_CAN_GetRxMessage(hcan, fifo, &rx_header, discard);
+            bus->rx_stats.ring_overflow++;
+            continue;
+        }
+        if(HAL_CAN_GetRxMessage(hcan, fifo, &rx_header, frame->data) != HAL_OK || rx_header.IDE != CAN_ID_STD) {
+            continue;
+        }
+        frame->std_id = rx_header.StdId;
+        frame->dlc = rx_header.DLC;
+        frame->stamp = stamp;
+        __DMB(); // 先写完报文再发布head
+        ring->head = head + 1;
+        bus->rx_stats.rx_count++;
+        bus->rx_stats.rx_bytes += rx_header.DLC;
+    }
+
+    BaseType_t woken = pdFALSE;
+    if (canRxTaskHandle) {
+        vTaskNotifyGiveFromISR((TaskHandle_t)canRxTaskHandle, &woken);
+    }
+    uint32_t cost = DWT->CYCCNT - enter;
+    bus->rx_stats.isr_cycles_last = cost;
+    if (cost > bus->rx_stats.isr_cycles_max) {
+        bus->rx_stats.isr_cycles_max = cost;
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief 解码任务,被接收中断唤醒后一次取完所有环形缓冲区中的报文
+ */
+static void CAN_RxTask(const void *parameter) {
+    UNUSED(parameter);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (uint8_t bus_idx = 0; bus_idx < 2; bus_idx++) {
+            CANBusManager *bus = &can_bus[bus_idx];
+            for (uint8_t r = 0; r < 2; r++) {
+                CanRxRing_t *ring = &bus->rx_ring[r];
+                while (ring->tail != ring->head) {
+                    __DMB(); // 先读到head再读报文
+                    CanRxFrame_t *frame = &ring->frames[ring->tail & (CAN_RX_RING_LEN - 1)];
+                    CAN_RxDispatch(bus, bus_idx, frame->std_id, frame->data, frame->dlc, frame->stamp);
+                    uint32_t latency = DWT->CYCCNT - (uint32_t)frame->stamp;
+                    if (latency > bus->rx_stats.latency_cycles_max) {
+                        bus->rx_stats.latency_cycles_max = latency;
                     }
-                    __enable_irq();
+                    ring->tail++;
                 }
             }
         }
     }
 }
-
-void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan) {
+#else
+/**
+ * @brief 两个FIFO共用的接收处理,通过rx_id_map直接找到设备,在中断中调用设备回调
+ */
+static void CAN_RxFifoHandler(CAN_HandleTypeDef *hcan, uint32_t fifo) {
     static CAN_RxHeaderTypeDef rx_header;
     static uint8_t data[8];
+    uint64_t stamp = DWT_GetCycle64();
+    uint32_t enter = (uint32_t)stamp;
+    uint8_t bus_idx = CAN_BusIndex(hcan);
+    CANBusManager *bus = &can_bus[bus_idx];
 
-    while (HAL_CAN_GetRxFifoFillLevel(hcan, CAN_RX_FIFO1)) {
-        if(HAL_CAN_GetRxMessage(hcan, CAN_RX_FIFO1, &rx_header, data) == HAL_OK) {
-            CANBusManager *bus = NULL;
-            for(uint8_t i=0; i<2; i++) {
-                if(can_bus[i].hcan == hcan) {
-                    bus = &can_bus[i];
-                    break;
-                }
-            }
-            if(!bus) return;
-
-            // 遍历设备查找匹配ID
-            for(uint8_t i=0; i<MAX_DEVICES_PER_BUS; i++) {
-                if(bus->devices[i].can_handle != NULL && 
-                   rx_header.StdId == bus->devices[i].rx_id && 
-                   bus->devices[i].can_handle == hcan) 
-                {
-                    __disable_irq();
-                    memcpy(bus->devices[i].rx_buff, data, rx_header.DLC);
-                    bus->devices[i].rx_len = rx_header.DLC;
-                    if(bus->devices[i].can_callback) {
-                        bus->devices[i].can_callback(bus->devices[i].can_handle, rx_header.StdId);
-                    }
-                    __enable_irq();
-            }
-            }
+    while (HAL_CAN_GetRxFifoFillLevel(hcan, fifo)) {
+        if(HAL_CAN_GetRxMessage(hcan, fifo, &rx_header, data) != HAL_OK || rx_header.IDE != CAN_ID_STD) {
+            continue;
         }
+        bus->rx_stats.rx_count++;
+        bus->rx_stats.rx_bytes += rx_header.DLC;
+        __disable_irq();
+        uint32_t off = DWT->CYCCNT;
+        CAN_RxDispatch(bus, bus_idx, rx_header.StdId, data, rx_header.DLC, stamp);
+        off = DWT->CYCCNT - off;
+        __enable_irq();
+        if (off > bus->rx_stats.irq_off_cycles_max) {
+            bus->rx_stats.irq_off_cycles_max = off;
+        }
+    }
+    uint32_t cost = DWT->CYCCNT - enter;
+    bus->rx_stats.isr_cycles_last = cost;
+    if (cost > bus->rx_stats.isr_cycles_max) {
+        bus->rx_stats.isr_cycles_max = cost;
     }
 }
+#endif
 
+void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) {
+    PROF_BEGIN(CAN_RX_ISR);
+    CAN_RxFifoHandler(hcan, CAN_RX_FIFO0);
+    PROF_END(CAN_RX_ISR);
+}
+
+void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan) {
+    PROF_BEGIN(CAN_RX_ISR);
+    CAN_RxFifoHandler(hcan, CAN_RX_FIFO1);
+    PROF_END(CAN_RX_ISR);
+}
 
 
-// 增强错误处理回调
-// void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan)
-// {
-//     uint32_t error_code = HAL_CAN_GetError(hcan);
-    
-//     // 重置错误标志
-//     HAL_CAN_ResetError(hcan);
-    
-//     // 如果是严重错误，执行完整的重启流程
-//     if(error_code) {
-//         HAL_CAN_Stop(hcan);
-//         HAL_CAN_Start(hcan);
-        
-//         // 重新激活所有中断
-//         HAL_CAN_ActivateNotification(hcan, CAN_IT_RX_FIFO0_MSG_PENDING |
-//                                           CAN_IT_RX_FIFO1_MSG_PENDING |
-//                                           CAN_IT_ERROR);
-        
-//     }
-// }
+
+/* 错误状态变化中断,只做统计,恢复由can_monitor模块在任务中限频执行 */
+void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan) {
+    CAN_ErrStats_t *stats = &can_bus[CAN_BusIndex(hcan)].err_stats;
+    uint32_t error_code = HAL_CAN_GetError(hcan);
+    // HAL在每次错误中断时都会报告所有仍然置位的状态,例如进入被动状态时警告状态也还在,
+    // 与上一次记录的ESR状态比较,只统计新进入的状态
+    uint32_t state = hcan->Instance->ESR & (CAN_ESR_EWGF | CAN_ESR_EPVF | CAN_ESR_BOFF);
+    uint32_t entered = state & ~stats->esr_state;
+    stats->esr_state = state;
+
+    if (entered & CAN_ESR_EWGF) {
+        stats->warning_count++;
+    }
+    if (entered & CAN_ESR_EPVF) {
+        stats->passive_count++;
+    }
+    if (entered & CAN_ESR_BOFF) {
+        stats->busoff_count++;
+    }
+    stats->last_error = error_code;
+    HAL_CAN_ResetError(hcan);
+}
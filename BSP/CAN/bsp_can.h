@@ -6,10 +6,29 @@
 #include "semphr.h"
 #include <stdint.h>
 
-#define MAX_DEVICES_PER_BUS  8  // 每总线最大设备数
+#define MAX_DEVICES_PER_BUS  16 // 每总线最大设备数
+#define CAN_FILTER_BANKS_PER_BUS 14 // 每条总线可用的过滤器组数,0-13给CAN1,14-27给CAN2
+#define CAN_DEFAULT_RX_RATE_HZ   1000 // 设备没有给出rx_rate_hz时假定的反馈频率,用于平衡两个FIFO
+#define CAN_STD_ID_NUM       2048 // 标准帧11位ID的数量,用于rx_id到设备的直接查找表
 
-#define CAN_SEND_RETRY_CNT  3        // 重试次数
-#define CAN_SEND_TIMEOUT_US 100 
+#define CAN_TX_QUEUE_LEN    16       // 每条总线发送队列长度,邮箱满时报文在此排队,由发送完成中断取出
+
+/* 1: 接收中断只给报文打时间戳并放入环形缓冲区,由解码任务调用设备回调,中断中不再关中断和做浮点运算
+   0: 在接收中断中直接调用设备回调 */
+#ifndef CAN_RX_DEFERRED
+#define CAN_RX_DEFERRED     1
+#endif
+#define CAN_RX_RING_LEN     32       // 每个FIFO的接收环形缓冲区长度,必须是2的幂
+
+/* 1: 控制类报文经CAN_SchedSend()暂存,每个控制周期由CAN_SchedFlush()统一按优先级发出
+   0: CAN_SchedSend()直接发送 */
+#define CAN_TX_SCHED              1
+#define CAN_SCHED_LEN             16  // 每条总线可调度的报文ID数
+#define CAN_SCHED_FRAMES_PER_TICK 14  // 每个控制周期每条总线最多发出的帧数,1Mbps下2ms内最坏情况(含位填充约135位)可发送的8字节帧数
+#define CAN_SCHED_REFRESH_TICKS   10  // 允许跳过的未变化报文至少每隔这么多个周期重发一次,防止接收端超时
+
+/* CAN_SchedSend()的flags */
+#define CAN_SCHED_SKIP_UNCHANGED  0x01 // 内容与上次发出的相同时可以跳过
 
 /* 接收模式枚举 */
 typedef enum {
@@ -18,7 +37,7 @@ typedef enum {
 } CAN_Mode;
 
 /* CAN设备实例结构体 */
-typedef struct
+typedef struct Can_Device
 {
     CAN_HandleTypeDef *can_handle;  // CAN句柄
     CAN_TxHeaderTypeDef txconf;     // 发送配置
@@ -29,11 +48,14 @@ typedef struct
     uint32_t rx_id;                 // 接收ID
     uint8_t rx_buff[8];             // 接收缓冲区
     uint8_t rx_len;                 // 接收长度
+    uint64_t rx_stamp;              // 收到rx_buff中报文时的64位DWT周期计数,在接收中断入口记录
 
     CAN_Mode tx_mode;
     CAN_Mode rx_mode;
+    uint16_t rx_rate_hz;            // 预期的接收帧率
 
-    void (*can_callback)(const CAN_HandleTypeDef* hcan, const uint32_t rx_id); // 接收回调
+    void (*can_callback)(struct Can_Device *device); // 接收回调,直接传入收到报文的设备
+    void *id;                                         // 使用该设备的模块实例指针,回调中通过它直接找到模块,无需再查找
 } Can_Device;
 
 /* 初始化配置结构体 */
@@ -44,15 +66,90 @@ typedef struct
     uint32_t rx_id;
     CAN_Mode tx_mode;
     CAN_Mode rx_mode;
-    void (*can_callback)(const CAN_HandleTypeDef* hcan, const uint32_t rx_id);
+    uint16_t rx_rate_hz; // 预期的接收帧率,用于把设备分配到负载较低的FIFO,为0时按CAN_DEFAULT_RX_RATE_HZ计算
+    void (*can_callback)(Can_Device *device);
+    void *id; // 使用该设备的模块实例指针,会保存到Can_Device的id中
 } Can_Device_Init_Config_s;
 
+/* 发送队列中的一帧 */
+typedef struct {
+    uint32_t std_id;
+    uint32_t seq;      // 入队序号,同优先级的报文按入队顺序发送
+    uint8_t priority;  // 0最高,CAN_SendMessage()为0,调度发出的报文沿用CAN_SchedSend()的priority
+    uint8_t dlc;
+    uint8_t data[8];
+} CanTxFrame_t;
+
+/* 发送队列统计 */
+typedef struct {
+    uint32_t tx_count;    // 写入邮箱的报文数
+    uint32_t tx_bytes;    // 写入邮箱的数据字节数,用于估算总线负载
+    uint32_t drop_count;  // 队列满被丢弃的报文数
+    uint8_t queue_len;    // 当前排队的报文数
+    uint8_t queue_max;    // 队列长度历史最大值(高水位)
+} CAN_TxStats_t;
+
+/* 接收环形缓冲区中的一帧 */
+typedef struct {
+    uint32_t std_id;
+    uint64_t stamp;    // 进入中断时的64位DWT周期计数
+    uint8_t dlc;
+    uint8_t data[8];
+} CanRxFrame_t;
+
+/* 单生产者(接收中断)单消费者(解码任务)环形缓冲区,head只由中断写,tail只由任务写,无需加锁 */
+typedef struct {
+    CanRxFrame_t frames[CAN_RX_RING_LEN];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} CanRxRing_t;
+
+/* 接收统计,时间单位均为CPU周期,可以用DWT_CycleToUs()换算 */
+typedef struct {
+    uint32_t rx_count;          // 收到的报文数
+    uint32_t rx_bytes;          // 收到的数据字节数,用于估算总线负载
+    uint32_t isr_cycles_last;   // 最近一次接收中断处理耗时
+    uint32_t isr_cycles_max;    // 接收中断处理耗时最大值
+    uint32_t irq_off_cycles_max;// 接收处理中关中断的最长时间
+    uint32_t latency_cycles_max;// 延迟模式下从进入中断到解码完成的最长时间
+    uint32_t ring_overflow;     // 环形缓冲区满被丢弃的报文数
+} CAN_RxStats_t;
+
+/* 错误中断统计,在HAL_CAN_ErrorCallback中累加 */
+typedef struct {
+    uint32_t warning_count;     // 进入错误警告状态(TEC或REC>=96)的次数
+    uint32_t passive_count;     // 进入错误被动状态(TEC或REC>=128)的次数
+    uint32_t busoff_count;      // 进入离线(bus-off)状态的次数
+    uint32_t recover_count;     // 调用CAN_BusRecover()的次数
+    uint32_t last_error;        // 最近一次的HAL错误码
+    uint32_t esr_state;         // 已经计入的状态,ESR中的EWGF/EPVF/BOFF位,只在置位的边沿计数
+} CAN_ErrStats_t;
+
+/* 发送调度统计 */
+typedef struct {
+    uint32_t sent;          // 调度发出的帧数
+    uint32_t skipped;       // 内容未变化被跳过的帧数
+    uint32_t deferred;      // 超出每周期帧数预算被推迟到下一周期的次数
+    uint32_t overwritten;   // 同一周期内被同ID新内容覆盖的帧数
+    uint8_t peak_per_tick;  // 单个周期发出帧数的最大值
+} CAN_SchedStats_t;
+
 /* CAN总线管理结构 */
 typedef struct {
     CAN_HandleTypeDef *hcan;
     Can_Device devices[MAX_DEVICES_PER_BUS];
-    SemaphoreHandle_t tx_mutex;
     uint8_t device_count;
+    uint8_t filter_banks_used; // 当前占用的过滤器组数,重新分配后多余的组需要关闭
+
+    /* 发送队列,不按位置排序,取出时选priority最小、同优先级中最先入队的报文.
+       邮箱按请求顺序发送(TransmitFifoPriority),因此写入邮箱的顺序就是上线的顺序 */
+    CanTxFrame_t tx_queue[CAN_TX_QUEUE_LEN];
+    uint32_t tx_seq;
+    CAN_TxStats_t tx_stats;
+
+    CanRxRing_t rx_ring[2];  // FIFO0和FIFO1各一个
+    CAN_RxStats_t rx_stats;
+    CAN_ErrStats_t err_stats;
 } CANBusManager;
 
 typedef struct
@@ -63,10 +160,96 @@ typedef struct
     uint8_t tx_buff[8];             // 发送缓冲区
 } CanMessage_t;
 
+/* 根据CAN句柄得到总线下标,CAN1为0,CAN2为1 */
+static inline uint8_t CAN_BusIndex(const CAN_HandleTypeDef *hcan)
+{
+    return hcan->Instance == CAN1 ? 0 : 1;
+}
+
 /* 公有函数声明 */
 Can_Device* BSP_CAN_Device_Init(Can_Device_Init_Config_s *config);
+
+/**
+ * @brief 注销设备并重新分配该总线的过滤器,之后该设备的ID不再进入接收中断
+ */
+void BSP_CAN_Device_DeInit(Can_Device *dev);
+
+/**
+ * @brief 发送设备tx_buff中的报文,不会阻塞
+ * @note 有空邮箱且队列为空时直接写入邮箱,否则以最高优先级(0)进入总线发送队列,由发送完成中断按入队顺序写入邮箱
+ *
+ * @return uint8_t HAL_OK已写入邮箱或队列, HAL_BUSY队列已满报文被丢弃
+ */
 uint8_t CAN_SendMessage(Can_Device *device, uint8_t len);
+
+/**
+ * @brief 发送任意报文,不会阻塞,行为同CAN_SendMessage()
+ * @note 报文会被拷贝,返回后aData可以立即修改.pTxMailbox只有直接写入邮箱时才会被更新
+ */
 uint8_t CAN_SendMessage_hcan(CAN_HandleTypeDef *hcan, CAN_TxHeaderTypeDef *pHeader,
     const uint8_t aData[], uint32_t *pTxMailbox,uint8_t len);
 
+/**
+ * @brief 以指定优先级发送任意报文,邮箱满时在发送队列中排在priority更大的报文之前,同优先级按入队顺序
+ * @note 供CAN_SchedFlush()保持调度的顺序,一般的发送请用CAN_SendMessage()
+ */
+uint8_t CAN_SendMessage_prio(CAN_HandleTypeDef *hcan, uint32_t std_id, const uint8_t *data, uint8_t len,
+                             uint8_t priority);
+
+/**
+ * @brief 暂存一帧控制报文,在下一次CAN_SchedFlush()时发出.同一ID在一个周期内多次暂存只发最新的内容
+ * @note 用于每个控制周期都会发送的报文(电机控制、板间通信).模式切换等一次性命令请用CAN_SendMessage(),
+ *       否则可能被同ID的控制报文覆盖
+ *
+ * @param priority 0最高,同优先级中被推迟过的帧和先暂存的帧先发
+ * @param flags CAN_SCHED_SKIP_UNCHANGED等
+ * @return uint8_t HAL_OK成功, HAL_BUSY调度表已满,报文被丢弃
+ */
+uint8_t CAN_SchedSend(Can_Device *device, uint8_t len, uint8_t priority, uint8_t flags);
+
+/**
+ * @brief 同CAN_SchedSend(),发送任意ID
+ */
+uint8_t CAN_SchedSend_hcan(CAN_HandleTypeDef *hcan, uint32_t std_id, const uint8_t *data, uint8_t len,
+                           uint8_t priority, uint8_t flags);
+
+/**
+ * @brief 把本周期暂存的报文按优先级排序后发出,每条总线不超过CAN_SCHED_FRAMES_PER_TICK帧,其余推迟到下一周期
+ * @attention 每个控制周期调用一次,在所有控制报文都生成之后(电机任务末尾)
+ */
+void CAN_SchedFlush(void);
+
+/**
+ * @brief 获取发送调度统计信息
+ */
+void CAN_GetSchedStats(CAN_HandleTypeDef *hcan, CAN_SchedStats_t *stats);
+
+/**
+ * @brief 获取总线发送队列的统计信息
+ */
+void CAN_GetTxStats(CAN_HandleTypeDef *hcan, CAN_TxStats_t *stats);
+
+/**
+ * @brief 获取总线接收统计信息,用于比较CAN_RX_DEFERRED开关前后的中断耗时和关中断时间
+ */
+void CAN_GetRxStats(CAN_HandleTypeDef *hcan, CAN_RxStats_t *stats);
+
+/**
+ * @brief 获取总线错误中断统计信息
+ */
+void CAN_GetErrStats(CAN_HandleTypeDef *hcan, CAN_ErrStats_t *stats);
+
+/**
+ * @brief 错误计数器回落、退出警告/被动/离线状态时硬件不产生中断,由周期任务调用,
+ *        把已经退出的状态从err_stats.esr_state中清掉,之后再次进入时才会被计数
+ */
+void CAN_ErrorStateSync(CAN_HandleTypeDef *hcan);
+
+/**
+ * @brief 重启CAN外设,用于从bus-off状态恢复.只能在任务中调用,会等待总线出现11个连续隐性位
+ *
+ * @return uint8_t HAL_OK恢复成功
+ */
+uint8_t CAN_BusRecover(CAN_HandleTypeDef *hcan);
+
 #endif // BSP_CAN_H
@@ -0,0 +1,191 @@
+/**
+ * @file bsp_can_sched.c
+ * @brief 按控制周期对齐的CAN发送调度
+ *
+ * @note 各任务生成的控制报文先按ID暂存在调度表中,每个控制周期由CAN_SchedFlush()一次性按
+ *       (优先级, 被推迟的周期数, 暂存顺序)排序后发出,两条总线交替写入发送队列.
+ *       报文不再在各任务运行的任意时刻涌入邮箱,命令到上线的延迟被限制在一个周期以内
+ */
+
+#include "bsp_can.h"
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* 调度表中的一项,对应一个报文ID,注册后一直保留,用于比较内容是否变化 */
+typedef struct {
+    CAN_HandleTypeDef *hcan;
+    uint32_t std_id;
+    uint32_t seq;         // 暂存顺序
+    uint8_t dlc;
+    uint8_t data[8];
+    uint8_t priority;
+    uint8_t flags;
+    uint8_t pending;      // 有等待发出的内容
+    uint8_t wait_ticks;   // 因超出帧数预算被推迟的周期数
+    uint8_t idle_ticks;   // 距上一次真正发出经过的周期数,初始为最大值表示从未发出
+    uint8_t sent_dlc;
+    uint8_t sent_data[8]; // 上一次发出的内容
+} CanSchedEntry_t;
+
+typedef struct {
+    CanSchedEntry_t entries[CAN_SCHED_LEN];
+    uint8_t count;
+    uint32_t seq;
+    CAN_SchedStats_t stats;
+} CanSched_t;
+
+static CanSched_t can_sched[2];
+
+static inline CanSched_t *CAN_GetSched(const CAN_HandleTypeDef *hcan)
+{
+    return &can_sched[CAN_BusIndex(hcan)];
+}
+
+uint8_t CAN_SchedSend_hcan(CAN_HandleTypeDef *hcan, uint32_t std_id, const uint8_t *data, uint8_t len,
+                           uint8_t priority, uint8_t flags)
+{
+#if CAN_TX_SCHED
+    CanSched_t *sched = CAN_GetSched(hcan);
+    uint8_t ret = HAL_OK;
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    CanSchedEntry_t *entry = NULL;
+    for (uint8_t i = 0; i < sched->count; i++) {
+        if (sched->entries[i].std_id == std_id) {
+            entry = &sched->entries[i];
+            break;
+        }
+    }
+    if (entry == NULL && sched->count < CAN_SCHED_LEN) {
+        entry = &sched->entries[sched->count++];
+        entry->hcan = hcan;
+        entry->std_id = std_id;
+        entry->idle_ticks = UINT8_MAX;
+    }
+    if (entry == NULL) {
+        ret = HAL_BUSY;
+    } else {
+        if (entry->pending) {
+            sched->stats.overwritten++;
+        } else {
+            entry->seq = sched->seq++;
+        }
+        entry->dlc = len;
+        memcpy(entry->data, data, len);
+        entry->priority = priority;
+        entry->flags = flags;
+        entry->pending = 1;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return ret;
+#else
+    CAN_TxHeaderTypeDef header = {.StdId = std_id, .IDE = CAN_ID_STD, .RTR = CAN_RTR_DATA};
+    uint32_t mailbox;
+    (void)priority;
+    (void)flags;
+    return CAN_SendMessage_hcan(hcan, &header, data, &mailbox, len);
+#endif
+}
+
+uint8_t CAN_SchedSend(Can_Device *device, uint8_t len, uint8_t priority, uint8_t flags)
+{
+    device->txconf.DLC = len;
+    return CAN_SchedSend_hcan(device->can_handle, device->txconf.StdId, device->tx_buff, len, priority, flags);
+}
+
+/* a是否应该排在b之前 */
+static inline uint8_t CAN_SchedBefore(const CanSchedEntry_t *a, const CanSchedEntry_t *b)
+{
+    if (a->priority != b->priority) {
+        return a->priority < b->priority;
+    }
+    if (a->wait_ticks != b->wait_ticks) {
+        return a->wait_ticks > b->wait_ticks;
+    }
+    return (int32_t)(a->seq - b->seq) < 0;
+}
+
+/**
+ * @brief 选出一条总线本周期要发出的报文,调用者需要处于临界区
+ *
+ * @return uint8_t 选出的帧数,内容拷贝到out中
+ */
+static uint8_t CAN_SchedSelect(CanSched_t *sched, CanSchedEntry_t out[CAN_SCHED_FRAMES_PER_TICK])
+{
+    CanSchedEntry_t *order[CAN_SCHED_LEN];
+    uint8_t n = 0;
+
+    for (uint8_t i = 0; i < sched->count; i++) {
+        CanSchedEntry_t *e = &sched->entries[i];
+        if (e->idle_ticks < UINT8_MAX) {
+            e->idle_ticks++;
+        }
+        if (!e->pending) {
+            continue;
+        }
+        if ((e->flags & CAN_SCHED_SKIP_UNCHANGED) && e->idle_ticks < CAN_SCHED_REFRESH_TICKS &&
+            e->dlc == e->sent_dlc && memcmp(e->data, e->sent_data, e->dlc) == 0) {
+            e->pending = 0;
+            sched->stats.skipped++;
+            continue;
+        }
+        // 插入排序,n不超过CAN_SCHED_LEN
+        uint8_t j = n++;
+        for (; j > 0 && CAN_SchedBefore(e, order[j - 1]); j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = e;
+    }
+
+    uint8_t count = n < CAN_SCHED_FRAMES_PER_TICK ? n : CAN_SCHED_FRAMES_PER_TICK;
+    for (uint8_t i = 0; i < count; i++) {
+        CanSchedEntry_t *e = order[i];
+        out[i] = *e;
+        e->sent_dlc = e->dlc;
+        memcpy(e->sent_data, e->data, e->dlc);
+        e->pending = 0;
+        e->wait_ticks = 0;
+        e->idle_ticks = 0;
+    }
+    for (uint8_t i = count; i < n; i++) {
+        if (order[i]->wait_ticks < UINT8_MAX) {
+            order[i]->wait_ticks++;
+        }
+        sched->stats.deferred++;
+    }
+    sched->stats.sent += count;
+    if (count > sched->stats.peak_per_tick) {
+        sched->stats.peak_per_tick = count;
+    }
+    return count;
+}
+
+void CAN_SchedFlush(void)
+{
+#if CAN_TX_SCHED
+    static CanSchedEntry_t out[2][CAN_SCHED_FRAMES_PER_TICK]; // 只在调用CAN_SchedFlush()的任务中使用
+    uint8_t count[2];
+
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    count[0] = CAN_SchedSelect(&can_sched[0], out[0]);
+    count[1] = CAN_SchedSelect(&can_sched[1], out[1]);
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+
+    // 两条总线交替写入,使CAN2不必等CAN1的报文全部入队后才开始发送
+    for (uint8_t i = 0; i < CAN_SCHED_FRAMES_PER_TICK; i++) {
+        for (uint8_t b = 0; b < 2; b++) {
+            if (i >= count[b]) {
+                continue;
+            }
+            // 带上调度的优先级,邮箱满时排队的报文仍按这里的顺序写入邮箱
+            CanSchedEntry_t *e = &out[b][i];
+            CAN_SendMessage_prio(e->hcan, e->std_id, e->data, e->dlc, e->priority);
+        }
+    }
+#endif
+}
+
+void CAN_GetSchedStats(CAN_HandleTypeDef *hcan, CAN_SchedStats_t *stats)
+{
+    *stats = CAN_GetSched(hcan)->stats;
+}
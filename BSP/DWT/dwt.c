@@ -12,33 +12,27 @@
 #include "cmsis_os.h"
 #include "stm32f407xx.h"
 
-static DWT_Time_t SysTime;
+/* CYCCNT每2^31个周期(168MHz下约12.8s)为半圈,CYCCNT_Epoch记录经过的半圈数,最低位与CYCCNT最高位一致时高32位为CYCCNT_Epoch >> 1.
+ * 只有DWT_TimerUpdate()写入,读取方只读一次这个32位变量,不需要关中断,任何中断和任务中都可以调用 */
+static volatile uint32_t CYCCNT_Epoch;
 static uint32_t CPU_FREQ_Hz, CPU_FREQ_Hz_ms, CPU_FREQ_Hz_us;
-static uint32_t CYCCNT_RountCount;
-static uint32_t CYCCNT_LAST;
-static uint64_t CYCCNT64;
+static float CPU_Period_s;             // 1/CPU_FREQ_Hz,用乘法代替除法
+static double CPU_Period_s64;
+static float CPU_Period_ms, CPU_Period_us;
+static uint32_t NS_Per_Cycle_Int;      // 每周期纳秒数的整数部分
+static uint32_t NS_Per_Cycle_Frac;     // 小数部分,Q32
+static uint64_t NS_Per_Wrap;           // 2^32个周期对应的纳秒数
 
 /**
- * @brief 私有函数,用于检查DWT CYCCNT寄存器是否溢出,并更新CYCCNT_RountCount
- * @attention 此函数假设两次调用之间的时间间隔不超过一次溢出
- *
- * @todo 更好的方案是为dwt的时间更新单独设置一个任务?
- *       不过,使用dwt的初衷是定时不被中断/任务等因素影响,因此该实现仍然有其存在的意义
+ * @brief 私有函数,由当前的半圈数和CYCCNT组成64位周期数
+ * @attention 假设距离上一次DWT_TimerUpdate()不超过半圈,最多补一次半圈
  *
  */
-static void DWT_CNT_Update(void)
+static inline uint64_t DWT_Extend(uint32_t epoch, uint32_t cnt)
 {
-    static volatile uint8_t bit_locker = 0;
-    if (!bit_locker)
-    {
-        bit_locker = 1;
-        volatile uint32_t cnt_now = DWT->CYCCNT;
-        if (cnt_now < CYCCNT_LAST)
-            CYCCNT_RountCount++;
-
-        CYCCNT_LAST = DWT->CYCCNT;
-        bit_locker = 0;
-    }
+    if ((epoch ^ (cnt >> 31)) & 1u)
+        epoch++;
+    return ((uint64_t)(epoch >> 1) << 32) | cnt;
 }
 
 void DWT_Init(uint32_t CPU_Freq_mHz)
@@ -55,81 +49,123 @@ void DWT_Init(uint32_t CPU_Freq_mHz)
     CPU_FREQ_Hz = CPU_Freq_mHz * 1000000;
     CPU_FREQ_Hz_ms = CPU_FREQ_Hz / 1000;
     CPU_FREQ_Hz_us = CPU_FREQ_Hz / 1000000;
-    CYCCNT_RountCount = 0;
+    CPU_Period_s = 1.0f / (float)CPU_FREQ_Hz;
+    CPU_Period_s64 = 1.0 / (double)CPU_FREQ_Hz;
+    CPU_Period_ms = 1.0f / (float)CPU_FREQ_Hz_ms;
+    CPU_Period_us = 1.0f / (float)CPU_FREQ_Hz_us;
+    NS_Per_Cycle_Int = 1000000000u / CPU_FREQ_Hz;
+    NS_Per_Cycle_Frac = (uint32_t)((((uint64_t)(1000000000u % CPU_FREQ_Hz)) << 32) / CPU_FREQ_Hz);
+    NS_Per_Wrap = ((1000000000ull << 32) + CPU_FREQ_Hz / 2) / CPU_FREQ_Hz;
+    CYCCNT_Epoch = 0; // 在CYCCNT清零之后,期间TIM14中断推进的半圈数在这里作废
+}
 
-    DWT_CNT_Update();
+void DWT_TimerUpdate(void)
+{
+    uint32_t epoch = CYCCNT_Epoch;
+    if ((epoch ^ (DWT->CYCCNT >> 31)) & 1u)
+        CYCCNT_Epoch = epoch + 1;
 }
 
 float DWT_GetDeltaT(uint32_t *cnt_last)
 {
-    volatile uint32_t cnt_now = DWT->CYCCNT;
-    float dt = ((uint32_t)(cnt_now - *cnt_last)) / ((float)(CPU_FREQ_Hz));
+    uint32_t cnt_now = DWT->CYCCNT;
+    float dt = (uint32_t)(cnt_now - *cnt_last) * CPU_Period_s;
     *cnt_last = cnt_now;
 
-    DWT_CNT_Update();
-
     return dt;
 }
 
 double DWT_GetDeltaT64(uint32_t *cnt_last)
 {
-    volatile uint32_t cnt_now = DWT->CYCCNT;
-    double dt = ((uint32_t)(cnt_now - *cnt_last)) / ((double)(CPU_FREQ_Hz));
+    uint32_t cnt_now = DWT->CYCCNT;
+    double dt = (uint32_t)(cnt_now - *cnt_last) * CPU_Period_s64;
     *cnt_last = cnt_now;
 
-    DWT_CNT_Update();
-
     return dt;
 }
 
-void DWT_SysTimeUpdate(void)
+uint32_t DWT_GetCycle(void)
 {
-    volatile uint32_t cnt_now = DWT->CYCCNT;
-    static uint64_t CNT_TEMP1, CNT_TEMP2, CNT_TEMP3;
+    return DWT->CYCCNT;
+}
 
-    DWT_CNT_Update();
+uint64_t DWT_GetCycle64(void)
+{
+    // 先读epoch再读CYCCNT,两次读取之间被DWT_TimerUpdate()打断时,DWT_Extend按CYCCNT的最高位补上
+    uint32_t epoch = CYCCNT_Epoch;
+    return DWT_Extend(epoch, DWT->CYCCNT);
+}
 
-    CYCCNT64 = (uint64_t)CYCCNT_RountCount * (uint64_t)UINT32_MAX + (uint64_t)cnt_now;
-    CNT_TEMP1 = CYCCNT64 / CPU_FREQ_Hz;
-    CNT_TEMP2 = CYCCNT64 - CNT_TEMP1 * CPU_FREQ_Hz;
-    SysTime.s = CNT_TEMP1;
-    SysTime.ms = CNT_TEMP2 / CPU_FREQ_Hz_ms;
-    CNT_TEMP3 = CNT_TEMP2 - SysTime.ms * CPU_FREQ_Hz_ms;
-    SysTime.us = CNT_TEMP3 / CPU_FREQ_Hz_us;
+uint64_t DWT_CycleToNs(uint64_t cycles)
+{
+    uint32_t lo = (uint32_t)cycles;
+    return (cycles >> 32) * NS_Per_Wrap + (uint64_t)lo * NS_Per_Cycle_Int +
+           (((uint64_t)lo * NS_Per_Cycle_Frac) >> 32);
 }
 
-float DWT_GetTimeline_s(void)
+uint64_t DWT_GetNs(void)
 {
-    DWT_SysTimeUpdate();
+    return DWT_CycleToNs(DWT_GetCycle64());
+}
 
-    float DWT_Timelinef32 = SysTime.s + SysTime.ms * 0.001f + SysTime.us * 0.000001f;
+uint64_t DWT_GetUs(void)
+{
+    return DWT_GetCycle64() / CPU_FREQ_Hz_us;
+}
 
-    return DWT_Timelinef32;
+uint32_t DWT_GetMs(void)
+{
+    return (uint32_t)(DWT_GetCycle64() / CPU_FREQ_Hz_ms);
 }
 
-float DWT_GetTimeline_ms(void)
+float DWT_Cycle64ToMs(uint64_t cycles)
 {
-    DWT_SysTimeUpdate();
+    return (float)cycles * CPU_Period_ms;
+}
 
-    float DWT_Timelinef32 = SysTime.s * 1000 + SysTime.ms + SysTime.us * 0.001f;
+float DWT_CycleToUs(uint32_t cycles)
+{
+    return cycles * CPU_Period_us;
+}
 
-    return DWT_Timelinef32;
+void DWT_SysTimeUpdate(void)
+{
+    DWT_TimerUpdate();
 }
 
-uint64_t DWT_GetTimeline_us(void)
+DWT_Time_t DWT_GetTime(void)
+{
+    uint64_t cycles = DWT_GetCycle64();
+    uint64_t s = cycles / CPU_FREQ_Hz;
+    uint32_t rem = (uint32_t)(cycles - s * CPU_FREQ_Hz);
+    DWT_Time_t t = {
+        .s = (uint32_t)s,
+        .ms = rem / CPU_FREQ_Hz_ms,
+        .us = (rem % CPU_FREQ_Hz_ms) / CPU_FREQ_Hz_us,
+    };
+    return t;
+}
+
+float DWT_GetTimeline_s(void)
 {
-    DWT_SysTimeUpdate();
+    return (float)DWT_GetCycle64() * CPU_Period_s;
+}
 
-    uint64_t DWT_Timelinef32 = SysTime.s * 1000000 + SysTime.ms * 1000 + SysTime.us;
+float DWT_GetTimeline_ms(void)
+{
+    return (float)DWT_GetCycle64() * CPU_Period_ms;
+}
 
-    return DWT_Timelinef32;
+uint64_t DWT_GetTimeline_us(void)
+{
+    return DWT_GetUs();
 }
 
 void DWT_Delay(float Delay)
 {
     uint32_t tickstart = DWT->CYCCNT;
-    float wait = Delay;
+    uint32_t wait = (uint32_t)(Delay * (float)CPU_FREQ_Hz);
 
-    while ((DWT->CYCCNT - tickstart) < wait * (float)CPU_FREQ_Hz)
+    while ((DWT->CYCCNT - tickstart) < wait)
         ;
 }
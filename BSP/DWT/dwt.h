@@ -46,6 +46,71 @@ float DWT_GetDeltaT(uint32_t *cnt_last);
  */
 double DWT_GetDeltaT64(uint32_t *cnt_last);
 
+/**
+ * @brief 获取DWT CYCCNT原始计数值,用于打时间戳,两次之差即为经过的CPU周期数
+ *
+ * @return uint32_t 当前CYCCNT
+ */
+uint32_t DWT_GetCycle(void);
+
+/**
+ * @brief 获取64位CPU周期计数,不会溢出,不关中断,可以在任何中断和任务中调用
+ * @note 用于给跨越较长时间的事件打时间戳,两次之差用DWT_Cycle64ToMs()或DWT_CycleToNs()换算
+ *
+ * @return uint64_t 初始化以来经过的CPU周期数
+ */
+uint64_t DWT_GetCycle64(void);
+
+/**
+ * @brief 推进64位周期计数的高位,在1kHz的HAL时基中断(TIM14)中调用
+ * @attention 两次调用的间隔不能超过CYCCNT的半圈(168MHz下约12.8s)
+ */
+void DWT_TimerUpdate(void);
+
+/**
+ * @brief 将64位CPU周期数换算为纳秒,只用整数乘法
+ *
+ * @param cycles CPU周期数,DWT_GetCycle64()或两次之差
+ * @return uint64_t 时间,单位为纳秒/ns
+ */
+uint64_t DWT_CycleToNs(uint64_t cycles);
+
+/**
+ * @brief 获取初始化以来的时间,单位为纳秒/ns
+ */
+uint64_t DWT_GetNs(void);
+
+/**
+ * @brief 获取初始化以来的时间,单位为微秒/us
+ */
+uint64_t DWT_GetUs(void);
+
+/**
+ * @brief 获取初始化以来的时间,单位为毫秒/ms,约49天溢出
+ */
+uint32_t DWT_GetMs(void);
+
+/**
+ * @brief 将64位CPU周期数换算为毫秒
+ *
+ * @param cycles CPU周期数,通常为两个DWT_GetCycle64()之差
+ * @return float 时间,单位为毫秒/ms
+ */
+float DWT_Cycle64ToMs(uint64_t cycles);
+
+/**
+ * @brief 将CPU周期数换算为微秒
+ *
+ * @param cycles CPU周期数,通常为两个DWT_GetCycle()之差
+ * @return float 时间,单位为微秒/us
+ */
+float DWT_CycleToUs(uint32_t cycles);
+
+/**
+ * @brief 获取初始化以来的时间,拆分为秒、毫秒、微秒
+ */
+DWT_Time_t DWT_GetTime(void);
+
 /**
  * @brief 获取当前时间,单位为秒/s,即初始化后的时间
  *
@@ -77,8 +142,8 @@ uint64_t DWT_GetTimeline_us(void);
 void DWT_Delay(float Delay);
 
 /**
- * @brief DWT更新时间轴函数,会被三个timeline函数调用
- * @attention 如果长时间不调用timeline函数,则需要手动调用该函数更新时间轴,否则CYCCNT溢出后定时和时间轴不准确
+ * @brief 兼容旧接口,等同于DWT_TimerUpdate()
+ * @note 时间轴由TIM14中断推进,不再需要手动调用
  */
 void DWT_SysTimeUpdate(void);
 
@@ -0,0 +1,177 @@
+#include "dwt_prof.h"
+
+#if DWT_PROF_ENABLE
+
+#include <string.h>
+#include "cmsis_os.h"
+#include "stm32f4xx.h"
+#include "SEGGER_RTT.h"
+
+#define LOG_TAG "dwt_prof"
+#include "elog.h"
+
+static const char *const prof_site_name[PROF_SITE_COUNT] = {
+#define PROF_SITE_NAME(id, name) name,
+    DWT_PROF_SITE_TABLE(PROF_SITE_NAME)
+#undef PROF_SITE_NAME
+};
+
+static DWT_Prof_Stat_t prof_stat[PROF_SITE_COUNT];
+static uint32_t prof_overhead;      // 一对PROF_BEGIN/PROF_END本身测到的周期数
+static uint32_t prof_reset_ms;      // 上一次清零的时刻
+static osThreadId prof_task_handle;
+static char prof_up_buffer[2048];   // 直方图全部非零时一行约1.4KB
+
+/* 桶序号: 小于2^(SUB_BITS+1)的值每个值一个桶,之后每个2倍区间按最高位后面的SUB_BITS位分桶 */
+static inline uint32_t DWT_ProfBucket(uint32_t cycles)
+{
+    uint32_t msb = 31u - __CLZ(cycles | 1u);
+    uint32_t idx;
+    if (msb <= DWT_PROF_SUB_BITS)
+        idx = cycles;
+    else
+        idx = ((msb - DWT_PROF_SUB_BITS) << DWT_PROF_SUB_BITS) + (cycles >> (msb - DWT_PROF_SUB_BITS));
+    return idx < DWT_PROF_BUCKETS ? idx : DWT_PROF_BUCKETS - 1;
+}
+
+void DWT_ProfRecord(DWT_Prof_Site_e site, uint32_t cycles)
+{
+    DWT_Prof_Stat_t *stat = &prof_stat[site];
+    uint32_t bucket = DWT_ProfBucket(cycles);
+    // 同一个测量点可能同时在不同优先级的任务和中断中,关中断保证几个字段一起更新,约20个周期
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (stat->count == 0 || cycles < stat->min)
+        stat->min = cycles;
+    if (cycles > stat->max)
+        stat->max = cycles;
+    stat->count++;
+    stat->sum += cycles;
+    stat->hist[bucket]++;
+    __set_PRIMASK(primask);
+}
+
+void DWT_ProfGet(DWT_Prof_Site_e site, DWT_Prof_Stat_t *stat)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stat = prof_stat[site];
+    __set_PRIMASK(primask);
+}
+
+void DWT_ProfReset(void)
+{
+    for (uint8_t i = 0; i < PROF_SITE_COUNT; i++)
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        memset(&prof_stat[i], 0, sizeof(prof_stat[i]));
+        __set_PRIMASK(primask);
+    }
+    prof_reset_ms = DWT_GetMs();
+}
+
+/* 等待主机取走RTT缓冲区中的数据,每次只写一行,避免写满时丢掉半行;主机没有连接时放弃这次输出 */
+static uint8_t DWT_ProfWaitEmpty(void)
+{
+    for (uint8_t i = 0; i < 50; i++)
+    {
+        if (SEGGER_RTT_GetAvailWriteSpace(DWT_PROF_RTT_CHANNEL) >= sizeof(prof_up_buffer) - 1)
+            return 1;
+        osDelay(2);
+    }
+    return 0;
+}
+
+/**
+ * @brief 输出一次统计,格式为文本行,由prof_view.py解析:
+ *        #prof mhz=<> overhead=<> window_ms=<> sites=<>
+ *        site=<名称> count=<> min=<> max=<> mean=<> hist=<桶>:<次数>,...
+ *        #end
+ */
+static void DWT_ProfDump(void)
+{
+    static DWT_Prof_Stat_t stat;
+
+    if (!DWT_ProfWaitEmpty())
+        return;
+    SEGGER_RTT_printf(DWT_PROF_RTT_CHANNEL, "#prof mhz=%u overhead=%u window_ms=%u sites=%u\r\n",
+                      (unsigned)(SystemCoreClock / 1000000u), (unsigned)prof_overhead,
+                      (unsigned)(DWT_GetMs() - prof_reset_ms), PROF_SITE_COUNT);
+    for (uint8_t i = 0; i < PROF_SITE_COUNT; i++)
+    {
+        DWT_ProfGet((DWT_Prof_Site_e)i, &stat);
+        if (!DWT_ProfWaitEmpty())
+            return;
+        SEGGER_RTT_printf(DWT_PROF_RTT_CHANNEL, "site=%s count=%u min=%u max=%u mean=%u hist=", prof_site_name[i],
+                          (unsigned)stat.count, (unsigned)stat.min, (unsigned)stat.max,
+                          (unsigned)(stat.count ? stat.sum / stat.count : 0));
+        uint8_t first = 1;
+        for (uint8_t b = 0; b < DWT_PROF_BUCKETS; b++)
+        {
+            if (stat.hist[b] == 0)
+                continue;
+            SEGGER_RTT_printf(DWT_PROF_RTT_CHANNEL, first ? "%u:%u" : ",%u:%u", b, (unsigned)stat.hist[b]);
+            first = 0;
+        }
+        SEGGER_RTT_WriteString(DWT_PROF_RTT_CHANNEL, "\r\n");
+    }
+    SEGGER_RTT_WriteString(DWT_PROF_RTT_CHANNEL, "#end\r\n");
+}
+
+static void DWT_ProfTask(const void *argument)
+{
+    static char down_buffer[16];
+    uint8_t stream = 0;
+    uint32_t last_stream = osKernelSysTick();
+    char tmp[16];
+    (void)argument;
+
+    SEGGER_RTT_ConfigUpBuffer(DWT_PROF_RTT_CHANNEL, "prof", prof_up_buffer, sizeof(prof_up_buffer),
+                              SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    SEGGER_RTT_ConfigDownBuffer(DWT_PROF_RTT_CHANNEL, "prof", down_buffer, sizeof(down_buffer),
+                                SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    for (;;)
+    {
+        unsigned n = SEGGER_RTT_Read(DWT_PROF_RTT_CHANNEL, tmp, sizeof(tmp));
+        if (n > 0)
+        {
+            if (memchr(tmp, 's', n))
+                stream = !stream;
+            DWT_ProfDump();
+            if (memchr(tmp, 'r', n))
+                DWT_ProfReset();
+        }
+        if (stream && osKernelSysTick() - last_stream >= DWT_PROF_STREAM_MS)
+        {
+            last_stream = osKernelSysTick();
+            DWT_ProfDump();
+        }
+        osDelay(100);
+    }
+}
+
+void DWT_ProfInit(void)
+{
+    uint32_t overhead = UINT32_MAX;
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        PROF_BEGIN(OVERHEAD);
+        uint32_t cycles = DWT_GetCycle() - prof_start_OVERHEAD;
+        if (cycles < overhead)
+            overhead = cycles;
+    }
+    prof_overhead = overhead;
+    DWT_ProfReset();
+
+    osThreadDef(profTask, DWT_ProfTask, osPriorityLow, 0, 256);
+    prof_task_handle = osThreadCreate(osThread(profTask), NULL);
+    if (prof_task_handle == NULL)
+    {
+        log_e("Failed to create profiler task");
+        return;
+    }
+    log_i("profiler enabled, %u sites, overhead %u cycles", PROF_SITE_COUNT, (unsigned)prof_overhead);
+}
+
+#endif // DWT_PROF_ENABLE
@@ -0,0 +1,90 @@
+/**
+ * @file dwt_prof.h
+ * @brief 基于DWT CYCCNT的热点代码周期统计,每个测量点记录调用次数、最小/最大/平均值和对数直方图
+ *
+ * @note 用法: 在DWT_PROF_SITE_TABLE中加一行,然后在代码中成对使用
+ *           PROF_BEGIN(DJI_MOTOR_CONTROL);
+ *           ...
+ *           PROF_END(DJI_MOTOR_CONTROL);
+ *       两者必须在同一个作用域中,中间的代码被中断打断时中断的耗时也会计入.
+ *       DWT_PROF_ENABLE为0时宏展开为空,不占用内存和时间.
+ * @note 直方图每个2倍区间分为4个桶,分辨率约25%,主机端根据直方图计算p50/p90/p99.
+ *       统计通过RTT通道DWT_PROF_RTT_CHANNEL输出:下行发送's'开关周期输出,'r'输出后清零,其他字符输出一次,
+ *       主机端用tools/profiler/prof_view.py显示
+ */
+
+#ifndef __DWT_PROF_H
+#define __DWT_PROF_H
+
+#include <stdint.h>
+#include "dwt.h"
+
+#ifndef DWT_PROF_ENABLE
+#define DWT_PROF_ENABLE         0       // 1开启统计,也可以在编译选项中定义
+#endif
+
+#define DWT_PROF_RTT_CHANNEL    4       // 0为日志,1为message_center,2为can_monitor,3为黑匣子
+#define DWT_PROF_STREAM_MS      1000    // 周期输出的间隔
+#define DWT_PROF_SUB_BITS       2       // 每个2倍区间分为2^DWT_PROF_SUB_BITS个桶
+#define DWT_PROF_BUCKETS        96      // 最后一个桶包含2^25周期(168MHz下约200ms)以上的所有值
+
+/**
+ * @note 每一项为 X(测量点枚举, 显示名),枚举名加上PROF_前缀
+ */
+#define DWT_PROF_SITE_TABLE(X)                          \
+    X(DJI_MOTOR_CONTROL, "DJIMotorControl")             \
+    X(PID_CALCULATE, "PIDCalculate")                    \
+    X(QEKF_UPDATE, "IMU_QuaternionEKF_Update")          \
+    X(JUDGE_READ_DATA, "JudgeReadData")                 \
+    X(CAN_RX_ISR, "CAN rx isr")                         \
+    X(CAN_TX_ISR, "CAN tx isr")
+
+typedef enum
+{
+#define PROF_SITE_ENUM(id, name) PROF_##id,
+    DWT_PROF_SITE_TABLE(PROF_SITE_ENUM)
+#undef PROF_SITE_ENUM
+    PROF_SITE_COUNT, // 测量点数量
+} DWT_Prof_Site_e;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;               // 单位均为CPU周期
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist[DWT_PROF_BUCKETS];
+} DWT_Prof_Stat_t;
+
+#if DWT_PROF_ENABLE
+
+#define PROF_BEGIN(id) uint32_t prof_start_##id = DWT_GetCycle()
+#define PROF_END(id) DWT_ProfRecord(PROF_##id, DWT_GetCycle() - prof_start_##id)
+
+/**
+ * @brief 测量自身开销并创建输出任务,需要在DWT_Init之后调用
+ */
+void DWT_ProfInit(void);
+
+/**
+ * @brief 记录一次耗时,可以在中断中调用,通常通过PROF_END调用
+ */
+void DWT_ProfRecord(DWT_Prof_Site_e site, uint32_t cycles);
+
+/**
+ * @brief 拷贝一个测量点的统计,拷贝期间关中断
+ */
+void DWT_ProfGet(DWT_Prof_Site_e site, DWT_Prof_Stat_t *stat);
+
+void DWT_ProfReset(void);
+
+#else
+
+#define PROF_BEGIN(id) ((void)0)
+#define PROF_END(id) ((void)0)
+
+static inline void DWT_ProfInit(void) {}
+
+#endif // DWT_PROF_ENABLE
+
+#endif // !__DWT_PROF_H
@@ -0,0 +1,45 @@
+#include "bsp_gpio.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define LOG_TAG "bsp_gpio"
+#include "elog.h"
+
+typedef struct {
+    GPIO_EXTI_Callback callback;
+    void *arg;
+} GPIO_EXTI_Handler_t;
+
+static GPIO_EXTI_Handler_t exti_handlers[BSP_GPIO_EXTI_LINE_NUM];
+
+uint8_t BSP_GPIO_EXTI_Register(uint16_t pin, GPIO_EXTI_Callback callback, void *arg)
+{
+    if (pin == 0 || (pin & (pin - 1)) != 0) {
+        log_e("EXTI register needs a single pin: 0x%04x", pin);
+        return 0;
+    }
+    GPIO_EXTI_Handler_t *handler = &exti_handlers[__builtin_ctz(pin)];
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR(); // 调度器启动前后都可以注册
+    uint8_t ok = callback == NULL || handler->callback == NULL || handler->callback == callback;
+    if (ok) {
+        handler->callback = callback;
+        handler->arg = arg;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    if (!ok) {
+        log_e("EXTI line %d already in use", __builtin_ctz(pin));
+    }
+    return ok;
+}
+
+/* 覆盖HAL中的弱定义,所有引脚的外部中断都从这里分发 */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    if (GPIO_Pin == 0) {
+        return;
+    }
+    GPIO_EXTI_Handler_t *handler = &exti_handlers[__builtin_ctz(GPIO_Pin)];
+    if (handler->callback) {
+        handler->callback(GPIO_Pin, handler->arg);
+    }
+}
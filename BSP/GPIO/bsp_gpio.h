@@ -0,0 +1,23 @@
+#ifndef __BSP_GPIO_H__
+#define __BSP_GPIO_H__
+
+#include "stm32f4xx_hal.h"
+#include <stdint.h>
+
+#define BSP_GPIO_EXTI_LINE_NUM 16 // EXTI0~EXTI15,同一编号的引脚在各端口之间共用一条中断线
+
+/* EXTI回调,在中断中调用,pin为触发的引脚 */
+typedef void (*GPIO_EXTI_Callback)(uint16_t pin, void *arg);
+
+/**
+ * @brief 注册一个引脚的外部中断回调,HAL_GPIO_EXTI_Callback由本模块统一定义并按引脚分发
+ * @note 引脚的触发方式和NVIC优先级仍在CubeMX(Src/gpio.c)中配置.注册之前该引脚的中断被忽略
+ *
+ * @param pin 单个引脚,如GPIO_PIN_4
+ * @param callback 回调,为NULL时注销
+ * @param arg 原样传给回调
+ * @return uint8_t 1成功, 0引脚无效或该中断线已被其他回调占用
+ */
+uint8_t BSP_GPIO_EXTI_Register(uint16_t pin, GPIO_EXTI_Callback callback, void *arg);
+
+#endif /* __BSP_GPIO_H__ */
@@ -105,161 +105,304 @@ void SPI_DeviceUnRegister(const SPI_DeviceInstance_t* dev)
 }
 
 
+/* 异步传输队列,以下函数需要在临界区中调用 */
+
+// 启动一次异步传输
+static HAL_StatusTypeDef SPI_XferStart(SPI_Bus_t* bus, SPI_Transfer_t* xfer)
+{
+    SPI_DeviceInstance_t* dev = xfer->dev;
+    HAL_StatusTypeDef ret;
+
+    HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
+    bus->active_dev = dev;
+    bus->active_xfer = xfer;
+    if (xfer->rx_data == NULL) {
+        ret = HAL_SPI_Transmit_DMA(bus->hspi, (uint8_t *)xfer->tx_data, xfer->size);
+    } else if (xfer->tx_data == NULL) {
+        ret = HAL_SPI_Receive_DMA(bus->hspi, xfer->rx_data, xfer->size);
+    } else {
+        ret = HAL_SPI_TransmitReceive_DMA(bus->hspi, (uint8_t *)xfer->tx_data, xfer->rx_data, xfer->size);
+    }
+    if (ret != HAL_OK) {
+        bus->active_dev = NULL;
+        bus->active_xfer = NULL;
+        HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+    }
+    return ret;
+}
+
+/**
+ * @brief 总线空闲时从队列中取出下一次传输并启动
+ *
+ * @return SPI_Transfer_t* 启动失败的传输,需要在退出临界区后调用其回调;没有则为NULL
+ */
+static SPI_Transfer_t* SPI_QueueKick(SPI_Bus_t* bus)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if (bus->active_xfer || bus->queue_count == 0) {
+        return NULL;
+    }
+    // 阻塞传输正在占用总线时不启动,等它释放总线后再启动
+    if (xSemaphoreTakeFromISR(bus->mutex, &xHigherPriorityTaskWoken) != pdTRUE) {
+        return NULL;
+    }
+    SPI_Transfer_t* xfer = bus->queue[bus->queue_head];
+    bus->queue_head = (bus->queue_head + 1) % BSP_SPI_XFER_QUEUE_LEN;
+    bus->queue_count--;
+    if (SPI_XferStart(bus, xfer) != HAL_OK) {
+        bus->stats.errors++;
+        xSemaphoreGiveFromISR(bus->mutex, &xHigherPriorityTaskWoken);
+        return xfer;
+    }
+    return NULL;
+}
+
+// 在队列中启动下一次传输,启动失败的依次回调并继续尝试后面的
+static void SPI_QueueRun(SPI_Bus_t* bus)
+{
+    SPI_Transfer_t* failed;
+    do {
+        UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+        failed = SPI_QueueKick(bus);
+        taskEXIT_CRITICAL_FROM_ISR(mask);
+        if (failed && failed->callback) {
+            failed->callback(failed, HAL_ERROR);
+        }
+    } while (failed);
+}
+
+// 在任务中释放阻塞传输占用的总线,队列中有等待的异步传输时接着启动
+static void SPI_BusUnlock(SPI_Bus_t* bus)
+{
+    bus->active_dev = NULL;
+    xSemaphoreGive(bus->mutex);
+    SPI_QueueRun(bus);
+}
+
+HAL_StatusTypeDef BSP_SPI_Submit(SPI_Transfer_t* xfer)
+{
+    if (!xfer || !xfer->dev || xfer->size == 0 || (!xfer->tx_data && !xfer->rx_data)) {
+        return HAL_ERROR;
+    }
+    SPI_Bus_t* bus = &spi_bus_pool[xfer->dev->target_bus];
+    if (bus->mutex == NULL) {
+        return HAL_ERROR;
+    }
+
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    if (bus->queue_count == BSP_SPI_XFER_QUEUE_LEN) {
+        bus->stats.queue_full++;
+        taskEXIT_CRITICAL_FROM_ISR(mask);
+        return HAL_BUSY;
+    }
+    bus->queue[(bus->queue_head + bus->queue_count) % BSP_SPI_XFER_QUEUE_LEN] = xfer;
+    bus->queue_count++;
+    bus->stats.submitted++;
+    if (bus->queue_count > bus->stats.max_depth) {
+        bus->stats.max_depth = bus->queue_count;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+
+    SPI_QueueRun(bus);
+    return HAL_OK;
+}
+
+void BSP_SPI_GetBusStats(SPI_BusType bus, SPI_BusStats_t* stats)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    *stats = spi_bus_pool[bus].stats;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
 // 数据传输封装
-void BSP_SPI_TransReceive(SPI_DeviceInstance_t* dev, const uint8_t* tx_data, uint8_t* rx_data, const uint16_t size)
+HAL_StatusTypeDef BSP_SPI_TransReceive(SPI_DeviceInstance_t* dev, const uint8_t* tx_data, uint8_t* rx_data, const uint16_t size)
 {
-    SPI_HandleTypeDef* hspi = spi_bus_pool[dev->target_bus].hspi;
+    SPI_Bus_t* bus = &spi_bus_pool[dev->target_bus];
+    HAL_StatusTypeDef status;
 
-    if(xSemaphoreTake(spi_bus_pool[dev->target_bus].mutex, 100) != pdTRUE) {return;}
+    if(xSemaphoreTake(bus->mutex, 100) != pdTRUE) {return HAL_TIMEOUT;}
 
     HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
-    spi_bus_pool[dev->target_bus].active_dev = dev;
+    bus->active_dev = dev;
 
     if (dev->tx_mode == BSP_SPI_MODE_DMA && dev->rx_mode == BSP_SPI_MODE_DMA) {
-        HAL_SPI_TransmitReceive_DMA(hspi, tx_data, rx_data, size);
+        status = HAL_SPI_TransmitReceive_DMA(bus->hspi, (uint8_t *)tx_data, rx_data, size);
     }
     else if (dev->tx_mode == BSP_SPI_MODE_IT && dev->rx_mode == BSP_SPI_MODE_IT) {
-        HAL_SPI_TransmitReceive_IT(hspi, tx_data, rx_data, size);
+        status = HAL_SPI_TransmitReceive_IT(bus->hspi, (uint8_t *)tx_data, rx_data, size);
     }
     else {
-        HAL_SPI_TransmitReceive(hspi, tx_data, rx_data, size,1000);
-        xSemaphoreGive(spi_bus_pool[dev->target_bus].mutex);
-        spi_bus_pool[dev->target_bus].active_dev = NULL;
+        status = HAL_SPI_TransmitReceive(bus->hspi, (uint8_t *)tx_data, rx_data, size,1000);
         HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+        SPI_BusUnlock(bus);
+        return status;
     }
+    if (status != HAL_OK) {
+        HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+        SPI_BusUnlock(bus);
+    }
+    return status;
 }
 
-void BSP_SPI_Transmit(SPI_DeviceInstance_t* dev, const uint8_t* tx_data,uint16_t size)
+HAL_StatusTypeDef BSP_SPI_Transmit(SPI_DeviceInstance_t* dev, const uint8_t* tx_data,uint16_t size)
 {
-    SPI_HandleTypeDef* hspi = spi_bus_pool[dev->target_bus].hspi;
+    SPI_Bus_t* bus = &spi_bus_pool[dev->target_bus];
+    HAL_StatusTypeDef status;
 
-    if(xSemaphoreTake(spi_bus_pool[dev->target_bus].mutex, 100) != pdTRUE) {return;}
+    if(xSemaphoreTake(bus->mutex, 100) != pdTRUE) {return HAL_TIMEOUT;}
 
     HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
-    spi_bus_pool[dev->target_bus].active_dev = dev;
+    bus->active_dev = dev;
 
     if (dev->tx_mode == BSP_SPI_MODE_DMA) {
-        HAL_SPI_Transmit_DMA(hspi, tx_data, size);
+        status = HAL_SPI_Transmit_DMA(bus->hspi, (uint8_t *)tx_data, size);
     }
     else if (dev->tx_mode == BSP_SPI_MODE_IT) {
-        HAL_SPI_Transmit_IT(hspi, tx_data, size);
+        status = HAL_SPI_Transmit_IT(bus->hspi, (uint8_t *)tx_data, size);
     }
     else {
-        HAL_SPI_Transmit(hspi, tx_data, size,1000);
-        xSemaphoreGive(spi_bus_pool[dev->target_bus].mutex);
-        spi_bus_pool[dev->target_bus].active_dev = NULL;
+        status = HAL_SPI_Transmit(bus->hspi, (uint8_t *)tx_data, size,1000);
         HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+        SPI_BusUnlock(bus);
+        return status;
     }
+    if (status != HAL_OK) {
+        HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+        SPI_BusUnlock(bus);
+    }
+    return status;
 }
 
-void BSP_SPI_Receive(SPI_DeviceInstance_t* dev,uint8_t* rx_data,uint16_t size)
+HAL_StatusTypeDef BSP_SPI_Receive(SPI_DeviceInstance_t* dev,uint8_t* rx_data,uint16_t size)
 {
     if (!dev || !dev->cs_port  || !rx_data) {
-        return;
+        return HAL_ERROR;
     }
-    SPI_HandleTypeDef* hspi = spi_bus_pool[dev->target_bus].hspi;
+    SPI_Bus_t* bus = &spi_bus_pool[dev->target_bus];
+    HAL_StatusTypeDef status;
 
-    if(xSemaphoreTake(spi_bus_pool[dev->target_bus].mutex, 100) != pdTRUE) {return;}
+    if(xSemaphoreTake(bus->mutex, 100) != pdTRUE) {return HAL_TIMEOUT;}
 
     HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
-    spi_bus_pool[dev->target_bus].active_dev = dev;
+    bus->active_dev = dev;
 
     if (dev->tx_mode == BSP_SPI_MODE_DMA) {
-        HAL_SPI_Receive_DMA(hspi, rx_data, size);
+        status = HAL_SPI_Receive_DMA(bus->hspi, rx_data, size);
     }
     else if (dev->tx_mode == BSP_SPI_MODE_IT) {
-        HAL_SPI_Receive_IT(hspi, rx_data, size);
+        status = HAL_SPI_Receive_IT(bus->hspi, rx_data, size);
     }
     else {
-        HAL_SPI_Receive(hspi, rx_data, size,1000);
-        xSemaphoreGive(spi_bus_pool[dev->target_bus].mutex);
-        spi_bus_pool[dev->target_bus].active_dev = NULL;
+        status = HAL_SPI_Receive(bus->hspi, rx_data, size,1000);
         HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+        SPI_BusUnlock(bus);
+        return status;
     }
+    if (status != HAL_OK) {
+        HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+        SPI_BusUnlock(bus);
+    }
+    return status;
 }
 
 HAL_StatusTypeDef BSP_SPI_TransAndTrans(SPI_DeviceInstance_t* dev, const uint8_t* tx_data1, uint16_t size1, const uint8_t* tx_data2, uint16_t size2)
 {
-    SPI_HandleTypeDef* hspi = spi_bus_pool[dev->target_bus].hspi;
+    SPI_Bus_t* bus = &spi_bus_pool[dev->target_bus];
     HAL_StatusTypeDef status = HAL_OK;
 
     // 获取总线锁
-    if(xSemaphoreTake(spi_bus_pool[dev->target_bus].mutex, dev->timeout) != pdTRUE) {
+    if(xSemaphoreTake(bus->mutex, dev->timeout) != pdTRUE) {
         return HAL_TIMEOUT;
     }
 
     HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_RESET);
-    spi_bus_pool[dev->target_bus].active_dev = dev;
+    bus->active_dev = dev;
 
     // 阻塞模式连续传输
     do {
         // 第一次传输
-        if((status = HAL_SPI_Transmit(hspi, tx_data1, size1, dev->timeout)) != HAL_OK) break;
+        if((status = HAL_SPI_Transmit(bus->hspi, (uint8_t *)tx_data1, size1, dev->timeout)) != HAL_OK) break;
         // 第二次传输
-        status = HAL_SPI_Transmit(hspi, tx_data2, size2, dev->timeout);
+        status = HAL_SPI_Transmit(bus->hspi, (uint8_t *)tx_data2, size2, dev->timeout);
     } while(0);
 
     // 无论成功与否都要恢复CS和释放锁
     HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
-    xSemaphoreGive(spi_bus_pool[dev->target_bus].mutex);
-    spi_bus_pool[dev->target_bus].active_dev = NULL;
+    SPI_BusUnlock(bus);
 
     return status;
 }
 
-
-// 中断部分处理
-
-//这里是HAL_SPI_TransmitReceive_it/dma回调
-void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+/**
+ * @brief 传输结束或出错的中断中释放总线
+ * @note 先启动队列中的下一次传输,再调用本次传输的回调,使相邻两次传输之间只隔中断处理的时间
+ */
+static void SPI_BusRelease_FromISR(SPI_Bus_t* bus, HAL_StatusTypeDef status)
 {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    SPI_DeviceInstance_t* dev = bus->active_dev;
+    SPI_Transfer_t* xfer = bus->active_xfer;
+    if (dev) {
+        HAL_GPIO_WritePin(dev->cs_port, dev->cs_pin, GPIO_PIN_SET);
+    }
+    // 清除活动设备记录
+    bus->active_dev = NULL;
+    bus->active_xfer = NULL;
+    if (xfer) {
+        if (status == HAL_OK) {
+            bus->stats.completed++;
+        } else {
+            bus->stats.errors++;
+        }
+    }
+    xSemaphoreGiveFromISR(bus->mutex,&xHigherPriorityTaskWoken);
+    SPI_QueueRun(bus);
 
-    for (int i = 0; i < SPI_BUS_MAX; ++i)
-    {
-        if (spi_bus_pool[i].mutex && spi_bus_pool[i].hspi == hspi)
-        {
-            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-            xSemaphoreGiveFromISR(spi_bus_pool[i].mutex,&xHigherPriorityTaskWoken);
-            HAL_GPIO_WritePin(spi_bus_pool[i].active_dev->cs_port, spi_bus_pool[i].active_dev->cs_pin, GPIO_PIN_SET);
-            // 清除活动设备记录
-            spi_bus_pool[i].active_dev = NULL;
-            if (xHigherPriorityTaskWoken){portYIELD_FROM_ISR(xHigherPriorityTaskWoken);}// 必要时触发上下文切换
-            break;
+    if (xfer) {
+        if (xfer->callback) {
+            xfer->callback(xfer, status);
         }
+    } else if (dev && dev->callback) {
+        dev->callback();
     }
+    if (xHigherPriorityTaskWoken){portYIELD_FROM_ISR(xHigherPriorityTaskWoken);}// 必要时触发上下文切换
 }
 
-//这里是HAL_SPI_Transmit_it/dma回调
-void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+static void SPI_Cplt_FromISR(SPI_HandleTypeDef *hspi, HAL_StatusTypeDef status)
+{
     for (int i = 0; i < SPI_BUS_MAX; ++i)
     {
-        if (spi_bus_pool[i].mutex && spi_bus_pool[i].hspi == hspi)
+        if (spi_bus_pool[i].mutex && spi_bus_pool[i].hspi == hspi && spi_bus_pool[i].active_dev)
         {
-            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-            xSemaphoreGiveFromISR(spi_bus_pool[i].mutex,&xHigherPriorityTaskWoken);
-            HAL_GPIO_WritePin(spi_bus_pool[i].active_dev->cs_port, spi_bus_pool[i].active_dev->cs_pin, GPIO_PIN_SET);
-            // 清除活动设备记录
-            spi_bus_pool[i].active_dev = NULL;
-            if (xHigherPriorityTaskWoken){portYIELD_FROM_ISR(xHigherPriorityTaskWoken);}// 必要时触发上下文切换
+            SPI_BusRelease_FromISR(&spi_bus_pool[i], status);
             break;
         }
     }
 }
 
+// 中断部分处理
+
+//这里是HAL_SPI_TransmitReceive_it/dma回调
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    SPI_Cplt_FromISR(hspi, HAL_OK);
+}
+
+//这里是HAL_SPI_Transmit_it/dma回调
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    SPI_Cplt_FromISR(hspi, HAL_OK);
+}
+
 //这里是HAL_SPI_Receive_it/dma回调
 void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
 {
-    for (int i = 0; i < SPI_BUS_MAX; ++i)
-    {
-        if (spi_bus_pool[i].mutex && spi_bus_pool[i].hspi == hspi)
-        {
-            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-            xSemaphoreGiveFromISR(spi_bus_pool[i].mutex,&xHigherPriorityTaskWoken);
-            HAL_GPIO_WritePin(spi_bus_pool[i].active_dev->cs_port, spi_bus_pool[i].active_dev->cs_pin, GPIO_PIN_SET);
-            // 清除活动设备记录
-            spi_bus_pool[i].active_dev = NULL;
-            if (xHigherPriorityTaskWoken){portYIELD_FROM_ISR(xHigherPriorityTaskWoken);}// 必要时触发上下文切换
-            break;
-        }
-    }
+    SPI_Cplt_FromISR(hspi, HAL_OK);
+}
+
+//传输出错,HAL已经终止了传输,释放总线避免后续传输一直拿不到锁
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    SPI_Cplt_FromISR(hspi, HAL_ERROR);
 }
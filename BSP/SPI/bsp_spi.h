@@ -6,6 +6,7 @@
 #include "semphr.h"
 
 #define BSP_SPI_BUS_MAX_DEVICE_NUM 3
+#define BSP_SPI_XFER_QUEUE_LEN 8 // 每条总线异步传输队列长度
 
 typedef enum {
     BSP_SPI_MODE_BLOCKING,
@@ -31,11 +32,36 @@ typedef struct {
     void (*callback)(void);
 } SPI_DeviceInstance_t;
 
+//异步传输描述符,由提交者分配,回调之前不能修改或释放
+typedef struct SPI_Transfer SPI_Transfer_t;
+typedef void (*SPI_TransferCallback)(SPI_Transfer_t* xfer, HAL_StatusTypeDef status);
+struct SPI_Transfer {
+    SPI_DeviceInstance_t* dev;
+    const uint8_t* tx_data;        // NULL时只接收
+    uint8_t* rx_data;              // NULL时只发送
+    uint16_t size;
+    SPI_TransferCallback callback; // 传输结束后在中断中调用,此时CS已拉高,队列中的下一次传输已经开始
+    void* arg;                     // 提交者自用
+};
+
+typedef struct {
+    uint32_t submitted;  // 提交的异步传输数
+    uint32_t completed;  // 成功完成的异步传输数
+    uint32_t errors;     // 启动失败或传输出错的异步传输数
+    uint32_t queue_full; // 队列满被拒绝的提交数
+    uint8_t max_depth;   // 队列中同时等待的最大传输数
+} SPI_BusStats_t;
+
 typedef struct {
     SPI_HandleTypeDef* hspi;
-    SemaphoreHandle_t mutex;
+    SemaphoreHandle_t mutex;       // 总线锁,异步队列运行期间也由队列持有
     uint8_t ref_count; // 设备引用计数
     SPI_DeviceInstance_t* active_dev;
+    SPI_Transfer_t* active_xfer;   // 正在进行的异步传输
+    SPI_Transfer_t* queue[BSP_SPI_XFER_QUEUE_LEN];
+    uint8_t queue_head;
+    uint8_t queue_count;
+    SPI_BusStats_t stats;
 } SPI_Bus_t;
 
 //传输状态
@@ -46,9 +72,24 @@ typedef enum {
 } SPI_TransferState;
 
 SPI_DeviceInstance_t* SPI_DeviceRegister(const SPI_DeviceInstance_t* config);
-void BSP_SPI_TransReceive(SPI_DeviceInstance_t* dev, const uint8_t* tx_data, uint8_t* rx_data,uint16_t size);
-void BSP_SPI_Transmit(SPI_DeviceInstance_t* dev, const uint8_t* tx_data,uint16_t size);
-void BSP_SPI_Receive(SPI_DeviceInstance_t* dev,uint8_t* rx_data,uint16_t size);
+/* 以下传输函数在拿不到总线锁时返回HAL_TIMEOUT,阻塞模式下返回HAL的传输结果 */
+HAL_StatusTypeDef BSP_SPI_TransReceive(SPI_DeviceInstance_t* dev, const uint8_t* tx_data, uint8_t* rx_data,uint16_t size);
+HAL_StatusTypeDef BSP_SPI_Transmit(SPI_DeviceInstance_t* dev, const uint8_t* tx_data,uint16_t size);
+HAL_StatusTypeDef BSP_SPI_Receive(SPI_DeviceInstance_t* dev,uint8_t* rx_data,uint16_t size);
 HAL_StatusTypeDef BSP_SPI_TransAndTrans(SPI_DeviceInstance_t* dev, const uint8_t* tx_data1, uint16_t size1, const uint8_t* tx_data2, uint16_t size2);
 
+/**
+ * @brief 提交一次异步DMA传输,不等待,可以在任务和中断中调用,与设备配置的传输模式无关
+ * @note 同一总线上的传输按提交顺序进行,一次传输结束后在DMA完成中断中拉高CS并立即开始下一次,
+ *       然后调用本次传输的callback.阻塞传输占用总线时在队列中等待,释放总线后接着进行
+ *
+ * @return HAL_StatusTypeDef HAL_OK已放入队列, HAL_BUSY队列已满, HAL_ERROR参数错误
+ */
+HAL_StatusTypeDef BSP_SPI_Submit(SPI_Transfer_t* xfer);
+
+/**
+ * @brief 获取总线的异步传输统计
+ */
+void BSP_SPI_GetBusStats(SPI_BusType bus, SPI_BusStats_t* stats);
+
 #endif /* __BSP_SPI_H__ */
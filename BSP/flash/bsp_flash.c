@@ -1,30 +1,79 @@
 #include "bsp_flash.h"
 #include "string.h"
 #include "main.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
 //第二个参数 pages 传递要擦除的扇区数量，而不是字节数
 
 #define LOG_TAG "bsp_flash"
 #include "elog.h"
+
+typedef enum {
+    FLASH_REQ_ERASE,
+    FLASH_REQ_WRITE,
+} Flash_ReqType;
+
+typedef struct {
+    Flash_ReqType type;
+    uint32_t addr;        // 擦除时为扇区号
+    const uint8_t *data;
+    uint16_t size;
+    BSP_Flash_Callback callback;
+    void *arg;
+} Flash_Request_t;
+
+static QueueHandle_t flash_queue = NULL;
+static SemaphoreHandle_t flash_mutex = NULL; // 同步接口和后台任务互斥使用flash控制器
+static osThreadId flash_task_handle = NULL;
+static BSP_Flash_EraseHooks_t flash_hooks;
+static volatile uint8_t flash_irq_error = 0;
+
+static void BSP_Flash_Lock(void)
+{
+    if (flash_mutex != NULL && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+        xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    }
+}
+
+static void BSP_Flash_Unlock(void)
+{
+    if (flash_mutex != NULL && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+        xSemaphoreGive(flash_mutex);
+    }
+}
+
 Flash_Status BSP_Flash_Erase(uint32_t sector, uint32_t pages) {
     FLASH_EraseInitTypeDef erase;
     uint32_t sector_error;
+    Flash_Status ret = FLASH_OK;
 
     log_i("Start erasing flash sector %lu, pages: %lu", sector, pages);
     erase.TypeErase = FLASH_TYPEERASE_SECTORS;
     erase.Sector = sector;
     erase.NbSectors = pages;
     erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+    BSP_Flash_Lock();
+    if (flash_hooks.before) {
+        flash_hooks.before();
+    }
     HAL_FLASH_Unlock();
 
     if (HAL_FLASHEx_Erase(&erase, &sector_error) != HAL_OK) {
         log_e("Flash erase failed at sector: %lu, error sector: %lu", sector, sector_error);
-        HAL_FLASH_Lock();
-        return FLASH_ERR_ERASE;
+        ret = FLASH_ERR_ERASE;
     }
 
     HAL_FLASH_Lock();
-    log_i("Flash erase completed successfully");
-    return FLASH_OK;
+    if (flash_hooks.after) {
+        flash_hooks.after();
+    }
+    BSP_Flash_Unlock();
+    if (ret == FLASH_OK) {
+        log_i("Flash erase completed successfully");
+    }
+    return ret;
 }
 
 Flash_Status BSP_Flash_Write(uint32_t addr, uint8_t *data, uint16_t size) {
@@ -32,18 +81,21 @@ Flash_Status BSP_Flash_Write(uint32_t addr, uint8_t *data, uint16_t size) {
         log_e("Invalid parameters: addr=0x%08lX, size=%u (both must be 4-byte aligned)", addr, size);
         return FLASH_ERR_PARAM;
     }
-    log_i("Start writing %u bytes to flash address 0x%08lX", size, addr);
+    log_d("Start writing %u bytes to flash address 0x%08lX", size, addr);
+    BSP_Flash_Lock();
     HAL_FLASH_Unlock();
 
     for (uint16_t i = 0; i < size; i += 4) {
         if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD,addr + i,*(uint32_t*)(data + i)) != HAL_OK) {
             log_e("Flash write failed at address 0x%08lX", addr + i);
             HAL_FLASH_Lock();
+            BSP_Flash_Unlock();
             return FLASH_ERR_WRITE;
         }
     }
     HAL_FLASH_Lock();
-    log_i("Flash write completed successfully");
+    BSP_Flash_Unlock();
+    log_d("Flash write completed successfully");
     return FLASH_OK;
 }
 
@@ -52,7 +104,181 @@ Flash_Status BSP_Flash_Read(uint32_t addr, uint8_t *buf, uint16_t size) {
         log_e("Invalid parameters for flash read: addr=0x%08lX, buf=%p, size=%u", addr, buf, size); 
         return FLASH_ERR_PARAM;
     }
-    log_i("Reading %u bytes from flash address 0x%08lX", size, addr);
+    log_d("Reading %u bytes from flash address 0x%08lX", size, addr);
     memcpy(buf, (void*)addr, size);
     return FLASH_OK;
 }
+
+/* 等待FLASH中断通知一次操作结束 */
+static Flash_Status BSP_Flash_WaitIT(uint32_t timeout_ms)
+{
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) == 0) {
+        return FLASH_ERR_BUSY;
+    }
+    return flash_irq_error ? FLASH_ERR_WRITE : FLASH_OK;
+}
+
+static Flash_Status BSP_Flash_EraseIT(uint32_t sector)
+{
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_SECTORS,
+        .Sector = sector,
+        .NbSectors = 1, // 多个扇区时每擦完一个扇区都会进一次完成回调,这里只擦一个
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+    };
+    Flash_Status ret = FLASH_OK;
+
+    // 比赛中等待,不在控制过程中停顿
+    while (flash_hooks.allow && !flash_hooks.allow()) {
+        osDelay(BSP_FLASH_GATE_POLL_MS);
+    }
+    log_i("Start background erasing flash sector %lu", sector);
+    BSP_Flash_Lock();
+    if (flash_hooks.before) {
+        flash_hooks.before();
+    }
+    HAL_FLASH_Unlock();
+    flash_irq_error = 0;
+    ulTaskNotifyTake(pdTRUE, 0);
+    if (HAL_FLASHEx_Erase_IT(&erase) != HAL_OK) {
+        ret = FLASH_ERR_ERASE;
+    } else if ((ret = BSP_Flash_WaitIT(BSP_FLASH_ERASE_TIMEOUT_MS)) != FLASH_OK) {
+        ret = FLASH_ERR_ERASE;
+    }
+    HAL_FLASH_Lock();
+    if (flash_hooks.after) {
+        flash_hooks.after();
+    }
+    BSP_Flash_Unlock();
+    if (ret != FLASH_OK) {
+        log_e("Background erase failed at sector: %lu", sector);
+    }
+    return ret;
+}
+
+static Flash_Status BSP_Flash_WriteIT(uint32_t addr, const uint8_t *data, uint16_t size)
+{
+    Flash_Status ret = FLASH_OK;
+    uint32_t word;
+
+    BSP_Flash_Lock();
+    HAL_FLASH_Unlock();
+    for (uint16_t i = 0; i < size; i += 4) {
+        memcpy(&word, data + i, 4);
+        flash_irq_error = 0;
+        ulTaskNotifyTake(pdTRUE, 0);
+        if (HAL_FLASH_Program_IT(FLASH_TYPEPROGRAM_WORD, addr + i, word) != HAL_OK ||
+            BSP_Flash_WaitIT(10) != FLASH_OK) {
+            log_e("Background write failed at address 0x%08lX", addr + i);
+            ret = FLASH_ERR_WRITE;
+            break;
+        }
+    }
+    HAL_FLASH_Lock();
+    BSP_Flash_Unlock();
+    return ret;
+}
+
+static void BSP_Flash_Task(const void *argument)
+{
+    UNUSED(argument);
+    Flash_Request_t req;
+    Flash_Status ret;
+
+    while (1) {
+        if (xQueueReceive(flash_queue, &req, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (req.type == FLASH_REQ_ERASE) {
+            ret = BSP_Flash_EraseIT(req.addr);
+        } else {
+            ret = BSP_Flash_WriteIT(req.addr, req.data, req.size);
+        }
+        if (req.callback) {
+            req.callback(ret, req.arg);
+        }
+    }
+}
+
+void BSP_Flash_ServiceInit(void)
+{
+    if (flash_queue != NULL) {
+        return;
+    }
+    flash_mutex = xSemaphoreCreateMutex();
+    flash_queue = xQueueCreate(BSP_FLASH_QUEUE_LEN, sizeof(Flash_Request_t));
+    if (flash_mutex == NULL || flash_queue == NULL) {
+        log_e("Failed to create flash queue");
+        return;
+    }
+    osThreadDef(FlashTask, BSP_Flash_Task, osPriorityLow, 0, 256);
+    flash_task_handle = osThreadCreate(osThread(FlashTask), NULL);
+    if (flash_task_handle == NULL) {
+        log_e("Failed to create flash task");
+    }
+}
+
+void BSP_Flash_SetEraseHooks(const BSP_Flash_EraseHooks_t *hooks)
+{
+    if (hooks) {
+        flash_hooks = *hooks;
+    } else {
+        memset(&flash_hooks, 0, sizeof(flash_hooks));
+    }
+}
+
+static Flash_Status BSP_Flash_Submit(const Flash_Request_t *req)
+{
+    if (flash_queue == NULL || flash_task_handle == NULL) {
+        return FLASH_ERR_BUSY;
+    }
+    if (xQueueSend(flash_queue, req, 0) != pdTRUE) {
+        log_w("Flash queue full");
+        return FLASH_ERR_BUSY;
+    }
+    return FLASH_OK;
+}
+
+Flash_Status BSP_Flash_EraseAsync(uint32_t sector, BSP_Flash_Callback callback, void *arg)
+{
+    if (!IS_FLASH_SECTOR(sector)) {
+        return FLASH_ERR_PARAM;
+    }
+    Flash_Request_t req = {.type = FLASH_REQ_ERASE, .addr = sector, .callback = callback, .arg = arg};
+    return BSP_Flash_Submit(&req);
+}
+
+Flash_Status BSP_Flash_WriteAsync(uint32_t addr, const uint8_t *data, uint16_t size, BSP_Flash_Callback callback,
+                                  void *arg)
+{
+    if (size == 0 || size % 4 != 0 || addr % 4 != 0 || !data || !IS_FLASH_ADDRESS(addr) ||
+        !IS_FLASH_ADDRESS(addr + size - 1)) {
+        log_e("Invalid parameters: addr=0x%08lX, size=%u (both must be 4-byte aligned)", addr, size);
+        return FLASH_ERR_PARAM;
+    }
+    Flash_Request_t req = {.type = FLASH_REQ_WRITE, .addr = addr, .data = data, .size = size,
+                           .callback = callback, .arg = arg};
+    return BSP_Flash_Submit(&req);
+}
+
+/* FLASH中断(优先级6)中调用 */
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue)
+{
+    UNUSED(ReturnValue);
+    BaseType_t woken = pdFALSE;
+    if (flash_task_handle != NULL) {
+        vTaskNotifyGiveFromISR(flash_task_handle, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue)
+{
+    UNUSED(ReturnValue);
+    BaseType_t woken = pdFALSE;
+    flash_irq_error = 1;
+    if (flash_task_handle != NULL) {
+        vTaskNotifyGiveFromISR(flash_task_handle, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
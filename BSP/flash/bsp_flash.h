@@ -26,11 +26,58 @@ typedef enum {
     FLASH_ERR_PARAM,
     FLASH_ERR_ERASE,
     FLASH_ERR_WRITE,
-    FLASH_ERR_ADDR
+    FLASH_ERR_ADDR,
+    FLASH_ERR_FULL
 } Flash_Status;
 
+#define BSP_FLASH_QUEUE_LEN         8     // 后台请求队列长度
+#define BSP_FLASH_GATE_POLL_MS      100   // 擦除不被允许时的重新检查间隔
+#define BSP_FLASH_ERASE_TIMEOUT_MS  4000  // 128K扇区擦除最长约2s
+
+/* 后台请求完成回调,在flash任务中调用 */
+typedef void (*BSP_Flash_Callback)(Flash_Status status, void *arg);
+
+/**
+ * @brief 擦除钩子
+ * @note 擦除扇区期间cpu从flash取指会停顿1~2s,期间所有任务和中断都不能执行,
+ *       所以擦除只在allow返回1时开始(例如比赛未开始且机器人处于零力状态),并在前后调用before/after放宽看门狗
+ */
+typedef struct {
+    uint8_t (*allow)(void); // 返回1时允许开始擦除,NULL表示总是允许,只对后台擦除生效
+    void (*before)(void);   // 擦除开始前调用
+    void (*after)(void);    // 擦除结束后调用
+} BSP_Flash_EraseHooks_t;
+
 Flash_Status BSP_Flash_Erase(uint32_t sector, uint32_t pages);
 Flash_Status BSP_Flash_Write(uint32_t addr, uint8_t *data, uint16_t size);
 Flash_Status BSP_Flash_Read(uint32_t addr, uint8_t *buf, uint16_t size);
 
+/**
+ * @brief 校验flash中保存的数据,CRC32(多项式0xEDB88320,与zlib.crc32相同),可以分段连续计算
+ *
+ * @param crc 第一段传0,之后传上一段的结果
+ */
+uint32_t BSP_Flash_Crc32(uint32_t crc, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 创建后台flash任务和请求队列,在调度器启动前调用
+ */
+void BSP_Flash_ServiceInit(void);
+
+void BSP_Flash_SetEraseHooks(const BSP_Flash_EraseHooks_t *hooks);
+
+/**
+ * @brief 把一个扇区的擦除放入后台队列,由低优先级任务在允许时用中断方式完成
+ *
+ * @return Flash_Status FLASH_OK已入队, FLASH_ERR_BUSY队列已满或服务未初始化
+ */
+Flash_Status BSP_Flash_EraseAsync(uint32_t sector, BSP_Flash_Callback callback, void *arg);
+
+/**
+ * @brief 把一次写入放入后台队列,按字用中断方式写入,每写完一个字让出cpu
+ * @note 不拷贝数据,data在回调之前需要保持有效
+ */
+Flash_Status BSP_Flash_WriteAsync(uint32_t addr, const uint8_t *data, uint16_t size, BSP_Flash_Callback callback,
+                                  void *arg);
+
 #endif //BSP_FLASH_H
@@ -0,0 +1,17 @@
+/* flash数据校验用的CRC32,不依赖HAL,主机测试可以直接链接 */
+#include "bsp_flash.h"
+
+uint32_t BSP_Flash_Crc32(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    // 按半字节查表,表只有64字节
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    crc = ~crc;
+    while (len--) {
+        crc = table[(crc ^ *data) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (*data >> 4)) & 0x0F] ^ (crc >> 4);
+        data++;
+    }
+    return ~crc;
+}
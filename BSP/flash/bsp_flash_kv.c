@@ -0,0 +1,361 @@
+#include "bsp_flash_kv.h"
+#include <string.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#define LOG_TAG "flash_kv"
+#include "elog.h"
+
+#define FLASHKV_MAGIC         0x4B56524DU // "MRVK"
+#define FLASHKV_HEAD_LEN      8           // 扇区头长度,第一条记录的偏移
+#define FLASHKV_REC_HEAD_LEN  8
+#define FLASHKV_ALIGN4(x)     (((x) + 3U) & ~3U)
+#define FLASHKV_REC_LEN(len)  (FLASHKV_REC_HEAD_LEN + FLASHKV_ALIGN4(len))
+
+typedef struct {
+    uint32_t seq;
+    uint32_t magic;
+} FlashKV_SectorHead_t;
+
+typedef struct {
+    uint16_t key;
+    uint16_t len;
+    uint32_t crc;
+} FlashKV_RecHead_t;
+
+typedef struct {
+    SemaphoreHandle_t mutex;
+    uint32_t sector;                  // 当前扇区号
+    uint32_t base;                    // 当前扇区地址
+    uint32_t seq;
+    uint32_t write_off;               // 下一条记录写入的偏移
+    uint32_t index[FLASHKV_KEY_MAX];  // 每个key最新记录的偏移,0表示不存在
+    volatile uint8_t spare_ready;     // 另一个扇区已经擦好,整理时不需要再擦除
+    volatile uint8_t spare_pending;   // 另一个扇区的擦除已经在后台队列中
+    FlashKV_Stats_t stats;
+} FlashKV_t;
+
+static FlashKV_t kv;
+static uint8_t kv_buf[FLASHKV_REC_LEN(FLASHKV_VALUE_MAX_LEN)]; // 持锁时使用
+
+static uint32_t FlashKV_RecCrc(const FlashKV_RecHead_t *head, const uint8_t *data)
+{
+    uint32_t crc = BSP_Flash_Crc32(0, (const uint8_t *)head, 4); // key和len
+    return BSP_Flash_Crc32(crc, data, head->len);
+}
+
+static inline uint32_t FlashKV_OtherSector(uint32_t sector)
+{
+    return sector == FLASHKV_SECTOR_A ? FLASHKV_SECTOR_B : FLASHKV_SECTOR_A;
+}
+
+static inline uint32_t FlashKV_SectorAddr(uint32_t sector)
+{
+    return sector == FLASHKV_SECTOR_A ? FLASHKV_SECTOR_A_ADDR : FLASHKV_SECTOR_B_ADDR;
+}
+
+static uint8_t FlashKV_ReadHead(uint32_t sector, FlashKV_SectorHead_t *head)
+{
+    BSP_Flash_Read(FlashKV_SectorAddr(sector), (uint8_t *)head, sizeof(*head));
+    return head->magic == FLASHKV_MAGIC;
+}
+
+static uint8_t FlashKV_SectorBlank(uint32_t sector)
+{
+    uint32_t buf[16];
+    uint32_t addr = FlashKV_SectorAddr(sector);
+    for (uint32_t off = 0; off < FLASHKV_SECTOR_SIZE; off += sizeof(buf)) {
+        BSP_Flash_Read(addr + off, (uint8_t *)buf, sizeof(buf));
+        for (uint8_t i = 0; i < 16; i++) {
+            if (buf[i] != 0xFFFFFFFFU) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* 扫描当前扇区的所有记录,建立索引并找到写入位置 */
+static void FlashKV_Scan(void)
+{
+    FlashKV_RecHead_t head;
+    uint32_t off = FLASHKV_HEAD_LEN;
+
+    memset(kv.index, 0, sizeof(kv.index));
+    while (off + FLASHKV_REC_HEAD_LEN <= FLASHKV_SECTOR_SIZE) {
+        BSP_Flash_Read(kv.base + off, (uint8_t *)&head, sizeof(head));
+        if (head.key == 0xFFFF && head.len == 0xFFFF) {
+            break; // 后面还没有写过
+        }
+        if (head.key == 0 || head.key >= FLASHKV_KEY_MAX || head.len > FLASHKV_VALUE_MAX_LEN ||
+            off + FLASHKV_REC_LEN(head.len) > FLASHKV_SECTOR_SIZE) {
+            // 记录头本身没写完整,找不到下一条记录的位置,不再往后写,下次写入时整理
+            kv.stats.crc_errors++;
+            off = FLASHKV_SECTOR_SIZE;
+            break;
+        }
+        if (head.len) {
+            BSP_Flash_Read(kv.base + off + FLASHKV_REC_HEAD_LEN, kv_buf, head.len);
+        }
+        if (FlashKV_RecCrc(&head, kv_buf) == head.crc) {
+            kv.index[head.key] = head.len ? off : 0;
+        } else {
+            kv.stats.crc_errors++; // 写入时掉电,保留这个key上一次的值
+        }
+        off += FLASHKV_REC_LEN(head.len);
+    }
+    kv.write_off = off;
+}
+
+static void FlashKV_UpdateStats(void)
+{
+    kv.stats.active_sector = kv.sector;
+    kv.stats.used = kv.write_off;
+    kv.stats.keys = 0;
+    for (uint16_t key = 1; key < FLASHKV_KEY_MAX; key++) {
+        if (kv.index[key]) {
+            kv.stats.keys++;
+        }
+    }
+}
+
+/* 在扇区开头写入扇区头,seq在前,magic在后,magic写入后扇区才有效 */
+static Flash_Status FlashKV_WriteHead(uint32_t sector, uint32_t seq)
+{
+    FlashKV_SectorHead_t head = {.seq = seq, .magic = FLASHKV_MAGIC};
+    return BSP_Flash_Write(FlashKV_SectorAddr(sector), (uint8_t *)&head, sizeof(head));
+}
+
+/* 后台擦除完成,在flash任务中调用 */
+static void FlashKV_SpareErased(Flash_Status status, void *arg)
+{
+    uint32_t sector = (uint32_t)arg;
+    xSemaphoreTake(kv.mutex, portMAX_DELAY);
+    kv.spare_pending = 0;
+    // 擦除期间没有发生整理时,擦好的扇区仍是备用扇区
+    if (status == FLASH_OK && sector == FlashKV_OtherSector(kv.sector)) {
+        kv.spare_ready = 1;
+    }
+    xSemaphoreGive(kv.mutex);
+}
+
+/* 把备用扇区的擦除放入后台队列,等比赛外再执行 */
+static void FlashKV_EraseSpare(void)
+{
+    uint32_t sector = FlashKV_OtherSector(kv.sector);
+    if (kv.spare_ready || kv.spare_pending) {
+        return;
+    }
+    if (BSP_Flash_EraseAsync(sector, FlashKV_SpareErased, (void *)sector) == FLASH_OK) {
+        kv.spare_pending = 1;
+    }
+}
+
+Flash_Status FlashKV_Init(void)
+{
+    FlashKV_SectorHead_t a, b;
+    uint8_t valid_a, valid_b;
+
+    if (kv.mutex == NULL) {
+        kv.mutex = xSemaphoreCreateMutex();
+    }
+    valid_a = FlashKV_ReadHead(FLASHKV_SECTOR_A, &a);
+    valid_b = FlashKV_ReadHead(FLASHKV_SECTOR_B, &b);
+
+    // 两个都有效时为整理后旧扇区还没擦除,旧扇区在后台擦除后作为备用扇区
+    if (valid_a && (!valid_b || (int32_t)(a.seq - b.seq) > 0)) {
+        kv.sector = FLASHKV_SECTOR_A;
+        kv.seq = a.seq;
+    } else if (valid_b) {
+        kv.sector = FLASHKV_SECTOR_B;
+        kv.seq = b.seq;
+    } else {
+        // 第一次使用,格式化扇区A;扇区B中可能有旧格式的数据,留给使用者迁移
+        log_w("no valid parameter store, formatting");
+        kv.sector = FLASHKV_SECTOR_A;
+        kv.seq = 1;
+        if (!FlashKV_SectorBlank(FLASHKV_SECTOR_A) && BSP_Flash_Erase(FLASHKV_SECTOR_A, 1) != FLASH_OK) {
+            return FLASH_ERR_ERASE;
+        }
+        if (FlashKV_WriteHead(FLASHKV_SECTOR_A, kv.seq) != FLASH_OK) {
+            return FLASH_ERR_WRITE;
+        }
+        kv.stats.formatted = 1;
+    }
+    kv.base = FlashKV_SectorAddr(kv.sector);
+    FlashKV_Scan();
+    FlashKV_UpdateStats();
+    // 格式化时扇区B中可能有旧格式的数据,使用者在调度器启动前迁移,之后才会执行后台擦除
+    kv.spare_ready = FlashKV_SectorBlank(FlashKV_OtherSector(kv.sector));
+    FlashKV_EraseSpare();
+    log_i("parameter store: sector %lu, %u keys, %lu bytes used", kv.sector, kv.stats.keys, kv.write_off);
+    return FLASH_OK;
+}
+
+/**
+ * @brief 把每个key的最新记录搬到另一个扇区,然后切换到新扇区
+ *
+ * @param reserve 整理后还需要的空间,放不下时不整理
+ */
+static Flash_Status FlashKV_Compact(uint32_t reserve)
+{
+    FlashKV_RecHead_t head;
+    uint32_t live = FLASHKV_HEAD_LEN;
+    uint32_t index[FLASHKV_KEY_MAX] = {0};
+
+    for (uint16_t key = 1; key < FLASHKV_KEY_MAX; key++) {
+        if (kv.index[key]) {
+            BSP_Flash_Read(kv.base + kv.index[key], (uint8_t *)&head, sizeof(head));
+            live += FLASHKV_REC_LEN(head.len);
+        }
+    }
+    if (live + reserve > FLASHKV_SECTOR_SIZE) {
+        return FLASH_ERR_FULL;
+    }
+
+    uint32_t sector = FlashKV_OtherSector(kv.sector);
+    uint32_t base = FlashKV_SectorAddr(sector);
+    uint32_t off = FLASHKV_HEAD_LEN;
+    if (!kv.spare_ready) {
+        // 调度器启动后擦除会让控制停顿1~2s,交给后台在比赛外擦除,这次写入返回忙.
+        // 擦除已经在后台队列中时也返回忙:队列中的擦除没法撤销,在这里整理过去之后它会把新的当前扇区擦掉
+        if (kv.spare_pending || xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+            FlashKV_EraseSpare();
+            return FLASH_ERR_BUSY;
+        }
+        if (BSP_Flash_Erase(sector, 1) != FLASH_OK) {
+            return FLASH_ERR_ERASE;
+        }
+        kv.spare_ready = 1;
+    }
+    log_i("compacting parameter store into sector %lu", sector);
+    for (uint16_t key = 1; key < FLASHKV_KEY_MAX; key++) {
+        if (!kv.index[key]) {
+            continue;
+        }
+        BSP_Flash_Read(kv.base + kv.index[key], (uint8_t *)&head, sizeof(head));
+        uint16_t len = FLASHKV_REC_LEN(head.len);
+        BSP_Flash_Read(kv.base + kv.index[key], kv_buf, len);
+        if (BSP_Flash_Write(base + off, kv_buf, len) != FLASH_OK) {
+            return FLASH_ERR_WRITE;
+        }
+        index[key] = off;
+        off += len;
+    }
+    // 扇区头最后写入,之前掉电时开机仍使用旧扇区
+    if (FlashKV_WriteHead(sector, kv.seq + 1) != FLASH_OK) {
+        return FLASH_ERR_WRITE;
+    }
+    kv.sector = sector;
+    kv.base = base;
+    kv.seq++;
+    kv.write_off = off;
+    memcpy(kv.index, index, sizeof(index));
+    kv.stats.compactions++;
+    // 旧扇区在后台擦除,作为下次整理的目标
+    kv.spare_ready = 0;
+    FlashKV_EraseSpare();
+    return FLASH_OK;
+}
+
+/* 追加一条记录,调用者持锁 */
+static Flash_Status FlashKV_Append(uint16_t key, const void *data, uint16_t len)
+{
+    uint32_t rec_len = FLASHKV_REC_LEN(len);
+    Flash_Status ret;
+
+    if (kv.write_off + rec_len > FLASHKV_SECTOR_SIZE) {
+        if ((ret = FlashKV_Compact(rec_len)) != FLASH_OK) {
+            return ret;
+        }
+    }
+
+    FlashKV_RecHead_t *head = (FlashKV_RecHead_t *)kv_buf;
+    memset(kv_buf, 0xFF, rec_len);
+    head->key = key;
+    head->len = len;
+    if (len) {
+        memcpy(kv_buf + FLASHKV_REC_HEAD_LEN, data, len);
+    }
+    head->crc = FlashKV_RecCrc(head, kv_buf + FLASHKV_REC_HEAD_LEN);
+
+    // 按地址从低到高写入,记录头先于数据写入
+    uint32_t off = kv.write_off;
+    kv.write_off += rec_len; // 写入失败时也跳过这段空间,不在写过的位置上再写
+    if ((ret = BSP_Flash_Write(kv.base + off, kv_buf, rec_len)) != FLASH_OK) {
+        return ret;
+    }
+    kv.index[key] = len ? off : 0;
+    kv.stats.writes++;
+    return FLASH_OK;
+}
+
+uint16_t FlashKV_Get(uint16_t key, void *buf, uint16_t size)
+{
+    FlashKV_RecHead_t head = {0};
+
+    if (key == 0 || key >= FLASHKV_KEY_MAX || kv.mutex == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(kv.mutex, portMAX_DELAY);
+    if (kv.index[key]) {
+        BSP_Flash_Read(kv.base + kv.index[key], (uint8_t *)&head, sizeof(head));
+        uint16_t n = head.len < size ? head.len : size;
+        if (n) {
+            BSP_Flash_Read(kv.base + kv.index[key] + FLASHKV_REC_HEAD_LEN, buf, n);
+        }
+    }
+    xSemaphoreGive(kv.mutex);
+    return head.len;
+}
+
+Flash_Status FlashKV_Set(uint16_t key, const void *data, uint16_t len)
+{
+    Flash_Status ret = FLASH_OK;
+
+    if (key == 0 || key >= FLASHKV_KEY_MAX || len == 0 || len > FLASHKV_VALUE_MAX_LEN || !data ||
+        kv.mutex == NULL) {
+        return FLASH_ERR_PARAM;
+    }
+    xSemaphoreTake(kv.mutex, portMAX_DELAY);
+    if (kv.index[key]) {
+        FlashKV_RecHead_t head;
+        BSP_Flash_Read(kv.base + kv.index[key], (uint8_t *)&head, sizeof(head));
+        if (head.len == len) {
+            BSP_Flash_Read(kv.base + kv.index[key] + FLASHKV_REC_HEAD_LEN, kv_buf, len);
+            if (memcmp(kv_buf, data, len) == 0) {
+                xSemaphoreGive(kv.mutex);
+                return FLASH_OK;
+            }
+        }
+    }
+    ret = FlashKV_Append(key, data, len);
+    FlashKV_UpdateStats();
+    xSemaphoreGive(kv.mutex);
+    if (ret != FLASH_OK) {
+        log_e("write key %u failed: %d", key, ret);
+    }
+    return ret;
+}
+
+Flash_Status FlashKV_Delete(uint16_t key)
+{
+    Flash_Status ret = FLASH_OK;
+
+    if (key == 0 || key >= FLASHKV_KEY_MAX || kv.mutex == NULL) {
+        return FLASH_ERR_PARAM;
+    }
+    xSemaphoreTake(kv.mutex, portMAX_DELAY);
+    if (kv.index[key]) {
+        ret = FlashKV_Append(key, NULL, 0);
+        FlashKV_UpdateStats();
+    }
+    xSemaphoreGive(kv.mutex);
+    return ret;
+}
+
+void FlashKV_GetStats(FlashKV_Stats_t *stats)
+{
+    *stats = kv.stats;
+}
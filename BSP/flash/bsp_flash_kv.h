@@ -0,0 +1,79 @@
+/**
+ * @file bsp_flash_kv.h
+ * @brief 保存在flash中的键值参数存储,用两个扇区轮流记录,写入时只追加不擦除
+ *
+ * @note 布局:
+ *       扇区头 [seq(4)] [magic(4)]          magic最后写入,有magic的扇区内容完整;两个扇区都有效时seq大的为当前扇区
+ *       记录   [key(2) len(2)] [crc(4)] [数据,补齐到4字节]   len为0表示删除
+ *       同一个key的新记录追加在后面,开机扫描一次当前扇区建立key到记录位置的索引,之后查找不再扫描.
+ *       当前扇区写满时只把每个key的最新记录搬到另一个扇区,写入扇区头后切换.
+ *       另一个扇区平时保持擦好的状态:开机和每次整理后把擦除放入bsp_flash的后台队列,在比赛外执行,
+ *       所以运行中写入参数只需要写flash,不会因为擦除让控制停顿.
+ * @note 掉电保护:记录先写头再写数据,写到一半掉电时crc校验不通过,开机时跳过,这个key保留上一次的值;
+ *       整理过程中掉电时新扇区没有magic,开机仍使用旧扇区
+ */
+
+#ifndef BSP_FLASH_KV_H
+#define BSP_FLASH_KV_H
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+#include "bsp_flash.h"
+
+#define FLASHKV_SECTOR_A        FLASH_SECTOR_10
+#define FLASHKV_SECTOR_A_ADDR   ADDR_FLASH_SECTOR_10
+#define FLASHKV_SECTOR_B        FLASH_SECTOR_11
+#define FLASHKV_SECTOR_B_ADDR   ADDR_FLASH_SECTOR_11
+#define FLASHKV_SECTOR_SIZE     (128 * 1024)
+
+#define FLASHKV_KEY_MAX         64   // key的取值范围为1~FLASHKV_KEY_MAX-1,索引表大小
+#define FLASHKV_VALUE_MAX_LEN   128  // 单条记录数据的最大长度
+
+/* 参数的key,新增参数在这里分配,已经分配的不要修改 */
+typedef enum {
+    FLASHKV_KEY_IMU_CALI = 1, // BMI088标定结果
+    FLASHKV_KEY_BLACKBOX = 2, // 黑匣子冻结状态
+} FlashKV_Key;
+
+typedef struct {
+    uint8_t active_sector;  // 当前扇区号
+    uint8_t formatted;      // 开机时没有找到有效的存储,重新格式化过
+    uint16_t keys;          // 有效的key数
+    uint32_t used;          // 当前扇区已用字节数
+    uint32_t writes;        // 开机后写入的记录数
+    uint32_t compactions;   // 开机后整理的次数
+    uint32_t crc_errors;    // 开机扫描时crc校验失败(写入时掉电)的记录数
+} FlashKV_Stats_t;
+
+/**
+ * @brief 找到当前扇区并建立索引,需要在使用其他接口之前调用一次
+ * @note 没有有效的存储时格式化扇区A;另一个扇区不是空白时放入后台擦除,需要先调用BSP_Flash_ServiceInit
+ */
+Flash_Status FlashKV_Init(void);
+
+/**
+ * @brief 读取参数
+ *
+ * @param buf 输出缓冲区,长度不够时只拷贝前size字节
+ * @return uint16_t 参数的实际长度,不存在时返回0
+ */
+uint16_t FlashKV_Get(uint16_t key, void *buf, uint16_t size);
+
+/**
+ * @brief 写入参数,内容与已保存的相同时不写入
+ * @note 通常只追加一条记录,耗时在毫秒以内;当前扇区写满时整理到已擦好的另一个扇区.
+ *       调度器启动前另一个扇区没有擦好、擦除也不在后台队列中时直接擦除,耗时1~2s
+ *
+ * @return Flash_Status FLASH_OK成功, FLASH_ERR_PARAM参数错误, FLASH_ERR_FULL有效数据超过一个扇区,
+ *         FLASH_ERR_BUSY需要整理但另一个扇区还在等待后台擦除(调度器启动前FlashKV_Init放入队列的擦除也算), 其他为flash操作失败
+ */
+Flash_Status FlashKV_Set(uint16_t key, const void *data, uint16_t len);
+
+/**
+ * @brief 删除参数,不存在时直接返回FLASH_OK
+ */
+Flash_Status FlashKV_Delete(uint16_t key);
+
+void FlashKV_GetStats(FlashKV_Stats_t *stats);
+
+#endif // BSP_FLASH_KV_H
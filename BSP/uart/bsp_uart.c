@@ -16,6 +16,9 @@ static uint8_t default_buf[UART_MAX_INSTANCE_NUM][2][UART_DEFAULT_BUF_SIZE];
 // 私有函数声明
 static void Start_Rx(UART_Device *inst);
 static void Process_Rx_Complete(UART_Device *inst, uint16_t Size);
+static void Process_Rx_Ring(UART_Device *inst, uint16_t Size);
+static void Notify_Rx_Event(UART_Device *inst);
+static void Start_Tx(UART_Device *inst);
 
 UART_Device* UART_Init(UART_Device_init_config *config) {
     // 检查实例是否已存在
@@ -41,6 +44,22 @@ UART_Device* UART_Init(UART_Device_init_config *config) {
         return NULL;
     }
 
+    if (config->rx_mode == UART_MODE_DMA_CIRCULAR) {
+        // 环形模式依赖DMA循环模式,需要在CubeMX中把对应的RX DMA配置为Circular
+        if (config->huart->hdmarx == NULL || config->huart->hdmarx->Init.Mode != DMA_CIRCULAR) {
+            log_e("UART rx DMA is not circular");
+            return NULL;
+        }
+        if (config->rx_buf == NULL) {
+            log_e("UART ring mode needs an rx buffer");
+            return NULL;
+        }
+    }
+    if (config->tx_mode == UART_MODE_DMA_CIRCULAR) {
+        log_e("UART_MODE_DMA_CIRCULAR is rx only");
+        return NULL;
+    }
+
     // 初始化参数
     UART_Device *inst = &registered_uart[free_index];
     memset(inst, 0, sizeof(UART_Device));
@@ -65,6 +84,7 @@ UART_Device* UART_Init(UART_Device_init_config *config) {
     inst->tx_mode = config->tx_mode;
     inst->timeout = config->timeout;
     inst->rx_complete_cb = config->rx_complete_cb;
+    inst->rx_ring_cb = config->rx_ring_cb;
     inst->cb_type = config->cb_type;
     inst->event_flag = config->event_flag;
 
@@ -84,26 +104,62 @@ UART_Device* UART_Init(UART_Device_init_config *config) {
     return inst;
 }
 
-HAL_StatusTypeDef UART_Send(UART_Device *inst, uint8_t *data, uint16_t len) {
+HAL_StatusTypeDef UART_Send(UART_Device *inst, const uint8_t *data, uint16_t len) {
+    if (inst->tx_mode == UART_MODE_DMA) {
+        HAL_StatusTypeDef ret = HAL_OK;
+        UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+        if (len > UART_TX_BUF_SIZE - inst->tx_count) {
+            inst->tx_stats.dropped_bytes += len;
+            inst->tx_stats.dropped_msgs++;
+            ret = HAL_BUSY;
+        } else {
+            uint16_t head = (inst->tx_tail + inst->tx_count) % UART_TX_BUF_SIZE;
+            uint16_t first = UART_TX_BUF_SIZE - head;
+            if (first >= len) {
+                memcpy(&inst->tx_buf[head], data, len);
+            } else {
+                memcpy(&inst->tx_buf[head], data, first);
+                memcpy(inst->tx_buf, data + first, len - first);
+            }
+            inst->tx_count += len;
+            inst->tx_stats.queued_bytes += len;
+            if (inst->tx_count > inst->tx_stats.high_water) {
+                inst->tx_stats.high_water = inst->tx_count;
+            }
+            if (inst->tx_inflight == 0) {
+                Start_Tx(inst);
+            }
+        }
+        taskEXIT_CRITICAL_FROM_ISR(mask);
+        return ret;
+    }
+
     // 检查互斥量
     if(xSemaphoreTake(inst->tx_mutex,inst->timeout) != pdTRUE) return HAL_BUSY;
     switch(inst->tx_mode){
         case UART_MODE_BLOCKING:
-            HAL_UART_Transmit(inst->huart, data, len, inst->timeout);
+            HAL_UART_Transmit(inst->huart, (uint8_t *)data, len, inst->timeout);
             xSemaphoreGive(inst->tx_mutex);
             break;
             
         case UART_MODE_IT:
-            HAL_UART_Transmit_IT(inst->huart, data, len);
-            break;
-            
-        case UART_MODE_DMA:
-            HAL_UART_Transmit_DMA(inst->huart, data, len);
+            HAL_UART_Transmit_IT(inst->huart, (uint8_t *)data, len);
             break;
+
+        default:
+            xSemaphoreGive(inst->tx_mutex);
+            return HAL_ERROR;
     }
     return HAL_OK;
 }
 
+void UART_GetTxStats(UART_Device *inst, UART_TxStats_t *stats) {
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    *stats = inst->tx_stats;
+    stats->pending = inst->tx_count;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
 void UART_Deinit(UART_Device *inst) {
     for(int i=0; i<UART_MAX_INSTANCE_NUM; i++){
         if(&registered_uart[i] == inst){
@@ -123,6 +179,10 @@ void UART_Deinit(UART_Device *inst) {
 void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
     for(int i=0; i<UART_MAX_INSTANCE_NUM; i++){
         if(uart_used[i] && registered_uart[i].huart == huart){
+            if (registered_uart[i].rx_mode == UART_MODE_DMA_CIRCULAR) {
+                Process_Rx_Ring(&registered_uart[i], Size); // DMA一直在运行,不需要重启
+                break;
+            }
             Process_Rx_Complete(&registered_uart[i], Size);
             Start_Rx(&registered_uart[i]); // 重启接收
             break;
@@ -134,6 +194,20 @@ void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
 void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
     for(int i=0; i<UART_MAX_INSTANCE_NUM; i++){
         if(uart_used[i] && registered_uart[i].huart == huart){
+            UART_Device *inst = &registered_uart[i];
+            if (inst->tx_mode == UART_MODE_DMA) {
+                // 释放刚发完的一段,缓冲区里还有数据就接着发
+                UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+                inst->tx_tail = (inst->tx_tail + inst->tx_inflight) % UART_TX_BUF_SIZE;
+                inst->tx_count -= inst->tx_inflight;
+                inst->tx_stats.sent_bytes += inst->tx_inflight;
+                inst->tx_inflight = 0;
+                if (inst->tx_count) {
+                    Start_Tx(inst);
+                }
+                taskEXIT_CRITICAL_FROM_ISR(mask);
+                break;
+            }
             BaseType_t xHigherPriorityTaskWoken = pdFALSE;
             xSemaphoreGiveFromISR(registered_uart[i].tx_mutex, &xHigherPriorityTaskWoken);
             if (xHigherPriorityTaskWoken){portYIELD_FROM_ISR(xHigherPriorityTaskWoken);}
@@ -147,8 +221,27 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
 void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
     for(int i=0; i<UART_MAX_INSTANCE_NUM; i++){
         if(uart_used[i] && registered_uart[i].huart == huart){      
+            UART_Device *inst = &registered_uart[i];
+            if (inst->tx_mode == UART_MODE_DMA && inst->tx_inflight && huart->gState == HAL_UART_STATE_READY) {
+                // DMA发送出错被HAL终止,丢弃这一段,继续发送后面的数据
+                UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+                inst->tx_tail = (inst->tx_tail + inst->tx_inflight) % UART_TX_BUF_SIZE;
+                inst->tx_count -= inst->tx_inflight;
+                inst->tx_stats.dropped_bytes += inst->tx_inflight;
+                inst->tx_inflight = 0;
+                if (inst->tx_count) {
+                    Start_Tx(inst);
+                }
+                taskEXIT_CRITICAL_FROM_ISR(mask);
+            }
             log_e("UART error occurred, restarting RX");      
             HAL_UART_AbortReceive(huart);
+            if (registered_uart[i].rx_mode == UART_MODE_DMA_CIRCULAR) {
+                // 重启后DMA从缓冲区开头写入,尚未读取的数据在消费者下一次取数据时丢弃
+                registered_uart[i].rx_restart_total = registered_uart[i].rx_total;
+                registered_uart[i].rx_head = 0;
+                registered_uart[i].rx_restarted = 1;
+            }
             Start_Rx(&registered_uart[i]);
             break;
         }
@@ -161,27 +254,46 @@ void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
 static void Start_Rx(UART_Device *inst) {
     uint8_t next_buf = !inst->rx_active_buf;
     uint16_t max_len = inst->rx_buf_size;
+    uint8_t *buf = (uint8_t *)inst->rx_buf + next_buf * inst->rx_buf_size; // 两个缓冲区首尾相接
 
     switch(inst->rx_mode){
         case UART_MODE_BLOCKING:
-            HAL_UART_Receive(inst->huart, (uint8_t*)&inst->rx_buf[next_buf], 
+            HAL_UART_Receive(inst->huart, buf, 
                 inst->expected_len ? inst->expected_len : max_len, inst->timeout);
             break;
             
         case UART_MODE_IT:
-            HAL_UARTEx_ReceiveToIdle_IT(inst->huart, (uint8_t*)&inst->rx_buf[next_buf], 
+            HAL_UARTEx_ReceiveToIdle_IT(inst->huart, buf, 
                 inst->expected_len ? inst->expected_len : max_len);
             break;
             
         case UART_MODE_DMA:
-            HAL_UARTEx_ReceiveToIdle_DMA(inst->huart, (uint8_t*)&inst->rx_buf[next_buf], 
+            HAL_UARTEx_ReceiveToIdle_DMA(inst->huart, buf, 
                 inst->expected_len ? inst->expected_len : max_len);
             break;
+
+        case UART_MODE_DMA_CIRCULAR:
+            HAL_UARTEx_ReceiveToIdle_DMA(inst->huart, (uint8_t *)inst->rx_buf, inst->rx_buf_size);
+            return;
     }
     
     inst->rx_active_buf = next_buf;
 }
 
+/**
+ * @brief 从tx_tail开始发送缓冲区中连续的一段,到缓冲区末尾为止,剩下的在发送完成中断中接着发.调用者需要处于临界区
+ */
+static void Start_Tx(UART_Device *inst) {
+    uint16_t len = UART_TX_BUF_SIZE - inst->tx_tail;
+    if (len > inst->tx_count) {
+        len = inst->tx_count;
+    }
+    if (HAL_UART_Transmit_DMA(inst->huart, &inst->tx_buf[inst->tx_tail], len) == HAL_OK) {
+        inst->tx_inflight = len;
+        inst->tx_stats.dma_starts++;
+    }
+}
+
 static void Process_Rx_Complete(UART_Device *inst, uint16_t Size) {
     // 计算实际接收长度
     if(inst->expected_len == 0){
@@ -197,20 +309,104 @@ static void Process_Rx_Complete(UART_Device *inst, uint16_t Size) {
     inst->rx_len = Size;
 
     // 触发回调
-    uint8_t *data = inst->rx_buf[!inst->rx_active_buf]; // 使用非活动缓冲区
+    // DMA刚写完的是当前活动缓冲区,回调之后Start_Rx()切换到另一个缓冲区,回调中的数据在下一次接收期间不会被覆盖
+    uint8_t *data = (uint8_t *)inst->rx_buf + inst->rx_active_buf * inst->rx_buf_size;
     
     if(inst->cb_type == UART_CALLBACK_DIRECT){
         if(inst->rx_complete_cb)
             inst->rx_complete_cb(data, Size);
     }
     else{
-        if(inst->rx_event)
-        {
-            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-            xEventGroupSetBitsFromISR(inst->rx_event, 
-                                    inst->event_flag,
-                                    &xHigherPriorityTaskWoken);
-            if (xHigherPriorityTaskWoken){portYIELD_FROM_ISR(xHigherPriorityTaskWoken);}// 必要时触发上下文切换
-        }
+        Notify_Rx_Event(inst);
+    }
+}
+
+static void Notify_Rx_Event(UART_Device *inst) {
+    if(inst->rx_event)
+    {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        xEventGroupSetBitsFromISR(inst->rx_event, 
+                                inst->event_flag,
+                                &xHigherPriorityTaskWoken);
+        if (xHigherPriorityTaskWoken){portYIELD_FROM_ISR(xHigherPriorityTaskWoken);}// 必要时触发上下文切换
+    }
+}
+
+/**
+ * @brief 半满、全满和空闲事件中推进写指针
+ * @note Size为DMA当前写入位置,全满事件时等于缓冲区大小(即位置0);全满后紧跟的空闲事件也会再报一次缓冲区大小,此时没有新数据
+ */
+static void Process_Rx_Ring(UART_Device *inst, uint16_t Size) {
+    uint16_t pos = Size % inst->rx_buf_size;
+    uint16_t n = (pos + inst->rx_buf_size - inst->rx_head) % inst->rx_buf_size;
+    if (n == 0) {
+        return;
+    }
+    inst->rx_head = pos;
+    inst->rx_total += n;
+
+    if (inst->cb_type == UART_CALLBACK_DIRECT) {
+        if (inst->rx_ring_cb)
+            inst->rx_ring_cb(inst);
+    } else {
+        Notify_Rx_Event(inst);
+    }
+}
+
+/*----------------------------------环形接收----------------------------*/
+uint16_t UART_RxAvailable(UART_Device *inst) {
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    uint32_t total = inst->rx_total;
+    if (inst->rx_restarted) {
+        inst->rx_overrun += inst->rx_restart_total - inst->rx_consumed;
+        inst->rx_consumed = inst->rx_restart_total;
+        inst->rx_tail = 0;
+        inst->rx_restarted = 0;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+
+    uint32_t avail = total - inst->rx_consumed;
+    if (avail >= inst->rx_buf_size) {
+        // 写指针追上了读指针,读指针处的数据已经被覆盖或正在被覆盖
+        inst->rx_overrun += avail;
+        inst->rx_tail = (inst->rx_tail + avail) % inst->rx_buf_size;
+        inst->rx_consumed = total;
+        return 0;
+    }
+    return (uint16_t)avail;
+}
+
+uint8_t UART_RxPeekByte(UART_Device *inst, uint16_t offset) {
+    uint16_t pos = inst->rx_tail + offset;
+    if (pos >= inst->rx_buf_size) {
+        pos -= inst->rx_buf_size;
+    }
+    return ((uint8_t *)inst->rx_buf)[pos];
+}
+
+const uint8_t *UART_RxPeek(UART_Device *inst, uint16_t offset, uint16_t len, uint8_t *scratch) {
+    uint8_t *ring = (uint8_t *)inst->rx_buf;
+    uint16_t pos = inst->rx_tail + offset;
+    if (pos >= inst->rx_buf_size) {
+        pos -= inst->rx_buf_size;
+    }
+    if (pos + len <= inst->rx_buf_size) {
+        return &ring[pos];
+    }
+    if (scratch == NULL) {
+        return NULL;
+    }
+    uint16_t first = inst->rx_buf_size - pos;
+    memcpy(scratch, &ring[pos], first);
+    memcpy(scratch + first, ring, len - first);
+    return scratch;
+}
+
+void UART_RxCommit(UART_Device *inst, uint16_t len) {
+    uint16_t pos = inst->rx_tail + len;
+    if (pos >= inst->rx_buf_size) {
+        pos -= inst->rx_buf_size;
     }
+    inst->rx_tail = pos;
+    inst->rx_consumed += len;
 }
@@ -11,12 +11,14 @@
 #define UART_MAX_INSTANCE_NUM 3 
 #define UART_RX_DONE_EVENT (0x01 << 0) //接收完成事件
 #define UART_DEFAULT_BUF_SIZE 32  // 添加默认最小缓冲区大小定义
+#define UART_TX_BUF_SIZE 512      // DMA发送环形缓冲区大小,UART_Send放不下时整条丢弃
 
 // 模式选择
 typedef enum {
     UART_MODE_BLOCKING,
     UART_MODE_IT,
-    UART_MODE_DMA
+    UART_MODE_DMA,
+    UART_MODE_DMA_CIRCULAR  // 仅用于接收:DMA循环写入环形缓冲区,消费者通过UART_Rx*接口原地解析
 } UART_Mode;
 
 // 回调触发方式
@@ -25,22 +27,50 @@ typedef enum {
     UART_CALLBACK_EVENT
 } UART_CallbackType;
 
-// UART设备结构体
+// DMA发送统计
 typedef struct {
+    uint32_t queued_bytes;   // 累计放入发送缓冲区的字节数
+    uint32_t sent_bytes;     // 累计发送完成的字节数
+    uint32_t dropped_bytes;  // 缓冲区放不下或DMA出错丢弃的字节数
+    uint32_t dropped_msgs;   // 缓冲区放不下而丢弃的UART_Send调用次数
+    uint32_t dma_starts;     // 启动DMA的次数,多条消息可能合并成一次
+    uint16_t pending;        // 当前缓冲区中等待发送的字节数
+    uint16_t high_water;     // pending的最大值
+} UART_TxStats_t;
+
+// UART设备结构体
+typedef struct UART_Device UART_Device;
+struct UART_Device {
     UART_HandleTypeDef *huart;
     
     // 接收相关
-    uint8_t (*rx_buf)[2];    // 指向外部定义的双缓冲区
-    uint16_t rx_buf_size;    // 缓冲区大小
+    uint8_t (*rx_buf)[2];    // 指向外部定义的双缓冲区,环形模式下为一整块环形缓冲区
+    uint16_t rx_buf_size;    // 单个缓冲区大小,环形模式下为环形缓冲区大小
     volatile uint8_t rx_active_buf;  // 当前活动缓冲区
     uint16_t rx_len;         // 接收数据长度
     uint16_t expected_len;   // 预期长度（0为不定长）
 
+    // 环形接收(UART_MODE_DMA_CIRCULAR),DMA在半满、全满和空闲中断时推进写指针
+    uint16_t rx_head;                // DMA已经写到的位置,只在中断中使用
+    uint16_t rx_tail;                // 消费者已提交的位置
+    volatile uint32_t rx_total;      // 累计收到的字节数
+    uint32_t rx_consumed;            // 累计提交的字节数
+    volatile uint32_t rx_restart_total; // 出错重启DMA时的rx_total,重启后数据从缓冲区开头写入
+    volatile uint8_t rx_restarted;
+    uint32_t rx_overrun;             // 消费者来不及处理,被DMA覆盖而丢弃的字节数
+
     //发送相关
     SemaphoreHandle_t tx_mutex;
+    // DMA发送环形缓冲区,UART_Send拷贝后立即返回,发送完成中断接着发送后面的数据
+    uint8_t tx_buf[UART_TX_BUF_SIZE];
+    uint16_t tx_tail;        // 下一次DMA发送的起点
+    uint16_t tx_count;       // 缓冲区中的字节数,包括正在发送的
+    uint16_t tx_inflight;    // 正在DMA发送的字节数,0表示DMA空闲
+    UART_TxStats_t tx_stats;
     
     // 回调相关
     void (*rx_complete_cb)(uint8_t *data, uint16_t len);
+    void (*rx_ring_cb)(UART_Device *inst); // 环形模式下有新数据时在中断中调用
     EventGroupHandle_t rx_event;
     uint32_t event_flag;
     UART_CallbackType cb_type;
@@ -49,7 +79,7 @@ typedef struct {
     UART_Mode rx_mode;
     UART_Mode tx_mode;
     uint32_t timeout;
-} UART_Device;
+};
 
 // 初始化配置结构体
 typedef struct {
@@ -61,13 +91,52 @@ typedef struct {
     UART_Mode tx_mode;
     uint32_t timeout;
     void (*rx_complete_cb)(uint8_t *data, uint16_t len);
+    void (*rx_ring_cb)(UART_Device *inst); // 环形模式下UART_CALLBACK_DIRECT使用的回调
     UART_CallbackType cb_type;
     uint32_t event_flag;
 } UART_Device_init_config;
 
 // 接口函数
 UART_Device* UART_Init(UART_Device_init_config *config);
-HAL_StatusTypeDef UART_Send(UART_Device *inst, uint8_t *data, uint16_t len);
+/**
+ * @brief 发送数据
+ * @note DMA模式下数据被拷贝到发送缓冲区后立即返回,调用者可以马上修改或释放data;
+ *       可以在中断中调用.阻塞和中断模式下行为不变
+ *
+ * @return HAL_StatusTypeDef HAL_OK成功(DMA模式为已放入缓冲区), HAL_BUSY缓冲区放不下或等待发送超时
+ */
+HAL_StatusTypeDef UART_Send(UART_Device *inst, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief 获取DMA发送统计
+ */
+void UART_GetTxStats(UART_Device *inst, UART_TxStats_t *stats);
 void UART_Deinit(UART_Device *inst);
 
+/* 环形接收接口,只能在一个消费者(任务或rx_ring_cb)中使用 */
+
+/**
+ * @brief 可读的字节数.消费者落后超过一整圈时,被覆盖的数据全部丢弃并计入rx_overrun
+ */
+uint16_t UART_RxAvailable(UART_Device *inst);
+
+/**
+ * @brief 读取读指针之后第offset个字节,offset需小于UART_RxAvailable()
+ */
+uint8_t UART_RxPeekByte(UART_Device *inst, uint16_t offset);
+
+/**
+ * @brief 取读指针之后[offset, offset+len)的数据,不提交
+ * @note 数据在缓冲区内连续时直接返回缓冲区中的地址,不拷贝;跨过缓冲区末尾时拷贝到scratch中再返回scratch
+ *
+ * @param scratch 至少len字节,可以为NULL(此时跨末尾返回NULL)
+ * @return const uint8_t* 数据地址,提交之前有效
+ */
+const uint8_t *UART_RxPeek(UART_Device *inst, uint16_t offset, uint16_t len, uint8_t *scratch);
+
+/**
+ * @brief 提交已经处理完的len字节,释放缓冲区空间
+ */
+void UART_RxCommit(UART_Device *inst, uint16_t len);
+
 #endif /* __BSP_UART_H__ */
@@ -29,6 +29,7 @@
 #include "robot_init.h"
 #include "RGB.h"
 #include "offline.h"
+#include "message_center.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -120,6 +121,7 @@ void StartDefaultTask(void const * argument)
     if (get_system_status()==0) {
     RGB_show(LED_Green);
     }
+    MessageCenter_StatsPoll();
     osDelay(20);
   }
   /* USER CODE END StartDefaultTask */
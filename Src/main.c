@@ -37,6 +37,7 @@
 /* USER CODE BEGIN Includes */
 #include "stm32f407xx.h"
 #include "systemwatch.h"
+#include "dwt.h"
 #include "robot_init.h"
 /* USER CODE END Includes */
 
@@ -214,6 +215,10 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
     HAL_IncTick();
   }
   /* USER CODE BEGIN Callback 1 */
+  if (htim->Instance == TIM14)
+  {
+    DWT_TimerUpdate();
+  }
   if (htim->Instance == TIM6)
   {
     sysytemwatch_it_callback();
@@ -102,7 +102,7 @@ void ChassisInit(void)
     motor_lb = DJIMotorInit(&chassis_motor_config);
 
 
-    chassis_sub = SubRegister("chassis_cmd", sizeof(Chassis_Ctrl_Cmd_s));
+    chassis_sub = SubRegisterTopic(TOPIC_CHASSIS_CMD, Chassis_Ctrl_Cmd_s);
 
     Hit_Check_t hit_check = {
         .is_being_hit = 0,
@@ -117,7 +117,8 @@ void chassis_thread_entry(const void *parameter)
     SystemWatch_RegisterTask(chassisTaskHandle, "chassisTask");
     for (;;) {
         SystemWatch_ReportTaskAlive(osThreadGetId());
-        SubGetMessage(chassis_sub, &chassis_cmd_recv);
+        // 等待cmd发布新的控制指令,收到即被唤醒,最长等待一个原控制周期
+        SubWaitMessage(chassis_sub, &chassis_cmd_recv, 3);
         if (!get_device_status(motor_lf->offline_index)
             && !get_device_status(motor_lb->offline_index)
             && !get_device_status(motor_rf->offline_index)
@@ -225,7 +226,6 @@ void chassis_thread_entry(const void *parameter)
             DJIMotorStop(motor_lb);
             DJIMotorStop(motor_rb);
         }
-        osDelay(3);
     } 
 }
 
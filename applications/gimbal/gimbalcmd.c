@@ -148,8 +148,8 @@ static osThreadId gimbalTaskHandle;
         };
         pitch_motor = DMMotorInit(&pitch_config,MIT_MODE);
 
-        gimbal_sub = SubRegister("gimbal_cmd", sizeof(Gimbal_Ctrl_Cmd_s));
-        gimbal_pub = PubRegister("gimbal_feed", sizeof(Gimbal_Upload_Data_s));
+        gimbal_sub = SubRegisterTopic(TOPIC_GIMBAL_CMD, Gimbal_Ctrl_Cmd_s);
+        gimbal_pub = PubRegisterTopic(TOPIC_GIMBAL_FEED, Gimbal_Upload_Data_s);
     }
 #endif
 
@@ -159,7 +159,8 @@ void gimbal_thread_entry(const void *parameter)
     for (;;)
     {
         SystemWatch_ReportTaskAlive(osThreadGetId());
-        SubGetMessage(gimbal_sub, &gimbal_cmd_recv);
+        // 等待cmd发布新的控制指令,收到即被唤醒,最长等待一个原控制周期
+        SubWaitMessage(gimbal_sub, &gimbal_cmd_recv, 3);
         if (!get_device_status(big_yaw->offline_index) 
          && !get_device_status(small_yaw->offline_index) 
          && !get_device_status(pitch_motor->offline_index) ) 
@@ -305,7 +306,6 @@ void gimbal_thread_entry(const void *parameter)
             // 推送消息
             PubPushMessage(gimbal_pub, (void *)&gimbal_feedback_data);
         }
-        osDelay(3);
     }
 }
 
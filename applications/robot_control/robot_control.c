@@ -1,3 +1,4 @@
+#include "blackbox.h"
 #include "board_com.h"
 #include "can.h"
 #include "dji.h"
@@ -10,6 +11,7 @@
 #include "offline.h"
 #include "robotdef.h"
 #include "vcom.h"
+#include "vcom_msg_codec.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -43,12 +45,21 @@ static void RemoteControlSet(Chassis_Ctrl_Cmd_s *Chassis_Ctrl,Shoot_Ctrl_Cmd_s *
 
             static board_com_t *board_com = NULL; // 板间通讯实例
             static struct Sentry_Send_s sentry_send;
+            /* 黑匣子采样中由应用层填写的部分,在黑匣子任务中调用 */
+            static void BlackBoxFill(BlackBox_Sample_t *sample)
+            {
+                sample->chassis_mode = chassis_cmd_send.chassis_mode;
+                sample->gimbal_mode = gimbal_cmd_send.gimbal_mode;
+                sample->shoot_mode = (shoot_cmd_send.shoot_mode & 0x01) | ((shoot_cmd_send.friction_mode & 0x01) << 1) |
+                                     ((shoot_cmd_send.load_mode & 0x07) << 2);
+                sample->flags = board_com != NULL && board_com->Chassis_Upload_Data.game_progess == 4; // bit0 比赛中
+            }
             void robot_control_init(void)
             {
                 //订阅 发布注册
-                gimbal_cmd_pub = PubRegister("gimbal_cmd", sizeof(Gimbal_Ctrl_Cmd_s));
-                gimbal_feed_sub = SubRegister("gimbal_feed", sizeof(Gimbal_Upload_Data_s));
-                shoot_cmd_pub = PubRegister("shoot_cmd", sizeof(Shoot_Ctrl_Cmd_s));
+                gimbal_cmd_pub = PubRegisterTopic(TOPIC_GIMBAL_CMD, Gimbal_Ctrl_Cmd_s);
+                gimbal_feed_sub = SubRegisterTopic(TOPIC_GIMBAL_FEED, Gimbal_Upload_Data_s);
+                shoot_cmd_pub = PubRegisterTopic(TOPIC_SHOOT_CMD, Shoot_Ctrl_Cmd_s);
 
                 //板间通讯初始化
                 board_com_init_t board_com_config = {
@@ -69,6 +80,7 @@ static void RemoteControlSet(Chassis_Ctrl_Cmd_s *Chassis_Ctrl,Shoot_Ctrl_Cmd_s *
                     }
                 };
                 board_com = board_com_init(&board_com_config);
+                BlackBox_SetFill(BlackBoxFill);
             }
 
             void robot_control(void)
@@ -107,7 +119,6 @@ static void RemoteControlSet(Chassis_Ctrl_Cmd_s *Chassis_Ctrl,Shoot_Ctrl_Cmd_s *
 
                 board_send(&chassis_cmd_send);    
 
-                sentry_send.header = 0xaa;
                 sentry_send.current_hp_percent = board_com->Chassis_Upload_Data.current_hp_percent;
                 sentry_send.projectile_allowance_17mm = board_com->Chassis_Upload_Data.projectile_allowance_17mm;  //剩余发弹量
                 sentry_send.power_management_shooter_output = board_com->Chassis_Upload_Data.power_management_shooter_output; // 功率管理 shooter 输出
@@ -120,20 +131,36 @@ static void RemoteControlSet(Chassis_Ctrl_Cmd_s *Chassis_Ctrl,Shoot_Ctrl_Cmd_s *
                 sentry_send.roll = INS.Roll;
                 sentry_send.pitch = INS.Pitch * (-1);
                 sentry_send.yaw = INS.Yaw;
-                sentry_send.end = 0x0D;
-                uint8_t data[sizeof(struct Sentry_Send_s)]={0};
-                memcpy(data,&sentry_send,sizeof(struct Sentry_Send_s));
-                CDC_Transmit_FS(data,sizeof(struct Sentry_Send_s));           
+                uint8_t data[SENTRY_SEND_LEN];
+                CDC_Transmit_FS(data, SentrySend_Encode(&sentry_send, data));           
             } 
     #else
             static Chassis_referee_Upload_Data_s Chassis_referee_Upload_Data;
             static board_com_t *board_com = NULL; // 板间通讯实例
             static Publisher_t *chassis_cmd_pub;                  // 底盘控制消息发布者
             static Chassis_Ctrl_Cmd_s chassis_cmd_send={0};      // 传递给底盘的控制信息
+            /* 黑匣子采样中由应用层填写的部分,在黑匣子任务中调用 */
+            static void BlackBoxFill(BlackBox_Sample_t *sample)
+            {
+                uint16_t data_len;
+                const ext_game_robot_state_t *robot_state = GetRefereeDataByCmd(ID_game_robot_state, &data_len);
+                const ext_power_heat_data_t *power_heat = GetRefereeDataByCmd(ID_power_heat_data, &data_len);
+                const ext_game_state_t *game_state = GetRefereeDataByCmd(ID_game_state, &data_len);
+
+                sample->chassis_mode = chassis_cmd_send.chassis_mode;
+                if (robot_state != NULL) {
+                    sample->power_limit = robot_state->chassis_power_limit > 255 ? 255 : robot_state->chassis_power_limit;
+                }
+                if (power_heat != NULL) {
+                    sample->buffer_energy = power_heat->buffer_energy > 255 ? 255 : power_heat->buffer_energy;
+                    sample->shooter_heat = power_heat->shooter_17mm_1_barrel_heat;
+                }
+                sample->flags = game_state != NULL && game_state->game_progress == 4; // bit0 比赛中
+            }
             void robot_control_init(void)
             {
                 //订阅注册
-                chassis_cmd_pub = PubRegister("chassis_cmd", sizeof(Chassis_Ctrl_Cmd_s));
+                chassis_cmd_pub = PubRegisterTopic(TOPIC_CHASSIS_CMD, Chassis_Ctrl_Cmd_s);
                 //板间通讯初始化
                 board_com_init_t board_com_config = {
                     .offline_manage_init = {
@@ -153,6 +180,7 @@ static void RemoteControlSet(Chassis_Ctrl_Cmd_s *Chassis_Ctrl,Shoot_Ctrl_Cmd_s *
                     }
                 };
                 board_com = board_com_init(&board_com_config);
+                BlackBox_SetFill(BlackBoxFill);
             }
 
             void robot_control(void)
@@ -365,3 +393,28 @@ static void RemoteControlSet(Chassis_Ctrl_Cmd_s *Chassis_Ctrl,Shoot_Ctrl_Cmd_s *
 #endif
 
 #endif
+
+
+/**
+ * @brief 后台擦除flash的许可,擦除时cpu会停顿1~2s,期间不发送任何控制量
+ *        比赛进行中不擦除,比赛外也只在各模块都是零力(遥控器拨到安全档或离线)时擦除
+ *
+ */
+uint8_t robot_control_flash_erase_allowed(void)
+{
+#if defined (ONE_BOARD)
+    uint16_t data_len;
+    const ext_game_state_t *game_state = GetRefereeDataByCmd(ID_game_state, &data_len);
+    return game_state == NULL || game_state->game_progress != 4;
+#elif defined (GIMBAL_BOARD)
+    uint8_t disarmed = gimbal_cmd_send.gimbal_mode == GIMBAL_ZERO_FORCE &&
+                       chassis_cmd_send.chassis_mode == CHASSIS_ZERO_FORCE &&
+                       shoot_cmd_send.friction_mode == FRICTION_OFF;
+    return disarmed && (board_com == NULL || board_com->Chassis_Upload_Data.game_progess != 4);
+#else
+    uint16_t data_len;
+    const ext_game_state_t *game_state = GetRefereeDataByCmd(ID_game_state, &data_len);
+    return chassis_cmd_send.chassis_mode == CHASSIS_ZERO_FORCE &&
+           (game_state == NULL || game_state->game_progress != 4);
+#endif
+}
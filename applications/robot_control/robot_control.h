@@ -1,9 +1,12 @@
 #ifndef __ROBOT_CONTROL_H
 #define __ROBOT_CONTROL_H
 
+#include <stdint.h>
+
 
 void robot_control(void);
 void robot_control_init(void);
+uint8_t robot_control_flash_erase_allowed(void);
 
 
 #endif
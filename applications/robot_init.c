@@ -1,10 +1,14 @@
 #include "BMI088.h"
+#include "blackbox.h"
+#include "bsp_flash_kv.h"
+#include "can_monitor.h"
 #include "RGB.h"
 #include "SEGGER_RTT.h"
 #include "chassiscmd.h"
 #include "cm_backtrace.h"
 #include "dm_imu.h"
 #include "dwt.h"
+#include "dwt_prof.h"
 #include "elog.h"
 #include "gimbalcmd.h"
 #include "imu.h"
@@ -13,6 +17,7 @@
 #include "offline.h"
 #include "powercontroller.h"
 #include "referee.h"
+#include "robot_control.h"
 #include "robot_task.h"
 #include "sbus.h"
 #include "shootcmd.h"
@@ -34,12 +39,23 @@ void base_init(void)
     SEGGER_RTT_Init();
     if (elog_user_init() == ELOG_NO_ERR) 
     { elog_start();}
+    BSP_Flash_ServiceInit();
+    FlashKV_Init();
     BMI088_init();
 }
 void robot_init(void)
 {
     SystemWatch_Init();
+    BSP_Flash_EraseHooks_t flash_hooks = {
+        .allow = robot_control_flash_erase_allowed,
+        .before = SystemWatch_Suspend,
+        .after = SystemWatch_Resume,
+    };
+    BSP_Flash_SetEraseHooks(&flash_hooks);
+    BlackBox_Init();
+    DWT_ProfInit();
     offline_init();
+    can_monitor_init();
     INS_TASK_init();
     #if defined (GIMBAL_BOARD)
     vcom_init();
@@ -94,7 +94,8 @@ void ShootInit(void)
         .motor_type = M2006,
     };
     loader = DJIMotorInit(&loader_config);
-    shoot_sub = SubRegister("shoot_cmd", sizeof(Shoot_Ctrl_Cmd_s));
+    // 单发等指令是一次性事件,用队列订阅避免发射任务来不及处理时被新指令覆盖
+    shoot_sub = SubRegisterTopicQueue(TOPIC_SHOOT_CMD, Shoot_Ctrl_Cmd_s, 4, QUEUE_DROP_OLDEST);
 }
 
 /* 机器人发射机构控制核心任务 */
@@ -104,12 +105,12 @@ void shootask(const void *parameter)
     for (;;)
     {
         SystemWatch_ReportTaskAlive(osThreadGetId());
-        // 从cmd获取控制数据
+        // 从cmd获取控制数据,收到新指令即被唤醒,最长等待一个原控制周期
+        SubWaitMessage(shoot_sub, &shoot_cmd_recv, 3);
         if (   !get_device_status(friction_l->offline_index)
             && !get_device_status(friction_r->offline_index)
             && !get_device_status(loader->offline_index)) 
         {
-            SubGetMessage(shoot_sub, &shoot_cmd_recv);
             if (shoot_cmd_recv.shoot_mode ==SHOOT_ON)
             {
                 DJIMotorEnable(friction_l);
@@ -159,7 +160,6 @@ void shootask(const void *parameter)
             DJIMotorStop(friction_r);
             DJIMotorStop(loader);
         }
-        osDelay(3);
     }
 }
 void shoot_task_init(void){
@@ -4,11 +4,15 @@
 #include "BMI088_reg.h"
 #include "BMI088.h"
 #include "bsp_flash.h"
+#include "bsp_flash_kv.h"
+#include "bsp_gpio.h"
 #include "bsp_spi.h"
 #include "controller.h"
 #include "RGB.h"
 #include "dwt.h"
 #include "tim.h"
+#include "spi.h"
+#include "cmsis_os.h"
 
 #ifndef abs
 #define abs(x) ((x > 0) ? x : -x)
@@ -27,6 +31,90 @@ static SPI_DeviceInstance_t *bmi_acc_device;
 static void bmi088_get_accel(void);
 static void bmi088_get_gyro(void);
 
+#if BMI088_USE_IRQ
+/* 中断触发DMA读取:
+   INT1(加速度计)和INT3(陀螺仪)的下降沿中断中打时间戳并向SPI1的异步队列提交DMA突发读取,
+   两个传感器各自维护读取状态,可以同时在队列中,一个读完后总线在DMA中断中直接开始另一个.
+   陀螺仪样本读完后通知INS任务,INS任务不再访问SPI.
+   BMI088_USE_FIFO为0时中断为数据就绪中断,每次读一个样本;
+   为1时中断为FIFO水位中断,先读FIFO中的数据量,再一次读出所有帧,按输出频率推算每帧的时间戳 */
+#define BMI088_READ_ACC  0x01
+#define BMI088_READ_GYRO 0x02
+
+#if BMI088_USE_FIFO
+#define BMI088_FIFO_READ_FRAMES 32   // 一次最多读出的帧数,剩余的接着再读
+#define BMI088_GYRO_ODR_HZ 2000
+#define BMI088_ACC_ODR_HZ 800
+#define BMI088_ACC_DMA_LEN  (2 + BMI088_ACC_FIFO_FRAME_LEN * BMI088_FIFO_READ_FRAMES)
+#define BMI088_GYRO_DMA_LEN (1 + BMI088_GYRO_FIFO_FRAME_LEN * BMI088_FIFO_READ_FRAMES)
+#define BMI088_ACC_LEN_READ_LEN (2 + BMI088_ACC_FIFO_LENGTH_1 - BMI088_TEMP_M + 1) // 0x22~0x25,顺带读出温度
+#define BMI088_GYRO_STATUS_READ_LEN 2
+#else
+#define BMI088_ACC_DMA_LEN  (2 + BMI088_TEMP_L - BMI088_ACCEL_XOUT_L + 1) // 命令+dummy字节,0x12~0x23连续读出加速度和温度
+#define BMI088_GYRO_DMA_LEN (1 + 6)                                      // 命令,0x02~0x07
+#endif
+
+typedef struct
+{
+    int16_t acc[3];
+    int16_t gyro[3];
+    int16_t temp;
+    uint64_t acc_cycle;
+    uint64_t gyro_cycle;
+} BMI088_Raw_t;
+
+/* 一个传感器的读取状态,只在EXTI和SPI DMA中断中修改,两者优先级相同不会互相打断 */
+typedef struct
+{
+    uint8_t which;
+    uint8_t *tx;
+    uint8_t *rx;
+    SPI_Transfer_t xfer;
+    uint64_t irq_cycle;         // 中断的时间戳
+    uint64_t read_cycle;        // 正在读取的样本的时间戳
+#if BMI088_USE_FIFO
+    uint8_t irq_fresh;          // 有还未用于推算时间戳的水位中断
+    uint8_t irq_in_read;        // 水位中断到来时正在读取,读完后FIFO开头会前移
+    uint8_t irq_offset;         // 水位中断之后从FIFO中读走的帧数
+    uint8_t read_fresh;         // 正在读取的这批数据对应一次新的水位中断
+    uint8_t read_offset;
+    uint8_t phase;              // 0读取数据量,1读取数据
+    uint16_t fifo_len;          // 第二阶段要读出的帧数(陀螺仪)或字节数(加速度计)
+    uint8_t more;               // FIFO中的数据超过一次能读出的量
+    uint64_t last_cycle;        // 上一帧的时间戳
+#endif
+} BMI088_Reader_t;
+
+static uint8_t acc_dma_tx[BMI088_ACC_DMA_LEN], acc_dma_rx[BMI088_ACC_DMA_LEN];
+static uint8_t gyro_dma_tx[BMI088_GYRO_DMA_LEN], gyro_dma_rx[BMI088_GYRO_DMA_LEN];
+static BMI088_Reader_t bmi_reader[2] = {
+    {.which = BMI088_READ_ACC, .tx = acc_dma_tx, .rx = acc_dma_rx},
+    {.which = BMI088_READ_GYRO, .tx = gyro_dma_tx, .rx = gyro_dma_rx}};
+static BMI088_Raw_t bmi_raw;          // 最新样本,任务中读取时需要进入临界区
+static uint8_t bmi_pending;           // 等待读取的传感器
+static uint8_t bmi_reading;           // 已提交读取还未完成的传感器
+static volatile uint8_t bmi_irq_ready; // 初始化和标定完成前忽略中断
+static TaskHandle_t bmi_notify_task;
+static BMI088_IrqStats_t bmi_stats;
+
+#if BMI088_USE_FIFO
+typedef struct
+{
+    int16_t v[BMI088_BATCH_LEN][3];
+    uint64_t cycle[BMI088_BATCH_LEN];
+    uint8_t head;
+    uint8_t count;
+} BMI088_SampleQueue_t;
+
+static BMI088_SampleQueue_t gyro_queue, acc_queue; // 中断写入,BMI088_GetBatch()取走
+#endif
+
+#define BMI088_READER(which) (&bmi_reader[(which) == BMI088_READ_GYRO])
+
+static void bmi088_dma_cplt(SPI_Transfer_t *xfer, HAL_StatusTypeDef status);
+static void bmi088_start_read(void);
+#endif
+
 
 /* 内部使用的bmi088读写函数*/
 void _bmi088_writedata(SPI_DeviceInstance_t *device  , const uint8_t addr, const uint8_t *data, const uint8_t data_len){
@@ -35,10 +123,10 @@ void _bmi088_writedata(SPI_DeviceInstance_t *device  , const uint8_t addr, const
 }
 
 void _bmi088_readdata(SPI_DeviceInstance_t *device  , const uint8_t addr, uint8_t *data, const uint8_t data_len){
-    static uint8_t tmp[8];
-    static uint8_t tx[8]={0};
+    uint8_t tmp[8] = {0};     // 阻塞传输,用栈上的缓冲区,可以在多个任务中同时调用;总线超时读到的是0
+    uint8_t tx[8]={0};
 
-    configASSERT(data_len <= 6)
+    configASSERT(data_len <= 6);
 
     if (device==bmi_acc_device)
     {
@@ -216,6 +304,49 @@ void bmi088_gyro_init(void){
     }
 }
 
+#if BMI088_USE_IRQ && BMI088_USE_FIFO
+// FIFO模式的配置,在初始化和标定完成后写入,陀螺仪改为2kHz输出,中断改为FIFO水位中断
+static uint8_t BMI088_Accel_Fifo_Table[][3] =
+    {
+        {BMI088_ACC_FIFO_DOWNS, BMI088_ACC_FIFO_DOWNS_MUST_Set, BMI088_FIFO_CONFIG_ERROR},
+        {BMI088_ACC_FIFO_WTM_0, (BMI088_ACC_FIFO_WM * BMI088_ACC_FIFO_FRAME_LEN) & 0xFF, BMI088_FIFO_CONFIG_ERROR},
+        {BMI088_ACC_FIFO_WTM_1, (BMI088_ACC_FIFO_WM * BMI088_ACC_FIFO_FRAME_LEN) >> 8, BMI088_FIFO_CONFIG_ERROR},
+        {BMI088_ACC_FIFO_CONFIG_0, BMI088_ACC_FIFO_STREAM_MODE, BMI088_FIFO_CONFIG_ERROR},
+        {BMI088_ACC_FIFO_CONFIG_1, BMI088_ACC_FIFO_ACC_EN, BMI088_FIFO_CONFIG_ERROR},
+        {BMI088_INT_MAP_DATA, BMI088_ACC_INT1_FWM_INTERRUPT, BMI088_INT_MAP_DATA_ERROR}};
+static uint8_t BMI088_Gyro_Fifo_Table[][3] =
+    {
+        {BMI088_GYRO_BANDWIDTH, BMI088_GYRO_2000_230_HZ | BMI088_GYRO_BANDWIDTH_MUST_Set, BMI088_GYRO_BANDWIDTH_ERROR},
+        {BMI088_GYRO_FIFO_CONFIG_0, BMI088_GYRO_FIFO_WM, BMI088_FIFO_CONFIG_ERROR},
+        {BMI088_GYRO_FIFO_CONFIG_1, BMI088_GYRO_FIFO_STREAM_MODE, BMI088_FIFO_CONFIG_ERROR},
+        {BMI088_GYRO_FIFO_WM_EN, BMI088_GYRO_FIFO_WM_ON, BMI088_FIFO_CONFIG_ERROR},
+        {BMI088_GYRO_CTRL, BMI088_GYRO_FIFO_INT_ON, BMI088_GYRO_CTRL_ERROR},
+        {BMI088_GYRO_INT3_INT4_IO_MAP, BMI088_GYRO_FIFO_IO_INT3, BMI088_GYRO_INT3_INT4_IO_MAP_ERROR}};
+
+static void bmi088_write_table(SPI_DeviceInstance_t *device, uint8_t (*table)[3], uint8_t num)
+{
+    uint8_t tmp = 0;
+    for (uint8_t i = 0; i < num; i++)
+    {
+        _bmi088_writedata(device, table[i][BMI088REG], &table[i][BMI088DATA], 1);
+        DWT_Delay(0.001);
+        _bmi088_readdata(device, table[i][BMI088REG], &tmp, 1);// 写完之后立刻读回检查
+        DWT_Delay(0.001);
+        if (tmp != table[i][BMI088DATA])
+        {
+            BMI088_Data.BMI088_ERORR_CODE = table[i][BMI088ERROR];
+            log_e("FIFO Init failed reg:%d\r\n", table[i][BMI088REG]);
+        }
+    }
+}
+
+void bmi088_fifo_init(void)
+{
+    bmi088_write_table(bmi_acc_device, BMI088_Accel_Fifo_Table, sizeof(BMI088_Accel_Fifo_Table) / sizeof(BMI088_Accel_Fifo_Table[0]));
+    bmi088_write_table(bmi_gyro_device, BMI088_Gyro_Fifo_Table, sizeof(BMI088_Gyro_Fifo_Table) / sizeof(BMI088_Gyro_Fifo_Table[0]));
+}
+#endif
+
 void bmi088_imu_temp_init(void){
     HAL_TIM_Base_Start(&htim10);
     HAL_TIM_PWM_Start(&htim10,TIM_CHANNEL_1);
@@ -223,33 +354,404 @@ void bmi088_imu_temp_init(void){
 }
 
 
+/* 温度寄存器为11位补码,高8位在TEMP_MSB,低3位在TEMP_LSB的高3位 */
+static int16_t bmi088_parse_temp(const uint8_t buf[2])
+{
+    int16_t tmp = (((buf[0] << 3) | (buf[1] >> 5)));
+    if (tmp > 1023)
+    {
+        tmp-=2048;
+    }
+    return tmp;
+}
+
+/* 原始数据换算为物理量,应用标定结果 */
+static void bmi088_convert_acc(const int16_t raw[3], float acc[3])
+{
+    for (uint8_t i = 0; i < 3; i++)
+        {acc[i] = (BMI088_ACCEL_6G_SEN) * (float)raw[i] * BMI088_Data.AccelScale;}
+}
+
+static void bmi088_convert_gyro(const int16_t raw[3], float gyro[3])
+{
+    for (uint8_t i = 0; i < 3; i++)
+        {gyro[i] = BMI088_GYRO_2000_SEN * (float)raw[i] - BMI088_Data.GyroOffset[i];}
+}
+
+static void bmi088_convert(const int16_t acc[3], const int16_t gyro[3], int16_t temp)
+{
+    bmi088_convert_acc(acc, BMI088_Data.acc);
+    bmi088_convert_gyro(gyro, BMI088_Data.gyro);
+    BMI088_Data.temperature = (float)temp*BMI088_TEMP_FACTOR + BMI088_TEMP_OFFSET;
+}
+
 void BMI088_data_acquire(void)
 {
     static uint8_t buf[6] = {0}; // 最多读取6个byte(gyro/acc,temp是2)
+    int16_t acc[3], gyro[3];
     // 读取accel的x轴数据首地址,bmi088内部自增读取地址 // 3* sizeof(int16_t)
     _bmi088_readdata(bmi_acc_device, BMI088_ACCEL_XOUT_L, buf, 6);
     for (uint8_t i = 0; i < 3; i++)
-        {BMI088_Data.acc[i] = (BMI088_ACCEL_6G_SEN) * (float)(int16_t)(((buf[2 * i + 1]) << 8) | buf[2 * i])* BMI088_Data.AccelScale;}
+        {acc[i] = (int16_t)(((buf[2 * i + 1]) << 8) | buf[2 * i]);}
     _bmi088_readdata(bmi_gyro_device, BMI088_GYRO_X_L, buf, 6); // 连续读取3个(3*2=6)轴的角速度
     for (uint8_t i = 0; i < 3; i++)
-        {BMI088_Data.gyro[i] = BMI088_GYRO_2000_SEN * (float)(int16_t)(((buf[2 * i + 1]) << 8) | buf[2 * i]) - BMI088_Data.GyroOffset[i];}
+        {gyro[i] = (int16_t)(((buf[2 * i + 1]) << 8) | buf[2 * i]);}
     _bmi088_readdata(bmi_acc_device, BMI088_TEMP_M, buf, 2);// 读温度,温度传感器在accel上
-    int16_t tmp = (((buf[0] << 3) | (buf[1] >> 5)));
-    if (tmp > 1023)
-    {
-        tmp-=2048;
-    }
-    BMI088_Data.temperature = (float)(int16_t)tmp*BMI088_TEMP_FACTOR + BMI088_TEMP_OFFSET;
+    bmi088_convert(acc, gyro, bmi088_parse_temp(buf));
 }
 
 BMI088_GET_Data_t BMI088_GET_DATA(void){
-    BMI088_data_acquire();
     BMI088_GET_Data_t data;
+#if BMI088_USE_IRQ
+    BMI088_Raw_t raw;
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    raw = bmi_raw;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    bmi088_convert(raw.acc, raw.gyro, raw.temp);
+    data.gyro_cycle = raw.gyro_cycle;
+    data.acc_cycle = raw.acc_cycle;
+#else
+    BMI088_data_acquire();
+    data.gyro_cycle = DWT_GetCycle64();
+    data.acc_cycle = data.gyro_cycle;
+#endif
     data.acc =  (const float (*)[3])&BMI088_Data.acc;    // 使用类型转换确保类型匹配
     data.gyro = (const float (*)[3])&BMI088_Data.gyro;   // 使用类型转换确保类型匹配
     return data; 
 }
 
+uint8_t BMI088_WaitData(uint32_t timeout_ms)
+{
+#if BMI088_USE_IRQ
+    if (bmi_notify_task == NULL) {
+        bmi_notify_task = (TaskHandle_t)osThreadGetId();
+    }
+    // 积压的多次通知一并清除,只处理最新的样本
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) > 0) {
+        return 1;
+    }
+#if BMI088_USE_FIFO
+    // FIFO中的数据已经超过水位时不会再产生水位中断,主动读一次恢复
+    if (bmi_irq_ready) {
+        UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+        bmi_pending |= BMI088_READ_ACC | BMI088_READ_GYRO;
+        bmi088_start_read();
+        taskEXIT_CRITICAL_FROM_ISR(mask);
+    }
+#endif
+    return 0;
+#else
+    UNUSED(timeout_ms);
+    osDelay(1);
+    return 1;
+#endif
+}
+
+uint8_t BMI088_GetBatch(BMI088_Batch_t *batch)
+{
+#if BMI088_USE_IRQ && BMI088_USE_FIFO
+    static BMI088_SampleQueue_t gyro, acc; // 只在调用者任务中使用,避免占用任务栈
+    int16_t temp;
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    gyro = gyro_queue;
+    acc = acc_queue;
+    gyro_queue.count = 0;
+    acc_queue.count = 0;
+    temp = bmi_raw.temp;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+
+    for (uint8_t i = 0; i < gyro.count; i++) {
+        uint8_t idx = (gyro.head + i) % BMI088_BATCH_LEN;
+        bmi088_convert_gyro(gyro.v[idx], batch->gyro[i]);
+        batch->gyro_cycle[i] = gyro.cycle[idx];
+    }
+    for (uint8_t i = 0; i < acc.count; i++) {
+        uint8_t idx = (acc.head + i) % BMI088_BATCH_LEN;
+        bmi088_convert_acc(acc.v[idx], batch->acc[i]);
+        batch->acc_cycle[i] = acc.cycle[idx];
+    }
+    batch->gyro_num = gyro.count;
+    batch->acc_num = acc.count;
+    // FIFO中没有温度,温度在读取FIFO数据量时顺带读出
+    BMI088_Data.temperature = (float)temp*BMI088_TEMP_FACTOR + BMI088_TEMP_OFFSET;
+    return batch->gyro_num;
+#else
+    batch->gyro_num = 0;
+    batch->acc_num = 0;
+    return 0;
+#endif
+}
+
+void BMI088_GetIrqStats(BMI088_IrqStats_t *stats)
+{
+#if BMI088_USE_IRQ
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    *stats = bmi_stats;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+#if BMI088_USE_IRQ
+/* 向SPI队列提交一次DMA读取,队列满时记为待读取 */
+static uint8_t bmi088_spi_start(BMI088_Reader_t *r, uint16_t len)
+{
+    r->xfer.size = len;
+    if (BSP_SPI_Submit(&r->xfer) != HAL_OK) {
+        bmi_stats.bus_busy++;
+        bmi_pending |= r->which;
+        return 0;
+    }
+    bmi_reading |= r->which;
+    return 1;
+}
+
+/* 为待读取且没有在读的传感器提交读取,陀螺仪先提交,在中断或临界区中调用 */
+static void bmi088_start_read(void)
+{
+    for (int8_t idx = 1; idx >= 0; idx--) {
+        BMI088_Reader_t *r = &bmi_reader[idx];
+        if (!(bmi_pending & r->which) || (bmi_reading & r->which)) {
+            continue;
+        }
+        bmi_pending &= ~r->which;
+#if BMI088_USE_FIFO
+        // 第一阶段:读FIFO中的数据量
+        if (r->which == BMI088_READ_GYRO) {
+            r->tx[0] = BMI088_SPI_READ_CODE | BMI088_GYRO_FIFO_STATUS;
+        } else {
+            r->tx[0] = BMI088_SPI_READ_CODE | BMI088_TEMP_M;
+        }
+        // 先记下这次读取对应的中断,提交后可能立即开始传输
+        r->phase = 0;
+        r->read_fresh = r->irq_fresh;
+        r->read_cycle = r->irq_cycle;
+        r->read_offset = r->irq_offset;
+        r->irq_fresh = 0;
+        r->irq_offset = 0;
+        if (!bmi088_spi_start(r, r->which == BMI088_READ_GYRO ? BMI088_GYRO_STATUS_READ_LEN : BMI088_ACC_LEN_READ_LEN)) {
+            r->irq_fresh = r->read_fresh;
+            r->irq_offset = r->read_offset;
+        }
+#else
+        r->read_cycle = r->irq_cycle;
+        bmi088_spi_start(r, r->which == BMI088_READ_GYRO ? BMI088_GYRO_DMA_LEN : BMI088_ACC_DMA_LEN);
+#endif
+    }
+}
+
+#if BMI088_USE_FIFO
+static void bmi088_queue_push(BMI088_SampleQueue_t *q, const uint8_t *le, uint64_t cycle)
+{
+    uint8_t idx;
+    if (q->count == BMI088_BATCH_LEN) {
+        // 任务来不及取,覆盖最旧的样本
+        q->head = (q->head + 1) % BMI088_BATCH_LEN;
+        q->count--;
+        bmi_stats.dropped++;
+    }
+    idx = (q->head + q->count) % BMI088_BATCH_LEN;
+    for (uint8_t i = 0; i < 3; i++)
+        {q->v[idx][i] = (int16_t)((le[2 * i + 1] << 8) | le[2 * i]);}
+    q->cycle[idx] = cycle;
+    q->count++;
+}
+
+/**
+ * @brief 推算一批帧中第一帧的时间戳
+ * @note 水位中断在FIFO中的帧数达到水位时产生,即第wm帧(从0数为wm-1)在中断时刻写入,其余帧按输出周期前后推算;
+ *       中断之后又读走了offset帧时,这一帧在本批中的位置相应前移.
+ *       同一次中断的数据没读完而接着读时,接着上一帧往后推;还没有上一帧时(刚启动),认为最后一帧是刚写入的
+ */
+static uint64_t bmi088_first_frame_cycle(const BMI088_Reader_t *r, uint8_t wm, uint32_t period, uint16_t frames)
+{
+    if (r->read_fresh) {
+        return r->read_cycle + ((int64_t)r->read_offset - (wm - 1)) * (int64_t)period;
+    }
+    if (r->last_cycle == 0) {
+        return DWT_GetCycle64() - (uint64_t)(frames - 1) * period;
+    }
+    return r->last_cycle + period;
+}
+
+/* 解析陀螺仪FIFO数据,每帧6字节 */
+static void bmi088_parse_gyro_fifo(BMI088_Reader_t *r, const uint8_t *buf, uint16_t frames)
+{
+    uint32_t period = SystemCoreClock / BMI088_GYRO_ODR_HZ;
+    uint64_t cycle = bmi088_first_frame_cycle(r, BMI088_GYRO_FIFO_WM, period, frames);
+    for (uint16_t i = 0; i < frames; i++, cycle += period) {
+        bmi088_queue_push(&gyro_queue, &buf[i * BMI088_GYRO_FIFO_FRAME_LEN], cycle);
+    }
+    const uint8_t *last = &buf[(frames - 1) * BMI088_GYRO_FIFO_FRAME_LEN];
+    for (uint8_t i = 0; i < 3; i++)
+        {bmi_raw.gyro[i] = (int16_t)((last[2 * i + 1] << 8) | last[2 * i]);}
+    r->last_cycle = cycle - period;
+    bmi_raw.gyro_cycle = r->last_cycle;
+    bmi_stats.gyro_samples += frames;
+}
+
+/* 解析加速度计FIFO数据,按帧头区分帧类型,只取加速度帧,返回加速度帧数 */
+static uint16_t bmi088_parse_acc_fifo(BMI088_Reader_t *r, const uint8_t *buf, uint16_t len)
+{
+    const uint8_t *frame[BMI088_FIFO_READ_FRAMES];
+    uint16_t frames = 0, i = 0;
+    while (i < len) {
+        uint8_t header = buf[i];
+        if ((header & 0xFC) == BMI088_ACC_FIFO_HEADER_ACC) {
+            if (i + BMI088_ACC_FIFO_FRAME_LEN > len || frames == BMI088_FIFO_READ_FRAMES) {
+                break; // 没读完整的帧留在FIFO中,下次重新读出
+            }
+            frame[frames++] = &buf[i + 1];
+            i += BMI088_ACC_FIFO_FRAME_LEN;
+        } else if (header == BMI088_ACC_FIFO_HEADER_SKIP) {
+            bmi_stats.overrun++;
+            i += 2;
+        } else if (header == BMI088_ACC_FIFO_HEADER_TIME) {
+            i += 4;
+        } else if (header == BMI088_ACC_FIFO_HEADER_CONFIG || header == BMI088_ACC_FIFO_HEADER_DROP) {
+            i += 2;
+        } else {
+            break; // 0x80为FIFO已空
+        }
+    }
+    if (frames == 0) {
+        return 0;
+    }
+    uint32_t period = SystemCoreClock / BMI088_ACC_ODR_HZ;
+    uint64_t cycle = bmi088_first_frame_cycle(r, BMI088_ACC_FIFO_WM, period, frames);
+    for (uint16_t k = 0; k < frames; k++, cycle += period) {
+        bmi088_queue_push(&acc_queue, frame[k], cycle);
+    }
+    for (uint8_t k = 0; k < 3; k++)
+        {bmi_raw.acc[k] = (int16_t)((frame[frames - 1][2 * k + 1] << 8) | frame[frames - 1][2 * k]);}
+    r->last_cycle = cycle - period;
+    bmi_raw.acc_cycle = r->last_cycle;
+    bmi_stats.acc_samples += frames;
+    return frames;
+}
+
+/**
+ * @brief FIFO模式下一次传输结束的处理
+ *
+ * @return uint8_t 是否读到了新的陀螺仪样本
+ */
+static uint8_t bmi088_fifo_cplt(BMI088_Reader_t *r)
+{
+    if (r->phase == 0) {
+        // 第一阶段结束,按数据量发起第二阶段读取
+        if (r->which == BMI088_READ_GYRO) {
+            uint8_t status = r->rx[1];
+            uint16_t frames = status & BMI088_GYRO_FIFO_COUNT_MASK;
+            if (status & BMI088_GYRO_FIFO_OVERRUN) {
+                bmi_stats.overrun++;
+            }
+            r->more = frames > BMI088_FIFO_READ_FRAMES;
+            r->fifo_len = r->more ? BMI088_FIFO_READ_FRAMES : frames;
+            r->tx[0] = BMI088_SPI_READ_CODE | BMI088_GYRO_FIFO_DATA;
+        } else {
+            bmi_raw.temp = bmi088_parse_temp(&r->rx[2]);
+            uint16_t bytes = ((uint16_t)(r->rx[5] & 0x3F) << 8) | r->rx[4];
+            r->more = bytes > BMI088_ACC_DMA_LEN - 2;
+            r->fifo_len = r->more ? BMI088_ACC_DMA_LEN - 2 : bytes;
+            r->tx[0] = BMI088_SPI_READ_CODE | BMI088_ACC_FIFO_DATA;
+        }
+        if (r->fifo_len == 0) {
+            r->irq_in_read = 0;
+            return 0;
+        }
+        r->phase = 1;
+        uint16_t len = r->which == BMI088_READ_GYRO ? 1 + r->fifo_len * BMI088_GYRO_FIFO_FRAME_LEN : 2 + r->fifo_len;
+        if (!bmi088_spi_start(r, len)) {
+            r->irq_fresh |= r->read_fresh; // 重新从第一阶段开始时仍按这次中断推算时间戳
+        }
+        return 0;
+    }
+
+    // 第二阶段结束,解析数据
+    uint16_t frames;
+    if (r->which == BMI088_READ_GYRO) {
+        bmi088_parse_gyro_fifo(r, &r->rx[1], r->fifo_len);
+        frames = r->fifo_len;
+    } else {
+        frames = bmi088_parse_acc_fifo(r, &r->rx[2], r->fifo_len);
+    }
+    if (r->irq_in_read) {
+        r->irq_offset = frames;
+        r->irq_in_read = 0;
+    }
+    r->read_fresh = 0;
+    if (r->more) {
+        bmi_pending |= r->which; // 剩余的数据不会再产生水位中断,接着读
+    }
+    return r->which == BMI088_READ_GYRO;
+}
+#endif
+
+/* SPI DMA传输结束回调,在中断中调用,此时总线可能已经开始另一个传感器的读取 */
+static void bmi088_dma_cplt(SPI_Transfer_t *xfer, HAL_StatusTypeDef status)
+{
+    BaseType_t woken = pdFALSE;
+    BMI088_Reader_t *r = (BMI088_Reader_t *)xfer->arg;
+    uint8_t new_gyro = 0;
+    bmi_reading &= ~r->which;
+
+    if (status != HAL_OK) {
+        bmi_stats.spi_error++;
+#if BMI088_USE_FIFO
+        bmi_pending |= r->which; // 重新读取,否则FIFO中的数据不会再产生水位中断
+        r->irq_fresh |= r->read_fresh;
+#endif
+    } else {
+#if BMI088_USE_FIFO
+        new_gyro = bmi088_fifo_cplt(r);
+#else
+        if (r->which == BMI088_READ_GYRO) {
+            for (uint8_t i = 0; i < 3; i++)
+                {bmi_raw.gyro[i] = (int16_t)((r->rx[2 * i + 2] << 8) | r->rx[2 * i + 1]);}
+            bmi_raw.gyro_cycle = r->read_cycle;
+            bmi_stats.gyro_samples++;
+            new_gyro = 1;
+        } else {
+            for (uint8_t i = 0; i < 3; i++)
+                {bmi_raw.acc[i] = (int16_t)((r->rx[2 * i + 3] << 8) | r->rx[2 * i + 2]);}
+            bmi_raw.temp = bmi088_parse_temp(&r->rx[2 + BMI088_TEMP_M - BMI088_ACCEL_XOUT_L]);
+            bmi_raw.acc_cycle = r->read_cycle;
+            bmi_stats.acc_samples++;
+        }
+#endif
+    }
+    if (new_gyro && bmi_notify_task) {
+        vTaskNotifyGiveFromISR(bmi_notify_task, &woken);
+    }
+    bmi088_start_read();
+    portYIELD_FROM_ISR(woken);
+}
+
+/* INT1/INT3的EXTI回调,由bsp_gpio按引脚分发,arg为对应传感器的读取状态 */
+static void bmi088_exti(uint16_t pin, void *arg)
+{
+    UNUSED(pin);
+    BMI088_Reader_t *r = arg;
+    uint8_t which = r->which;
+    if (!bmi_irq_ready) {
+        return;
+    }
+#if BMI088_USE_FIFO
+    r->irq_fresh = 1;
+    r->irq_offset = 0;
+    r->irq_in_read = (bmi_reading & which) != 0;
+#else
+    if (bmi_pending & which) {
+        bmi_stats.overrun++;
+    }
+#endif
+    r->irq_cycle = DWT_GetCycle64();
+    bmi_pending |= which;
+    bmi088_start_read();
+}
+#endif
+
 void bmi088_get_accel(void)
 {
     static uint8_t buf[6] = {0}; // 最多读取6个byte(gyro/acc,temp是2)
@@ -259,12 +761,7 @@ void bmi088_get_accel(void)
         {BMI088_Data.acc[i] = (BMI088_ACCEL_6G_SEN) * (float)((int16_t)((buf[2 * i + 1]) << 8) | buf[2 * i]);}
 
     _bmi088_readdata(bmi_acc_device, BMI088_TEMP_M, buf, 2);// 读温度,温度传感器在accel上
-    int16_t tmp = (((buf[0] << 3) | (buf[1] >> 5)));
-    if (tmp > 1023)
-    {
-        tmp-=2048;
-    }
-    BMI088_Data.temperature = (float)(int16_t)tmp*BMI088_TEMP_FACTOR + BMI088_TEMP_OFFSET;
+    BMI088_Data.temperature = (float)bmi088_parse_temp(buf)*BMI088_TEMP_FACTOR + BMI088_TEMP_OFFSET;
 }
 
 void bmi088_get_gyro(void)
@@ -276,6 +773,57 @@ void bmi088_get_gyro(void)
 }
 
 
+/* 保存在参数存储中的标定结果 */
+typedef struct
+{
+    float gyro_offset[3];
+    float g_norm;
+    float temp_when_cali;
+} BMI088_Cali_t;
+
+static uint8_t cali_unsaved;        // 参数存储忙(另一个扇区等待后台擦除)时标定结果还没保存
+static uint32_t cali_retry_tick;
+
+static void bmi088_save_cali(void)
+{
+    BMI088_Cali_t cali;
+    memcpy(cali.gyro_offset, BMI088_Data.GyroOffset, sizeof(cali.gyro_offset));
+    cali.g_norm = BMI088_Data.gNorm;
+    cali.temp_when_cali = BMI088_Data.TempWhenCali;
+    cali_unsaved = FlashKV_Set(FLASHKV_KEY_IMU_CALI, &cali, sizeof(cali)) == FLASH_ERR_BUSY;
+    cali_retry_tick = osKernelSysTick();
+}
+
+/**
+ * @brief 读取标定结果
+ * @note 参数存储是新格式化的时候,扇区11中可能还有旧版本直接写入的标定数据(第31字节为0xAA),读出后转存
+ *
+ * @return uint8_t 是否有标定结果
+ */
+static uint8_t bmi088_load_cali(void)
+{
+    BMI088_Cali_t cali;
+    FlashKV_Stats_t stats;
+    if (FlashKV_Get(FLASHKV_KEY_IMU_CALI, &cali, sizeof(cali)) != sizeof(cali)) {
+        uint8_t tmpdata[32] = {0};
+        FlashKV_GetStats(&stats);
+        BSP_Flash_Read(ADDR_FLASH_SECTOR_11, tmpdata, sizeof(tmpdata));
+        if (!stats.formatted || tmpdata[31] != 0XAA) {
+            return 0;
+        }
+        memcpy(&cali, tmpdata, sizeof(cali)); // 旧格式的前20字节与BMI088_Cali_t相同
+        cali_unsaved = 1;
+    }
+    memcpy(BMI088_Data.GyroOffset, cali.gyro_offset, sizeof(cali.gyro_offset));
+    BMI088_Data.gNorm        = cali.g_norm;
+    BMI088_Data.TempWhenCali = cali.temp_when_cali;
+    BMI088_Data.AccelScale   = 9.81f / BMI088_Data.gNorm;
+    if (cali_unsaved) {
+        bmi088_save_cali();
+    }
+    return 1;
+}
+
 void Calibrate_MPU_Offset(void)
 {
     static float dt,t;
@@ -393,16 +941,7 @@ void Calibrate_MPU_Offset(void)
 
     BMI088_Data.AccelScale = 9.81f / BMI088_Data.gNorm;
 
-    uint8_t tmpdata[32]={0};
-    memcpy(tmpdata,&BMI088_Data.GyroOffset[0],sizeof(BMI088_Data.GyroOffset));
-    memcpy(tmpdata+4,&BMI088_Data.GyroOffset[1],sizeof(BMI088_Data.GyroOffset));
-    memcpy(tmpdata+8,&BMI088_Data.GyroOffset[2],sizeof(BMI088_Data.GyroOffset));
-    memcpy(tmpdata+12,&BMI088_Data.gNorm,sizeof(BMI088_Data.gNorm));
-    memcpy(tmpdata+16,&BMI088_Data.TempWhenCali,sizeof(BMI088_Data.TempWhenCali));
-    tmpdata[31]=0XAA;
-
-    BSP_Flash_Erase(FLASH_SECTOR_11, 1);
-    BSP_Flash_Write(ADDR_FLASH_SECTOR_11, tmpdata, sizeof(tmpdata));
+    bmi088_save_cali();
     log_i("calibrate MPU offset finished!\n");
 }
 
@@ -410,6 +949,14 @@ void Calibrate_MPU_Offset(void)
 void bmi088_temp_ctrl(void) {
     PIDCalculate(&BMI088_Data.imu_temp_pid, BMI088_Data.temperature, 40);
     __HAL_TIM_SET_COMPARE(&htim10, TIM_CHANNEL_1, BMI088_Data.imu_temp_pid.Output);
+    // 另一个扇区擦好之后补存,擦好前写入直接返回忙,不碰flash
+    if (cali_unsaved && osKernelSysTick() - cali_retry_tick >= BMI088_CALI_RETRY_MS) {
+        bmi088_save_cali();
+    }
+}
+
+void bmi088_heater_off(void) {
+    __HAL_TIM_SET_COMPARE(&htim10, TIM_CHANNEL_1, 0);
 }
 
 void BMI088_init(void){
@@ -446,29 +993,34 @@ void BMI088_init(void){
                         .Kd = 0,
                         .Improve = 0x01}; // enable integratiaon limit
         PIDInit(&BMI088_Data.imu_temp_pid, &config);
-        uint8_t tmpdata[32]={0};
-        BSP_Flash_Read(ADDR_FLASH_SECTOR_11, tmpdata, sizeof(tmpdata));
-        if (tmpdata[31]!=0XAA)
+        if (!bmi088_load_cali())
         {
             Calibrate_MPU_Offset();
         }
-        else
-        {
-            float tmp[5] = {0.0f};
-            memcpy(&tmp[0], tmpdata, sizeof(tmp[0]));
-            memcpy(&tmp[1], tmpdata + 4, sizeof(tmp[1]));
-            memcpy(&tmp[2], tmpdata + 8, sizeof(tmp[2]));
-            memcpy(&tmp[3], tmpdata + 12, sizeof(tmp[3]));
-            memcpy(&tmp[4],tmpdata+16,sizeof(tmp[4]));
-
-            BMI088_Data.GyroOffset[0] = tmp[0];
-            BMI088_Data.GyroOffset[1] = tmp[1];
-            BMI088_Data.GyroOffset[2] = tmp[2];
-            BMI088_Data.gNorm         = tmp[3];
-            BMI088_Data.TempWhenCali  = tmp[4];
-            BMI088_Data.AccelScale    = 9.81f / BMI088_Data.gNorm;
+    }
+
+#if BMI088_USE_IRQ
+    if (bmi_acc_device && bmi_gyro_device) {
+#if BMI088_USE_FIFO
+        bmi088_fifo_init();
+#else
+        acc_dma_tx[0] = BMI088_SPI_READ_CODE | BMI088_ACCEL_XOUT_L;
+        gyro_dma_tx[0] = BMI088_SPI_READ_CODE | BMI088_GYRO_X_L;
+#endif
+        for (uint8_t i = 0; i < 2; i++) {
+            bmi_reader[i].xfer.dev = i ? bmi_gyro_device : bmi_acc_device;
+            bmi_reader[i].xfer.tx_data = bmi_reader[i].tx;
+            bmi_reader[i].xfer.rx_data = bmi_reader[i].rx;
+            bmi_reader[i].xfer.callback = bmi088_dma_cplt;
+            bmi_reader[i].xfer.arg = &bmi_reader[i];
+        }
+        bmi_irq_ready = 1; // 此后只在中断中访问SPI
+        if (!BSP_GPIO_EXTI_Register(INT_ACC_Pin, bmi088_exti, BMI088_READER(BMI088_READ_ACC)) ||
+            !BSP_GPIO_EXTI_Register(INT_GYRO_Pin, bmi088_exti, BMI088_READER(BMI088_READ_GYRO))) {
+            log_e("BMI088 EXTI register failed");
         }
     }
+#endif
 
     if (BMI088_Data.BMI088_ERORR_CODE==BMI088_NO_ERROR) {
         log_i("BMI088 init success!\n");
@@ -9,6 +9,14 @@
 #define GzOFFSET 0.00114696583f
 #define gNORM 9.67463112f
 
+#define BMI088_USE_IRQ 1          // 1: 数据就绪中断触发DMA读取,INS任务等待新数据; 0: INS任务轮询阻塞读取
+#define BMI088_WAIT_TIMEOUT_MS 5  // 等待新数据的超时时间,超时说明传感器或SPI异常
+#define BMI088_USE_FIFO 1         // 1: FIFO水位中断批量读取,陀螺仪2kHz; 0: 数据就绪中断逐个读取.需要BMI088_USE_IRQ为1
+#define BMI088_GYRO_FIFO_WM 4     // 陀螺仪FIFO水位,单位帧,2kHz下每2ms读取一批并唤醒一次INS任务
+#define BMI088_ACC_FIFO_WM 2      // 加速度计FIFO水位,单位帧,800Hz下每2.5ms读取一批
+#define BMI088_BATCH_LEN 32       // 两次BMI088_GetBatch()之间最多缓存的样本数,超出丢弃最旧的
+#define BMI088_CALI_RETRY_MS 1000 // 参数存储忙时重新保存标定结果的间隔
+
 /* BMI088数据*/
 typedef struct
 {
@@ -29,10 +37,61 @@ typedef struct
 {
     const float (*gyro)[3];    // 陀螺仪数据,xyz
     const float (*acc)[3];     // 加速度计数据,xyz
+    uint64_t gyro_cycle;       // 陀螺仪数据就绪中断的DWT时间戳(DWT_GetCycle64),轮询模式下为读取时刻
+    uint64_t acc_cycle;        // 加速度计数据就绪中断的DWT时间戳
 } BMI088_GET_Data_t;
 
+/* FIFO模式下一批样本,按时间先后排列 */
+typedef struct
+{
+    float gyro[BMI088_BATCH_LEN][3];
+    uint64_t gyro_cycle[BMI088_BATCH_LEN]; // 由水位中断时间戳和输出频率推算的采样时刻
+    uint8_t gyro_num;
+    float acc[BMI088_BATCH_LEN][3];
+    uint64_t acc_cycle[BMI088_BATCH_LEN];
+    uint8_t acc_num;
+} BMI088_Batch_t;
+
+/* 中断读取统计 */
+typedef struct
+{
+    uint32_t gyro_samples;  // 读到的陀螺仪样本数
+    uint32_t acc_samples;   // 读到的加速度计样本数
+    uint32_t overrun;       // 上一个样本还没读就来了新的数据就绪中断的次数,FIFO模式下为传感器FIFO溢出次数
+    uint32_t bus_busy;      // 发起读取时SPI总线被占用的次数,会在下一次中断或传输完成时重试
+    uint32_t spi_error;     // DMA传输出错丢弃的样本数
+    uint32_t dropped;       // FIFO模式下任务来不及取走而丢弃的样本数
+} BMI088_IrqStats_t;
+
 void bmi088_temp_ctrl(void);
+/**
+ * @brief 关闭加热,等待数据超时时温度不再更新,不能按旧的温度继续加热;下一次bmi088_temp_ctrl()恢复
+ */
+void bmi088_heater_off(void);
 void BMI088_init(void);
+
+/**
+ * @brief 获取最新的数据
+ * @note BMI088_USE_IRQ为1时只拷贝中断中读到的最新样本,不访问SPI;否则阻塞读取一次
+ */
 BMI088_GET_Data_t BMI088_GET_DATA(void);
 
+/**
+ * @brief 等待新的陀螺仪样本,只能由一个任务调用
+ * @note BMI088_USE_IRQ为0时直接延时1ms后返回1
+ *
+ * @param timeout_ms 超时时间
+ * @return uint8_t 1有新数据, 0超时
+ */
+uint8_t BMI088_WaitData(uint32_t timeout_ms);
+
+/**
+ * @brief 取出上次调用以来中断中读到的所有样本,FIFO模式下使用
+ *
+ * @return uint8_t 陀螺仪样本数
+ */
+uint8_t BMI088_GetBatch(BMI088_Batch_t *batch);
+
+void BMI088_GetIrqStats(BMI088_IrqStats_t *stats);
+
 #endif
@@ -91,6 +91,32 @@ extern "C"{
 #define BMI088_ACC_INT1_DRDY_INTERRUPT_SHFITS 0x2
 #define BMI088_ACC_INT1_DRDY_INTERRUPT (0x1 << BMI088_ACC_INT1_DRDY_INTERRUPT_SHFITS)
 
+// INT_MAP_DATA: bit0 int1_ffull, bit1 int1_fwm, bit2 int1_drdy, bit4 int2_ffull, bit5 int2_fwm, bit6 int2_drdy
+#define BMI088_ACC_INT1_FFULL_INTERRUPT_SHFITS 0x0
+#define BMI088_ACC_INT1_FFULL_INTERRUPT (0x1 << BMI088_ACC_INT1_FFULL_INTERRUPT_SHFITS)
+#define BMI088_ACC_INT1_FWM_INTERRUPT_SHFITS 0x1
+#define BMI088_ACC_INT1_FWM_INTERRUPT (0x1 << BMI088_ACC_INT1_FWM_INTERRUPT_SHFITS)
+
+/* 加速度计FIFO,数据以帧为单位,每帧以1字节帧头开始 */
+#define BMI088_ACC_FIFO_LENGTH_0 0x24 // FIFO中的字节数,低8位
+#define BMI088_ACC_FIFO_LENGTH_1 0x25 // 高6位
+#define BMI088_ACC_FIFO_DATA 0x26
+#define BMI088_ACC_FIFO_DOWNS 0x45
+#define BMI088_ACC_FIFO_DOWNS_MUST_Set 0x80
+#define BMI088_ACC_FIFO_WTM_0 0x46    // 水位,单位字节
+#define BMI088_ACC_FIFO_WTM_1 0x47
+#define BMI088_ACC_FIFO_CONFIG_0 0x48
+#define BMI088_ACC_FIFO_STREAM_MODE 0x02 // bit1必须为1,bit0为0时FIFO满后覆盖旧数据
+#define BMI088_ACC_FIFO_CONFIG_1 0x49
+#define BMI088_ACC_FIFO_ACC_EN 0x50      // bit6使能加速度数据,bit4必须为1
+
+#define BMI088_ACC_FIFO_HEADER_ACC 0x84      // 加速度帧,后跟6字节数据,低2位为中断标记
+#define BMI088_ACC_FIFO_HEADER_SKIP 0x40     // 溢出丢帧,后跟1字节丢弃的帧数
+#define BMI088_ACC_FIFO_HEADER_TIME 0x44     // 传感器时间,后跟3字节
+#define BMI088_ACC_FIFO_HEADER_CONFIG 0x48   // 配置变化,后跟1字节
+#define BMI088_ACC_FIFO_HEADER_DROP 0x50     // 配置变化丢弃的帧,后跟1字节
+#define BMI088_ACC_FIFO_FRAME_LEN 7
+
 #define BMI088_ACC_SELF_TEST 0x6D
 #define BMI088_ACC_SELF_TEST_OFF 0x00
 #define BMI088_ACC_SELF_TEST_POSITIVE_SIGNAL 0x0D
@@ -174,6 +200,22 @@ extern "C"{
 #define BMI088_GYRO_DRDY_IO_INT4 0x80
 #define BMI088_GYRO_DRDY_IO_BOTH (BMI088_GYRO_DRDY_IO_INT3 | BMI088_GYRO_DRDY_IO_INT4)
 
+#define BMI088_GYRO_FIFO_IO_INT3 0x04
+
+#define BMI088_GYRO_FIFO_INT_ON 0x40 // 写入BMI088_GYRO_CTRL,使能FIFO中断
+
+/* 陀螺仪FIFO,每帧6字节xyz,不带帧头 */
+#define BMI088_GYRO_FIFO_STATUS 0x0E
+#define BMI088_GYRO_FIFO_OVERRUN 0x80
+#define BMI088_GYRO_FIFO_COUNT_MASK 0x7F
+#define BMI088_GYRO_FIFO_WM_EN 0x1E
+#define BMI088_GYRO_FIFO_WM_ON 0x88
+#define BMI088_GYRO_FIFO_CONFIG_0 0x3D   // 水位,单位帧
+#define BMI088_GYRO_FIFO_CONFIG_1 0x3E
+#define BMI088_GYRO_FIFO_STREAM_MODE 0x80 // 满后覆盖旧数据,xyz
+#define BMI088_GYRO_FIFO_DATA 0x3F
+#define BMI088_GYRO_FIFO_FRAME_LEN 6
+
 #define BMI088_GYRO_SELF_TEST 0x3C
 #define BMI088_GYRO_RATE_OK_SHFITS 0x4
 #define BMI088_GYRO_RATE_OK (0x1 << BMI088_GYRO_RATE_OK_SHFITS)
@@ -230,6 +272,7 @@ typedef enum
     BMI088_GYRO_CTRL_ERROR = 0x0B,
     BMI088_GYRO_INT3_INT4_IO_CONF_ERROR = 0x0C,
     BMI088_GYRO_INT3_INT4_IO_MAP_ERROR = 0x0D,
+    BMI088_FIFO_CONFIG_ERROR = 0x0E,
 
     BMI088_SELF_TEST_ACCEL_ERROR = 0x80,
     BMI088_SELF_TEST_GYRO_ERROR = 0x40,
@@ -129,26 +129,23 @@ void IMU_UpdateQuaternion(const Can_Device *candevice)
 	dm_imu.q[3] = uint_to_float(z,Quaternion_MIN,Quaternion_MAX,14);
 }
 
-void IMU_UpdateData(const CAN_HandleTypeDef* hcan, const uint32_t rx_id)
+void IMU_UpdateData(Can_Device *device)
 {
-    if (dm_imu.can_device->rx_id == rx_id)
+    offline_device_update(dm_imu.offline_index);
+    switch(device->rx_buff[0])
     {
-        offline_device_update(dm_imu.offline_index);
-        switch(dm_imu.can_device->rx_buff[0])
-        {
-            case 1:
-                IMU_UpdateAccel(dm_imu.can_device);
-                break;
-            case 2:
-                IMU_UpdateGyro(dm_imu.can_device);
-                break;
-            case 3:
-                IMU_UpdateEuler(dm_imu.can_device);
-                break;
-            case 4:
-                IMU_UpdateQuaternion(dm_imu.can_device);
-                break;
-        }
+        case 1:
+            IMU_UpdateAccel(device);
+            break;
+        case 2:
+            IMU_UpdateGyro(device);
+            break;
+        case 3:
+            IMU_UpdateEuler(device);
+            break;
+        case 4:
+            IMU_UpdateQuaternion(device);
+            break;
     }
 }
 
@@ -193,7 +190,8 @@ void DM_IMU_Init(void)
         .rx_id = 0x11,
         .tx_mode = CAN_MODE_BLOCKING,
         .rx_mode = CAN_MODE_IT,
-        .can_callback = IMU_UpdateData
+        .can_callback = IMU_UpdateData,
+        .id = &dm_imu
     };
     // 注册 CAN 设备并获取引用
     Can_Device *can_dev = BSP_CAN_Device_Init(&can_config);
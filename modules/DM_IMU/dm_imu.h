@@ -53,7 +53,7 @@ typedef struct {
 
 extern dm_imu_t dm_imu;
 
-void IMU_UpdateData(const CAN_HandleTypeDef* hcan, const uint32_t rx_id);
+void IMU_UpdateData(Can_Device *device);
 void IMU_RequestData(uint16_t can_id,uint8_t reg);
 void DM_IMU_Init(void);
 DM_IMU_DATA_T DMI_IMU_GetData(void);
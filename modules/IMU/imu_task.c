@@ -35,6 +35,27 @@ const float xb[3] = {1, 0, 0};
 const float yb[3] = {0, 1, 0};
 const float zb[3] = {0, 0, 1};
 
+#define INS_DT_MAX 0.005f // 两个样本间隔超过5ms(丢样本、传感器复位)时按标称周期积分
+
+/**
+ * @brief 由两个样本的时间戳计算dt,单位秒
+ * @note 时间戳按有符号数相减:不晚于上一个样本时返回0,调用者跳过这个样本;间隔过长时返回标称周期
+ *
+ * @param nominal 标称采样周期,第一个样本和间隔过长时使用
+ */
+static float INS_SampleDt(uint64_t cycle, uint64_t last_cycle, float nominal)
+{
+    if (last_cycle == 0) {
+        return nominal;
+    }
+    int64_t diff = (int64_t)(cycle - last_cycle);
+    if (diff <= 0) {
+        return 0;
+    }
+    float dt = DWT_Cycle64ToMs((uint64_t)diff) * 0.001f;
+    return dt > INS_DT_MAX ? nominal : dt;
+}
+
 
 // 使用加速度计的数据初始化Roll和Pitch,而Yaw置0,这样可以避免在初始时候的姿态估计误差
 static void InitQuaternion(float *init_q4)
@@ -83,23 +104,118 @@ void INS_Init(void)
     INS.AccelLPF = 0.0085f;
 }
 
+// EKF更新后计算输出量:姿态角,导航系基向量和运动加速度,dt为距上一次计算经过的时间
+static void INS_UpdateOutput(float dt)
+{
+    const float gravity[3] = {0, 0, 9.81f};
+
+    memcpy(INS.q, QEKF_INS.q, sizeof(QEKF_INS.q));
+
+    // 机体系基向量转换到导航坐标系，本例选取惯性系为导航系
+    BodyFrameToEarthFrame(xb, INS.xn, INS.q);
+    BodyFrameToEarthFrame(yb, INS.yn, INS.q);
+    BodyFrameToEarthFrame(zb, INS.zn, INS.q);
+
+    // 将重力从导航坐标系n转换到机体系b,随后根据加速度计数据计算运动加速度
+    float gravity_b[3];
+    EarthFrameToBodyFrame(gravity, gravity_b, INS.q);
+    for (uint8_t i = 0; i < 3; ++i) // 同样过一个低通滤波
+    {
+        INS.MotionAccel_b[i] = (INS.Accel[i] - gravity_b[i]) * dt / (INS.AccelLPF + dt) + INS.MotionAccel_b[i] * INS.AccelLPF / (INS.AccelLPF + dt);
+    }
+    BodyFrameToEarthFrame(INS.MotionAccel_b, INS.MotionAccel_n, INS.q); // 转换回导航系n
+
+    INS.Yaw = QEKF_INS.Yaw;
+    INS.Pitch = QEKF_INS.Pitch;
+    INS.Roll = QEKF_INS.Roll;
+    INS.YawTotalAngle = QEKF_INS.YawTotalAngle;
+    INS.YawRoundCount = QEKF_INS.YawRoundCount;
+}
+
+#if BMI088_USE_IRQ && BMI088_USE_FIFO
+static BMI088_Batch_t BMI088_Batch;
+
+/**
+ * @brief 对一批FIFO样本逐个做EKF更新
+ * @note 陀螺仪2kHz,加速度计800Hz,每个陀螺仪样本配上时间戳不晚于它的最新一个加速度计样本
+ */
+static void INS_UpdateBatch(void)
+{
+    static uint64_t last_gyro_cycle = 0;
+    float unused[3] = {0};
+    float batch_dt = 0;
+    uint8_t j = 0;
+
+    BMI088_GetBatch(&BMI088_Batch);
+    // demo function,用于修正安装误差,可以不管,本demo暂时没用;两种样本数量不同,分开修正
+    for (uint8_t k = 0; k < BMI088_Batch.acc_num; k++) {
+        IMU_Param_Correction(&IMU_Param, unused, BMI088_Batch.acc[k]);
+    }
+    for (uint8_t i = 0; i < BMI088_Batch.gyro_num; i++) {
+        IMU_Param_Correction(&IMU_Param, BMI088_Batch.gyro[i], unused);
+        memcpy(INS.Gyro, BMI088_Batch.gyro[i], sizeof(INS.Gyro));
+        while (j < BMI088_Batch.acc_num && BMI088_Batch.acc_cycle[j] <= BMI088_Batch.gyro_cycle[i]) {
+            memcpy(INS.Accel, BMI088_Batch.acc[j], sizeof(INS.Accel));
+            j++;
+        }
+
+        // 每个样本用自己的采样时刻计算dt
+        float dt = INS_SampleDt(BMI088_Batch.gyro_cycle[i], last_gyro_cycle, 0.0005f);
+        if (dt <= 0) {
+            continue;
+        }
+        INS.dt = dt;
+        last_gyro_cycle = BMI088_Batch.gyro_cycle[i];
+        INS.t += INS.dt;
+        batch_dt += INS.dt;
+
+        // 核心函数,EKF更新四元数
+        IMU_QuaternionEKF_Update(INS.Gyro[0], INS.Gyro[1], INS.Gyro[2], INS.Accel[0], INS.Accel[1], INS.Accel[2], INS.dt);
+    }
+    // 比最后一个陀螺仪样本还新的加速度计样本在下一批之前,直接作为当前值
+    if (j < BMI088_Batch.acc_num) {
+        memcpy(INS.Accel, BMI088_Batch.acc[BMI088_Batch.acc_num - 1], sizeof(INS.Accel));
+    }
+
+    if (batch_dt > 0) {
+        INS_UpdateOutput(batch_dt);
+    }
+}
+#endif
+
 void INSTask(const void *argument)
 {
     UNUSED(argument);
     INS_Init();
     static uint32_t count = 0;
-    const float gravity[3] = {0, 0, 9.81f};
+#if !(BMI088_USE_IRQ && BMI088_USE_FIFO)
+    static uint64_t last_gyro_cycle = 0;
+#endif
     SystemWatch_RegisterTask(INSTaskHandle, "INS Task");
     for (;;) {
         SystemWatch_ReportTaskAlive(osThreadGetId());
 
-        INS.dt = DWT_GetDeltaT(&INS.dwt_cnt);
-        INS.t += INS.dt;
+        // 等待陀螺仪新样本,超时说明传感器或SPI异常,不用旧数据解算,温度也没有更新,停止加热
+        if (!BMI088_WaitData(BMI088_WAIT_TIMEOUT_MS)) {
+            bmi088_heater_off();
+            continue;
+        }
+#if BMI088_USE_IRQ && BMI088_USE_FIFO
+        // FIFO模式下每次唤醒处理一批样本,EKF以陀螺仪的2kHz输出频率更新
+        INS_UpdateBatch();
+#else
+        BMI088_GET_Data = BMI088_GET_DATA();
+        // 用数据就绪中断的时间戳计算dt,不受任务调度和SPI等待的抖动影响;时间戳没有前进时跳过解算
+        float dt = INS_SampleDt(BMI088_GET_Data.gyro_cycle, last_gyro_cycle, 0.001f);
+        if (dt > 0) {
+            INS.dt = dt;
+            last_gyro_cycle = BMI088_GET_Data.gyro_cycle;
+            INS.t += INS.dt;
+        }
     
         // ins update
-        if ((count % 1) == 0)
+        if (dt > 0 && (count % 1) == 0)
         {
-            BMI088_GET_Data = BMI088_GET_DATA();
             INS.Accel[0] = (*BMI088_GET_Data.acc)[0];
             INS.Accel[1] = (*BMI088_GET_Data.acc)[1];
             INS.Accel[2] = (*BMI088_GET_Data.acc)[2];
@@ -117,28 +233,9 @@ void INSTask(const void *argument)
             // 核心函数,EKF更新四元数
             IMU_QuaternionEKF_Update(INS.Gyro[0], INS.Gyro[1], INS.Gyro[2], INS.Accel[0], INS.Accel[1], INS.Accel[2], INS.dt);
     
-            memcpy(INS.q, QEKF_INS.q, sizeof(QEKF_INS.q));
-    
-            // 机体系基向量转换到导航坐标系，本例选取惯性系为导航系
-            BodyFrameToEarthFrame(xb, INS.xn, INS.q);
-            BodyFrameToEarthFrame(yb, INS.yn, INS.q);
-            BodyFrameToEarthFrame(zb, INS.zn, INS.q);
-    
-            // 将重力从导航坐标系n转换到机体系b,随后根据加速度计数据计算运动加速度
-            float gravity_b[3];
-            EarthFrameToBodyFrame(gravity, gravity_b, INS.q);
-            for (uint8_t i = 0; i < 3; ++i) // 同样过一个低通滤波
-            {
-                INS.MotionAccel_b[i] = (INS.Accel[i] - gravity_b[i]) * INS.dt / (INS.AccelLPF + INS.dt) + INS.MotionAccel_b[i] * INS.AccelLPF / (INS.AccelLPF + INS.dt);
-            }
-            BodyFrameToEarthFrame(INS.MotionAccel_b, INS.MotionAccel_n, INS.q); // 转换回导航系n
-    
-            INS.Yaw = QEKF_INS.Yaw;
-            INS.Pitch = QEKF_INS.Pitch;
-            INS.Roll = QEKF_INS.Roll;
-            INS.YawTotalAngle = QEKF_INS.YawTotalAngle;
-            INS.YawRoundCount = QEKF_INS.YawRoundCount;
+            INS_UpdateOutput(INS.dt);
         }
+#endif
     
         // temperature control
         if ((count % 2) == 0)
@@ -146,7 +243,6 @@ void INSTask(const void *argument)
             // 500hz
             bmi088_temp_ctrl();
         } 
-        osDelay(1);
     }    
 }
 
@@ -86,7 +86,7 @@ void mit_ctrl(DMMOTOR_t *motor, float pos, float vel,float kp, float kd, float t
 	motor->can_device->tx_buff[6] = ((kd_tmp&0xF)<<4)|(tor_tmp>>8);
 	motor->can_device->tx_buff[7] = tor_tmp;
 	
-	CAN_SendMessage(motor->can_device,motor->can_device->txconf.DLC);
+	CAN_SchedSend(motor->can_device, motor->can_device->txconf.DLC, 0, 0); // 电机每收到一帧回复一次反馈,不能跳过
 }
 
 
@@ -112,7 +112,7 @@ void pos_speed_ctrl(DMMOTOR_t *motor, float pos_degree, float vel)
 	motor->can_device->tx_buff[6] = *(vbuf+2);
 	motor->can_device->tx_buff[7] = *(vbuf+3);
 	
-	CAN_SendMessage(motor->can_device,motor->can_device->txconf.DLC);
+	CAN_SchedSend(motor->can_device, motor->can_device->txconf.DLC, 0, 0); // 电机每收到一帧回复一次反馈,不能跳过
 }
 
 
@@ -130,42 +130,41 @@ void speed_ctrl(DMMOTOR_t *motor, float vel)
 	motor->can_device->tx_buff[2] = *(vbuf+2);
 	motor->can_device->tx_buff[3] = *(vbuf+3);
 	
-	CAN_SendMessage(motor->can_device,motor->can_device->txconf.DLC);
+	CAN_SchedSend(motor->can_device, motor->can_device->txconf.DLC, 0, 0); // 电机每收到一帧回复一次反馈,不能跳过
 }
 
-void DMMotorDecode(const CAN_HandleTypeDef* hcan,const  uint32_t rx_id)
+void DMMotorDecode(Can_Device *device)
 {
-    for (uint8_t i = 0; i < idx; i++) {
-        if (dmm_motor_list[i] 
-            &&dmm_motor_list[i]->can_device->can_handle == hcan 
-            && dmm_motor_list[i]->can_device->rx_id == rx_id)
-        {
-            uint8_t *rxbuff = dmm_motor_list[i]->can_device->rx_buff;  
-            offline_device_update(dmm_motor_list[i]->offline_index);
+    DMMOTOR_t *motor = (DMMOTOR_t *)device->id; // 注册时保存的电机实例,不需要再遍历电机列表
+    if (motor == NULL)
+    {
+        return;
+    }
+    uint8_t *rxbuff = device->rx_buff;
+    offline_device_update(motor->offline_index);
 
-            uint16_t tmp; // 用于暂存解析值,稍后转换成float数据,避免多次创建临时变量
+    uint16_t tmp; // 用于暂存解析值,稍后转换成float数据,避免多次创建临时变量
 
-            dmm_motor_list[i]->measure.last_position = dmm_motor_list[i]->measure.position;
-            tmp = (uint16_t)((rxbuff[1] << 8) | rxbuff[2]);
-            dmm_motor_list[i]->measure.position = uint_to_float(tmp, DM_P_MIN, DM_P_MAX, 16);
-            dmm_motor_list[i]->measure.position = rad_to_deg(dmm_motor_list[i]->measure.position);
+    motor->measure.last_position = motor->measure.position;
+    tmp = (uint16_t)((rxbuff[1] << 8) | rxbuff[2]);
+    motor->measure.position = uint_to_float(tmp, DM_P_MIN, DM_P_MAX, 16);
+    motor->measure.position = rad_to_deg(motor->measure.position);
 
-            tmp = (uint16_t)((rxbuff[3] << 4) | rxbuff[4] >> 4);
-            dmm_motor_list[i]->measure.velocity = uint_to_float(tmp, DM_V_MIN, DM_V_MAX, 12);
-            dmm_motor_list[i]->measure.velocity = rad_to_deg(dmm_motor_list[i]->measure.velocity);
+    tmp = (uint16_t)((rxbuff[3] << 4) | rxbuff[4] >> 4);
+    motor->measure.velocity = uint_to_float(tmp, DM_V_MIN, DM_V_MAX, 12);
+    motor->measure.velocity = rad_to_deg(motor->measure.velocity);
 
-            tmp = (uint16_t)(((rxbuff[4] & 0x0f) << 8) | rxbuff[5]);
-            dmm_motor_list[i]->measure.torque = uint_to_float(tmp, DM_T_MIN, DM_T_MAX, 12);
+    tmp = (uint16_t)(((rxbuff[4] & 0x0f) << 8) | rxbuff[5]);
+    motor->measure.torque = uint_to_float(tmp, DM_T_MIN, DM_T_MAX, 12);
 
-            dmm_motor_list[i]->measure.T_Mos = (float)rxbuff[6];
-            dmm_motor_list[i]->measure.T_Rotor = (float)rxbuff[7];
+    motor->measure.T_Mos = (float)rxbuff[6];
+    motor->measure.T_Rotor = (float)rxbuff[7];
+    motor->measure.stamp = device->rx_stamp;
 
-            // 解析错误码
-            uint8_t error_code = (rxbuff[0] >> 4) & 0x0F;
-            dmm_motor_list[i]->measure.id = rxbuff[0] & 0x0F;
-            dmm_motor_list[i]->measure.Error_Code = (error_code >= 0x08 && error_code <= 0x0E) ? (DMMotorError_t)error_code : DM_NO_ERROR;
-        }
-    }
+    // 解析错误码
+    uint8_t error_code = (rxbuff[0] >> 4) & 0x0F;
+    motor->measure.id = rxbuff[0] & 0x0F;
+    motor->measure.Error_Code = (error_code >= 0x08 && error_code <= 0x0E) ? (DMMotorError_t)error_code : DM_NO_ERROR;
 }
 
 void DMMotorCaliEncoder(DMMOTOR_t *motor)
@@ -195,7 +194,9 @@ DMMOTOR_t *DMMotorInit(Motor_Init_Config_s *config,uint32_t DM_Mode_type){
         .rx_id = config->can_init_config.rx_id,
         .tx_mode = CAN_MODE_BLOCKING,
         .rx_mode = CAN_MODE_IT,
-        .can_callback = DMMotorDecode
+        .rx_rate_hz = 500, // 一问一答,与电机任务2ms的控制周期一致
+        .can_callback = DMMotorDecode,
+        .id = DMMotor
     };
     // 注册 CAN 设备并获取引用
     Can_Device *can_dev = BSP_CAN_Device_Init(&can_config);
@@ -278,6 +279,19 @@ void DMMotorOuterLoop(DMMOTOR_t *motor, Closeloop_Type_e type,LQR_Init_Config_s
     }
 }
 
+float DMMotorFeedbackAge(DMMOTOR_t *motor)
+{
+    volatile uint64_t *src = &motor->measure.stamp;
+    uint64_t stamp;
+    do {
+        stamp = *src; // 64位读取不是原子的,解码任务可能在两半之间写入,读到两次相同为止
+    } while (stamp != *src);
+    if (stamp == 0) {
+        return -1.0f;
+    }
+    return DWT_Cycle64ToMs(DWT_GetCycle64() - stamp);
+}
+
 void DMMotorcontrol(void){
     DMMOTOR_t *motor =NULL;
     float state0,state1;
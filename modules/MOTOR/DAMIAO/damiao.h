@@ -44,6 +44,7 @@ typedef struct
     float T_Rotor;
     int32_t total_round;
     DMMotorError_t Error_Code; 
+    uint64_t stamp; // 本次反馈到达CAN接收中断的64位DWT周期计数,0表示尚未收到反馈
 }DM_Motor_Measure_s;
 
 typedef struct
@@ -83,7 +84,13 @@ void DMMotorOuterLoop(DMMOTOR_t *motor,Closeloop_Type_e closeloop_type,LQR_Init_
 void DMMotorEnable(DMMOTOR_t *motor);
 void DMMotorStop(DMMOTOR_t *motor);
 void DMMotorCaliEncoder(DMMOTOR_t *motor);
-void DMMotorDecode(const CAN_HandleTypeDef* hcan,const  uint32_t rx_id);
+void DMMotorDecode(Can_Device *device);
+/**
+ * @brief 获取电机反馈的数据年龄,即最近一次反馈到达到现在经过的时间
+ *
+ * @return float 单位ms,尚未收到反馈时返回-1
+ */
+float DMMotorFeedbackAge(DMMOTOR_t *motor);
 void DMMotorcontrol(void);
 void DMMotorSetMode(DMMotor_Mode_e cmd, DMMOTOR_t *motor);
 
@@ -2,6 +2,7 @@
 #include "bsp_can.h"
 #include "can.h"
 #include "dwt.h"
+#include "dwt_prof.h"
 #include "motor_def.h"
 #include "offline.h"
 #include "powercontroller.h"
@@ -18,6 +19,10 @@ static uint8_t idx = 0; // register idx,是该文件的全局电机索引,在注
 static DJIMotor_t *dji_motor_list[DJI_MOTOR_CNT] = {NULL}; // 会在control任务中遍历该指针数组进行pid计算
 // 存储未开启功率控制的电机输出
 static float motor_outputs[DJI_MOTOR_CNT] = {0};
+// 反馈连续过期的控制周期数,收到新反馈后清零
+static uint8_t motor_stale_cnt[DJI_MOTOR_CNT] = {0};
+// 最近一次填入发送报文的输出,包括功率控制之后的结果
+static int16_t motor_sent[DJI_MOTOR_CNT] = {0};
 // 获取未开启功率控制的电机输出
 static int16_t GetRawMotorOutput(uint8_t motor_num) {
     if(motor_num >= DJI_MOTOR_CNT) return 0;
@@ -161,63 +166,50 @@ static void MotorSenderGrouping(DJIMotor_t *motor, Can_Device_Init_Config_s *con
 /**
  * @brief 根据返回的can_instance对反馈报文进行解析
  */
- void DecodeDJIMotor(const CAN_HandleTypeDef* hcan, const uint32_t rx_id)
+ void DecodeDJIMotor(Can_Device *device)
  {
-     if (hcan == NULL) {return;}
- 
-     for (uint8_t i = 0; i < idx; i++) {
-         if (i >= DJI_MOTOR_CNT || dji_motor_list[i] == NULL) {continue;}
-         if (dji_motor_list[i]->can_device == NULL) {continue;}
-
-         if (dji_motor_list[i]->can_device->can_handle == hcan && dji_motor_list[i]->can_device->rx_id == rx_id)
-         {
-             // 更新在线状态
-             offline_device_update(dji_motor_list[i]->offline_index);
-            // 确保rx_buff长度足够
-            if (dji_motor_list[i]->can_device->rx_len < 8) {
-                continue;
-            }
-             // 使用临时变量存储计算结果，避免直接访问可能无效的内存
-             uint16_t ecd = ((uint16_t)dji_motor_list[i]->can_device->rx_buff[0] << 8) | dji_motor_list[i]->can_device->rx_buff[1];
-             int16_t speed = (int16_t)(dji_motor_list[i]->can_device->rx_buff[2] << 8 | dji_motor_list[i]->can_device->rx_buff[3]);
-             int16_t current = (int16_t)(dji_motor_list[i]->can_device->rx_buff[4] << 8 | dji_motor_list[i]->can_device->rx_buff[5]);
-             uint8_t temp = dji_motor_list[i]->can_device->rx_buff[6];
- 
-             // 更新电机数据
-             dji_motor_list[i]->measure.last_ecd = dji_motor_list[i]->measure.ecd;
-             dji_motor_list[i]->measure.ecd = ecd;
-             dji_motor_list[i]->measure.angle_single_round = ECD_ANGLE_COEF_DJI * (float)ecd;
-             
-             // 使用平滑系数更新速度和电流
-             dji_motor_list[i]->measure.speed_rpm = (1.0f - SPEED_SMOOTH_COEF) * 
-                 dji_motor_list[i]->measure.speed_rpm + SPEED_SMOOTH_COEF * (float)speed;
-             
-             dji_motor_list[i]->measure.speed_aps = (1.0f - SPEED_SMOOTH_COEF) * 
-                 dji_motor_list[i]->measure.speed_aps + RPM_2_ANGLE_PER_SEC * 
-                 SPEED_SMOOTH_COEF * (float)speed;
-             
-             dji_motor_list[i]->measure.real_current = (1.0f - CURRENT_SMOOTH_COEF) * 
-                 dji_motor_list[i]->measure.real_current + CURRENT_SMOOTH_COEF * 
-                 (float)current;
-             
-             dji_motor_list[i]->measure.temperature = temp;
- 
-             // 多圈角度计算
-             int16_t delta_ecd = dji_motor_list[i]->measure.ecd - 
-                                dji_motor_list[i]->measure.last_ecd;
-             
-             if (delta_ecd > 4096) {
-                 dji_motor_list[i]->measure.total_round--;
-             } else if (delta_ecd < -4096) {
-                 dji_motor_list[i]->measure.total_round++;
-             }
-             
-             dji_motor_list[i]->measure.total_angle = 
-                 dji_motor_list[i]->measure.total_round * 360.0f + 
-                 dji_motor_list[i]->measure.angle_single_round;
-             break; // 找到匹配的电机后退出循环
-         }
+     DJIMotor_t *motor = (DJIMotor_t *)device->id; // 注册时保存的电机实例,不需要再遍历电机列表
+     if (motor == NULL) {return;}
+
+     // 更新在线状态
+     offline_device_update(motor->offline_index);
+     // 确保rx_buff长度足够
+     if (device->rx_len < 8) {
+         return;
      }
+     uint8_t *rxbuff = device->rx_buff;
+     uint16_t ecd = ((uint16_t)rxbuff[0] << 8) | rxbuff[1];
+     int16_t speed = (int16_t)(rxbuff[2] << 8 | rxbuff[3]);
+     int16_t current = (int16_t)(rxbuff[4] << 8 | rxbuff[5]);
+     uint8_t temp = rxbuff[6];
+
+     // 更新电机数据
+     motor->measure.last_ecd = motor->measure.ecd;
+     motor->measure.ecd = ecd;
+     motor->measure.angle_single_round = ECD_ANGLE_COEF_DJI * (float)ecd;
+
+     // 使用平滑系数更新速度和电流
+     motor->measure.speed_rpm = (1.0f - SPEED_SMOOTH_COEF) * motor->measure.speed_rpm + SPEED_SMOOTH_COEF * (float)speed;
+
+     motor->measure.speed_aps = (1.0f - SPEED_SMOOTH_COEF) * motor->measure.speed_aps + 
+         RPM_2_ANGLE_PER_SEC * SPEED_SMOOTH_COEF * (float)speed;
+
+     motor->measure.real_current = (1.0f - CURRENT_SMOOTH_COEF) * motor->measure.real_current + 
+         CURRENT_SMOOTH_COEF * (float)current;
+
+     motor->measure.temperature = temp;
+     motor->measure.stamp = device->rx_stamp;
+
+     // 多圈角度计算
+     int16_t delta_ecd = motor->measure.ecd - motor->measure.last_ecd;
+
+     if (delta_ecd > 4096) {
+         motor->measure.total_round--;
+     } else if (delta_ecd < -4096) {
+         motor->measure.total_round++;
+     }
+
+     motor->measure.total_angle = motor->measure.total_round * 360.0f + motor->measure.angle_single_round;
  }
 
 // 电机初始化,返回一个电机实例
@@ -243,7 +235,9 @@ DJIMotor_t *DJIMotorInit(Motor_Init_Config_s *config)
         .rx_id = config->can_init_config.rx_id,
         .tx_mode = CAN_MODE_BLOCKING,
         .rx_mode = CAN_MODE_IT,
-        .can_callback = DecodeDJIMotor
+        .rx_rate_hz = 1000, // 电机反馈固定1kHz
+        .can_callback = DecodeDJIMotor,
+        .id = DJIMotor
     };
     // 注册 CAN 设备并获取引用
     Can_Device *can_dev = BSP_CAN_Device_Init(&can_config);
@@ -449,12 +443,36 @@ static float CalculateLQROutput(DJIMotor_t *motor)
 }
 
 
+float DJIMotorFeedbackAge(DJIMotor_t *motor)
+{
+    volatile uint64_t *src = &motor->measure.stamp;
+    uint64_t stamp;
+    do {
+        stamp = *src; // 64位读取不是原子的,解码任务可能在两半之间写入,读到两次相同为止
+    } while (stamp != *src);
+    if (stamp == 0) {
+        return -1.0f;
+    }
+    return DWT_Cycle64ToMs(DWT_GetCycle64() - stamp);
+}
+
+uint8_t DJIMotorGetSnapshot(int16_t *output, int16_t *speed_rpm, uint8_t max)
+{
+    uint8_t n = idx < max ? idx : max;
+    for (uint8_t i = 0; i < n; i++) {
+        output[i] = motor_sent[i];
+        speed_rpm[i] = (int16_t)dji_motor_list[i]->measure.speed_rpm;
+    }
+    return n;
+}
+
 void DJIMotorControl(void)
 {
     uint8_t group, num;
     float control_output;
     DJIMotor_t *motor;
     uint8_t power_control_count = 0;
+    PROF_BEGIN(DJI_MOTOR_CONTROL);
     
     // 第一次遍历：计算控制输出
     for (size_t i = 0; i < idx; ++i) {
@@ -464,7 +482,18 @@ void DJIMotorControl(void)
         if (get_device_status(motor->offline_index)==1 || motor->stop_flag == MOTOR_STOP) {
             control_output = 0;
         }
+        else if (DJIMotorFeedbackAge(motor) > DJI_FEEDBACK_STALE_MS) {
+            // 反馈没有更新,跳过本周期的闭环计算,避免积分项在旧数据上累积.
+            // 偶尔丢一两帧时保持上一次输出,持续过期则衰减到0,不让电机在离线检测触发前一直按旧指令输出
+            if (motor_stale_cnt[i] < DJI_FEEDBACK_STALE_HOLD) {
+                motor_stale_cnt[i]++;
+                control_output = motor_outputs[i];
+            } else {
+                control_output = motor_outputs[i] * DJI_FEEDBACK_STALE_DECAY;
+            }
+        }
         else {
+            motor_stale_cnt[i] = 0;
             __disable_irq(); 
             // 根据控制算法计算输出
             switch (motor->motor_settings.control_algorithm) 
@@ -483,13 +512,12 @@ void DJIMotorControl(void)
             }
             __enable_irq(); 
         }
+        // 未开启功率控制的直接使用本地数组中的输出,开启功率控制的也记录下来,反馈过期时在此基础上保持或衰减
+        motor_outputs[i] = control_output;
         // 根据功率控制状态分别处理
         if(motor->motor_settings.PowerControlState == PowerControlState_ON) {
             PowerControlDji(motor, control_output);
             power_control_count++;
-        } else {
-            // 未开启功率控制的直接存储到本地数组
-            motor_outputs[i] = control_output;
         }
     }
 
@@ -512,20 +540,22 @@ void DJIMotorControl(void)
             output = GetRawMotorOutput(i);      // 从本地数组获取
         }
         
+        motor_sent[i] = output;
         // 填充发送数据
         sender_assignment[group].tx_buff[2 * num] = (uint8_t)(output >> 8);
         sender_assignment[group].tx_buff[2 * num + 1] = (uint8_t)(output & 0x00ff);
     }
-    // 发送CAN消息
+    // 暂存到发送调度,由电机任务在本周期末尾统一发出;输出不变的分组帧可以跳过
     for (size_t i = 0; i < 10; ++i) {
         if (sender_enable_flag[i]) {
-            CAN_SendMessage_hcan(sender_assignment[i].can_handle,
-                               &sender_assignment[i].txconf,
+            CAN_SchedSend_hcan(sender_assignment[i].can_handle,
+                               sender_assignment[i].txconf.StdId,
                                sender_assignment[i].tx_buff,
-                               &sender_assignment[i].tx_mailbox,
-                               sender_assignment[i].txconf.DLC);
+                               sender_assignment[i].txconf.DLC,
+                               0, CAN_SCHED_SKIP_UNCHANGED);
         }
     }
+    PROF_END(DJI_MOTOR_CONTROL);
 }
 
 // void DJIMotorControl(void)
@@ -13,6 +13,9 @@ extern "C"{
 
 /* 滤波系数设置为1的时候即关闭滤波 */
 #define SPEED_SMOOTH_COEF 0.9f      // 最好大于0.85
+#define DJI_FEEDBACK_STALE_MS 3.0f  // 反馈为1kHz,超过该时间未更新则跳过本周期闭环计算
+#define DJI_FEEDBACK_STALE_HOLD 5   // 反馈过期后最多保持上一次输出的控制周期数,之后逐周期衰减到0
+#define DJI_FEEDBACK_STALE_DECAY 0.5f // 保持结束后每个控制周期输出乘以该系数,避免阶跃
 #define CURRENT_SMOOTH_COEF 0.9f     // 必须大于0.9
 #define ECD_ANGLE_COEF_DJI 0.043945f // (360/8192),将编码器值转化为角度制
 
@@ -30,6 +33,7 @@ typedef struct
     float total_angle;   // 总角度,注意方向
     int32_t total_round; // 总圈数,注意方向
     float total_output_round; //输出轴总圈数
+    uint64_t stamp;           // 本次反馈到达CAN接收中断的64位DWT周期计数,0表示尚未收到反馈
 } DJI_Motor_Measure_s;
 
 /**
@@ -58,7 +62,19 @@ void DJIMotorControl(void);
 void DJIMotorStop(DJIMotor_t *motor);
 void DJIMotorEnable(DJIMotor_t *motor);
 void DJIMotorOuterLoop(DJIMotor_t *motor, Closeloop_Type_e outer_loop, LQR_Init_Config_s *lqr_config);
-void DecodeDJIMotor(const CAN_HandleTypeDef* hcan,const  uint32_t rx_id);
+void DecodeDJIMotor(Can_Device *device);
+/**
+ * @brief 获取电机反馈的数据年龄,即最近一次反馈到达到现在经过的时间
+ *
+ * @return float 单位ms,尚未收到反馈时返回-1
+ */
+float DJIMotorFeedbackAge(DJIMotor_t *motor);
+/**
+ * @brief 按注册顺序读取前max个电机最近一次发出的电流指令和转速反馈,用于记录
+ *
+ * @return uint8_t 实际读取的电机数
+ */
+uint8_t DJIMotorGetSnapshot(int16_t *output, int16_t *speed_rpm, uint8_t max);
 
 
 
@@ -3,6 +3,7 @@
 #include "damiao.h"
 #include "dji.h"
 #include "systemwatch.h"
+#include "bsp_can.h"
 
 #define LOG_TAG  "motortask"
 #include "elog.h"
@@ -17,6 +18,7 @@ void motortask(const void *parameter)
         SystemWatch_ReportTaskAlive(osThreadGetId());
         DJIMotorControl();
         DMMotorcontrol();
+        CAN_SchedFlush(); // 本周期所有控制报文(含其他任务暂存的板间通信)统一按优先级发出
         osDelay(2);
     }
 }
@@ -7,34 +7,53 @@
 #define LOG_TAG  "sbus"
 #include "elog.h"
 
+#define SBUS_FRAME_LEN 25
+
 static SBUS_CH_Struct sbus;
-static uint8_t sbus_buf[2][30];
+static uint8_t sbus_buf[128];                 // DMA环形接收缓冲区
+static uint8_t sbus_frame[SBUS_FRAME_LEN];    // 跨过环形缓冲区末尾的帧拷贝到这里解析
 
-void uart3_rx_callback(uint8_t *buf, uint16_t len)
-{ 
-    if(len == 25 && buf[0] == 0x0F && buf[24] == 0x00)
+/* 解析一帧,帧头帧尾已经检查过 */
+static void sbus_decode(const uint8_t *buf)
+{
+    sbus.CH1      = ((int16_t)buf[1] >> 0 | ((int16_t)buf[2] << 8)) & 0x07FF;
+    sbus.CH2      = ((int16_t)buf[2] >> 3 | ((int16_t)buf[3] << 5)) & 0x07FF;
+    sbus.CH3      = ((int16_t)buf[3] >> 6 | ((int16_t)buf[4] << 2) | (int16_t)buf[5] << 10) & 0x07FF;
+    sbus.CH4      = ((int16_t)buf[5] >> 1 | ((int16_t)buf[6] << 7)) & 0x07FF;
+    sbus.CH5      = ((int16_t)buf[6] >> 4 | ((int16_t)buf[7] << 4)) & 0x07FF;
+    sbus.CH6      = ((int16_t)buf[7] >> 7 | ((int16_t)buf[8] << 1) | (int16_t)buf[9] << 9) & 0x07FF;
+    sbus.CH7      = ((int16_t)buf[9] >> 2 | ((int16_t)buf[10] << 6)) & 0x07FF;
+    sbus.CH8      = ((int16_t)buf[10] >> 5 | ((int16_t)buf[11] << 3)) & 0x07FF;
+    sbus.CH9      = ((int16_t)buf[12] << 0 | ((int16_t)buf[13] << 8)) & 0x07FF;
+    sbus.CH10     = ((int16_t)buf[13] >> 3 | ((int16_t)buf[14] << 5)) & 0x07FF;
+    sbus.CH11     = ((int16_t)buf[14] >> 6 | ((int16_t)buf[15] << 2) | (int16_t)buf[16] << 10) & 0x07FF;
+    sbus.CH12     = ((int16_t)buf[16] >> 1 | ((int16_t)buf[17] << 7)) & 0x07FF;
+    sbus.CH13     = ((int16_t)buf[17] >> 4 | ((int16_t)buf[18] << 4)) & 0x07FF;
+    sbus.CH14     = ((int16_t)buf[18] >> 7 | ((int16_t)buf[19] << 1) | (int16_t)buf[20] << 9) & 0x07FF;
+    sbus.CH15     = ((int16_t)buf[20] >> 2 | ((int16_t)buf[21] << 6)) & 0x07FF;
+    sbus.CH16     = ((int16_t)buf[21] >> 5 | ((int16_t)buf[22] << 3)) & 0x07FF;
+    sbus.ConnectState = buf[23];
+    if (sbus.ConnectState == 0x00)
+    {
+        offline_device_update(sbus.offline_index);
+    }
+}
+
+// 串口中断中调用,按帧头0x0F和帧尾0x00在环形缓冲区中找出完整的帧
+void uart3_rx_callback(UART_Device *uart)
+{
+    uint16_t avail = UART_RxAvailable(uart);
+    while (avail >= SBUS_FRAME_LEN)
     {
-        sbus.CH1      = ((int16_t)buf[1] >> 0 | ((int16_t)buf[2] << 8)) & 0x07FF;
-        sbus.CH2      = ((int16_t)buf[2] >> 3 | ((int16_t)buf[3] << 5)) & 0x07FF;
-        sbus.CH3      = ((int16_t)buf[3] >> 6 | ((int16_t)buf[4] << 2) | (int16_t)buf[5] << 10) & 0x07FF;
-        sbus.CH4      = ((int16_t)buf[5] >> 1 | ((int16_t)buf[6] << 7)) & 0x07FF;
-        sbus.CH5      = ((int16_t)buf[6] >> 4 | ((int16_t)buf[7] << 4)) & 0x07FF;
-        sbus.CH6      = ((int16_t)buf[7] >> 7 | ((int16_t)buf[8] << 1) | (int16_t)buf[9] << 9) & 0x07FF;
-        sbus.CH7      = ((int16_t)buf[9] >> 2 | ((int16_t)buf[10] << 6)) & 0x07FF;
-        sbus.CH8      = ((int16_t)buf[10] >> 5 | ((int16_t)buf[11] << 3)) & 0x07FF;
-        sbus.CH9      = ((int16_t)buf[12] << 0 | ((int16_t)buf[13] << 8)) & 0x07FF;
-        sbus.CH10     = ((int16_t)buf[13] >> 3 | ((int16_t)buf[14] << 5)) & 0x07FF;
-        sbus.CH11     = ((int16_t)buf[14] >> 6 | ((int16_t)buf[15] << 2) | (int16_t)buf[16] << 10) & 0x07FF;
-        sbus.CH12     = ((int16_t)buf[16] >> 1 | ((int16_t)buf[17] << 7)) & 0x07FF;
-        sbus.CH13     = ((int16_t)buf[17] >> 4 | ((int16_t)buf[18] << 4)) & 0x07FF;
-        sbus.CH14     = ((int16_t)buf[18] >> 7 | ((int16_t)buf[19] << 1) | (int16_t)buf[20] << 9) & 0x07FF;
-        sbus.CH15     = ((int16_t)buf[20] >> 2 | ((int16_t)buf[21] << 6)) & 0x07FF;
-        sbus.CH16     = ((int16_t)buf[21] >> 5 | ((int16_t)buf[22] << 3)) & 0x07FF;
-        sbus.ConnectState = buf[23];
-        if (sbus.ConnectState == 0x00)
+        if (UART_RxPeekByte(uart, 0) != 0x0F || UART_RxPeekByte(uart, SBUS_FRAME_LEN - 1) != 0x00)
         {
-            offline_device_update(sbus.offline_index);
+            UART_RxCommit(uart, 1);
+            avail--;
+            continue;
         }
+        sbus_decode(UART_RxPeek(uart, 0, SBUS_FRAME_LEN, sbus_frame));
+        UART_RxCommit(uart, SBUS_FRAME_LEN);
+        avail -= SBUS_FRAME_LEN;
     }
 }
 
@@ -55,13 +74,13 @@ void Remote_init(void){
 
     UART_Device_init_config uart3_cfg = {
         .huart = &huart3,
-        .expected_len = 25,      
+        .expected_len = 0,
         .rx_buf = (uint8_t (*)[2])sbus_buf,
-        .rx_buf_size = 30,
-        .rx_mode = UART_MODE_DMA,
+        .rx_buf_size = sizeof(sbus_buf),
+        .rx_mode = UART_MODE_DMA_CIRCULAR,
         .tx_mode = UART_MODE_BLOCKING,
         .timeout = 1000,
-        .rx_complete_cb = uart3_rx_callback, 
+        .rx_ring_cb = uart3_rx_callback, 
         .cb_type = UART_CALLBACK_DIRECT,
         .event_flag = 0x01,
     };
@@ -1,4 +1,5 @@
 #include "vcom.h"
+#include "vcom_msg_codec.h"
 #include "offline.h"
 #include "usbd_cdc_if.h"
 #include "usbd_def.h"
@@ -13,10 +14,12 @@
 vcom_receive_t vcom_receive;
 void usb_callback(uint8_t* Buf, uint32_t Len)
 {
-    if (Len ==sizeof(struct Recv_s) && Buf[0]==0xFF && Buf[sizeof(struct Recv_s)-1] == 0x0D)
+    struct Recv_s recv;
+    // 长度、帧头帧尾不对时不更新
+    if (VcomRecv_Decode(Buf, Len, &recv))
     {
         offline_device_update(vcom_receive.offline_index);
-        memcpy(&vcom_receive.recv,Buf,sizeof(struct Recv_s));
+        vcom_receive.recv = recv;
     }
 }
 
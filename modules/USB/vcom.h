@@ -3,10 +3,9 @@
 
 #include <stdint.h>
 #include <stdlib.h>
-#pragma pack(1)
+/* 上位机通信的报文格式由vcom_msg.json描述,帧头帧尾在vcom_msg_codec.c中收发,这里只保留数据字段 */
 struct Sentry_Send_s
 {
-  uint8_t header;
   uint16_t projectile_allowance_17mm;  //剩余发弹量
   uint8_t power_management_shooter_output; // 功率管理 shooter 输出
   uint16_t current_hp_percent; // 机器人当前血量百分比
@@ -18,12 +17,10 @@ struct Sentry_Send_s
   float roll;
   float pitch;
   float yaw;
-  uint8_t end ;
 };
 
 struct Recv_s
 {
-  uint8_t header; 
   uint8_t fire_advice;
   float pitch;
   float yaw;
@@ -32,11 +29,8 @@ struct Recv_s
   float vx;
   float vy;
   float wz;
-  uint8_t tail;
 };
 
-#pragma pack() 
-
 typedef struct{
   struct Recv_s recv;
   uint8_t offline_index;
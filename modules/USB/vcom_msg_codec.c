@@ -0,0 +1,217 @@
+/**
+ * @file vcom_msg_codec.c
+ * @brief 由 tools/codec/gen_codec.py 根据 modules/USB/vcom_msg.json 生成,请勿手动修改
+ */
+
+#include "vcom_msg_codec.h"
+#include <string.h>
+
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->projectile_allowance_17mm) == sizeof(uint16_t), "struct Sentry_Send_s.projectile_allowance_17mm changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->power_management_shooter_output) == sizeof(uint8_t), "struct Sentry_Send_s.power_management_shooter_output changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->current_hp_percent) == sizeof(uint16_t), "struct Sentry_Send_s.current_hp_percent changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->outpost_HP) == sizeof(uint16_t), "struct Sentry_Send_s.outpost_HP changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->base_HP) == sizeof(uint16_t), "struct Sentry_Send_s.base_HP changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->game_progess) == sizeof(uint8_t), "struct Sentry_Send_s.game_progess changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->game_time) == sizeof(uint16_t), "struct Sentry_Send_s.game_time changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->mode) == sizeof(uint8_t), "struct Sentry_Send_s.mode changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->roll) == sizeof(float), "struct Sentry_Send_s.roll changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->pitch) == sizeof(float), "struct Sentry_Send_s.pitch changed, regenerate codec");
+_Static_assert(sizeof(((struct Sentry_Send_s *)0)->yaw) == sizeof(float), "struct Sentry_Send_s.yaw changed, regenerate codec");
+_Static_assert(sizeof(((struct Recv_s *)0)->fire_advice) == sizeof(uint8_t), "struct Recv_s.fire_advice changed, regenerate codec");
+_Static_assert(sizeof(((struct Recv_s *)0)->pitch) == sizeof(float), "struct Recv_s.pitch changed, regenerate codec");
+_Static_assert(sizeof(((struct Recv_s *)0)->yaw) == sizeof(float), "struct Recv_s.yaw changed, regenerate codec");
+_Static_assert(sizeof(((struct Recv_s *)0)->distance) == sizeof(float), "struct Recv_s.distance changed, regenerate codec");
+_Static_assert(sizeof(((struct Recv_s *)0)->nav_state) == sizeof(uint8_t), "struct Recv_s.nav_state changed, regenerate codec");
+_Static_assert(sizeof(((struct Recv_s *)0)->vx) == sizeof(float), "struct Recv_s.vx changed, regenerate codec");
+_Static_assert(sizeof(((struct Recv_s *)0)->vy) == sizeof(float), "struct Recv_s.vy changed, regenerate codec");
+_Static_assert(sizeof(((struct Recv_s *)0)->wz) == sizeof(float), "struct Recv_s.wz changed, regenerate codec");
+
+static inline int32_t codec_round(float v)
+{
+    return (int32_t)(v >= 0.0f ? v + 0.5f : v - 0.5f);
+}
+
+/* 限幅到[lo, hi]后换算成定点数, NaN按offset处理 */
+static inline int32_t codec_quantize(float v, float lo, float hi, float offset, float inv_scale)
+{
+    if (!(v >= lo)) {
+        v = (v != v) ? offset : lo;
+    }
+    if (v > hi) {
+        v = hi;
+    }
+    return codec_round((v - offset) * inv_scale);
+}
+
+static inline int32_t codec_clamp_int(int32_t v, int32_t lo, int32_t hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static inline int32_t codec_sext(uint32_t raw, uint8_t bits)
+{
+    uint32_t m = 1u << (bits - 1);
+    return (int32_t)((raw ^ m) - m);
+}
+
+uint16_t SentrySend_Encode(const struct Sentry_Send_s *msg, uint8_t buf[SENTRY_SEND_LEN])
+{
+    uint32_t raw;
+
+    buf[0] = (uint8_t)0xAAu;
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->projectile_allowance_17mm, 0, 65535);
+    buf[1] = (uint8_t)raw;
+    buf[2] = (uint8_t)(raw >> 8);
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->power_management_shooter_output, 0, 255);
+    buf[3] = (uint8_t)raw;
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->current_hp_percent, 0, 65535);
+    buf[4] = (uint8_t)raw;
+    buf[5] = (uint8_t)(raw >> 8);
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->outpost_HP, 0, 65535);
+    buf[6] = (uint8_t)raw;
+    buf[7] = (uint8_t)(raw >> 8);
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->base_HP, 0, 65535);
+    buf[8] = (uint8_t)raw;
+    buf[9] = (uint8_t)(raw >> 8);
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->game_progess, 0, 255);
+    buf[10] = (uint8_t)raw;
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->game_time, 0, 65535);
+    buf[11] = (uint8_t)raw;
+    buf[12] = (uint8_t)(raw >> 8);
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->mode, 0, 255);
+    buf[13] = (uint8_t)raw;
+    memcpy(&raw, &msg->roll, sizeof(raw));
+    buf[14] = (uint8_t)raw;
+    buf[15] = (uint8_t)(raw >> 8);
+    buf[16] = (uint8_t)(raw >> 16);
+    buf[17] = (uint8_t)(raw >> 24);
+    memcpy(&raw, &msg->pitch, sizeof(raw));
+    buf[18] = (uint8_t)raw;
+    buf[19] = (uint8_t)(raw >> 8);
+    buf[20] = (uint8_t)(raw >> 16);
+    buf[21] = (uint8_t)(raw >> 24);
+    memcpy(&raw, &msg->yaw, sizeof(raw));
+    buf[22] = (uint8_t)raw;
+    buf[23] = (uint8_t)(raw >> 8);
+    buf[24] = (uint8_t)(raw >> 16);
+    buf[25] = (uint8_t)(raw >> 24);
+    buf[26] = (uint8_t)0xDu;
+    return SENTRY_SEND_LEN;
+}
+
+uint8_t SentrySend_Decode(const uint8_t *buf, uint16_t len, struct Sentry_Send_s *msg)
+{
+    uint32_t raw;
+
+    if (len != SENTRY_SEND_LEN) {
+        return 0;
+    }
+    raw = (uint32_t)buf[0];
+    if (raw != 0xAAu) {
+        return 0;
+    }
+    raw = (uint32_t)buf[1] | ((uint32_t)buf[2] << 8);
+    msg->projectile_allowance_17mm = (uint16_t)raw;
+    raw = (uint32_t)buf[3];
+    msg->power_management_shooter_output = (uint8_t)raw;
+    raw = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8);
+    msg->current_hp_percent = (uint16_t)raw;
+    raw = (uint32_t)buf[6] | ((uint32_t)buf[7] << 8);
+    msg->outpost_HP = (uint16_t)raw;
+    raw = (uint32_t)buf[8] | ((uint32_t)buf[9] << 8);
+    msg->base_HP = (uint16_t)raw;
+    raw = (uint32_t)buf[10];
+    msg->game_progess = (uint8_t)raw;
+    raw = (uint32_t)buf[11] | ((uint32_t)buf[12] << 8);
+    msg->game_time = (uint16_t)raw;
+    raw = (uint32_t)buf[13];
+    msg->mode = (uint8_t)raw;
+    raw = (uint32_t)buf[14] | ((uint32_t)buf[15] << 8) | ((uint32_t)buf[16] << 16) | ((uint32_t)buf[17] << 24);
+    memcpy(&msg->roll, &raw, sizeof(raw));
+    raw = (uint32_t)buf[18] | ((uint32_t)buf[19] << 8) | ((uint32_t)buf[20] << 16) | ((uint32_t)buf[21] << 24);
+    memcpy(&msg->pitch, &raw, sizeof(raw));
+    raw = (uint32_t)buf[22] | ((uint32_t)buf[23] << 8) | ((uint32_t)buf[24] << 16) | ((uint32_t)buf[25] << 24);
+    memcpy(&msg->yaw, &raw, sizeof(raw));
+    raw = (uint32_t)buf[26];
+    if (raw != 0xDu) {
+        return 0;
+    }
+    return 1;
+}
+
+uint16_t VcomRecv_Encode(const struct Recv_s *msg, uint8_t buf[VCOM_RECV_LEN])
+{
+    uint32_t raw;
+
+    buf[0] = (uint8_t)0xFFu;
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->fire_advice, 0, 255);
+    buf[1] = (uint8_t)raw;
+    memcpy(&raw, &msg->pitch, sizeof(raw));
+    buf[2] = (uint8_t)raw;
+    buf[3] = (uint8_t)(raw >> 8);
+    buf[4] = (uint8_t)(raw >> 16);
+    buf[5] = (uint8_t)(raw >> 24);
+    memcpy(&raw, &msg->yaw, sizeof(raw));
+    buf[6] = (uint8_t)raw;
+    buf[7] = (uint8_t)(raw >> 8);
+    buf[8] = (uint8_t)(raw >> 16);
+    buf[9] = (uint8_t)(raw >> 24);
+    memcpy(&raw, &msg->distance, sizeof(raw));
+    buf[10] = (uint8_t)raw;
+    buf[11] = (uint8_t)(raw >> 8);
+    buf[12] = (uint8_t)(raw >> 16);
+    buf[13] = (uint8_t)(raw >> 24);
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->nav_state, 0, 255);
+    buf[14] = (uint8_t)raw;
+    memcpy(&raw, &msg->vx, sizeof(raw));
+    buf[15] = (uint8_t)raw;
+    buf[16] = (uint8_t)(raw >> 8);
+    buf[17] = (uint8_t)(raw >> 16);
+    buf[18] = (uint8_t)(raw >> 24);
+    memcpy(&raw, &msg->vy, sizeof(raw));
+    buf[19] = (uint8_t)raw;
+    buf[20] = (uint8_t)(raw >> 8);
+    buf[21] = (uint8_t)(raw >> 16);
+    buf[22] = (uint8_t)(raw >> 24);
+    memcpy(&raw, &msg->wz, sizeof(raw));
+    buf[23] = (uint8_t)raw;
+    buf[24] = (uint8_t)(raw >> 8);
+    buf[25] = (uint8_t)(raw >> 16);
+    buf[26] = (uint8_t)(raw >> 24);
+    buf[27] = (uint8_t)0xDu;
+    return VCOM_RECV_LEN;
+}
+
+uint8_t VcomRecv_Decode(const uint8_t *buf, uint16_t len, struct Recv_s *msg)
+{
+    uint32_t raw;
+
+    if (len != VCOM_RECV_LEN) {
+        return 0;
+    }
+    raw = (uint32_t)buf[0];
+    if (raw != 0xFFu) {
+        return 0;
+    }
+    raw = (uint32_t)buf[1];
+    msg->fire_advice = (uint8_t)raw;
+    raw = (uint32_t)buf[2] | ((uint32_t)buf[3] << 8) | ((uint32_t)buf[4] << 16) | ((uint32_t)buf[5] << 24);
+    memcpy(&msg->pitch, &raw, sizeof(raw));
+    raw = (uint32_t)buf[6] | ((uint32_t)buf[7] << 8) | ((uint32_t)buf[8] << 16) | ((uint32_t)buf[9] << 24);
+    memcpy(&msg->yaw, &raw, sizeof(raw));
+    raw = (uint32_t)buf[10] | ((uint32_t)buf[11] << 8) | ((uint32_t)buf[12] << 16) | ((uint32_t)buf[13] << 24);
+    memcpy(&msg->distance, &raw, sizeof(raw));
+    raw = (uint32_t)buf[14];
+    msg->nav_state = (uint8_t)raw;
+    raw = (uint32_t)buf[15] | ((uint32_t)buf[16] << 8) | ((uint32_t)buf[17] << 16) | ((uint32_t)buf[18] << 24);
+    memcpy(&msg->vx, &raw, sizeof(raw));
+    raw = (uint32_t)buf[19] | ((uint32_t)buf[20] << 8) | ((uint32_t)buf[21] << 16) | ((uint32_t)buf[22] << 24);
+    memcpy(&msg->vy, &raw, sizeof(raw));
+    raw = (uint32_t)buf[23] | ((uint32_t)buf[24] << 8) | ((uint32_t)buf[25] << 16) | ((uint32_t)buf[26] << 24);
+    memcpy(&msg->wz, &raw, sizeof(raw));
+    raw = (uint32_t)buf[27];
+    if (raw != 0xDu) {
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file vcom_msg_codec.h
+ * @brief 由 tools/codec/gen_codec.py 根据 modules/USB/vcom_msg.json 生成,请勿手动修改
+ */
+
+#ifndef VCOM_MSG_CODEC_H
+#define VCOM_MSG_CODEC_H
+
+#include <stdint.h>
+#include "vcom.h"
+
+#define SENTRY_SEND_LEN 27 // 216 bit
+#define VCOM_RECV_LEN 28 // 224 bit
+
+/**
+ * @brief 发给上位机的比赛状态和姿态,布局与原先的packed结构体相同(小端,float为IEEE754)
+ * @note 低位先行的位流, 字段(起始位:位数):
+ *       -                                    0:8  常量 0xAA
+ *       projectile_allowance_17mm            8:16 无符号, 范围[0, 65535]
+ *       power_management_shooter_output     24:8  无符号, 范围[0, 255]
+ *       current_hp_percent                  32:16 无符号, 范围[0, 65535]
+ *       outpost_HP                          48:16 无符号, 范围[0, 65535]
+ *       base_HP                             64:16 无符号, 范围[0, 65535]
+ *       game_progess                        80:8  无符号, 范围[0, 255]
+ *       game_time                           88:16 无符号, 范围[0, 65535]
+ *       mode                               104:8  无符号, 范围[0, 255]
+ *       roll                               112:32 float
+ *       pitch                              144:32 float
+ *       yaw                                176:32 float
+ *       -                                  208:8  常量 0xD
+ */
+uint16_t SentrySend_Encode(const struct Sentry_Send_s *msg, uint8_t buf[SENTRY_SEND_LEN]);
+uint8_t SentrySend_Decode(const uint8_t *buf, uint16_t len, struct Sentry_Send_s *msg);
+
+/**
+ * @brief 上位机发来的自瞄和导航指令
+ * @note 低位先行的位流, 字段(起始位:位数):
+ *       -                                    0:8  常量 0xFF
+ *       fire_advice                          8:8  无符号, 范围[0, 255]
+ *       pitch                               16:32 float
+ *       yaw                                 48:32 float
+ *       distance                            80:32 float
+ *       nav_state                          112:8  无符号, 范围[0, 255]
+ *       vx                                 120:32 float
+ *       vy                                 152:32 float
+ *       wz                                 184:32 float
+ *       -                                  216:8  常量 0xD
+ */
+uint16_t VcomRecv_Encode(const struct Recv_s *msg, uint8_t buf[VCOM_RECV_LEN]);
+uint8_t VcomRecv_Decode(const uint8_t *buf, uint16_t len, struct Recv_s *msg);
+
+#endif // VCOM_MSG_CODEC_H
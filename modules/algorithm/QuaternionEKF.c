@@ -15,6 +15,7 @@
  */
 #include "QuaternionEKF.h"
 #include "arm_math.h"
+#include "dwt_prof.h"
 
 QEKF_INS_t QEKF_INS;
 
@@ -103,6 +104,7 @@ void IMU_QuaternionEKF_Update(float gx, float gy, float gz, float ax, float ay,
     // 0.5(Ohm-Ohm^bias)*deltaT,用于更新工作点处的状态转移F矩阵
     static float halfgxdt, halfgydt, halfgzdt;
     static float accelInvNorm;
+    PROF_BEGIN(QEKF_UPDATE);
     // if (!QEKF_INS.Initialized)
     // {
     //     IMU_QuaternionEKF_Init(10, 0.001, 1000000 * 10, 0.9996 * 0 + 1, 0);
@@ -222,6 +224,7 @@ void IMU_QuaternionEKF_Update(float gx, float gy, float gz, float ax, float ay,
     QEKF_INS.YawTotalAngle = 360.0f * QEKF_INS.YawRoundCount + QEKF_INS.Yaw;
     QEKF_INS.YawAngleLast = QEKF_INS.Yaw;
     QEKF_INS.UpdateCount++; // 初始化低通滤波用,计数测试用
+    PROF_END(QEKF_UPDATE);
 }
 
 /**
@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "dwt.h"
+#include "dwt_prof.h"
 
 
 
@@ -159,6 +160,7 @@ void PIDInit(PIDInstance *pid, PID_Init_Config_s *config)
  */
 float PIDCalculate(PIDInstance *pid, float measure, float ref)
 {
+    PROF_BEGIN(PID_CALCULATE);
     // 堵转检测
     if (pid->Improve & PID_ErrorHandle)
         f_PID_ErrorHandle(pid);
@@ -216,6 +218,7 @@ float PIDCalculate(PIDInstance *pid, float measure, float ref)
     pid->Last_Dout = pid->Dout;
     pid->Last_Err = pid->Err;
     pid->Last_ITerm = pid->ITerm;
+    PROF_END(PID_CALCULATE);
 
     //堵转保护
     if (pid->ERRORHandler.ERRORType == PID_MOTOR_BLOCKED_ERROR)
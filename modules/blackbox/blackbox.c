@@ -0,0 +1,413 @@
+#include "blackbox.h"
+#include <stddef.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cmsis_os.h"
+#include "SEGGER_RTT.h"
+#include "bsp_flash_kv.h"
+#include "dji.h"
+#include "imu.h"
+#include "systemwatch.h"
+#include "stm32f4xx_hal.h"
+
+#define LOG_TAG "blackbox"
+#include "elog.h"
+
+#define BLACKBOX_RING_MAGIC        0x474E5242U // "BRNG"
+#define BLACKBOX_SLOTS             (BLACKBOX_SIZE / BLACKBOX_BLOCK_SIZE)
+#define BLACKBOX_SLOTS_PER_SECTOR  (BLACKBOX_SECTOR_SIZE / BLACKBOX_BLOCK_SIZE)
+#define BLACKBOX_CRC_HEAD_LEN      offsetof(BlackBox_BlockHead_t, crc)
+#define BLACKBOX_RESERVE_BLOCKS    (BLACKBOX_RAM_BLOCKS - 1) // 缓冲中最多的待写入块数
+
+_Static_assert(sizeof(BlackBox_Sample_t) == 32, "BlackBox_Sample_t changed, update blackbox_decode.py");
+_Static_assert(sizeof(BlackBox_BlockHead_t) == 32, "BlackBox_BlockHead_t changed, update blackbox_decode.py");
+_Static_assert(sizeof(BlackBox_Block_t) == BLACKBOX_BLOCK_SIZE, "block must fill BLACKBOX_BLOCK_SIZE");
+
+/* 环形缓冲,放在CCM中不初始化,复位后内容还在 */
+typedef struct {
+    uint32_t magic;
+    uint32_t next_seq;  // 下一个填满的块使用的seq
+    uint16_t session;
+    uint16_t head;      // 正在填写的块
+    uint16_t tail;      // 最早一个还没写入flash的块
+    uint16_t full;      // 已填满等待写入的块数
+    uint32_t dropped;   // 还没记入块头的丢弃采样数
+    BlackBox_Block_t blocks[BLACKBOX_RAM_BLOCKS];
+} BlackBox_Ring_t;
+
+static BlackBox_Ring_t ring __attribute__((section(".ccm_noinit")));
+
+static struct {
+    osThreadId task;
+    void (*fill)(BlackBox_Sample_t *sample);
+    volatile uint8_t busy;    // 有写入或擦除交给了后台任务
+    volatile uint8_t writing; // 缓冲中最早的块正在写入,不能丢弃
+    uint8_t writable;         // write_slot是空白的
+    uint8_t commit_erase;     // 提交复位前的数据时允许擦除一次
+    uint32_t last_flush_ms;
+    BlackBox_Stats_t stats;
+} bb;
+
+static inline uint32_t BlackBox_SlotAddr(uint16_t slot)
+{
+    return BLACKBOX_ADDR + (uint32_t)slot * BLACKBOX_BLOCK_SIZE;
+}
+
+static inline uint32_t BlackBox_SlotSector(uint16_t slot)
+{
+    return slot < BLACKBOX_SLOTS_PER_SECTOR ? BLACKBOX_SECTOR_A : BLACKBOX_SECTOR_B;
+}
+
+/* 块按地址从低到高写入,块头空白说明整个块都没有写过 */
+static uint8_t BlackBox_SlotBlank(uint16_t slot)
+{
+    uint32_t head[sizeof(BlackBox_BlockHead_t) / 4];
+    BSP_Flash_Read(BlackBox_SlotAddr(slot), (uint8_t *)head, sizeof(head));
+    for (uint8_t i = 0; i < sizeof(head) / 4; i++) {
+        if (head[i] != 0xFFFFFFFFU) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* 确定write_slot能否直接写入;不是空白且不在扇区开头时跳到下一个扇区开头,擦除时不会擦掉同一扇区中刚写入的块 */
+static void BlackBox_CheckSlot(void)
+{
+    bb.writable = BlackBox_SlotBlank(bb.stats.write_slot);
+    if (!bb.writable && bb.stats.write_slot % BLACKBOX_SLOTS_PER_SECTOR) {
+        bb.stats.write_slot =
+            (bb.stats.write_slot / BLACKBOX_SLOTS_PER_SECTOR + 1) * BLACKBOX_SLOTS_PER_SECTOR % BLACKBOX_SLOTS;
+        bb.writable = BlackBox_SlotBlank(bb.stats.write_slot);
+    }
+}
+
+/* 找到seq最大的块,下一个位置为写入位置 */
+static void BlackBox_Scan(uint32_t *next_seq, uint16_t *session)
+{
+    BlackBox_BlockHead_t head;
+    uint8_t found = 0;
+    uint16_t newest = 0;
+
+    *next_seq = 1;
+    *session = 0;
+    for (uint16_t slot = 0; slot < BLACKBOX_SLOTS; slot++) {
+        BSP_Flash_Read(BlackBox_SlotAddr(slot), (uint8_t *)&head, sizeof(head));
+        if (head.magic != BLACKBOX_BLOCK_MAGIC) {
+            continue;
+        }
+        if (!found || (int32_t)(head.seq - (*next_seq - 1)) > 0) {
+            found = 1;
+            newest = slot;
+            *next_seq = head.seq + 1;
+            *session = head.session;
+        }
+    }
+    bb.stats.write_slot = found ? (newest + 1) % BLACKBOX_SLOTS : 0;
+    BlackBox_CheckSlot();
+}
+
+static uint8_t BlackBox_RingValid(void)
+{
+    return ring.magic == BLACKBOX_RING_MAGIC && ring.head < BLACKBOX_RAM_BLOCKS && ring.tail < BLACKBOX_RAM_BLOCKS &&
+           ring.full < BLACKBOX_RAM_BLOCKS && (ring.tail + ring.full) % BLACKBOX_RAM_BLOCKS == ring.head &&
+           ring.blocks[ring.head].head.count <= BLACKBOX_BLOCK_SAMPLES;
+}
+
+static void BlackBox_OpenBlock(void)
+{
+    BlackBox_Block_t *blk = &ring.blocks[ring.head];
+    memset(blk, 0xFF, sizeof(*blk));
+    blk->head.count = 0;
+}
+
+/* 填满或复位后结束当前块,放入待写入队列;缓冲满时丢弃最早的块,最早的块正在写入或是复位前的数据时丢弃当前块 */
+static void BlackBox_CloseBlock(uint32_t flags)
+{
+    BlackBox_Block_t *blk = &ring.blocks[ring.head];
+    uint8_t keep;
+
+    taskENTER_CRITICAL();
+    if (ring.full == BLACKBOX_RAM_BLOCKS - 1 && !bb.writing && !bb.stats.committing) {
+        ring.dropped += ring.blocks[ring.tail].head.count;
+        bb.stats.dropped += ring.blocks[ring.tail].head.count;
+        ring.tail = (ring.tail + 1) % BLACKBOX_RAM_BLOCKS;
+        ring.full--;
+    }
+    keep = ring.full < BLACKBOX_RAM_BLOCKS - 1;
+    taskEXIT_CRITICAL();
+
+    if (!keep) {
+        ring.dropped += blk->head.count;
+        bb.stats.dropped += blk->head.count;
+        BlackBox_OpenBlock();
+        return;
+    }
+    blk->head.magic = BLACKBOX_BLOCK_MAGIC;
+    blk->head.seq = ring.next_seq++;
+    blk->head.session = ring.session;
+    blk->head.dropped = ring.dropped;
+    blk->head.flags = flags | (bb.stats.frozen ? BLACKBOX_BLOCK_FROZEN : 0);
+    blk->head.reserved = 0;
+    blk->head.crc = BSP_Flash_Crc32(0, (const uint8_t *)&blk->head, BLACKBOX_CRC_HEAD_LEN);
+    blk->head.crc = BSP_Flash_Crc32(blk->head.crc, (const uint8_t *)blk->samples, sizeof(blk->samples));
+    ring.dropped = 0;
+
+    taskENTER_CRITICAL();
+    ring.head = (ring.head + 1) % BLACKBOX_RAM_BLOCKS;
+    ring.full++;
+    taskEXIT_CRITICAL();
+    BlackBox_OpenBlock();
+}
+
+static int16_t BlackBox_Centi(float deg)
+{
+    float v = deg * 100.0f;
+    if (v > 32767.0f) {
+        return 32767;
+    }
+    if (v < -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)v;
+}
+
+static void BlackBox_Record(uint32_t now)
+{
+    BlackBox_Block_t *blk = &ring.blocks[ring.head];
+    BlackBox_Sample_t *s = &blk->samples[blk->head.count];
+    int16_t out[BLACKBOX_MOTOR_NUM] = {0}, speed[BLACKBOX_MOTOR_NUM] = {0};
+
+    memset(s, 0, sizeof(*s));
+    s->time_ms = (uint16_t)now;
+    s->attitude[0] = BlackBox_Centi(INS.Yaw);
+    s->attitude[1] = BlackBox_Centi(INS.Pitch);
+    s->attitude[2] = BlackBox_Centi(INS.Roll);
+    DJIMotorGetSnapshot(out, speed, BLACKBOX_MOTOR_NUM);
+    memcpy(s->motor_out, out, sizeof(out));
+    memcpy(s->motor_speed, speed, sizeof(speed));
+    if (bb.fill) {
+        bb.fill(s);
+    }
+    if (blk->head.count == 0) {
+        blk->head.start_ms = now;
+    }
+    blk->head.count++;
+    bb.stats.samples++;
+    if (blk->head.count == BLACKBOX_BLOCK_SAMPLES) {
+        BlackBox_CloseBlock(0);
+    }
+}
+
+/* 写入完成,在flash任务中调用 */
+static void BlackBox_WriteDone(Flash_Status status, void *arg)
+{
+    UNUSED(arg);
+    if (status == FLASH_OK) {
+        bb.stats.blocks_written++;
+    } else {
+        bb.stats.write_errors++; // 这个位置已经写过,跳过
+    }
+    taskENTER_CRITICAL();
+    ring.tail = (ring.tail + 1) % BLACKBOX_RAM_BLOCKS;
+    ring.full--;
+    taskEXIT_CRITICAL();
+    bb.stats.write_slot = (bb.stats.write_slot + 1) % BLACKBOX_SLOTS;
+    BlackBox_CheckSlot();
+    if (bb.stats.committing && --bb.stats.committing == 0) {
+        bb.commit_erase = 0;
+    }
+    bb.writing = 0;
+    bb.busy = 0;
+}
+
+static void BlackBox_EraseDone(Flash_Status status, void *arg)
+{
+    UNUSED(arg);
+    if (status == FLASH_OK) {
+        bb.stats.erases++;
+        bb.commit_erase = 0;
+    }
+    BlackBox_CheckSlot();
+    bb.busy = 0;
+}
+
+/* 写入位置之后保留的空白块是否还在,保留的块只给复位前的数据使用.块按顺序写入,只需要看最远的一个 */
+static uint8_t BlackBox_ReserveBlank(void)
+{
+    uint16_t slot = (bb.stats.write_slot + BLACKBOX_RESERVE_BLOCKS) % BLACKBOX_SLOTS;
+    if (BlackBox_SlotSector(slot) == BlackBox_SlotSector(bb.stats.write_slot)) {
+        return 1;
+    }
+    return BlackBox_SlotBlank(slot);
+}
+
+static void BlackBox_Erase(uint16_t slot, uint32_t now)
+{
+    bb.busy = 1;
+    bb.last_flush_ms = now;
+    if (BSP_Flash_EraseAsync(BlackBox_SlotSector(slot), BlackBox_EraseDone, NULL) != FLASH_OK) {
+        bb.busy = 0;
+    }
+}
+
+/* 把缓冲中最早的块交给后台写入,写入位置或保留的块还没擦除时先擦除 */
+static void BlackBox_Flush(uint32_t now)
+{
+    if (bb.busy || ring.full == 0 || now - bb.last_flush_ms < BLACKBOX_FLUSH_MIN_MS) {
+        return;
+    }
+    if (!bb.writable) {
+        if (bb.stats.frozen && !bb.commit_erase) {
+            // 冻结后不再擦除,已经没有空白空间,复位前的数据留在缓冲中,之后按普通的块丢弃
+            bb.stats.committing = 0;
+            return;
+        }
+        BlackBox_Erase(bb.stats.write_slot, now);
+        return;
+    }
+    if (!bb.stats.committing && !BlackBox_ReserveBlank()) {
+        // 比赛中擦除在队列中等到比赛结束,期间只靠环形缓冲保留最近的数据
+        if (!bb.stats.frozen) {
+            BlackBox_Erase((bb.stats.write_slot + BLACKBOX_RESERVE_BLOCKS) % BLACKBOX_SLOTS, now);
+        }
+        return;
+    }
+    bb.busy = 1;
+    bb.writing = 1;
+    bb.last_flush_ms = now;
+    if (BSP_Flash_WriteAsync(BlackBox_SlotAddr(bb.stats.write_slot), (const uint8_t *)&ring.blocks[ring.tail],
+                             BLACKBOX_BLOCK_SIZE, BlackBox_WriteDone, NULL) != FLASH_OK) {
+        bb.writing = 0;
+        bb.busy = 0;
+    }
+}
+
+static void BlackBox_Dump(void)
+{
+    SEGGER_RTT_printf(BLACKBOX_RTT_CHANNEL, "\r\nblackbox session %u %s%s\r\n", bb.stats.session,
+                      bb.stats.frozen ? "frozen" : "recording", bb.stats.committing ? ", committing reset data" : "");
+    SEGGER_RTT_printf(BLACKBOX_RTT_CHANNEL, "reset flags 0x%08x, slot %u/%u %s, pending %u blocks\r\n",
+                      (unsigned)bb.stats.reset_flags, bb.stats.write_slot, BLACKBOX_SLOTS,
+                      bb.writable ? "blank" : "needs erase", ring.full);
+    SEGGER_RTT_printf(BLACKBOX_RTT_CHANNEL, "samples %u dropped %u written %u errors %u erases %u\r\n",
+                      (unsigned)bb.stats.samples, (unsigned)bb.stats.dropped, (unsigned)bb.stats.blocks_written,
+                      (unsigned)bb.stats.write_errors, (unsigned)bb.stats.erases);
+}
+
+static void BlackBox_Task(const void *argument)
+{
+    static char up_buffer[256];
+    static char down_buffer[16];
+    uint32_t wake = osKernelSysTick();
+    char tmp[16];
+    UNUSED(argument);
+
+    SEGGER_RTT_ConfigUpBuffer(BLACKBOX_RTT_CHANNEL, "blackbox", up_buffer, sizeof(up_buffer),
+                              SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    SEGGER_RTT_ConfigDownBuffer(BLACKBOX_RTT_CHANNEL, "blackbox", down_buffer, sizeof(down_buffer),
+                                SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    SystemWatch_RegisterTask(bb.task, "blackbox");
+    for (;;) {
+        SystemWatch_ReportTaskAlive(osThreadGetId());
+        uint32_t now = xTaskGetTickCount();
+        BlackBox_Record(now);
+        BlackBox_Flush(now);
+
+        unsigned n = SEGGER_RTT_Read(BLACKBOX_RTT_CHANNEL, tmp, sizeof(tmp));
+        if (n > 0) {
+            if (memchr(tmp, 'c', n)) {
+                BlackBox_Unfreeze();
+            }
+            BlackBox_Dump();
+        }
+        osDelayUntil(&wake, 1000 / BLACKBOX_RATE_HZ);
+    }
+}
+
+void BlackBox_Init(void)
+{
+    uint32_t next_seq;
+    uint16_t session;
+    uint8_t frozen = 0;
+
+    bb.stats.reset_flags = RCC->CSR;
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+    BlackBox_Scan(&next_seq, &session);
+    FlashKV_Get(FLASHKV_KEY_BLACKBOX, &frozen, sizeof(frozen));
+    bb.stats.frozen = frozen;
+
+    // 上电和欠压复位后CCM中是随机内容,其他复位后缓冲中还没写入flash的是复位前最后几秒
+    if (!(bb.stats.reset_flags & (RCC_CSR_PORRSTF | RCC_CSR_BORRSTF)) && BlackBox_RingValid()) {
+        if ((int32_t)(ring.session - session) > 0) {
+            session = ring.session;
+        }
+        if ((int32_t)(ring.next_seq - next_seq) > 0) {
+            next_seq = ring.next_seq;
+        }
+        ring.next_seq = next_seq;
+        if (ring.blocks[ring.head].head.count) {
+            BlackBox_CloseBlock(BLACKBOX_BLOCK_RESET);
+        }
+        if (ring.full) {
+            log_w("reset while recording (flags 0x%08lx), committing %u blocks", (unsigned long)bb.stats.reset_flags,
+                  ring.full);
+            bb.stats.committing = ring.full;
+            bb.commit_erase = !bb.stats.frozen; // 已经冻结时不擦除,只写入剩余空间
+            BlackBox_Freeze();
+        }
+    } else {
+        memset(&ring, 0, offsetof(BlackBox_Ring_t, blocks));
+        ring.next_seq = next_seq;
+        BlackBox_OpenBlock();
+        ring.magic = BLACKBOX_RING_MAGIC;
+    }
+    bb.stats.session = session + 1;
+    ring.session = bb.stats.session;
+    if (bb.stats.frozen) {
+        log_w("black box frozen, send 'c' on RTT channel %d after reading it out", BLACKBOX_RTT_CHANNEL);
+    }
+
+    osThreadDef(BlackBoxTask, BlackBox_Task, osPriorityBelowNormal, 0, 256);
+    bb.task = osThreadCreate(osThread(BlackBoxTask), NULL);
+    if (bb.task == NULL) {
+        log_e("Failed to create black box task");
+        return;
+    }
+    log_i("black box session %u, write slot %u", bb.stats.session, bb.stats.write_slot);
+}
+
+void BlackBox_SetFill(void (*fill)(BlackBox_Sample_t *sample))
+{
+    bb.fill = fill;
+}
+
+void BlackBox_Freeze(void)
+{
+    uint8_t frozen = 1;
+    if (bb.stats.frozen) {
+        return;
+    }
+    bb.stats.frozen = 1;
+    if (FlashKV_Set(FLASHKV_KEY_BLACKBOX, &frozen, sizeof(frozen)) != FLASH_OK) {
+        log_e("failed to save freeze state");
+    }
+    log_w("black box frozen");
+}
+
+void BlackBox_Unfreeze(void)
+{
+    if (!bb.stats.frozen) {
+        return;
+    }
+    bb.stats.frozen = 0;
+    FlashKV_Delete(FLASHKV_KEY_BLACKBOX);
+    log_i("black box unfrozen");
+}
+
+void BlackBox_GetStats(BlackBox_Stats_t *stats)
+{
+    *stats = bb.stats;
+    stats->pending = ring.full;
+}
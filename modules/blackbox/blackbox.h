@@ -0,0 +1,112 @@
+/**
+ * @file blackbox.h
+ * @brief 黑匣子:按固定格式记录控制数据,写入flash专用区域,异常复位后冻结,赛后读出分析
+ *
+ * @note 数据流: 记录任务按BLACKBOX_RATE_HZ采样,写入CCM中按块组织的环形缓冲(复位时不清零),
+ *       填满的块交给bsp_flash后台任务写入扇区8/9组成的循环日志,同一时间只有一个块在写,两次写入间隔不小于BLACKBOX_FLUSH_MIN_MS.
+ *       写入位置之后始终保留一个缓冲大小的空白块给复位前的数据,保留的块跨到还没擦除的扇区时把擦除放入后台队列,
+ *       比赛中不擦除,期间数据留在环形缓冲中,缓冲满时丢弃最早的块.
+ *       flash区域可以保存约40s,环形缓冲约5s
+ * @note 冻结: 开机时发现上次是非上电复位(看门狗、软件复位、按键复位,故障最终也会走到其中之一)且环形缓冲有效时,
+ *       先把缓冲中还没写入的数据(复位前最后几秒)写入保留的空白块,这些块写完前缓冲满时丢弃新数据;
+ *       之后不再擦除flash区域,新数据写入剩余的空白空间,保留的块留给下一次复位.
+ *       冻结状态保存在参数存储中,掉电不丢失,读出数据后在RTT通道BLACKBOX_RTT_CHANNEL下行发送'c'解除,发送其他字符打印一次状态
+ * @note 读出: 用调试器读出BLACKBOX_ADDR开始的BLACKBOX_SIZE字节保存为bin文件,
+ *       用tools/blackbox/blackbox_decode.py转换为csv
+ */
+
+#ifndef __BLACKBOX_H
+#define __BLACKBOX_H
+
+#include <stdint.h>
+#include "bsp_flash.h"
+
+#define BLACKBOX_RATE_HZ        200
+#define BLACKBOX_MOTOR_NUM      4                    // 记录的DJI电机数,按注册顺序
+#define BLACKBOX_SECTOR_A       FLASH_SECTOR_8
+#define BLACKBOX_SECTOR_B       FLASH_SECTOR_9
+#define BLACKBOX_ADDR           ADDR_FLASH_SECTOR_8
+#define BLACKBOX_SECTOR_SIZE    (128 * 1024)
+#define BLACKBOX_SIZE           (2 * BLACKBOX_SECTOR_SIZE)
+#define BLACKBOX_BLOCK_SIZE     2048                 // 每次写入flash的单位
+#define BLACKBOX_RAM_BLOCKS     16                   // 环形缓冲的块数,32KB
+#define BLACKBOX_FLUSH_MIN_MS   100                  // 两次写入flash之间的最小间隔
+#define BLACKBOX_RTT_CHANNEL    3                    // 0为日志,1为message_center,2为can_monitor
+
+#define BLACKBOX_BLOCK_MAGIC    0x5842424DU          // "MBBX"
+#define BLACKBOX_BLOCK_RESET    0x01                 // 块头flags: 复位前最后一个块,采样数不满
+#define BLACKBOX_BLOCK_FROZEN   0x02                 // 块头flags: 写入时已冻结
+
+/* 单次采样,32字节,字段按自然对齐排列,修改后需要同步修改tools/blackbox/blackbox_decode.py */
+typedef struct {
+    uint16_t time_ms;                         // 时间的低16位,完整时间在块头中
+    int16_t attitude[3];                      // INS yaw/pitch/roll, 0.01°
+    int16_t motor_out[BLACKBOX_MOTOR_NUM];    // 电机电流指令
+    int16_t motor_speed[BLACKBOX_MOTOR_NUM];  // 电机转速反馈,rpm
+    uint8_t power_limit;                      // 裁判系统底盘功率上限,W
+    uint8_t buffer_energy;                    // 裁判系统缓冲能量,J
+    uint16_t shooter_heat;                    // 裁判系统枪口热量
+    uint8_t chassis_mode;
+    uint8_t gimbal_mode;
+    uint8_t shoot_mode;                       // bit0 shoot_mode, bit1 friction_mode, bit2~4 load_mode
+    uint8_t flags;                            // 由应用层定义
+} BlackBox_Sample_t;
+
+/* 块头,32字节,crc覆盖块头的前28字节和全部采样区 */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;        // 块序号,跨开机递增
+    uint16_t session;    // 开机序号
+    uint16_t count;      // 有效采样数
+    uint32_t start_ms;   // 第一个采样的完整时间
+    uint32_t dropped;    // 这个块之前因缓冲满丢弃的采样数
+    uint32_t flags;      // BLACKBOX_BLOCK_*
+    uint32_t reserved;
+    uint32_t crc;
+} BlackBox_BlockHead_t;
+
+#define BLACKBOX_BLOCK_SAMPLES  ((BLACKBOX_BLOCK_SIZE - sizeof(BlackBox_BlockHead_t)) / sizeof(BlackBox_Sample_t))
+
+typedef struct {
+    BlackBox_BlockHead_t head;
+    BlackBox_Sample_t samples[BLACKBOX_BLOCK_SAMPLES];
+} BlackBox_Block_t;
+
+typedef struct {
+    uint8_t frozen;           // flash区域已冻结
+    uint8_t committing;       // 复位前缓冲中还没写入flash的块数
+    uint16_t session;
+    uint16_t write_slot;      // 下一个写入的块位置
+    uint16_t pending;         // 缓冲中等待写入的块数
+    uint32_t reset_flags;     // 开机时的RCC->CSR
+    uint32_t samples;         // 开机后的采样数
+    uint32_t dropped;         // 缓冲满或冻结后没有空间丢弃的采样数
+    uint32_t blocks_written;
+    uint32_t write_errors;
+    uint32_t erases;
+} BlackBox_Stats_t;
+
+/**
+ * @brief 检查复位原因和上次的缓冲,扫描flash日志,创建记录任务
+ * @note 需要在FlashKV_Init和BSP_Flash_ServiceInit之后调用,复位标志在这里读取后清除
+ */
+void BlackBox_Init(void);
+
+/**
+ * @brief 设置应用层的填写函数,在记录任务中调用,填写时间、姿态和电机以外的字段
+ */
+void BlackBox_SetFill(void (*fill)(BlackBox_Sample_t *sample));
+
+/**
+ * @brief 应用层检测到故障时调用,冻结flash区域,之后不再擦除
+ */
+void BlackBox_Freeze(void);
+
+/**
+ * @brief 读出数据后解除冻结
+ */
+void BlackBox_Unfreeze(void);
+
+void BlackBox_GetStats(BlackBox_Stats_t *stats);
+
+#endif // __BLACKBOX_H
@@ -2,13 +2,41 @@
 #define __BOARD_COM_H
 
 #include "bsp_can.h"
+#include "board_tp.h"
 #include "offline.h"
 #include "robotdef.h"
 
+/* 0: 按board_msg.json定点压缩成单帧(board_msg_codec.c),经发送调度表与电机报文一起按周期发出
+   1: 通过board_tp分段传输完整精度的结构体和发送时间戳,每条消息占用4帧.各段同ID,不能经过调度表合并,
+      以最高优先级直接进入发送队列,会和电机报文争抢邮箱,确认总线负载有余量后再开启.
+      1Mbps下一条分段消息约占总线428us,按robot_control的3ms周期约占14%,单帧约3.7%(tests/board_com/test_board_tp.c) */
+#ifndef BOARD_COM_SEGMENTED
+#define BOARD_COM_SEGMENTED 0
+#endif
+
+#if BOARD_COM_SEGMENTED
+/* 分段传输的消息直接传输结构体,两块板子使用同一份代码和编译器,布局一致 */
+typedef struct
+{
+    uint32_t stamp_ms;       // 发送方发送时的系统时间,接收方据此判断消息间隔
+    Chassis_Ctrl_Cmd_s cmd;
+} Board_Gimbal_Msg_s;
+
+typedef struct
+{
+    uint32_t stamp_ms;
+    Chassis_referee_Upload_Data_s referee;
+} Board_Chassis_Msg_s;
+#endif
+
 typedef struct
 {
     Can_Device *candevice;
     uint8_t offlinemanage_index;
+#if BOARD_COM_SEGMENTED
+    BoardTP_t tp;            // 分段传输的收发状态和统计
+    uint32_t peer_stamp_ms;  // 最近一条完整消息中对方的发送时间
+#endif
     #if defined(SENTRY_MODE)
         #if defined(GIMBAL_BOARD)
         Chassis_referee_Upload_Data_s Chassis_Upload_Data;
@@ -29,6 +57,6 @@ typedef struct
 board_com_t *board_com_init(board_com_init_t* board_com_init);
 void board_send(void *data);
 void *BoardRead(void);
-void board_recv(const CAN_HandleTypeDef* hcan,const  uint32_t rx_id);
+void board_recv(Can_Device *device);
 
 #endif // CAN_COMMON_H
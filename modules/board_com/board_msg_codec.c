@@ -0,0 +1,147 @@
+/**
+ * @file board_msg_codec.c
+ * @brief 由 tools/codec/gen_codec.py 根据 modules/board_com/board_msg.json 生成,请勿手动修改
+ */
+
+#include "board_msg_codec.h"
+#include <string.h>
+
+_Static_assert(BOARD_GIMBAL_CMD_LEN <= 8, "BoardGimbalCmd too long");
+_Static_assert(sizeof(((Chassis_Ctrl_Cmd_s *)0)->vx) == sizeof(float), "Chassis_Ctrl_Cmd_s.vx changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_Ctrl_Cmd_s *)0)->vy) == sizeof(float), "Chassis_Ctrl_Cmd_s.vy changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_Ctrl_Cmd_s *)0)->offset_angle) == sizeof(float), "Chassis_Ctrl_Cmd_s.offset_angle changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_Ctrl_Cmd_s *)0)->wz) == sizeof(float), "Chassis_Ctrl_Cmd_s.wz changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_Ctrl_Cmd_s *)0)->chassis_mode) == sizeof(chassis_mode_e), "Chassis_Ctrl_Cmd_s.chassis_mode changed, regenerate codec");
+_Static_assert(BOARD_CHASSIS_REFEREE_LEN <= 8, "BoardChassisReferee too long");
+_Static_assert(sizeof(((Chassis_referee_Upload_Data_s *)0)->Robot_Color) == sizeof(uint8_t), "Chassis_referee_Upload_Data_s.Robot_Color changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_referee_Upload_Data_s *)0)->projectile_allowance_17mm) == sizeof(uint16_t), "Chassis_referee_Upload_Data_s.projectile_allowance_17mm changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_referee_Upload_Data_s *)0)->power_management_shooter_output) == sizeof(uint8_t), "Chassis_referee_Upload_Data_s.power_management_shooter_output changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_referee_Upload_Data_s *)0)->current_hp_percent) == sizeof(uint16_t), "Chassis_referee_Upload_Data_s.current_hp_percent changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_referee_Upload_Data_s *)0)->outpost_HP) == sizeof(uint16_t), "Chassis_referee_Upload_Data_s.outpost_HP changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_referee_Upload_Data_s *)0)->base_HP) == sizeof(uint16_t), "Chassis_referee_Upload_Data_s.base_HP changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_referee_Upload_Data_s *)0)->game_progess) == sizeof(uint8_t), "Chassis_referee_Upload_Data_s.game_progess changed, regenerate codec");
+_Static_assert(sizeof(((Chassis_referee_Upload_Data_s *)0)->game_time) == sizeof(uint16_t), "Chassis_referee_Upload_Data_s.game_time changed, regenerate codec");
+
+static inline int32_t codec_round(float v)
+{
+    return (int32_t)(v >= 0.0f ? v + 0.5f : v - 0.5f);
+}
+
+/* 限幅到[lo, hi]后换算成定点数, NaN按offset处理 */
+static inline int32_t codec_quantize(float v, float lo, float hi, float offset, float inv_scale)
+{
+    if (!(v >= lo)) {
+        v = (v != v) ? offset : lo;
+    }
+    if (v > hi) {
+        v = hi;
+    }
+    return codec_round((v - offset) * inv_scale);
+}
+
+static inline int32_t codec_clamp_int(int32_t v, int32_t lo, int32_t hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static inline int32_t codec_sext(uint32_t raw, uint8_t bits)
+{
+    uint32_t m = 1u << (bits - 1);
+    return (int32_t)((raw ^ m) - m);
+}
+
+uint16_t BoardGimbalCmd_Encode(const Chassis_Ctrl_Cmd_s *msg, uint8_t buf[BOARD_GIMBAL_CMD_LEN])
+{
+    uint32_t raw;
+
+    raw = (uint32_t)codec_quantize((float)msg->vx, -32768.0f, 32767.0f, 0.0f, 1.0f);
+    raw &= 0xFFFFu;
+    buf[0] = (uint8_t)(raw >> 8);
+    buf[1] = (uint8_t)raw;
+    raw = (uint32_t)codec_quantize((float)msg->vy, -32768.0f, 32767.0f, 0.0f, 1.0f);
+    raw &= 0xFFFFu;
+    buf[2] = (uint8_t)(raw >> 8);
+    buf[3] = (uint8_t)raw;
+    raw = (uint32_t)codec_quantize((float)msg->offset_angle, -327.68f, 327.67f, 0.0f, 100.0f);
+    raw &= 0xFFFFu;
+    buf[4] = (uint8_t)(raw >> 8);
+    buf[5] = (uint8_t)raw;
+    raw = (uint32_t)codec_quantize((float)msg->wz, -12.8f, 12.7f, 0.0f, 10.0f);
+    raw &= 0xFFu;
+    buf[6] = (uint8_t)raw;
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->chassis_mode, 0, 255);
+    buf[7] = (uint8_t)raw;
+    return BOARD_GIMBAL_CMD_LEN;
+}
+
+uint8_t BoardGimbalCmd_Decode(const uint8_t *buf, uint16_t len, Chassis_Ctrl_Cmd_s *msg)
+{
+    uint32_t raw;
+
+    if (len != BOARD_GIMBAL_CMD_LEN) {
+        return 0;
+    }
+    raw = ((uint32_t)buf[0] << 8) | (uint32_t)buf[1];
+    msg->vx = (float)codec_sext(raw, 16);
+    raw = ((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+    msg->vy = (float)codec_sext(raw, 16);
+    raw = ((uint32_t)buf[4] << 8) | (uint32_t)buf[5];
+    msg->offset_angle = (float)codec_sext(raw, 16) * 0.01f;
+    raw = (uint32_t)buf[6];
+    msg->wz = (float)codec_sext(raw, 8) * 0.1f;
+    raw = (uint32_t)buf[7];
+    msg->chassis_mode = (chassis_mode_e)raw;
+    return 1;
+}
+
+uint16_t BoardChassisReferee_Encode(const Chassis_referee_Upload_Data_s *msg, uint8_t buf[BOARD_CHASSIS_REFEREE_LEN])
+{
+    uint32_t raw;
+
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->Robot_Color, 0, 1);
+    buf[0] = (uint8_t)(raw << 7);
+    raw = (uint32_t)codec_quantize((float)msg->projectile_allowance_17mm, 0.0f, 1000.0f, 0.0f, 0.127f);
+    buf[0] |= (uint8_t)raw;
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->power_management_shooter_output, 0, 1);
+    buf[1] = (uint8_t)(raw << 7);
+    raw = (uint32_t)codec_quantize((float)msg->current_hp_percent, 0.0f, 400.0f, 0.0f, 0.25f);
+    buf[1] |= (uint8_t)raw;
+    raw = (uint32_t)codec_quantize((float)msg->outpost_HP, 0.0f, 1500.0f, 0.0f, 1.36466667f);
+    buf[2] = (uint8_t)(raw >> 3);
+    buf[3] = (uint8_t)(raw << 5);
+    raw = (uint32_t)codec_quantize((float)msg->base_HP, 0.0f, 5000.0f, 0.0f, 1.6382f);
+    buf[3] |= (uint8_t)(raw >> 8);
+    buf[4] = (uint8_t)raw;
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->game_progess, 0, 7);
+    buf[5] = (uint8_t)(raw << 5);
+    raw = (uint32_t)codec_clamp_int((int32_t)msg->game_time, 0, 511);
+    buf[5] |= (uint8_t)(raw >> 4);
+    buf[6] = (uint8_t)(raw << 4);
+    return BOARD_CHASSIS_REFEREE_LEN;
+}
+
+uint8_t BoardChassisReferee_Decode(const uint8_t *buf, uint16_t len, Chassis_referee_Upload_Data_s *msg)
+{
+    uint32_t raw;
+
+    if (len != BOARD_CHASSIS_REFEREE_LEN) {
+        return 0;
+    }
+    raw = ((uint32_t)buf[0] >> 7) & 0x1u;
+    msg->Robot_Color = (uint8_t)raw;
+    raw = (uint32_t)buf[0] & 0x7Fu;
+    msg->projectile_allowance_17mm = (uint16_t)codec_round((float)raw * 7.87401575f);
+    raw = ((uint32_t)buf[1] >> 7) & 0x1u;
+    msg->power_management_shooter_output = (uint8_t)raw;
+    raw = (uint32_t)buf[1] & 0x7Fu;
+    msg->current_hp_percent = (uint16_t)codec_round((float)raw * 4.0f);
+    raw = (((uint32_t)buf[2] << 3) | ((uint32_t)buf[3] >> 5)) & 0x7FFu;
+    msg->outpost_HP = (uint16_t)codec_round((float)raw * 0.732779678f);
+    raw = (((uint32_t)buf[3] << 8) | (uint32_t)buf[4]) & 0x1FFFu;
+    msg->base_HP = (uint16_t)codec_round((float)raw * 0.610426077f);
+    raw = ((uint32_t)buf[5] >> 5) & 0x7u;
+    msg->game_progess = (uint8_t)raw;
+    raw = (((uint32_t)buf[5] << 4) | ((uint32_t)buf[6] >> 4)) & 0x1FFu;
+    msg->game_time = (uint16_t)raw;
+    return 1;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file board_msg_codec.h
+ * @brief 由 tools/codec/gen_codec.py 根据 modules/board_com/board_msg.json 生成,请勿手动修改
+ */
+
+#ifndef BOARD_MSG_CODEC_H
+#define BOARD_MSG_CODEC_H
+
+#include <stdint.h>
+#include "robotdef.h"
+
+#define BOARD_GIMBAL_CMD_LEN 8 // 64 bit
+#define BOARD_CHASSIS_REFEREE_LEN 7 // 56 bit
+
+/**
+ * @brief 云台板发给底盘板的底盘控制命令,单帧
+ * @note 高位先行的位流, 字段(起始位:位数):
+ *       vx                                   0:16 有符号, x1, 范围[-32768, 32767]
+ *       vy                                  16:16 有符号, x1, 范围[-32768, 32767]
+ *       offset_angle                        32:16 有符号, x0.01, 范围[-327.68, 327.67]
+ *       wz                                  48:8  有符号, x0.1, 范围[-12.8, 12.7]
+ *       chassis_mode                        56:8  无符号, 范围[0, 255]
+ */
+uint16_t BoardGimbalCmd_Encode(const Chassis_Ctrl_Cmd_s *msg, uint8_t buf[BOARD_GIMBAL_CMD_LEN]);
+uint8_t BoardGimbalCmd_Decode(const uint8_t *buf, uint16_t len, Chassis_Ctrl_Cmd_s *msg);
+
+/**
+ * @brief 底盘板发给云台板的裁判系统数据,单帧
+ * @note 高位先行的位流, 字段(起始位:位数):
+ *       Robot_Color                          0:1  无符号, 范围[0, 1]
+ *       projectile_allowance_17mm            1:7  无符号, x7.87402, 范围[0, 1000]
+ *       power_management_shooter_output      8:1  无符号, 范围[0, 1]
+ *       current_hp_percent                   9:7  无符号, x4, 范围[0, 400]
+ *       outpost_HP                          16:11 无符号, x0.73278, 范围[0, 1500]
+ *       base_HP                             27:13 无符号, x0.610426, 范围[0, 5000]
+ *       game_progess                        40:3  无符号, 范围[0, 7]
+ *       game_time                           43:9  无符号, 范围[0, 511]
+ *       -                                   52:4  保留
+ */
+uint16_t BoardChassisReferee_Encode(const Chassis_referee_Upload_Data_s *msg, uint8_t buf[BOARD_CHASSIS_REFEREE_LEN]);
+uint8_t BoardChassisReferee_Decode(const uint8_t *buf, uint16_t len, Chassis_referee_Upload_Data_s *msg);
+
+#endif // BOARD_MSG_CODEC_H
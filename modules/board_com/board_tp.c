@@ -0,0 +1,137 @@
+#include "board_tp.h"
+#include <string.h>
+
+#define LOG_TAG "board_tp"
+#include "elog.h"
+
+static uint8_t BoardTP_SendFrame(BoardTP_t *tp, CAN_HandleTypeDef *hcan, uint32_t std_id, const uint8_t *frame,
+                                 uint8_t dlc)
+{
+    CAN_TxHeaderTypeDef header = {.StdId = std_id, .IDE = CAN_ID_STD, .RTR = CAN_RTR_DATA};
+    uint32_t mailbox;
+    uint8_t ret = CAN_SendMessage_hcan(hcan, &header, frame, &mailbox, dlc);
+    if (ret == HAL_OK) {
+        tp->stats.tx_frames++;
+    }
+    return ret;
+}
+
+uint8_t BoardTP_Send(BoardTP_t *tp, CAN_HandleTypeDef *hcan, uint32_t std_id, const void *data, uint16_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    uint8_t frame[8];
+
+    if (len > BOARD_TP_MAX_LEN) {
+        log_e("message too long: %d", len);
+        return HAL_ERROR;
+    }
+    if (len <= 7) {
+        frame[0] = BOARD_TP_PCI_SF | len;
+        memcpy(&frame[1], src, len);
+        if (BoardTP_SendFrame(tp, hcan, std_id, frame, len + 1) != HAL_OK) {
+            tp->stats.tx_dropped++;
+            return HAL_BUSY;
+        }
+        tp->stats.tx_msgs++;
+        return HAL_OK;
+    }
+
+    frame[0] = BOARD_TP_PCI_FF | ((len >> 8) & 0x0F);
+    frame[1] = len & 0xFF;
+    frame[2] = tp->tx_seq++;
+    memcpy(&frame[3], src, 5);
+    if (BoardTP_SendFrame(tp, hcan, std_id, frame, 8) != HAL_OK) {
+        tp->stats.tx_dropped++;
+        return HAL_BUSY;
+    }
+    uint16_t offset = 5;
+    uint8_t sn = 1;
+    while (offset < len) {
+        uint8_t chunk = (len - offset) > 7 ? 7 : (uint8_t)(len - offset);
+        frame[0] = BOARD_TP_PCI_CF | (sn & 0x0F);
+        memcpy(&frame[1], src + offset, chunk);
+        if (BoardTP_SendFrame(tp, hcan, std_id, frame, chunk + 1) != HAL_OK) {
+            // 后续帧发不出去,接收端会因为序号不连续丢弃这条消息
+            tp->stats.tx_dropped++;
+            return HAL_BUSY;
+        }
+        offset += chunk;
+        sn++;
+    }
+    tp->stats.tx_msgs++;
+    return HAL_OK;
+}
+
+uint16_t BoardTP_Receive(BoardTP_t *tp, const uint8_t *frame, uint8_t dlc)
+{
+    if (dlc == 0) {
+        return 0;
+    }
+    tp->stats.rx_frames++;
+    switch (frame[0] & 0xF0) {
+    case BOARD_TP_PCI_SF: {
+        uint8_t len = frame[0] & 0x0F;
+        if (len == 0 || len > 7 || len + 1 > dlc) {
+            return 0;
+        }
+        if (tp->rx_active) {
+            tp->stats.rx_aborted++;
+            tp->rx_active = 0;
+        }
+        memcpy(tp->rx_buf, &frame[1], len);
+        tp->stats.rx_msgs++;
+        return len;
+    }
+    case BOARD_TP_PCI_FF: {
+        uint16_t len = ((uint16_t)(frame[0] & 0x0F) << 8) | frame[1];
+        if (dlc < 8 || len <= 7 || len > BOARD_TP_MAX_LEN) {
+            tp->rx_active = 0;
+            return 0;
+        }
+        if (tp->rx_active) {
+            tp->stats.rx_aborted++;
+        }
+        uint8_t gap = (uint8_t)(frame[2] - tp->rx_seq);
+        if (tp->stats.rx_msgs && gap > 1) {
+            tp->stats.rx_lost += gap - 1;
+        }
+        tp->rx_len = len;
+        tp->rx_seq = frame[2];
+        memcpy(tp->rx_buf, &frame[3], 5);
+        tp->rx_received = 5;
+        tp->rx_next_sn = 1;
+        tp->rx_active = 1;
+        return 0;
+    }
+    case BOARD_TP_PCI_CF: {
+        if (!tp->rx_active) {
+            return 0; // 首帧丢失,等待下一条消息
+        }
+        if ((frame[0] & 0x0F) != (tp->rx_next_sn & 0x0F)) {
+            tp->stats.rx_seq_errors++;
+            tp->rx_active = 0;
+            return 0;
+        }
+        uint16_t chunk = tp->rx_len - tp->rx_received;
+        if (chunk > 7) {
+            chunk = 7;
+        }
+        if (chunk + 1 > dlc) {
+            tp->stats.rx_seq_errors++;
+            tp->rx_active = 0;
+            return 0;
+        }
+        memcpy(&tp->rx_buf[tp->rx_received], &frame[1], chunk);
+        tp->rx_received += chunk;
+        tp->rx_next_sn++;
+        if (tp->rx_received < tp->rx_len) {
+            return 0;
+        }
+        tp->rx_active = 0;
+        tp->stats.rx_msgs++;
+        return tp->rx_len;
+    }
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,69 @@
+/**
+ * @file board_tp.h
+ * @brief 参考ISO-TP(ISO 15765-2)的CAN分段传输,用于板间通信发送超过8字节的消息
+ *
+ * @note 帧格式,第0字节高4位为帧类型(PCI):
+ *       单帧   [0x0|len] [数据x7]                       len<=7
+ *       首帧   [0x1|len_hi] [len_lo] [msg_seq] [数据x5]  len为12位
+ *       连续帧 [0x2|sn] [数据x7]                         sn从1开始,模16递增,最后一帧只发剩余字节
+ *       不做流控:板间是固定频率的点对点链路,接收端缓冲区静态分配,长度在编译期确定
+ * @note 各段以相同的优先级进入bsp_can发送队列,同优先级按入队顺序取出,bxCAN配置为FIFO发送优先级,因此各段不会乱序
+ */
+
+#ifndef BOARD_TP_H
+#define BOARD_TP_H
+
+#include <stdint.h>
+#include "bsp_can.h"
+
+#define BOARD_TP_MAX_LEN    64  // 单条消息最大长度,接收端重组缓冲区大小
+
+#define BOARD_TP_PCI_SF     0x00 // 单帧
+#define BOARD_TP_PCI_FF     0x10 // 首帧
+#define BOARD_TP_PCI_CF     0x20 // 连续帧
+
+typedef struct {
+    uint32_t tx_msgs;       // 发出的消息数
+    uint32_t tx_frames;     // 发出的帧数,用于评估分段带来的总线负载
+    uint32_t tx_dropped;    // 发送队列满导致整条消息失败的次数
+    uint32_t rx_msgs;       // 重组完成的消息数
+    uint32_t rx_frames;     // 收到的帧数
+    uint32_t rx_seq_errors; // 连续帧序号不对(丢帧)导致丢弃的消息数
+    uint32_t rx_aborted;    // 上一条消息未收完就收到新首帧的次数
+    uint32_t rx_lost;       // 根据首帧msg_seq的跳变推算出的整条丢失的多帧消息数
+} BoardTP_Stats_t;
+
+typedef struct {
+    uint8_t tx_seq;                 // 下一条多帧消息的msg_seq
+
+    uint8_t rx_buf[BOARD_TP_MAX_LEN]; // 只按字节对齐,按结构体读取时先拷贝出来
+    uint16_t rx_len;                // 正在重组的消息总长度
+    uint16_t rx_received;           // 已收到的字节数
+    uint8_t rx_next_sn;             // 期望的下一个连续帧序号
+    uint8_t rx_seq;                 // 正在重组的消息的msg_seq
+    uint8_t rx_active;              // 是否正在重组多帧消息
+
+    BoardTP_Stats_t stats;
+} BoardTP_t;
+
+/**
+ * @brief 发送一条消息,不超过7字节时用单帧,否则拆成首帧+连续帧,全部放入发送队列后立即返回
+ * @note 不经过CAN_SchedSend()的调度表,否则同ID的各段会在一个周期内被合并
+ *
+ * @param std_id 发送ID
+ * @param data 消息内容
+ * @param len 消息长度,不超过BOARD_TP_MAX_LEN
+ * @return uint8_t HAL_OK成功, HAL_ERROR长度超限, HAL_BUSY发送队列已满
+ */
+uint8_t BoardTP_Send(BoardTP_t *tp, CAN_HandleTypeDef *hcan, uint32_t std_id, const void *data, uint16_t len);
+
+/**
+ * @brief 处理收到的一帧,在设备的接收回调中调用
+ *
+ * @param frame 收到的报文
+ * @param dlc 报文长度
+ * @return uint16_t 一条消息重组完成时返回其长度,内容在tp->rx_buf中,直到下一帧到来前有效;否则返回0
+ */
+uint16_t BoardTP_Receive(BoardTP_t *tp, const uint8_t *frame, uint8_t dlc);
+
+#endif // BOARD_TP_H
@@ -0,0 +1,169 @@
+#include "can_monitor.h"
+#include "bsp_can.h"
+#include "cmsis_os.h"
+#include "dwt.h"
+#include "offline.h"
+#include "SEGGER_RTT.h"
+#include "systemwatch.h"
+
+#define LOG_TAG "canmonitor"
+#include "elog.h"
+
+#define CAN_FRAME_OVERHEAD_BITS 47 // 标准数据帧除数据段外的位数,含帧间隔
+
+static CAN_Health_t can_health[2];
+static osThreadId canMonitorTaskHandle;
+
+/* 由BTR寄存器和APB1时钟计算波特率,不依赖CubeMX中的配置值 */
+static uint32_t CAN_GetBitrate(CAN_HandleTypeDef *hcan)
+{
+    uint32_t btr = hcan->Instance->BTR;
+    uint32_t brp = ((btr & CAN_BTR_BRP) >> CAN_BTR_BRP_Pos) + 1;
+    uint32_t ts1 = ((btr & CAN_BTR_TS1) >> CAN_BTR_TS1_Pos) + 1;
+    uint32_t ts2 = ((btr & CAN_BTR_TS2) >> CAN_BTR_TS2_Pos) + 1;
+    return HAL_RCC_GetPCLK1Freq() / (brp * (1 + ts1 + ts2));
+}
+
+/* 读取错误状态寄存器,离线时限频尝试恢复 */
+static void CAN_SampleErrors(CAN_Health_t *health, uint32_t now)
+{
+    uint32_t esr = health->hcan->Instance->ESR;
+    CAN_ErrorStateSync(health->hcan);
+    health->tec = (esr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos;
+    health->rec = (esr & CAN_ESR_REC) >> CAN_ESR_REC_Pos;
+    health->last_error_code = (esr & CAN_ESR_LEC) >> CAN_ESR_LEC_Pos;
+    health->error_warning = (esr & CAN_ESR_EWGF) ? 1 : 0;
+    health->error_passive = (esr & CAN_ESR_EPVF) ? 1 : 0;
+    health->bus_off = (esr & CAN_ESR_BOFF) ? 1 : 0;
+    if (health->tec > health->tec_max) {
+        health->tec_max = health->tec;
+    }
+    if (health->rec > health->rec_max) {
+        health->rec_max = health->rec;
+    }
+
+    if (health->bus_off) {
+        // AutoBusOff关闭,需要软件重启外设;总线短路时恢复会反复失败,所以限制频率
+        if (now - health->last_recover_ms >= CAN_MONITOR_RECOVER_MS) {
+            health->last_recover_ms = now;
+            health->recover_attempts++;
+            if (CAN_BusRecover(health->hcan) != HAL_OK) {
+                log_w("%s bus-off recover failed, attempt %u", health->hcan->Instance == CAN1 ? "can1" : "can2",
+                      health->recover_attempts);
+            }
+        }
+    } else if (!health->error_passive) {
+        offline_device_update(health->offline_index);
+    }
+}
+
+/* 计算两次调用之间的收发帧率和总线负载 */
+static void CAN_UpdateRates(CAN_Health_t *health, float dt, CAN_RxStats_t *last_rx, CAN_TxStats_t *last_tx)
+{
+    CAN_RxStats_t rx;
+    CAN_TxStats_t tx;
+    CAN_GetRxStats(health->hcan, &rx);
+    CAN_GetTxStats(health->hcan, &tx);
+
+    uint32_t frames = (rx.rx_count - last_rx->rx_count) + (tx.tx_count - last_tx->tx_count);
+    uint32_t bytes = (rx.rx_bytes - last_rx->rx_bytes) + (tx.tx_bytes - last_tx->tx_bytes);
+    health->rx_fps = (rx.rx_count - last_rx->rx_count) / dt;
+    health->tx_fps = (tx.tx_count - last_tx->tx_count) / dt;
+    float bits = (frames * CAN_FRAME_OVERHEAD_BITS + bytes * 8) * CAN_MONITOR_STUFF_FACTOR;
+    health->load = health->bitrate ? bits / (health->bitrate * dt) * 100.0f : 0;
+
+    *last_rx = rx;
+    *last_tx = tx;
+}
+
+static void CAN_MonitorDump(void)
+{
+    // SEGGER_RTT_printf()不支持%s的宽度,表头和状态名直接写成定宽的字符串
+    SEGGER_RTT_WriteString(CAN_MONITOR_RTT_CHANNEL,
+                           "\r\nbus     rx/s    tx/s  load% tec rec tmax rmax lec state  recover\r\n");
+    for (uint8_t i = 0; i < 2; ++i) {
+        CAN_Health_t *health = &can_health[i];
+        CAN_ErrStats_t err;
+        CAN_GetErrStats(health->hcan, &err);
+        const char *state = health->bus_off ? "  off" : health->error_passive ? " pasv" : health->error_warning ? " warn" : "   ok";
+        SEGGER_RTT_printf(CAN_MONITOR_RTT_CHANNEL, "can%u %7u %7u %6u %3u %3u %4u %4u %3u %s %8u\r\n", i + 1,
+                          (uint32_t)health->rx_fps, (uint32_t)health->tx_fps, (uint32_t)health->load, health->tec,
+                          health->rec, health->tec_max, health->rec_max, health->last_error_code, state,
+                          health->recover_attempts);
+        SEGGER_RTT_printf(CAN_MONITOR_RTT_CHANNEL, "     irq warn:%u pasv:%u off:%u last:0x%x\r\n", err.warning_count,
+                          err.passive_count, err.busoff_count, err.last_error);
+    }
+}
+
+static void CAN_MonitorTask(const void *parameter)
+{
+    static char up_buffer[512];
+    static char down_buffer[16];
+    static CAN_RxStats_t last_rx[2];
+    static CAN_TxStats_t last_tx[2];
+    uint32_t rate_cnt = 0;
+    uint32_t last_rate_ms = xTaskGetTickCount();
+    char tmp[16];
+
+    SEGGER_RTT_ConfigUpBuffer(CAN_MONITOR_RTT_CHANNEL, "can", up_buffer, sizeof(up_buffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    SEGGER_RTT_ConfigDownBuffer(CAN_MONITOR_RTT_CHANNEL, "can", down_buffer, sizeof(down_buffer),
+                                SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    SystemWatch_RegisterTask(canMonitorTaskHandle, "canMonitor");
+    DWT_GetDeltaT(&rate_cnt);
+    for (;;)
+    {
+        SystemWatch_ReportTaskAlive(osThreadGetId());
+        uint32_t now = xTaskGetTickCount();
+        for (uint8_t i = 0; i < 2; ++i) {
+            // 没有设备注册的总线不会被启动,不检查
+            if (can_health[i].hcan->State == HAL_CAN_STATE_READY) {
+                offline_device_update(can_health[i].offline_index);
+                continue;
+            }
+            CAN_SampleErrors(&can_health[i], now);
+        }
+
+        if (now - last_rate_ms >= CAN_MONITOR_RATE_PERIOD_MS) {
+            last_rate_ms = now;
+            float dt = DWT_GetDeltaT(&rate_cnt);
+            for (uint8_t i = 0; i < 2; ++i) {
+                can_health[i].bitrate = CAN_GetBitrate(can_health[i].hcan);
+                CAN_UpdateRates(&can_health[i], dt, &last_rx[i], &last_tx[i]);
+            }
+        }
+
+        if (SEGGER_RTT_Read(CAN_MONITOR_RTT_CHANNEL, tmp, sizeof(tmp)) > 0) { // 收到任意字符即输出一次
+            CAN_MonitorDump();
+        }
+        osDelay(CAN_MONITOR_PERIOD_MS);
+    }
+}
+
+void can_monitor_init(void)
+{
+    static const char *names[2] = {"can1", "can2"};
+    can_health[0].hcan = &hcan1;
+    can_health[1].hcan = &hcan2;
+    for (uint8_t i = 0; i < 2; ++i) {
+        OfflineDeviceInit_t offline_init = {
+            .name = names[i],
+            .timeout_ms = 100,
+            .level = OFFLINE_LEVEL_MEDIUM,
+            .beep_times = 0,
+            .enable = OFFLINE_ENABLE,
+        };
+        can_health[i].offline_index = offline_device_register(&offline_init);
+        can_health[i].bitrate = CAN_GetBitrate(can_health[i].hcan);
+    }
+
+    osThreadDef(canMonitorTask, CAN_MonitorTask, osPriorityBelowNormal, 0, 256);
+    canMonitorTaskHandle = osThreadCreate(osThread(canMonitorTask), NULL);
+    if (canMonitorTaskHandle == NULL) {
+        log_e("canMonitorTask create failed");
+    }
+}
+
+const CAN_Health_t *can_monitor_get(CAN_HandleTypeDef *hcan)
+{
+    return &can_health[hcan->Instance == CAN1 ? 0 : 1];
+}
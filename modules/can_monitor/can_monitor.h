@@ -0,0 +1,54 @@
+/**
+ * @file can_monitor.h
+ * @brief CAN总线健康监测:周期读取错误计数器,统计收发帧率和总线负载,离线(bus-off)时限频自动恢复
+ *
+ * @note 状态和负载通过RTT通道CAN_MONITOR_RTT_CHANNEL输出,在该通道下行发送任意字符即打印一次
+ *       总线负载按标准数据帧估算: 每帧47位固定开销+每字节8位,再乘上位填充系数CAN_MONITOR_STUFF_FACTOR
+ */
+
+#ifndef __CAN_MONITOR_H
+#define __CAN_MONITOR_H
+
+#include <stdint.h>
+#include "can.h"
+
+#define CAN_MONITOR_PERIOD_MS       10      // 采样错误寄存器的周期
+#define CAN_MONITOR_RATE_PERIOD_MS  1000    // 计算帧率和负载的周期
+#define CAN_MONITOR_RECOVER_MS      100     // 两次bus-off恢复尝试之间的最小间隔
+#define CAN_MONITOR_STUFF_FACTOR    1.1f    // 位填充带来的平均额外位数比例
+#define CAN_MONITOR_RTT_CHANNEL     2       // 状态输出使用的RTT通道,0为日志,1为message_center
+
+/* 单条总线的健康状态 */
+typedef struct {
+    CAN_HandleTypeDef *hcan;
+    uint8_t tec;                // 发送错误计数器
+    uint8_t rec;                // 接收错误计数器
+    uint8_t tec_max;            // 发送错误计数器历史最大值
+    uint8_t rec_max;            // 接收错误计数器历史最大值
+    uint8_t last_error_code;    // 最近一次的错误类型(ESR.LEC),0为无错误
+    uint8_t error_warning;      // TEC或REC>=96
+    uint8_t error_passive;      // TEC或REC>=128
+    uint8_t bus_off;            // TEC>255,外设已离开总线
+    uint32_t recover_attempts;  // 自动恢复尝试次数
+    uint32_t last_recover_ms;   // 上一次尝试恢复的时刻
+    uint32_t bitrate;           // 根据BTR寄存器和APB1时钟算出的波特率
+    float rx_fps;               // 每秒接收帧数
+    float tx_fps;               // 每秒发送帧数
+    float load;                 // 总线负载,0~100%
+    uint8_t offline_index;      // 在offline模块中的索引,bus-off或错误被动时视为离线
+} CAN_Health_t;
+
+/**
+ * @brief 初始化监测模块,创建监测任务并为每条总线注册离线设备,需在canbus_init和offline_init之后调用
+ */
+void can_monitor_init(void);
+
+/**
+ * @brief 获取总线健康状态
+ *
+ * @param hcan &hcan1或&hcan2
+ * @return const CAN_Health_t* 只读的状态快照
+ */
+const CAN_Health_t *can_monitor_get(CAN_HandleTypeDef *hcan);
+
+#endif /* __CAN_MONITOR_H */
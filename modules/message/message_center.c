@@ -1,16 +1,37 @@
 #include "message_center.h"
-#include "stdlib.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "dwt.h"
+#include "SEGGER_RTT.h"
 #include "string.h"
 
 #define LOG_TAG              "message"
 #define LOG_LVL              LOG_LVL_DBG
 #include <elog.h>
 
-/* message_center是fake head node,是方便链表编写的技巧,这样就不需要处理链表头的特殊情况 */
-static Publisher_t message_center = {
-    .topic_name = "Message_Manager",
-    .first_subs = NULL,
-    .next_topic_node = NULL};
+/* 每个话题的双缓冲,按消息类型静态分配 */
+#define TOPIC_BUFFER(id, name, type) static type id##_buffer[2];
+MESSAGE_TOPIC_TABLE(TOPIC_BUFFER)
+#undef TOPIC_BUFFER
+
+/* data_len为uint8_t,消息长度不能超过255字节 */
+#define TOPIC_SIZE_CHECK(id, name, type) _Static_assert(sizeof(type) <= UINT8_MAX, name " message too large");
+MESSAGE_TOPIC_TABLE(TOPIC_SIZE_CHECK)
+#undef TOPIC_SIZE_CHECK
+
+/* 话题表,按Topic_e索引 */
+static Publisher_t message_center[TOPIC_COUNT] = {
+#define TOPIC_ENTRY(id, name, type) \
+    [id] = {.topic_name = name, .data_len = sizeof(type), .buffer = {&id##_buffer[0], &id##_buffer[1]}},
+    MESSAGE_TOPIC_TABLE(TOPIC_ENTRY)
+#undef TOPIC_ENTRY
+};
+
+static Subscriber_t subscriber_pool[MAX_SUBSCRIBER_COUNT]; // 订阅者静态池
+static uint8_t subscriber_count = 0;
+
+static uint32_t queue_pool[MESSAGE_QUEUE_POOL_SIZE / 4]; // 队列订阅者的存储,按4字节对齐
+static uint16_t queue_pool_used = 0;                     // 已分配的字节数
 
 static void CheckName(char *name)
 {
@@ -30,89 +51,398 @@ static void CheckLen(uint8_t len1, uint8_t len2)
     }
 }
 
-Publisher_t *PubRegister(char *name, uint8_t data_len)
+/* 旧接口使用,在话题表中按名字查找,只在初始化时调用,线性查找即可 */
+static Publisher_t *FindTopic(char *name, uint8_t data_len)
 {
     CheckName(name);
-    Publisher_t *node = &message_center;
-    while (node->next_topic_node) // message_center会直接跳过,不需要特殊处理,这被称作dumb_head(编程技巧)
+    for (uint8_t i = 0; i < TOPIC_COUNT; ++i)
     {
-        node = node->next_topic_node;            // 切换到下一个发布者(话题)结点
-        if (strcmp(node->topic_name, name) == 0) // 如果已经注册了相同的话题,直接返回结点指针
+        if (strcmp(message_center[i].topic_name, name) == 0)
         {
-            CheckLen(data_len, node->data_len);
-            node->pub_registered_flag = 1;
-            return node;
+            CheckLen(data_len, message_center[i].data_len);
+            return &message_center[i];
         }
-    } // 遍历完发现尚未创建name对应的话题
-    // 在链表尾部创建新的话题并初始化
-    node->next_topic_node = (Publisher_t *)malloc(sizeof(Publisher_t));
-    memset(node->next_topic_node, 0, sizeof(Publisher_t));
-    node->next_topic_node->data_len = data_len;
-    strcpy(node->next_topic_node->topic_name, name);
-    node->pub_registered_flag = 1;
-    return node->next_topic_node;
+    }
+    log_e("topic %s not in MESSAGE_TOPIC_TABLE", name);
+    return NULL;
 }
 
-Subscriber_t *SubRegister(char *name, uint8_t data_len)
+Publisher_t *PubRegisterById(Topic_e topic)
 {
-    Publisher_t *pub = PubRegister(name, data_len); // 查找或创建该话题的发布者
-    // 创建新的订阅者结点,申请内存,注意要memset因为新空间不一定是空的,可能有之前留存的垃圾值
-    Subscriber_t *ret = (Subscriber_t *)malloc(sizeof(Subscriber_t));
-    memset(ret, 0, sizeof(Subscriber_t));
-    // 对新建的Subscriber进行初始化
-    ret->data_len = data_len; // 设定数据长度
-    for (size_t i = 0; i < QUEUE_SIZE; ++i)
-    { // 给消息队列的每一个元素分配空间,queue里保存的实际上是数据执指针,这样可以兼容不同的数据长度
-        ret->queue[i] = malloc(data_len);
+    if (topic >= TOPIC_COUNT)
+    {
+        log_e("invalid topic:%d", topic);
+        return NULL;
     }
-    // 如果是第一个订阅者,特殊处理一下,将first_subs指针指向新建的订阅者(详见文档)
-    if (pub->first_subs == NULL)
+    message_center[topic].pub_registered_flag = 1;
+    return &message_center[topic];
+}
+
+Subscriber_t *SubRegisterById(Topic_e topic)
+{
+    return SubRegisterQueue(topic, 0, QUEUE_DROP_OLDEST);
+}
+
+Subscriber_t *SubRegisterQueue(Topic_e topic, uint8_t depth, Queue_Overflow_e policy)
+{
+    if (topic >= TOPIC_COUNT)
     {
-        pub->first_subs = ret;
-        return ret;
+        log_e("invalid topic:%d", topic);
+        return NULL;
     }
-    // 若该话题已经有订阅者, 遍历订阅者链表,直到到达尾部
-    Subscriber_t *sub = pub->first_subs; // 作为iterator
-    while (sub->next_subs_queue)         // 遍历订阅了该话题的订阅者链表
+    if (subscriber_count >= MAX_SUBSCRIBER_COUNT)
     {
-        sub = sub->next_subs_queue; // 移动到下一个订阅者,遇到空指针停下,说明到了链表尾部
+        log_e("subscriber pool full, topic:%s", message_center[topic].topic_name);
+        return NULL;
     }
-    sub->next_subs_queue = ret; // 把刚刚创建的订阅者接上
+    Publisher_t *pub = &message_center[topic];
+    uint16_t slot_size = (sizeof(uint32_t) + pub->data_len + 3) & ~3u; // 时间戳+消息,4字节对齐
+    if (depth && queue_pool_used + (uint32_t)slot_size * depth > MESSAGE_QUEUE_POOL_SIZE)
+    {
+        log_e("queue pool full, topic:%s depth:%d", pub->topic_name, depth);
+        return NULL;
+    }
+    // 从静态池取出一个订阅者并初始化
+    Subscriber_t *ret = &subscriber_pool[subscriber_count++];
+    ret->topic = pub;
+    ret->data_len = pub->data_len;
+    ret->last_version = 0;
+    if (depth)
+    {
+        ret->depth = depth;
+        ret->policy = policy;
+        ret->slot_size = slot_size;
+        ret->ring = (uint8_t *)queue_pool + queue_pool_used;
+        queue_pool_used += slot_size * depth;
+    }
+    // 挂到该话题订阅者链表的头部,顺序无关紧要
+    ret->next_subs_queue = pub->first_subs;
+    pub->first_subs = ret;
+    pub->subs_count++;
     return ret;
 }
 
-/* 如果队列为空,会返回0;成功获取数据,返回1;后续可以做更多的修改,比如剩余消息数目等 */
-uint8_t SubGetMessage(Subscriber_t *sub, void *data_ptr)
+Publisher_t *PubRegister(char *name, uint8_t data_len)
+{
+    Publisher_t *pub = FindTopic(name, data_len);
+    if (pub == NULL)
+    {
+        return NULL;
+    }
+    return PubRegisterById((Topic_e)(pub - message_center));
+}
+
+Subscriber_t *SubRegister(char *name, uint8_t data_len)
+{
+    Publisher_t *pub = FindTopic(name, data_len);
+    if (pub == NULL)
+    {
+        return NULL;
+    }
+    return SubRegisterById((Topic_e)(pub - message_center));
+}
+
+/**
+ * @brief seqlock读端的一致性检查
+ *        读取开始时seq为s1(偶数,对应第s1/2次发布写入的缓冲区),读完后seq为s2.
+ *        只要这期间发布者最多开始了一次新的写入,它写的就是另一个缓冲区,读到的数据仍然完整
+ */
+static inline uint8_t SeqReadValid(uint32_t s1, uint32_t s2)
+{
+    return (uint32_t)(s2 - s1) <= 2;
+}
+
+/**
+ * @brief 把一条消息放入队列订阅者的队列,在PubPushMessage()中调用
+ *        队列操作都在临界区中完成,发布者可能在中断中,taskENTER_CRITICAL_FROM_ISR在任务和中断中都可以使用
+ */
+static uint8_t QueuePush(Subscriber_t *sub, void *data_ptr, uint32_t stamp, uint8_t in_isr)
 {
-    if (sub->temp_size == 0)
+    TickType_t start = 0;
+    uint8_t waited = 0;
+    for (;;)
     {
+        UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+        if (sub->count == sub->depth) // 队列已满
+        {
+            if (sub->policy == QUEUE_DROP_OLDEST)
+            {
+                sub->head = (sub->head + 1) % sub->depth; // 抛弃最老的消息,腾出位置
+                sub->count--;
+                sub->overflow_count++;
+            }
+            else if (sub->policy == QUEUE_DROP_NEWEST || in_isr ||
+                     (waited && xTaskGetTickCount() - start >= pdMS_TO_TICKS(MESSAGE_BLOCK_TIMEOUT_MS)))
+            {
+                sub->overflow_count++;
+                // 超时放弃等待,撤销登记,否则订阅者之后取消息时会给已经不在等待的发布者发一个多余的通知
+                if (waited && sub->blocked_pub == xTaskGetCurrentTaskHandle())
+                {
+                    sub->blocked_pub = NULL;
+                }
+                taskEXIT_CRITICAL_FROM_ISR(mask);
+                return 0;
+            }
+            else // QUEUE_BLOCK,等待订阅者取走消息后通知
+            {
+                if (!waited)
+                {
+                    start = xTaskGetTickCount();
+                    waited = 1;
+                }
+                sub->blocked_pub = xTaskGetCurrentTaskHandle();
+                taskEXIT_CRITICAL_FROM_ISR(mask);
+                TickType_t elapsed = xTaskGetTickCount() - start;
+                if (elapsed < pdMS_TO_TICKS(MESSAGE_BLOCK_TIMEOUT_MS))
+                {
+                    xTaskNotifyWait(0, MESSAGE_NOTIFY_BIT, NULL, pdMS_TO_TICKS(MESSAGE_BLOCK_TIMEOUT_MS) - elapsed);
+                }
+                continue;
+            }
+        }
+        uint8_t *slot = sub->ring + sub->tail * sub->slot_size;
+        memcpy(slot, &stamp, sizeof(uint32_t));
+        memcpy(slot + sizeof(uint32_t), data_ptr, sub->data_len);
+        sub->tail = (sub->tail + 1) % sub->depth;
+        sub->count++;
+        taskEXIT_CRITICAL_FROM_ISR(mask);
+        return 1;
+    }
+}
+
+/* 从队列订阅者的队列中取出最老的消息 */
+static uint8_t QueuePop(Subscriber_t *sub, void *data_ptr)
+{
+    uint32_t stamp;
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    if (sub->count == 0)
+    {
+        taskEXIT_CRITICAL_FROM_ISR(mask);
         return 0;
     }
-    memcpy(data_ptr, sub->queue[sub->front_idx], sub->data_len);
-    sub->front_idx = (sub->front_idx++) % QUEUE_SIZE; // 队列头索引增加
-    sub->temp_size--;                                 // pop一个数据,长度减1
+    uint8_t *slot = sub->ring + sub->head * sub->slot_size;
+    memcpy(&stamp, slot, sizeof(uint32_t));
+    memcpy(data_ptr, slot + sizeof(uint32_t), sub->data_len);
+    sub->head = (sub->head + 1) % sub->depth;
+    sub->count--;
+    TaskHandle_t blocked = (TaskHandle_t)sub->blocked_pub;
+    sub->blocked_pub = NULL;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+
+    if (blocked) // 有发布者在等待队列空位
+    {
+        xTaskNotify(blocked, MESSAGE_NOTIFY_BIT, eSetBits);
+    }
+    sub->read_count++;
+    sub->wait_us = DWT_CycleToUs(DWT_GetCycle() - stamp);
+    if (sub->wait_us > sub->max_wait_us)
+    {
+        sub->max_wait_us = sub->wait_us;
+    }
+    return 1;
+}
+
+/* 没有新消息会返回0;成功获取数据,返回1 */
+uint8_t SubGetMessage(Subscriber_t *sub, void *data_ptr)
+{
+    if (sub->depth)
+    {
+        return QueuePop(sub, data_ptr);
+    }
+    Publisher_t *pub = sub->topic;
+    uint32_t s1, s2, version, stamp;
+    do
+    {
+        s1 = __atomic_load_n(&pub->seq, __ATOMIC_ACQUIRE) & ~1u; // 奇数说明正在写入,上一次完整的发布是s1-1
+        version = s1 >> 1;
+        if (version == 0 || version == sub->last_version) // 尚未发布或者已经读过
+        {
+            return 0;
+        }
+        memcpy(data_ptr, pub->buffer[version & 1], sub->data_len);
+        stamp = pub->stamp[version & 1];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        s2 = __atomic_load_n(&pub->seq, __ATOMIC_RELAXED);
+    } while (!SeqReadValid(s1, s2)); // 读取期间被覆盖,重新读一次最新的
+    if (sub->last_version) // 第一次读取之前的消息不计入
+    {
+        sub->overwrite_count += version - sub->last_version - 1;
+    }
+    sub->last_version = version;
+    sub->read_count++;
+    sub->wait_us = DWT_CycleToUs(DWT_GetCycle() - stamp);
+    if (sub->wait_us > sub->max_wait_us)
+    {
+        sub->max_wait_us = sub->wait_us;
+    }
     return 1;
 }
 
+uint8_t SubWaitMessage(Subscriber_t *sub, void *data_ptr, uint32_t timeout_ms)
+{
+    // 先登记等待的任务再检查消息,这样检查之后到开始等待之前发布的消息也会留下通知位,不会漏掉
+    if (sub->wait_task == NULL)
+    {
+        __atomic_store_n(&sub->wait_task, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
+    }
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    for (;;)
+    {
+        if (SubGetMessage(sub, data_ptr))
+        {
+            return 1;
+        }
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout)
+        {
+            return 0;
+        }
+        // 通知位可能是之前的消息留下的,被唤醒后重新检查一次即可
+        if (xTaskNotifyWait(0, MESSAGE_NOTIFY_BIT, NULL, timeout - elapsed) == pdFALSE)
+        {
+            return SubGetMessage(sub, data_ptr);
+        }
+    }
+}
+
+const void *SubPeekMessage(Subscriber_t *sub, uint32_t *token)
+{
+    Publisher_t *pub = sub->topic;
+    if (sub->depth) // 队列订阅者的消息在自己的队列中,不能直接访问话题缓冲区
+    {
+        return NULL;
+    }
+    uint32_t s1 = __atomic_load_n(&pub->seq, __ATOMIC_ACQUIRE) & ~1u;
+    uint32_t version = s1 >> 1;
+    *token = s1;
+    if (version == 0)
+    {
+        return NULL;
+    }
+    sub->last_version = version;
+    return pub->buffer[version & 1];
+}
+
+uint8_t SubPeekCheck(Subscriber_t *sub, uint32_t token)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return SeqReadValid(token, __atomic_load_n(&sub->topic->seq, __ATOMIC_RELAXED));
+}
+
 uint8_t PubPushMessage(Publisher_t *pub, void *data_ptr)
 {
-    static Subscriber_t *iter;
-    iter = pub->first_subs; // iter作为订阅者指针,遍历订阅该话题的所有订阅者;如果为空说明遍历结束
-    // 遍历订阅了当前话题的所有订阅者,依次填入最新消息
-    while (iter)
+    uint32_t seq = pub->seq; // 每个话题只有一个发布者在写,这里不需要原子读
+    uint32_t version = (seq >> 1) + 1;
+    // seq置为奇数,标记写入开始;release屏障保证读者先看到奇数seq,再看到被修改的缓冲区
+    __atomic_store_n(&pub->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    // 写入另一个缓冲区,正在读上一次数据的订阅者不会受影响
+    uint32_t stamp = DWT_GetCycle();
+    memcpy(pub->buffer[version & 1], data_ptr, pub->data_len);
+    pub->stamp[version & 1] = stamp;
+    __atomic_store_n(&pub->seq, seq + 2, __ATOMIC_RELEASE);
+
+    // 队列订阅者需要各自保存一份,然后唤醒正在等待该话题的订阅者
+    BaseType_t woken = pdFALSE;
+    uint8_t in_isr = xPortIsInsideInterrupt();
+    uint8_t count = 0;
+    for (Subscriber_t *iter = pub->first_subs; iter; iter = iter->next_subs_queue)
+    {
+        if (iter->depth && !QueuePush(iter, data_ptr, stamp, in_isr))
+        {
+            continue; // 队列满,新消息被丢弃,不需要唤醒
+        }
+        count++;
+        TaskHandle_t task = (TaskHandle_t)__atomic_load_n(&iter->wait_task, __ATOMIC_ACQUIRE);
+        if (task == NULL)
+        {
+            continue;
+        }
+        if (in_isr)
+        {
+            xTaskNotifyFromISR(task, MESSAGE_NOTIFY_BIT, eSetBits, &woken);
+        }
+        else
+        {
+            xTaskNotify(task, MESSAGE_NOTIFY_BIT, eSetBits);
+        }
+    }
+    if (in_isr)
+    {
+        portYIELD_FROM_ISR(woken);
+    }
+    return count;
+}
+
+/**
+ * @brief SEGGER_RTT_printf()会忽略%s的宽度,名字先在这里左对齐补空格到width个字符,再用%s输出
+ *        超过width的名字完整保留,只是这一行之后的列会错开
+ */
+static const char *StatsPadName(char *buf, uint8_t size, uint8_t width, const char *name)
+{
+    uint8_t i = 0;
+    for (; name[i] && i < size - 1; i++)
     {
-        if (iter->temp_size == QUEUE_SIZE) // 如果队列已满,则需要删除最老的数据(头部),再填入
+        buf[i] = name[i];
+    }
+    for (; i < width && i < size - 1; i++)
+    {
+        buf[i] = ' ';
+    }
+    buf[i] = '\0';
+    return buf;
+}
+
+void MessageCenter_DumpStats(void)
+{
+    char name[MAX_TOPIC_NAME_LEN + 1];
+    static char up_buffer[1024];
+    static uint8_t rtt_inited = 0;
+    static uint32_t last_pub_count[TOPIC_COUNT];
+    static uint32_t last_dump_cnt = 0;
+    if (!rtt_inited)
+    {
+        SEGGER_RTT_ConfigUpBuffer(MESSAGE_STATS_RTT_CHANNEL, "message", up_buffer, sizeof(up_buffer),
+                                  SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+        rtt_inited = 1;
+    }
+    float dt = DWT_GetDeltaT(&last_dump_cnt); // 距上一次输出的时间,用于计算平均发布频率
+
+    SEGGER_RTT_WriteString(MESSAGE_STATS_RTT_CHANNEL, "\r\ntopic                  pubs  rate_hz subs\r\n");
+    for (uint8_t i = 0; i < TOPIC_COUNT; ++i)
+    {
+        Publisher_t *pub = &message_center[i];
+        uint32_t pub_count = __atomic_load_n(&pub->seq, __ATOMIC_RELAXED) >> 1; // seq>>1即为发布次数
+        uint32_t rate = (uint32_t)((pub_count - last_pub_count[i]) / dt);
+        last_pub_count[i] = pub_count;
+        SEGGER_RTT_printf(MESSAGE_STATS_RTT_CHANNEL, "%s %10u %8u %4u\r\n",
+                          StatsPadName(name, sizeof(name), 16, pub->topic_name), pub_count, rate, pub->subs_count);
+        for (Subscriber_t *sub = pub->first_subs; sub; sub = sub->next_subs_queue)
         {
-            // 队列头索引前移动,相当于抛弃前一个位置的数据,被抛弃的位置稍后会被写入新的数据
-            iter->front_idx = (iter->front_idx + 1) % QUEUE_SIZE;
-            iter->temp_size--; // 相当于出队,size-1
+            const char *task = sub->wait_task ? pcTaskGetName((TaskHandle_t)sub->wait_task) : "-";
+            // 最新值订阅者统计被覆盖的消息,队列订阅者统计队列满丢弃的消息
+            SEGGER_RTT_printf(MESSAGE_STATS_RTT_CHANNEL, "  %s %s %10u lost:%-8u wait:%-6u max:%-6u q:%u/%u\r\n",
+                              StatsPadName(name, sizeof(name), 14, task), sub->depth ? "queue" : " last", sub->read_count,
+                              sub->depth ? sub->overflow_count : sub->overwrite_count, (uint32_t)sub->wait_us,
+                              (uint32_t)sub->max_wait_us, sub->count, sub->depth);
         }
-        // 将Pub的数据复制到队列的尾部(最新)
-        memcpy(iter->queue[iter->back_idx], data_ptr, pub->data_len);
-        iter->back_idx = (iter->back_idx + 1) % QUEUE_SIZE; // 队列尾部前移
-        iter->temp_size++;                                  // 入队,size+1
+    }
+}
 
-        iter = iter->next_subs_queue; // 访问下一个订阅者
+void MessageCenter_StatsPoll(void)
+{
+    static char down_buffer[16];
+    static uint8_t rtt_inited = 0;
+    char tmp[16];
+    if (!rtt_inited)
+    {
+        SEGGER_RTT_ConfigDownBuffer(MESSAGE_STATS_RTT_CHANNEL, "message", down_buffer, sizeof(down_buffer),
+                                    SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+        rtt_inited = 1;
+    }
+    if (SEGGER_RTT_Read(MESSAGE_STATS_RTT_CHANNEL, tmp, sizeof(tmp)) > 0) // 收到任意字符即输出一次
+    {
+        MessageCenter_DumpStats();
     }
-    return 1;
 }
@@ -2,30 +2,65 @@
  * @file message_center.h
  * @author NeoZeng neozng1@hnu.edu.cn
  * @brief 这是一个伪pubsub机制,仅对应用之间的通信进行了隔离
- * @version 0.1
+ * @version 0.2
  * @date 2022-11-30
  *
  * @copyright Copyright (c) 2022
  *
+ * @note 0.2: 话题改为seqlock双缓冲的"最新值"模型,发布者只写一次,订阅者无锁读取,
+ *       发布开销与订阅者数量无关,且读者不会读到被撕裂(写了一半)的数据
+ * @note 0.3: 话题改为编译期确定的静态话题表(见message_topics.h),不再使用堆和字符串查找
+ * @note 0.4: 增加SubWaitMessage(),发布时通过任务通知唤醒等待的订阅者,并记录每条消息从发布到被读取的延迟
+ * @note 0.5: 订阅者可以选择队列模式,自定义队列深度和队列满时的处理策略,队列存储来自静态池
+ * @note 0.6: 统计每个话题的发布次数和频率,每个订阅者的读取次数、被覆盖/丢弃次数和消息延迟,可通过RTT输出
  */
 
 #ifndef PUBSUB_H
 #define PUBSUB_H
 
 #include "stdint.h"
+#include "message_topics.h"
 
-#define MAX_TOPIC_NAME_LEN 32 // 最大的话题名长度,每个话题都有字符串来命名
-#define MAX_TOPIC_COUNT 12    // 最多支持的话题数量
-#define QUEUE_SIZE 1
+#define MAX_TOPIC_NAME_LEN 32     // 最大的话题名长度,每个话题都有字符串来命名
+#define MAX_SUBSCRIBER_COUNT 16   // 所有话题的订阅者总数上限,订阅者从静态池中分配
+#define MESSAGE_NOTIFY_BIT (1UL << 31) // SubWaitMessage()使用的任务通知位,调用它的任务不要把这一位用作其他用途
+#define MESSAGE_QUEUE_POOL_SIZE 1024   // 所有队列订阅者共享的静态存储大小,单位字节
+#define MESSAGE_BLOCK_TIMEOUT_MS 5     // QUEUE_BLOCK策略下发布者最长等待时间,超时则丢弃新消息
+#define MESSAGE_STATS_RTT_CHANNEL 1    // 统计表输出使用的RTT通道,通道0被日志占用
 
+/* 队列订阅者在队列满时的处理策略 */
+typedef enum
+{
+    QUEUE_DROP_OLDEST = 0, // 丢弃最老的消息,写入新消息
+    QUEUE_DROP_NEWEST,     // 丢弃新消息,保留队列中的消息
+    QUEUE_BLOCK,           // 发布者阻塞等待订阅者取走消息,中断中发布或超时则丢弃新消息
+} Queue_Overflow_e;
+
+/**
+ * @brief 订阅者类型.订阅者不再持有数据副本,只记录自己读到的最新版本号,数据统一保存在话题(发布者)中
+ *
+ */
 typedef struct mqt
 {
-    /* 用数组模拟FIFO队列 */
-    void *queue[QUEUE_SIZE];
-    uint8_t data_len;
-    uint8_t front_idx;
-    uint8_t back_idx;
-    uint8_t temp_size; // 当前队列长度
+    struct ent *topic;      // 订阅的话题
+    uint8_t data_len;       // 消息长度
+    uint32_t last_version;  // 上一次读到的消息版本号,用于判断是否有新消息
+    void *wait_task;        // 调用过SubWaitMessage()的任务句柄,发布时通知该任务;为NULL说明是轮询订阅者
+    float wait_us;          // 最近一次读到的消息从发布到被读取经过的时间,单位us
+    float max_wait_us;      // wait_us的最大值
+    uint32_t read_count;    // 读到新消息的次数
+    uint32_t overwrite_count; // 最新值订阅者没来得及读就被新消息覆盖的消息数
+
+    /* 以下为队列订阅者使用,depth为0说明是最新值订阅者,直接读取话题的双缓冲 */
+    uint8_t depth;                  // 队列深度
+    Queue_Overflow_e policy;        // 队列满时的处理策略
+    uint16_t slot_size;             // 每个槽的大小,4字节时间戳+消息,按4字节对齐
+    uint8_t *ring;                  // 队列存储,来自静态池
+    uint8_t head;                   // 队列头,最老的消息
+    uint8_t tail;                   // 队列尾,下一条消息写入的位置
+    uint8_t count;                  // 当前队列中的消息数
+    uint32_t overflow_count;        // 队列满导致丢弃消息的次数
+    void *blocked_pub;              // 因队列满而阻塞的发布者任务
 
     /* 指向下一个订阅了相同的话题的订阅者的指针 */
     struct mqt *next_subs_queue; // 使得发布者可以通过链表访问所有订阅了相同话题的订阅者
@@ -38,43 +73,125 @@ typedef struct mqt
 typedef struct ent
 {
     /* 话题名称 */
-    char topic_name[MAX_TOPIC_NAME_LEN + 1]; // 1个字节用于存放字符串结束符 '\0'
+    const char *topic_name;
     uint8_t data_len;                        // 该话题的数据长度
+    /* seqlock双缓冲: 第n次发布写入buffer[n&1],seq为奇数表示正在写入,seq>>1为已完成的发布次数 */
+    volatile uint32_t seq;
+    void *buffer[2];
+    uint32_t stamp[2]; // 对应缓冲区被发布时的DWT周期计数
     /* 指向第一个订阅了该话题的订阅者,通过链表访问所有订阅者 */
     Subscriber_t *first_subs;
-    /* 指向下一个Publisher的指针 */
-    struct ent *next_topic_node;
+    uint8_t subs_count; // 订阅者数量
     uint8_t pub_registered_flag; // 用于标记该发布者是否已经注册
 } Publisher_t;
 
+/* 编译期检查消息类型与话题表中登记的类型长度一致,不一致时数组长度为-1,编译报错 */
+#define MESSAGE_CHECK_LEN(id, type) ((void)sizeof(char[(sizeof(type) == id##_LEN) ? 1 : -1]))
+
 /**
- * @brief 订阅name的话题消息
+ * @brief 按话题枚举订阅,推荐使用,长度在编译期检查
+ * @example gimbal_sub = SubRegisterTopic(TOPIC_GIMBAL_CMD, Gimbal_Ctrl_Cmd_s);
+ */
+#define SubRegisterTopic(id, type) (MESSAGE_CHECK_LEN(id, type), SubRegisterById(id))
+
+/**
+ * @brief 按话题枚举订阅,使用消息队列,不会丢失突发的消息,适合一次性事件
+ * @example shoot_sub = SubRegisterTopicQueue(TOPIC_SHOOT_CMD, Shoot_Ctrl_Cmd_s, 4, QUEUE_DROP_OLDEST);
+ */
+#define SubRegisterTopicQueue(id, type, depth, policy) (MESSAGE_CHECK_LEN(id, type), SubRegisterQueue(id, depth, policy))
+
+/**
+ * @brief 按话题枚举注册发布者,推荐使用,长度在编译期检查
+ * @example gimbal_pub = PubRegisterTopic(TOPIC_GIMBAL_FEED, Gimbal_Upload_Data_s);
+ */
+#define PubRegisterTopic(id, type) (MESSAGE_CHECK_LEN(id, type), PubRegisterById(id))
+
+/**
+ * @brief 订阅话题消息
+ *
+ * @param topic 话题枚举
+ * @return Subscriber_t* 返回订阅者实例,订阅者池用完时返回NULL
+ */
+Subscriber_t *SubRegisterById(Topic_e topic);
+
+/**
+ * @brief 以队列模式订阅话题消息,每条发布的消息都会进入该订阅者的队列
+ *
+ * @param topic 话题枚举
+ * @param depth 队列深度,为0时等同于SubRegisterById()
+ * @param policy 队列满时的处理策略
+ * @return Subscriber_t* 返回订阅者实例,订阅者池或队列存储池用完时返回NULL
+ */
+Subscriber_t *SubRegisterQueue(Topic_e topic, uint8_t depth, Queue_Overflow_e policy);
+
+/**
+ * @brief 注册成为消息发布者,话题是静态分配的,直接返回话题表中的实例
+ *
+ * @param topic 话题枚举
+ * @return Publisher_t* 返回发布者实例
+ */
+Publisher_t *PubRegisterById(Topic_e topic);
+
+/**
+ * @brief 订阅name的话题消息(兼容旧接口,会在话题表中查找name)
  *
  * @param name 话题名称
  * @param data_len 消息长度,通过sizeof()获取
- * @return Subscriber_t* 返回订阅者实例
+ * @return Subscriber_t* 返回订阅者实例,话题不存在时返回NULL
  */
 Subscriber_t *SubRegister(char *name, uint8_t data_len);
 
 /**
- * @brief 注册成为消息发布者
+ * @brief 注册成为消息发布者(兼容旧接口,会在话题表中查找name)
  *
  * @param name 发布者发布的话题名称(话题)
- * @return Publisher_t* 返回发布者实例
+ * @param data_len 消息长度,通过sizeof()获取
+ * @return Publisher_t* 返回发布者实例,话题不存在时返回NULL
  */
 Publisher_t *PubRegister(char *name, uint8_t data_len);
 
 /**
- * @brief 获取消息
+ * @brief 获取消息.最新值订阅者拷贝一份一致的最新值快照,队列订阅者取出最老的一条消息
  *
  * @param sub 订阅者实例指针
  * @param data_ptr 数据指针,接收的消息将会放到此处
- * @return uint8_t 返回值为0说明没有新的消息(消息队列为空),为1说明获取到了新的消息
+ * @return uint8_t 返回值为0说明没有新的消息(data_ptr不会被修改),为1说明获取到了新的消息
  */
 uint8_t SubGetMessage(Subscriber_t *sub, void *data_ptr);
 
 /**
- * @brief 发布者给所有订阅了话题的订阅者推送消息
+ * @brief 阻塞等待新消息,发布者推送时会通过任务通知立即唤醒,不需要订阅者周期性轮询
+ * @attention 只能在任务中调用,且一个订阅者只能被一个任务等待.首次调用时会记录当前任务
+ *
+ * @param sub 订阅者实例指针
+ * @param data_ptr 数据指针,接收的消息将会放到此处
+ * @param timeout_ms 最长等待时间,单位ms
+ * @return uint8_t 1为收到新消息,0为超时(data_ptr不会被修改)
+ */
+uint8_t SubWaitMessage(Subscriber_t *sub, void *data_ptr, uint32_t timeout_ms);
+
+/**
+ * @brief 零拷贝读取最新消息,返回话题内部缓冲区的只读指针,仅用于最新值订阅者
+ * @attention 读完之后必须调用SubPeekCheck()确认读取期间数据没有被覆盖,失败则应重新读取
+ *
+ * @param sub 订阅者实例指针
+ * @param token 输出读取凭证,传给SubPeekCheck()
+ * @return const void* 最新消息的指针,尚未有消息发布时返回NULL
+ */
+const void *SubPeekMessage(Subscriber_t *sub, uint32_t *token);
+
+/**
+ * @brief 确认通过SubPeekMessage()读到的数据是一致的
+ *
+ * @param sub 订阅者实例指针
+ * @param token SubPeekMessage()输出的读取凭证
+ * @return uint8_t 1表示数据有效,0表示读取期间发布者已经开始覆盖该缓冲区
+ */
+uint8_t SubPeekCheck(Subscriber_t *sub, uint32_t token);
+
+/**
+ * @brief 发布者发布消息,数据只写入话题一次,所有订阅者共享,并唤醒正在SubWaitMessage()的订阅者
+ * @attention 同一话题同时只能有一个任务在发布,可以在中断中调用
  *
  * @param pub 发布者实例指针
  * @param data_ptr 指向要发布的数据的指针
@@ -82,4 +199,16 @@ uint8_t SubGetMessage(Subscriber_t *sub, void *data_ptr);
  */
 uint8_t PubPushMessage(Publisher_t *pub, void *data_ptr);
 
+/**
+ * @brief 通过RTT输出所有话题和订阅者的统计表,发布频率为距上一次输出期间的平均值
+ * @note 输出到MESSAGE_STATS_RTT_CHANNEL,在J-Link RTT Viewer中打开对应的terminal查看
+ */
+void MessageCenter_DumpStats(void);
+
+/**
+ * @brief 检查上位机是否通过RTT下行通道MESSAGE_STATS_RTT_CHANNEL发送了任意字符,是则输出统计表
+ * @note 在低优先级任务中周期调用即可,输出较慢,不要在控制任务中调用
+ */
+void MessageCenter_StatsPoll(void);
+
 #endif // !PUBSUB_H
@@ -0,0 +1,36 @@
+/**
+ * @file message_topics.h
+ * @brief 话题表,所有话题在编译期确定,新增话题只需要在MESSAGE_TOPIC_TABLE中加一行
+ *
+ * @note 每一项为 X(话题枚举, 话题名, 消息类型)
+ *       话题枚举用于O(1)访问,话题名用于兼容按字符串注册的旧接口,消息类型用于静态分配缓冲区和编译期长度检查
+ */
+
+#ifndef MESSAGE_TOPICS_H
+#define MESSAGE_TOPICS_H
+
+#include "robotdef.h"
+
+#define MESSAGE_TOPIC_TABLE(X)                                     \
+    X(TOPIC_GIMBAL_CMD, "gimbal_cmd", Gimbal_Ctrl_Cmd_s)           \
+    X(TOPIC_GIMBAL_FEED, "gimbal_feed", Gimbal_Upload_Data_s)      \
+    X(TOPIC_SHOOT_CMD, "shoot_cmd", Shoot_Ctrl_Cmd_s)              \
+    X(TOPIC_CHASSIS_CMD, "chassis_cmd", Chassis_Ctrl_Cmd_s)
+
+typedef enum
+{
+#define TOPIC_ENUM(id, name, type) id,
+    MESSAGE_TOPIC_TABLE(TOPIC_ENUM)
+#undef TOPIC_ENUM
+    TOPIC_COUNT, // 话题数量
+} Topic_e;
+
+/* 每个话题的消息长度,TOPIC_GIMBAL_CMD_LEN等,用于编译期检查 */
+enum
+{
+#define TOPIC_LEN(id, name, type) id##_LEN = sizeof(type),
+    MESSAGE_TOPIC_TABLE(TOPIC_LEN)
+#undef TOPIC_LEN
+};
+
+#endif // !MESSAGE_TOPICS_H
@@ -169,11 +169,11 @@ uint8_t get_device_status(uint8_t device_index){
     return offline_manager.devices[device_index].is_offline;
 }
 
-uint8_t get_system_status(void){
-    uint8_t status = 0;
+uint32_t get_system_status(void){
+    uint32_t status = 0;
     for (uint8_t i = 0; i < offline_manager.device_count; i++) {
         if (offline_manager.devices[i].is_offline) {
-            status |= (1 << i);
+            status |= (1UL << i);
         }
     }
     return status;
@@ -7,7 +7,7 @@
 #include "task.h"
 
 // 配置定义
-#define MAX_OFFLINE_DEVICES    12      // 最大离线设备数量 
+#define MAX_OFFLINE_DEVICES    16      // 最大离线设备数量,不能超过32(get_system_status按位返回)
 #define OFFLINE_INVALID_INDEX  0xFF
 
 // 状态定义
@@ -60,6 +60,6 @@ void offline_device_update(uint8_t device_index);
 void offline_device_enable(uint8_t device_index);
 void offline_device_disable(uint8_t device_index);
 uint8_t get_device_status(uint8_t device_index);
-uint8_t get_system_status(void);
+uint32_t get_system_status(void);
 
 #endif /* OFFLINE_H */
@@ -1,6 +1,7 @@
 #include "referee.h"
 #include "bsp_uart.h"
 #include "crc_rm.h"
+#include "dwt_prof.h"
 #include "offline.h"
 #include "referee_protocol.h"
 #include "stm32f4xx_hal_def.h"
@@ -17,10 +18,13 @@
 static referee_info_t referee_info;			  // 裁判系统数据
 uint8_t UI_Seq;
 static osThreadId refereeTaskHandle;
-static uint8_t referee_buf[2][1024];
+#define REFEREE_FRAME_MAX_LEN 256      // 一帧的最大长度,帧头中的长度超过它时认为帧头有误
+static uint8_t referee_buf[1024];      // DMA环形接收缓冲区
+static uint8_t referee_frame[REFEREE_FRAME_MAX_LEN]; // 跨过环形缓冲区末尾的帧拷贝到这里解析
 
 void RefereeTask(const void *argument);
 void JudgeReadData(uint8_t *buff);
+static void RefereeParseStream(void);
 void DeterminRobotID(void);
 void RefereeInit(void)
 {   
@@ -39,7 +43,7 @@ void RefereeInit(void)
         .expected_len = 0,       // 不定长
         .rx_buf_size = 1024,
         .rx_buf = (uint8_t (*)[2])referee_buf,
-        .rx_mode = UART_MODE_DMA,
+        .rx_mode = UART_MODE_DMA_CIRCULAR,
         .tx_mode = UART_MODE_DMA,
         .timeout = 1000,
         .rx_complete_cb = NULL,
@@ -69,112 +73,131 @@ void RefereeTask(const void *argument)
             );
             if(flags & UART_RX_DONE_EVENT) 
             {
-                JudgeReadData(*referee_info.uart_device->rx_buf);
+                RefereeParseStream();
             }
             osDelay(1);
         }
     }
 }
 
+/**
+ * @brief 从环形缓冲区中取出所有完整的帧并解析,帧在缓冲区内连续时原地解析,不完整的帧留到下次
+ */
+static void RefereeParseStream(void)
+{
+    UART_Device *uart = referee_info.uart_device;
+    uint16_t avail = UART_RxAvailable(uart);
+
+    while (avail >= LEN_HEADER)
+    {
+        if (UART_RxPeekByte(uart, SOF) != REFEREE_SOF)
+        {
+            UART_RxCommit(uart, 1);
+            avail--;
+            continue;
+        }
+        uint8_t *header = (uint8_t *)UART_RxPeek(uart, 0, LEN_HEADER, referee_frame);
+        uint16_t frame_len = (header[DATA_LENGTH] | (header[DATA_LENGTH + 1] << 8)) + LEN_HEADER + LEN_CMDID + LEN_TAIL;
+        if (Verify_CRC8_Check_Sum(header, LEN_HEADER) != RM_TRUE || frame_len > REFEREE_FRAME_MAX_LEN)
+        {
+            // 不是帧头,从下一个字节继续找
+            UART_RxCommit(uart, 1);
+            avail--;
+            continue;
+        }
+        if (avail < frame_len)
+        {
+            break; // 这一帧还没收完
+        }
+        uint8_t *frame = (uint8_t *)UART_RxPeek(uart, 0, frame_len, referee_frame);
+        if (Verify_CRC16_Check_Sum(frame, frame_len) == RM_TRUE)
+        {
+            PROF_BEGIN(JUDGE_READ_DATA);
+            JudgeReadData(frame);
+            PROF_END(JUDGE_READ_DATA);
+            UART_RxCommit(uart, frame_len);
+            avail -= frame_len;
+        }
+        else
+        {
+            UART_RxCommit(uart, 1);
+            avail--;
+        }
+    }
+}
+
  /**
-  * @brief  读取裁判数据,中断中读取保证速度
-  * @param  buff: 读取到的裁判系统原始数据
-  * @retval 是否对正误判断做处理
-  * @attention  在此判断帧头和CRC校验,无误再写入数据，不重复判断帧头
+  * @brief  解析一帧裁判系统数据
+  * @param  buff: 一帧完整的数据,帧头CRC8和帧尾CRC16已经校验通过
   */
 void JudgeReadData(uint8_t *buff)
 {
-    uint16_t judge_length; // 统计一帧数据长度
-    if (buff == NULL)	   // 空数据包，则不作任何处理
-        return;
- 
-    // 写入帧头数据(5-byte),用于判断是否开始存储裁判数据
+    offline_device_update(referee_info.offline_index);
     memcpy(&referee_info.FrameHeader, buff, LEN_HEADER);
- 
-    // 判断帧头数据(0)是否为0xA5
-    if (buff[SOF] == REFEREE_SOF)
+    // 2个8位拼成16位int
+    referee_info.CmdID = (buff[6] << 8 | buff[5]);
+    // 解析数据命令码,将数据拷贝到相应结构体中(注意拷贝数据的长度)
+    // 第8个字节开始才是数据 data=7
+    switch (referee_info.CmdID)
     {
-        // 帧头CRC8校验
-         if (Verify_CRC8_Check_Sum(buff, LEN_HEADER) == RM_TRUE)
+    case ID_game_state: // 0x0001
+        memcpy(&referee_info.GameState, (buff + DATA_Offset), LEN_game_state);
+        break;
+    case ID_game_result: // 0x0002
+        memcpy(&referee_info.GameResult, (buff + DATA_Offset), LEN_game_result);
+        break;
+    case ID_game_robot_survivors: // 0x0003
+        memcpy(&referee_info.GameRobotHP, (buff + DATA_Offset), LEN_game_robot_HP);
+        break;
+    case ID_event_data: // 0x0101
+        memcpy(&referee_info.EventData, (buff + DATA_Offset), LEN_event_data);
+        break;
+    case ID_supply_projectile_action: // 0x0102
+        memcpy(&referee_info.SupplyProjectileAction, (buff + DATA_Offset), LEN_supply_projectile_action);
+        break;
+    case ID_game_robot_state: // 0x0201
+        memcpy(&referee_info.GameRobotState, (buff + DATA_Offset), LEN_game_robot_state);
+        if (referee_info.init_flag == 0)
         {
-            offline_device_update(referee_info.offline_index);
-             // 统计一帧数据长度(byte),用于CR16校验
-             judge_length = buff[DATA_LENGTH] + LEN_HEADER + LEN_CMDID + LEN_TAIL;
-             // 帧尾CRC16校验
-             if (Verify_CRC16_Check_Sum(buff, judge_length) == RM_TRUE)
-             {
-                 // 2个8位拼成16位int
-                referee_info.CmdID = (buff[6] << 8 | buff[5]);
-                 // 解析数据命令码,将数据拷贝到相应结构体中(注意拷贝数据的长度)
-                 // 第8个字节开始才是数据 data=7
-                switch (referee_info.CmdID)
-                {
-                 case ID_game_state: // 0x0001
-                    memcpy(&referee_info.GameState, (buff + DATA_Offset), LEN_game_state);
-                    break;
-                 case ID_game_result: // 0x0002
-                    memcpy(&referee_info.GameResult, (buff + DATA_Offset), LEN_game_result);
-                    break;
-                 case ID_game_robot_survivors: // 0x0003
-                    memcpy(&referee_info.GameRobotHP, (buff + DATA_Offset), LEN_game_robot_HP);
-                    break;
-                 case ID_event_data: // 0x0101
-                    memcpy(&referee_info.EventData, (buff + DATA_Offset), LEN_event_data);
-                    break;
-                 case ID_supply_projectile_action: // 0x0102
-                    memcpy(&referee_info.SupplyProjectileAction, (buff + DATA_Offset), LEN_supply_projectile_action);
-                    break;
-                 case ID_game_robot_state: // 0x0201
-                    memcpy(&referee_info.GameRobotState, (buff + DATA_Offset), LEN_game_robot_state);
-                    if (referee_info.init_flag == 0)
-                    {
-                        DeterminRobotID();
-                        referee_info.init_flag=1;
-                    }
-                    break;
-                 case ID_power_heat_data: // 0x0202
-                    memcpy(&referee_info.PowerHeatData, (buff + DATA_Offset), LEN_power_heat_data);
-                    break;
-                 case ID_game_robot_pos: // 0x0203
-                    memcpy(&referee_info.GameRobotPos, (buff + DATA_Offset), LEN_game_robot_pos);
-                    break;
-                 case ID_buff_musk: // 0x0204
-                    memcpy(&referee_info.BuffMusk, (buff + DATA_Offset), LEN_buff_musk);
-                    break;
-                 case ID_aerial_robot_energy: // 0x0205
-                    memcpy(&referee_info.AerialRobotEnergy, (buff + DATA_Offset), LEN_aerial_robot_energy);
-                    break;
-                 case ID_robot_hurt: // 0x0206
-                    memcpy(&referee_info.RobotHurt, (buff + DATA_Offset), LEN_robot_hurt);
-                    break;
-                 case ID_shoot_data: // 0x0207
-                    memcpy(&referee_info.ShootData, (buff + DATA_Offset), LEN_shoot_data);
-                    break;
-                 case ID_shoot_remaining:
-                    memcpy(&referee_info.ext_shoot_remaing, (buff + DATA_Offset), LEN_shoot_remaing);
-                    break;
-                 case ID_rfid_status:
-                    memcpy(&referee_info.rfid_status, (buff + DATA_Offset), LEN_rfid_status);
-                    break;
-                 case ID_ground_robot_position :
-                    memcpy(&referee_info.ground_robot_position, (buff + DATA_Offset), LEN_ground_robot_position);
-                    break;
-                 case ID_sentry_info:
-                    memcpy(&referee_info.sentry_info, (buff + DATA_Offset), LEN_sentry_info);
-                    if (referee_info.sentry_info.sentry_can_free_revive == 1){Sentry_Free_Revive();}
-                    break;
-                }
-            }
-        }
-        // 首地址加帧长度,指向CRC16下一字节,用来判断是否为0xA5,从而判断一个数据包是否有多帧数据
-        if (*(buff + sizeof(xFrameHeader) + LEN_CMDID + referee_info.FrameHeader.DataLength + LEN_TAIL) == 0xA5)
-        { // 如果一个数据包出现了多帧数据,则再次调用解析函数,直到所有数据包解析完毕
-             JudgeReadData(buff + sizeof(xFrameHeader) + LEN_CMDID + referee_info.FrameHeader.DataLength + LEN_TAIL);
+            DeterminRobotID();
+            referee_info.init_flag=1;
         }
+        break;
+    case ID_power_heat_data: // 0x0202
+        memcpy(&referee_info.PowerHeatData, (buff + DATA_Offset), LEN_power_heat_data);
+        break;
+    case ID_game_robot_pos: // 0x0203
+        memcpy(&referee_info.GameRobotPos, (buff + DATA_Offset), LEN_game_robot_pos);
+        break;
+    case ID_buff_musk: // 0x0204
+        memcpy(&referee_info.BuffMusk, (buff + DATA_Offset), LEN_buff_musk);
+        break;
+    case ID_aerial_robot_energy: // 0x0205
+        memcpy(&referee_info.AerialRobotEnergy, (buff + DATA_Offset), LEN_aerial_robot_energy);
+        break;
+    case ID_robot_hurt: // 0x0206
+        memcpy(&referee_info.RobotHurt, (buff + DATA_Offset), LEN_robot_hurt);
+        break;
+    case ID_shoot_data: // 0x0207
+        memcpy(&referee_info.ShootData, (buff + DATA_Offset), LEN_shoot_data);
+        break;
+    case ID_shoot_remaining:
+        memcpy(&referee_info.ext_shoot_remaing, (buff + DATA_Offset), LEN_shoot_remaing);
+        break;
+    case ID_rfid_status:
+        memcpy(&referee_info.rfid_status, (buff + DATA_Offset), LEN_rfid_status);
+        break;
+    case ID_ground_robot_position :
+        memcpy(&referee_info.ground_robot_position, (buff + DATA_Offset), LEN_ground_robot_position);
+        break;
+    case ID_sentry_info:
+        memcpy(&referee_info.sentry_info, (buff + DATA_Offset), LEN_sentry_info);
+        if (referee_info.sentry_info.sentry_can_free_revive == 1){Sentry_Free_Revive();}
+        break;
     }
 }
 
-void RefereeSend(uint8_t *send, uint16_t tx_len){
+void RefereeSend(const uint8_t *send, uint16_t tx_len){
     UART_Send(referee_info.uart_device, send, tx_len);
 }
  
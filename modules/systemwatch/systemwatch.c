@@ -18,6 +18,8 @@ static TaskMonitor_t taskList[MAX_MONITORED_TASKS];
 static uint8_t taskCount = 0;
 static osThreadId watchTaskHandle;
 static volatile uint32_t watch_task_last_active = 0;
+static volatile uint8_t watch_suspended = 0;
+static IWDG_InitTypeDef iwdg_saved;
 
 // 辅助函数声明
 static void PrintTaskInfo(TaskStatus_t *pxTaskStatus, TaskMonitor_t *pxTaskMonitor);
@@ -35,7 +37,7 @@ static void SystemWatch_Task(const void *argument)
         for(uint8_t i = 0; i < taskCount; i++) {
             if(taskList[i].isActive) {
                 // 检查任务执行间隔是否过长
-                if(taskList[i].dt > TASK_BLOCK_TIMEOUT) {
+                if(!watch_suspended && taskList[i].dt > TASK_BLOCK_TIMEOUT) {
                     taskENTER_CRITICAL();
                     
                     log_e("\r\n**** Task Blocked Detected! System State Dump ****");
@@ -65,7 +67,7 @@ static void SystemWatch_Task(const void *argument)
 // 定时器中断回调，用于监控 SystemWatch 任务本身
 void sysytemwatch_it_callback(void){
     HAL_IWDG_Refresh(&hiwdg);
-    if (systemwatch_init==1)
+    if (systemwatch_init==1 && !watch_suspended)
     {
         {
             if (taskList[0].dt > TASK_BLOCK_TIMEOUT) //列表第一个就是watchtask本身
@@ -108,6 +110,40 @@ void SystemWatch_Init(void)
     log_i("SystemWatch initialized, watch task created.");
 }
 
+void SystemWatch_Suspend(void)
+{
+    if (watch_suspended) {
+        return;
+    }
+    watch_suspended = 1;
+    // 看门狗还没启动时(Instance为空)不能重新初始化,否则会提前启动看门狗
+    if (hiwdg.Instance != NULL) {
+        iwdg_saved = hiwdg.Init;
+        hiwdg.Init.Prescaler = SUSPEND_IWDG_PRESCALER;
+        hiwdg.Init.Reload = SUSPEND_IWDG_RELOAD;
+        HAL_IWDG_Init(&hiwdg);
+    }
+}
+
+void SystemWatch_Resume(void)
+{
+    if (!watch_suspended) {
+        return;
+    }
+    if (hiwdg.Instance != NULL) {
+        hiwdg.Init = iwdg_saved;
+        HAL_IWDG_Init(&hiwdg);
+    }
+    // 暂停期间的停顿不计入任务间隔
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    for (uint8_t i = 0; i < taskCount; i++) {
+        DWT_GetDeltaT(&taskList[i].dt_cnt);
+        taskList[i].dt = 0;
+    }
+    watch_suspended = 0;
+    taskEXIT_CRITICAL_FROM_ISR(uxSavedInterruptStatus);
+}
+
 static void PrintTaskInfo(TaskStatus_t *pxTaskStatus, TaskMonitor_t *pxTaskMonitor)
 {
     log_e("Name: %s", pxTaskMonitor->name);
@@ -10,6 +10,9 @@
 #define TASK_BLOCK_TIMEOUT 1
 // 监控任务运行周期 (ms)
 #define MONITOR_PERIOD 100
+// 暂停期间独立看门狗的超时,需要大于flash扇区擦除的最长时间(2s): 64分频,重装载2000,约4s
+#define SUSPEND_IWDG_PRESCALER IWDG_PRESCALER_64
+#define SUSPEND_IWDG_RELOAD    2000
 
 typedef struct {
     osThreadId handle;    // 任务句柄
@@ -27,6 +30,10 @@ void SystemWatch_Init(void);
 int8_t SystemWatch_RegisterTask(osThreadId taskHandle, const char* taskName);
 // 在被监控的任务中调用此函数更新计数器
 void SystemWatch_ReportTaskAlive(osThreadId taskHandle);
+// 暂停阻塞检测并放宽看门狗,用于擦除flash等会让cpu停顿的操作
+void SystemWatch_Suspend(void);
+// 恢复看门狗设置,重新开始计算各任务的间隔
+void SystemWatch_Resume(void);
 void sysytemwatch_it_callback(void);
 void sysytemwatch_it_callback(void);
 
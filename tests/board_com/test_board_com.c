@@ -0,0 +1,185 @@
+/**
+ * @file test_board_com.c
+ * @brief board_com.c(云台板)通过bsp_can.c在虚拟总线上与模拟的底盘板通信,按BOARD_COM_SEGMENTED的两种取值各编译一次:
+ *        0: 控制命令定点压缩成单帧,经发送调度表按周期发出,内容不变时跳过但每CAN_SCHED_REFRESH_TICKS个周期至少重发一次;
+ *        1: 控制命令连同发送时间分段传输,每个周期都发出4帧,底盘板收到的是完整精度的结构体.
+ *        两种方式下底盘板发来的裁判系统数据都由BoardRead()读出,每条完整的消息刷新一次离线检测,长度不对的报文丢弃
+ * @note 离线检测用本文件中的替身代替.模拟的底盘板使用同一份board_msg_codec.c编解码,分段传输时用board_tp.c重组,
+ *       发送的分段由本文件按board_tp.h中的帧格式独立拼出
+ */
+
+#include "board_com.h"
+#include "board_msg_codec.h"
+#include "bsp_can.h"
+#include "can.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "task.h"
+#include "vcan.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MS_CYCLES (VCAN_CPU_HZ / 1000)
+
+/* 替身 */
+static uint32_t offline_updates;
+
+uint8_t offline_device_register(const OfflineDeviceInit_t *init)
+{
+    (void)init;
+    return 0;
+}
+void offline_device_update(uint8_t device_index)
+{
+    (void)device_index;
+    offline_updates++;
+}
+
+/* 模拟底盘板: 解码收到的控制命令 */
+typedef struct {
+    uint32_t frames;
+    uint32_t msgs;
+    Chassis_Ctrl_Cmd_s cmd;
+#if BOARD_COM_SEGMENTED
+    BoardTP_t tp;
+    uint32_t stamp_ms;
+#endif
+} Chassis_t;
+
+static Chassis_t chassis;
+static int8_t chassis_node;
+
+static void ChassisRx(void *ctx, uint16_t std_id, const uint8_t *data, uint8_t dlc)
+{
+    Chassis_t *c = ctx;
+    if (std_id != GIMBAL_ID)
+        return;
+    c->frames++;
+#if BOARD_COM_SEGMENTED
+    Board_Gimbal_Msg_s msg;
+    if (BoardTP_Receive(&c->tp, data, dlc) == sizeof(msg)) {
+        memcpy(&msg, c->tp.rx_buf, sizeof(msg));
+        c->cmd = msg.cmd;
+        c->stamp_ms = msg.stamp_ms;
+        c->msgs++;
+    }
+#else
+    if (BoardGimbalCmd_Decode(data, dlc, &c->cmd))
+        c->msgs++;
+#endif
+}
+
+static void ChassisSend(const Chassis_referee_Upload_Data_s *referee)
+{
+#if BOARD_COM_SEGMENTED
+    // 首帧带5字节,之后每个连续帧7字节
+    Board_Chassis_Msg_s msg = {.stamp_ms = 1234, .referee = *referee};
+    const uint8_t *src = (const uint8_t *)&msg;
+    uint8_t frame[8] = {BOARD_TP_PCI_FF, sizeof(msg), 0};
+    memcpy(&frame[3], src, 5);
+    VCAN_NodeSend(&hcan1, chassis_node, CHASSIS_ID, frame, 8);
+    for (uint16_t offset = 5, sn = 1; offset < sizeof(msg); offset += 7, sn++) {
+        uint8_t chunk = sizeof(msg) - offset > 7 ? 7 : (uint8_t)(sizeof(msg) - offset);
+        frame[0] = BOARD_TP_PCI_CF | (sn & 0x0F);
+        memcpy(&frame[1], src + offset, chunk);
+        VCAN_NodeSend(&hcan1, chassis_node, CHASSIS_ID, frame, chunk + 1);
+    }
+#else
+    uint8_t data[8];
+    uint16_t len = BoardChassisReferee_Encode(referee, data);
+    VCAN_NodeSend(&hcan1, chassis_node, CHASSIS_ID, data, (uint8_t)len);
+#endif
+}
+
+/* 一个控制周期: 发送、统一发出,然后等报文传输完 */
+static void ControlTick(const Chassis_Ctrl_Cmd_s *cmd)
+{
+    board_send((void *)cmd);
+    CAN_SchedFlush();
+    VCAN_Advance(MS_CYCLES);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    VCAN_Reset();
+    chassis_node = VCAN_AttachNode(&hcan1, ChassisRx, &chassis);
+
+    board_com_init_t init = {
+        .Can_Device_Init_Config = {.can_handle = &hcan1, .tx_id = GIMBAL_ID, .rx_id = CHASSIS_ID},
+        .offline_manage_init = {.name = "board_com", .timeout_ms = 100, .enable = OFFLINE_ENABLE},
+    };
+    board_com_t *board = board_com_init(&init);
+    TEST_CHECK(board != NULL);
+
+    // 云台板 -> 底盘板
+    Chassis_Ctrl_Cmd_s cmd = {.vx = 1200.0f, .vy = -300.0f, .wz = -3.5f, .offset_angle = 12.34f,
+                              .chassis_mode = CHASSIS_ROTATE};
+    ControlTick(&cmd);
+    TEST_CHECK(chassis.msgs == 1);
+    TEST_CHECK(chassis.cmd.vx == 1200.0f && chassis.cmd.vy == -300.0f);
+    TEST_CHECK(chassis.cmd.chassis_mode == CHASSIS_ROTATE);
+#if BOARD_COM_SEGMENTED
+    // 完整精度,带发送时的系统时间
+    TEST_CHECK(chassis.frames == 4 && board->tp.stats.tx_frames == 4);
+    TEST_CHECK(chassis.cmd.wz == -3.5f && chassis.cmd.offset_angle == 12.34f);
+    TEST_CHECK(xTaskGetTickCount() - chassis.stamp_ms <= 1);
+
+    // 每个周期都发出
+    for (uint8_t i = 0; i < 2 * CAN_SCHED_REFRESH_TICKS; i++)
+        ControlTick(&cmd);
+    TEST_CHECK(chassis.msgs == 1 + 2 * CAN_SCHED_REFRESH_TICKS && chassis.frames == 4 * chassis.msgs);
+    cmd.vx = -50.123f;
+    ControlTick(&cmd);
+    TEST_CHECK(chassis.cmd.vx == -50.123f);
+    TEST_CHECK(chassis.tp.stats.rx_seq_errors == 0 && chassis.tp.stats.rx_lost == 0);
+#else
+    TEST_CHECK(chassis.frames == 1);
+    TEST_CHECK(fabsf(chassis.cmd.wz + 3.5f) < 0.05f + 1e-4f);
+    TEST_CHECK(fabsf(chassis.cmd.offset_angle - 12.34f) < 0.005f + 1e-4f);
+
+    // 内容不变时跳过,但不会超过CAN_SCHED_REFRESH_TICKS个周期不发
+    for (uint8_t i = 0; i < 2 * CAN_SCHED_REFRESH_TICKS; i++)
+        ControlTick(&cmd);
+    TEST_CHECK(chassis.frames >= 2 && chassis.frames <= 4);
+    uint32_t frames = chassis.frames;
+    cmd.vx = -50.0f;
+    ControlTick(&cmd);
+    TEST_CHECK(chassis.frames == frames + 1 && chassis.cmd.vx == -50.0f);
+#endif
+
+    // 底盘板 -> 云台板
+    Chassis_referee_Upload_Data_s referee = {
+        .Robot_Color = 1,
+        .projectile_allowance_17mm = 500,
+        .power_management_shooter_output = 1,
+        .current_hp_percent = 100,
+        .outpost_HP = 1500,
+        .base_HP = 5000,
+        .game_progess = 4,
+        .game_time = 300,
+    };
+    uint32_t updates = offline_updates;
+    ChassisSend(&referee);
+    VCAN_Advance(MS_CYCLES);
+    Chassis_referee_Upload_Data_s *read = BoardRead();
+    TEST_CHECK(offline_updates == updates + 1);
+    TEST_CHECK(read->Robot_Color == 1 && read->power_management_shooter_output == 1);
+    TEST_CHECK(read->game_progess == 4 && read->game_time == 300);
+    TEST_CHECK(read->outpost_HP == 1500 && read->base_HP == 5000 && read->current_hp_percent == 100);
+#if BOARD_COM_SEGMENTED
+    TEST_CHECK(read->projectile_allowance_17mm == 500 && board->peer_stamp_ms == 1234);
+#else
+    TEST_CHECK(abs((int)read->projectile_allowance_17mm - 500) <= 4);
+#endif
+
+    // 长度不对的报文丢弃,不刷新离线检测
+    uint8_t junk[3] = {0};
+    VCAN_NodeSend(&hcan1, chassis_node, CHASSIS_ID, junk, sizeof(junk));
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(offline_updates == updates + 1 && read->game_time == 300);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,265 @@
+/**
+ * @file test_board_tp.c
+ * @brief board_tp.c在虚拟总线上往返: 固件发出的各段由模拟节点截获,原样或修改后再发回固件,由注册的设备重组.
+ *        覆盖单帧、首帧+连续帧、最大长度和超长,连续帧序号错误和缺帧时丢弃整条消息,整条多帧消息丢失时按msg_seq计数,
+ *        未收完就收到新首帧或单帧时放弃旧消息,发送队列满时整条消息计为丢弃
+ * @note 最后打印一条板间消息分段前后占用总线的时间,板间通信每3ms发送一次
+ */
+
+#include "board_tp.h"
+#include "bsp_can.h"
+#include "can.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "vcan.h"
+
+#include <string.h>
+
+#define MS_CYCLES (VCAN_CPU_HZ / 1000)
+#define TRANSFER_CYCLES (5 * MS_CYCLES) // 足够传完一条最长的消息
+#define TX_ID 0x320
+#define RX_ID 0x321
+#define MAX_FRAMES 32
+
+static BoardTP_t tx_tp, rx_tp;
+
+/* 固件侧接收: 重组完成的消息 */
+static uint8_t rx_msg[BOARD_TP_MAX_LEN];
+static uint16_t rx_msg_len;
+static uint32_t rx_count;
+
+static void DeviceRx(Can_Device *device)
+{
+    uint16_t len = BoardTP_Receive(&rx_tp, device->rx_buff, device->rx_len);
+    if (len) {
+        memcpy(rx_msg, rx_tp.rx_buf, len);
+        rx_msg_len = len;
+        rx_count++;
+    }
+}
+
+/* 模拟节点: 截获固件发出的各段 */
+typedef struct {
+    uint8_t data[8];
+    uint8_t dlc;
+    uint64_t stamp; // 传输结束的时刻
+} Frame_t;
+
+typedef struct {
+    Frame_t frames[MAX_FRAMES];
+    uint8_t count;
+} Capture_t;
+
+static Capture_t capture;
+static int8_t node;
+
+static void NodeRx(void *ctx, uint16_t std_id, const uint8_t *data, uint8_t dlc)
+{
+    Capture_t *c = ctx;
+    if (std_id != TX_ID || c->count >= MAX_FRAMES)
+        return;
+    Frame_t *f = &c->frames[c->count++];
+    memcpy(f->data, data, dlc);
+    f->dlc = dlc;
+    f->stamp = VCAN_Now();
+}
+
+static void Fill(uint8_t *msg, uint16_t len, uint8_t seed)
+{
+    for (uint16_t i = 0; i < len; i++)
+        msg[i] = (uint8_t)(seed + i * 7);
+}
+
+/* 固件发送一条消息,截获到msg中,返回帧数 */
+static uint8_t Transfer(Capture_t *msg, const uint8_t *data, uint16_t len)
+{
+    capture.count = 0;
+    TEST_CHECK(BoardTP_Send(&tx_tp, &hcan1, TX_ID, data, len) == HAL_OK);
+    VCAN_Advance(TRANSFER_CYCLES);
+    *msg = capture;
+    return msg->count;
+}
+
+/* 节点把截获的第first到last帧发回固件 */
+static void Replay(const Capture_t *msg, uint8_t first, uint8_t last)
+{
+    for (uint8_t i = first; i <= last && i < msg->count; i++)
+        VCAN_NodeSend(&hcan1, node, RX_ID, msg->frames[i].data, msg->frames[i].dlc);
+    VCAN_Advance(TRANSFER_CYCLES);
+}
+
+static uint8_t Received(const uint8_t *data, uint16_t len)
+{
+    return rx_msg_len == len && memcmp(rx_msg, data, len) == 0;
+}
+
+static void TestSingleFrame(void)
+{
+    uint8_t data[7];
+    Capture_t msg;
+    Fill(data, sizeof(data), 1);
+    TEST_CHECK(Transfer(&msg, data, sizeof(data)) == 1);
+    TEST_CHECK(msg.frames[0].dlc == 8 && msg.frames[0].data[0] == (BOARD_TP_PCI_SF | 7));
+    Replay(&msg, 0, 0);
+    TEST_CHECK(rx_count == 1 && Received(data, sizeof(data)));
+}
+
+static void TestMultiFrame(void)
+{
+    uint8_t data[BOARD_TP_MAX_LEN];
+    Capture_t msg;
+
+    // 38字节: 首帧5字节,连续帧7+7+7+7+7字节
+    Fill(data, 38, 2);
+    TEST_CHECK(Transfer(&msg, data, 38) == 6);
+    TEST_CHECK(msg.frames[0].dlc == 8 && msg.frames[0].data[0] == BOARD_TP_PCI_FF && msg.frames[0].data[1] == 38);
+    for (uint8_t i = 1; i < 6; i++)
+        TEST_CHECK(msg.frames[i].data[0] == (BOARD_TP_PCI_CF | i));
+    TEST_CHECK(msg.frames[5].dlc == 1 + 38 - 5 - 4 * 7);
+    Replay(&msg, 0, 5);
+    TEST_CHECK(rx_count == 2 && Received(data, 38));
+
+    // 最大长度,每个首帧的msg_seq加1
+    uint8_t seq = msg.frames[0].data[2];
+    Fill(data, BOARD_TP_MAX_LEN, 3);
+    TEST_CHECK(Transfer(&msg, data, BOARD_TP_MAX_LEN) == 10);
+    TEST_CHECK(msg.frames[0].data[2] == (uint8_t)(seq + 1));
+    Replay(&msg, 0, 9);
+    TEST_CHECK(rx_count == 3 && Received(data, BOARD_TP_MAX_LEN));
+
+    // 超长的消息不发送
+    uint8_t frames = (uint8_t)tx_tp.stats.tx_frames;
+    TEST_CHECK(BoardTP_Send(&tx_tp, &hcan1, TX_ID, data, BOARD_TP_MAX_LEN + 1) == HAL_ERROR);
+    TEST_CHECK((uint8_t)tx_tp.stats.tx_frames == frames);
+    TEST_CHECK(rx_tp.stats.rx_seq_errors == 0 && rx_tp.stats.rx_lost == 0 && rx_tp.stats.rx_aborted == 0);
+}
+
+/* 连续帧序号不对或缺帧时丢弃整条消息,之后的连续帧忽略,下一条消息正常收到 */
+static void TestBadSequence(void)
+{
+    uint8_t data[38], next[20];
+    Capture_t msg;
+    Fill(data, sizeof(data), 4);
+    Fill(next, sizeof(next), 5);
+    uint32_t count = rx_count;
+
+    Transfer(&msg, data, sizeof(data));
+    msg.frames[2].data[0] = BOARD_TP_PCI_CF | 3;
+    Replay(&msg, 0, 5);
+    TEST_CHECK(rx_count == count && rx_tp.stats.rx_seq_errors == 1);
+
+    Transfer(&msg, data, sizeof(data));
+    Replay(&msg, 0, 1);
+    Replay(&msg, 3, 5); // 第2个连续帧丢失
+    TEST_CHECK(rx_count == count && rx_tp.stats.rx_seq_errors == 2);
+
+    Transfer(&msg, next, sizeof(next));
+    Replay(&msg, 0, msg.count - 1);
+    TEST_CHECK(rx_count == count + 1 && Received(next, sizeof(next)));
+    TEST_CHECK(rx_tp.stats.rx_lost == 0);
+}
+
+/* 整条多帧消息丢失,从下一个首帧的msg_seq推算 */
+static void TestLostMessage(void)
+{
+    uint8_t data[20];
+    Capture_t first, lost, last;
+    Fill(data, sizeof(data), 6);
+    Transfer(&first, data, sizeof(data));
+    Transfer(&lost, data, sizeof(data));
+    Transfer(&last, data, sizeof(data));
+    uint32_t count = rx_count;
+    Replay(&first, 0, first.count - 1);
+    Replay(&last, 0, last.count - 1);
+    TEST_CHECK(rx_count == count + 2 && rx_tp.stats.rx_lost == 1);
+}
+
+/* 未收完就收到新首帧或单帧,放弃旧消息,新消息正常收到 */
+static void TestAbort(void)
+{
+    uint8_t a[38], b[20], c[3], d[38];
+    Capture_t msg_a, msg_b, msg_c, msg_d;
+    Fill(a, sizeof(a), 7);
+    Fill(b, sizeof(b), 8);
+    Fill(c, sizeof(c), 9);
+    Fill(d, sizeof(d), 10);
+    Transfer(&msg_a, a, sizeof(a));
+    Transfer(&msg_b, b, sizeof(b));
+    Transfer(&msg_c, c, sizeof(c));
+    Transfer(&msg_d, d, sizeof(d));
+    uint32_t count = rx_count;
+
+    Replay(&msg_a, 0, 1);
+    Replay(&msg_b, 0, msg_b.count - 1);
+    TEST_CHECK(rx_count == count + 1 && Received(b, sizeof(b)) && rx_tp.stats.rx_aborted == 1);
+    Replay(&msg_a, 2, 5); // 旧消息剩下的连续帧忽略
+    TEST_CHECK(rx_count == count + 1 && rx_tp.stats.rx_seq_errors == 2);
+
+    Replay(&msg_d, 0, 2);
+    Replay(&msg_c, 0, 0);
+    TEST_CHECK(rx_count == count + 2 && Received(c, sizeof(c)) && rx_tp.stats.rx_aborted == 2);
+    TEST_CHECK(rx_tp.stats.rx_lost == 1);
+}
+
+/* 发送队列满: 3个邮箱加CAN_TX_QUEUE_LEN,第二条64字节的消息放不下 */
+static void TestTxDropped(void)
+{
+    uint8_t data[BOARD_TP_MAX_LEN];
+    Fill(data, sizeof(data), 11);
+    capture.count = 0;
+    uint32_t msgs = tx_tp.stats.tx_msgs, frames = tx_tp.stats.tx_frames;
+    TEST_CHECK(BoardTP_Send(&tx_tp, &hcan1, TX_ID, data, sizeof(data)) == HAL_OK);
+    TEST_CHECK(BoardTP_Send(&tx_tp, &hcan1, TX_ID, data, sizeof(data)) == HAL_BUSY);
+    TEST_CHECK(tx_tp.stats.tx_msgs == msgs + 1 && tx_tp.stats.tx_dropped == 1);
+    TEST_CHECK(tx_tp.stats.tx_frames == frames + 3 + CAN_TX_QUEUE_LEN);
+    VCAN_Advance(TRANSFER_CYCLES);
+    TEST_CHECK(capture.count == 3 + CAN_TX_QUEUE_LEN);
+}
+
+/* 板间消息(4字节时间戳加Chassis_Ctrl_Cmd_s,共24字节)分段后与board_msg_codec压缩成8字节单帧占用总线的时间 */
+static void ReportBusLoad(void)
+{
+    uint8_t data[24];
+    Capture_t msg;
+    Fill(data, sizeof(data), 12);
+    uint64_t start = VCAN_Now();
+    uint8_t frames = Transfer(&msg, data, sizeof(data));
+    uint64_t segmented = msg.frames[frames - 1].stamp - start;
+    TEST_CHECK(frames == 4);
+
+    start = VCAN_Now();
+    capture.count = 0;
+    CAN_SendMessage_prio(&hcan1, TX_ID, data, 8, 0);
+    VCAN_Advance(MS_CYCLES);
+    uint64_t single = capture.frames[0].stamp - start;
+    printf("board message on the bus: segmented %u frames %.1f us, single frame %.1f us, "
+           "at 333Hz %.1f%% vs %.1f%% of the bus\n",
+           frames, segmented * 1e6 / VCAN_CPU_HZ, single * 1e6 / VCAN_CPU_HZ,
+           segmented * 333.0 * 100 / VCAN_CPU_HZ, single * 333.0 * 100 / VCAN_CPU_HZ);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    VCAN_Reset();
+    node = VCAN_AttachNode(&hcan1, NodeRx, &capture);
+
+    Can_Device_Init_Config_s config = {
+        .can_handle = &hcan1,
+        .tx_id = TX_ID,
+        .rx_id = RX_ID,
+        .tx_mode = CAN_MODE_BLOCKING,
+        .rx_mode = CAN_MODE_IT,
+        .can_callback = DeviceRx,
+    };
+    TEST_CHECK(BSP_CAN_Device_Init(&config) != NULL);
+
+    TestSingleFrame();
+    TestMultiFrame();
+    TestBadSequence();
+    TestLostMessage();
+    TestAbort();
+    TestTxDropped();
+    ReportBusLoad();
+    return HOST_TEST_RESULT();
+}
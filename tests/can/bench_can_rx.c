@@ -0,0 +1,165 @@
+/**
+ * @file bench_can_rx.c
+ * @brief CAN接收中断的耗时和关中断时间,分别以CAN_RX_DEFERRED为0(中断中调用dji.c的反馈解码)和1(中断只入环形缓冲区)编译,
+ *        8个M3508每1ms各发一帧反馈,读出bsp_can.c自己的接收统计,每收到一帧取一次isr_cycles_last求中位数.
+ *        另外给出主机上一次vTaskNotifyGiveFromISR()的耗时,延迟接收的中断中包含一次通知,
+ *        主机上的通知是pthread条件变量,比板上的FreeRTOS通知慢得多,比较时应先减去
+ * @note 虚拟总线的时间只在事件之间跳变,这里用Host_DwtAddWallTime()让中断执行期间的实际时间也计入DWT,
+ *       数字是主机上按168MHz换算的周期数,不能换算到板上,只用来比较两种接收方式.
+ *       ./bench_can_rx_direct [毫秒数] 和 ./bench_can_rx_deferred [毫秒数]
+ */
+
+#include "bsp_can.h"
+#include "can.h"
+#include "dji.h"
+#include "host_dwt.h"
+#include "cmsis_os.h"
+#include "host_rtos.h"
+#include "powercontroller.h"
+#include "vcan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MOTORS 8
+#define MS_CYCLES (VCAN_CPU_HZ / 1000)
+#define FRAME8_CYCLES ((47 + 64) * (VCAN_CPU_HZ / VCAN_DEFAULT_BITRATE)) // 1Mbps下8字节帧的传输时间
+
+/* 替身,与test_dji_motor.c相同 */
+uint8_t offline_device_register(const OfflineDeviceInit_t *init)
+{
+    (void)init;
+    return 0;
+}
+void offline_device_update(uint8_t device_index) { (void)device_index; }
+uint8_t get_device_status(uint8_t device_index)
+{
+    (void)device_index;
+    return 0;
+}
+void PowerControlDji(DJIMotor_t *motor, float control_output)
+{
+    (void)motor;
+    (void)control_output;
+}
+void PowerControlDjiFinalize(DJIMotor_t **motor_list, uint8_t motor_count)
+{
+    (void)motor_list;
+    (void)motor_count;
+}
+int16_t GetPowerControlOutput(uint8_t motor_num)
+{
+    (void)motor_num;
+    return 0;
+}
+void LQRInit(LQRInstance *lqr, LQR_Init_Config_s *config)
+{
+    (void)lqr;
+    (void)config;
+}
+float LQRCalculate(LQRInstance *lqr, float state0, float state1, float ref)
+{
+    (void)lqr;
+    (void)state0;
+    (void)state1;
+    (void)ref;
+    return 0;
+}
+
+static uint32_t samples[1 << 20];
+
+static int CompareU32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t Median(uint32_t *v, uint32_t n)
+{
+    qsort(v, n, sizeof(*v), CompareU32);
+    return n ? v[n / 2] : 0;
+}
+
+/* 等待通知的任务,与bsp_can的解码任务一样被中断唤醒 */
+static void Waiter(const void *arg)
+{
+    (void)arg;
+    for (;;)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+/* 中断中唤醒一个等待通知的任务的耗时中位数,单位为168MHz周期 */
+static uint32_t NotifyCost(uint32_t n)
+{
+    osThreadDef(waiter, Waiter, osPriorityHigh, 0, 128);
+    osThreadId task = osThreadCreate(osThread(waiter), NULL);
+    Host_WaitIdle(1000);
+    for (uint32_t i = 0; i < n; i++) {
+        struct timespec a, b;
+        BaseType_t woken = pdFALSE;
+        Host_IsrEnter();
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        vTaskNotifyGiveFromISR((TaskHandle_t)task, &woken);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        Host_IsrExit();
+        samples[i] = (uint32_t)(((b.tv_sec - a.tv_sec) * 1000000000ll + (b.tv_nsec - a.tv_nsec)) * 168 / 1000);
+        Host_WaitIdle(1000);
+    }
+    return Median(samples, n);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ms = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 10000;
+    Host_TaskSetName("bench");
+    VCAN_Reset();
+    int8_t esc = VCAN_AttachNode(&hcan1, NULL, NULL);
+
+    for (uint8_t i = 0; i < MOTORS; i++) {
+        Motor_Init_Config_s config = {
+            .controller_param_init_config = {.speed_PID = {.Kp = 10.0f, .MaxOut = 16384.0f}},
+            .controller_setting_init_config = {.outer_loop_type = SPEED_LOOP, .close_loop_type = SPEED_LOOP},
+            .motor_type = M3508,
+            .can_init_config = {.can_handle = &hcan1, .tx_id = (uint8_t)(i + 1)},
+            .offline_device_motor = {.name = "m3508", .timeout_ms = 50, .enable = OFFLINE_ENABLE},
+        };
+        if (DJIMotorInit(&config) == NULL) {
+            fprintf(stderr, "motor %u init failed\n", i + 1);
+            return 1;
+        }
+    }
+
+    CAN_RxStats_t stats = {0};
+    uint32_t isr_count = 0;
+    Host_DwtAddWallTime(1);
+    for (uint32_t t = 0; t < ms; t++) {
+        for (uint8_t i = 0; i < MOTORS; i++) {
+            uint16_t ecd = (uint16_t)((t * 37 + i * 1000) & 0x1FFF);
+            int16_t speed = (int16_t)(t % 2000), current = (int16_t)(i * 100);
+            uint8_t data[8] = {(uint8_t)(ecd >> 8), (uint8_t)ecd, (uint8_t)(speed >> 8), (uint8_t)speed,
+                               (uint8_t)(current >> 8), (uint8_t)current, 40, 0};
+            VCAN_NodeSend(&hcan1, esc, (uint16_t)(0x201 + i), data, 8);
+        }
+        // 每次推进一帧的时间,帧之间总线空闲,每帧各进一次接收中断
+        uint64_t end = VCAN_Now() + MS_CYCLES;
+        for (uint8_t i = 0; i < MOTORS; i++) {
+            uint32_t before = stats.rx_count;
+            VCAN_Advance(FRAME8_CYCLES);
+            CAN_GetRxStats(&hcan1, &stats);
+            if (stats.rx_count == before + 1 && isr_count < sizeof(samples) / sizeof(samples[0]))
+                samples[isr_count++] = stats.isr_cycles_last;
+        }
+        VCAN_Advance(end - VCAN_Now());
+    }
+    Host_DwtAddWallTime(0);
+
+    CAN_GetRxStats(&hcan1, &stats);
+    printf("CAN_RX_DEFERRED=%d frames %lu isr %lu\n", CAN_RX_DEFERRED, (unsigned long)stats.rx_count,
+           (unsigned long)isr_count);
+    printf("  isr cycles      median %8lu  max %8lu\n", (unsigned long)Median(samples, isr_count),
+           (unsigned long)stats.isr_cycles_max);
+    printf("  irq-off cycles                   max %8lu\n", (unsigned long)stats.irq_off_cycles_max);
+    printf("  host notify-from-isr cycles median %lu\n", (unsigned long)NotifyCost(10000));
+    return 0;
+}
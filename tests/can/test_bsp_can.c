@@ -0,0 +1,272 @@
+/**
+ * @file test_bsp_can.c
+ * @brief bsp_can.c在虚拟总线上运行: 过滤器分配只放行已注册的ID,邮箱满时发送队列按优先级和入队顺序补充,
+ *        调度发出的报文上线顺序与调度顺序一致,接收中断打时间戳后由解码任务调用设备回调,
+ *        错误状态只在进入时计数,离线恢复后发出积压的报文
+ */
+
+#include "bsp_can.h"
+#include "can.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "vcan.h"
+
+#include <string.h>
+
+#define FRAME8_CYCLES ((47 + 64) * (VCAN_CPU_HZ / VCAN_DEFAULT_BITRATE)) // 1Mbps下8字节帧的传输时间
+#define MS_CYCLES (VCAN_CPU_HZ / 1000)
+
+/* 模拟节点收到的报文 */
+typedef struct {
+    uint16_t id[64];
+    uint8_t data[64][8];
+    uint8_t count;
+} Recorder_t;
+
+/* 设备回调记录 */
+typedef struct {
+    uint32_t count;
+    uint8_t data[8];
+    uint64_t stamp;
+    char task[16];
+} DeviceLog_t;
+
+static void RecordRx(void *ctx, uint16_t std_id, const uint8_t *data, uint8_t dlc)
+{
+    Recorder_t *rec = ctx;
+    if (rec->count < 64) {
+        rec->id[rec->count] = std_id;
+        memcpy(rec->data[rec->count], data, dlc);
+        rec->count++;
+    }
+}
+
+static void DeviceRx(Can_Device *dev)
+{
+    DeviceLog_t *log = dev->id;
+    log->count++;
+    memcpy(log->data, dev->rx_buff, dev->rx_len);
+    log->stamp = dev->rx_stamp;
+    strncpy(log->task, pcTaskGetName(NULL), sizeof(log->task) - 1);
+}
+
+static Can_Device *Register(CAN_HandleTypeDef *hcan, uint32_t rx_id, DeviceLog_t *log)
+{
+    Can_Device_Init_Config_s config = {
+        .can_handle = hcan,
+        .tx_id = rx_id - 0x100,
+        .rx_id = rx_id,
+        .tx_mode = CAN_MODE_BLOCKING,
+        .rx_mode = CAN_MODE_IT,
+        .can_callback = DeviceRx,
+        .id = log,
+    };
+    return BSP_CAN_Device_Init(&config);
+}
+
+static void NodeSend(CAN_HandleTypeDef *hcan, int8_t node, uint16_t id)
+{
+    uint8_t data[8] = {(uint8_t)id, (uint8_t)(id >> 8), 1, 2, 3, 4, 5, 6};
+    VCAN_NodeSend(hcan, node, id, data, 8);
+}
+
+static uint8_t SendFrame(CAN_HandleTypeDef *hcan, uint16_t id)
+{
+    CAN_TxHeaderTypeDef header = {.StdId = id, .IDE = CAN_ID_STD, .RTR = CAN_RTR_DATA};
+    uint8_t data[8] = {(uint8_t)id};
+    uint32_t mailbox;
+    return CAN_SendMessage_hcan(hcan, &header, data, &mailbox, 8);
+}
+
+static DeviceLog_t can1_log[7];
+static DeviceLog_t can2_log;
+static Can_Device *can1_dev[7];
+static int8_t can1_node;
+static int8_t can2_node;
+static Recorder_t can1_rec;
+static Recorder_t can2_rec;
+
+/* 0x201-0x204打包为掩码组,其余为列表组,未注册的ID在过滤器处就被丢弃,不进入接收中断 */
+static void TestFilters(void)
+{
+    static const uint16_t ids[7] = {0x201, 0x202, 0x203, 0x204, 0x205, 0x20A, 0x100};
+    static const uint16_t others[5] = {0x206, 0x207, 0x209, 0x300, 0x101};
+    for (uint8_t i = 0; i < 7; i++) {
+        can1_dev[i] = Register(&hcan1, ids[i], &can1_log[i]);
+        TEST_CHECK(can1_dev[i] != NULL);
+    }
+    TEST_CHECK(Register(&hcan2, 0x201, &can2_log) != NULL); // 另一条总线上可以有相同的ID
+
+    for (uint8_t i = 0; i < 5; i++) {
+        NodeSend(&hcan1, can1_node, others[i]);
+    }
+    for (uint8_t i = 0; i < 7; i++) {
+        NodeSend(&hcan1, can1_node, ids[i]);
+    }
+    VCAN_Advance(10 * MS_CYCLES);
+
+    for (uint8_t i = 0; i < 7; i++) {
+        TEST_CHECK(can1_log[i].count == 1);
+        TEST_CHECK(can1_log[i].data[0] == (uint8_t)ids[i] && can1_log[i].data[1] == (uint8_t)(ids[i] >> 8));
+    }
+    TEST_CHECK(can2_log.count == 0);
+    CAN_RxStats_t rx;
+    CAN_GetRxStats(&hcan1, &rx);
+    TEST_CHECK(rx.rx_count == 7);
+    TEST_CHECK(VCAN_GetRxOverrun(&hcan1, CAN_RX_FIFO0) == 0 && VCAN_GetRxOverrun(&hcan1, CAN_RX_FIFO1) == 0);
+
+    NodeSend(&hcan2, can2_node, 0x201);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(can2_log.count == 1);
+    TEST_CHECK(can1_log[0].count == 1);
+
+    // 注销后重新打包,该ID不再通过过滤器
+    BSP_CAN_Device_DeInit(can1_dev[6]);
+    NodeSend(&hcan1, can1_node, 0x100);
+    VCAN_Advance(MS_CYCLES);
+    CAN_GetRxStats(&hcan1, &rx);
+    TEST_CHECK(rx.rx_count == 7);
+    TEST_CHECK(can1_log[6].count == 1);
+}
+
+/* 3个邮箱按请求顺序发出,排队的报文在邮箱空出时按入队顺序补充,队列满时丢弃 */
+static void TestTxQueue(void)
+{
+    static const uint16_t direct[3] = {0x300, 0x200, 0x100};
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_CHECK(SendFrame(&hcan2, direct[i]) == HAL_OK);
+    }
+    for (uint8_t i = 0; i < CAN_TX_QUEUE_LEN + 2; i++) {
+        uint8_t ret = SendFrame(&hcan2, (uint16_t)(0x7F0 - 0x10 * i));
+        TEST_CHECK(ret == (i < CAN_TX_QUEUE_LEN ? HAL_OK : HAL_BUSY));
+    }
+    CAN_TxStats_t tx;
+    CAN_GetTxStats(&hcan2, &tx);
+    TEST_CHECK(tx.queue_len == CAN_TX_QUEUE_LEN && tx.queue_max == CAN_TX_QUEUE_LEN);
+    TEST_CHECK(tx.drop_count == 2);
+
+    VCAN_Advance(10 * MS_CYCLES);
+    TEST_CHECK(can2_rec.count == 3 + CAN_TX_QUEUE_LEN);
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_CHECK(can2_rec.id[i] == direct[i]);
+    }
+    for (uint8_t i = 3; i < can2_rec.count; i++) {
+        TEST_CHECK(can2_rec.id[i] == 0x7F0 - 0x10 * (i - 3));
+        TEST_CHECK(can2_rec.data[i][0] == (uint8_t)can2_rec.id[i]);
+    }
+    CAN_GetTxStats(&hcan2, &tx);
+    TEST_CHECK(tx.queue_len == 0 && tx.tx_count == 3 + CAN_TX_QUEUE_LEN);
+}
+
+/* 邮箱满后排队的报文保持调度的顺序(priority, 暂存顺序),而不是按StdId重新排序 */
+static void TestSchedOrder(void)
+{
+    static const uint16_t ids[6] = {0x100, 0x200, 0x300, 0x050, 0x400, 0x150};
+    static const uint8_t prio[6] = {2, 0, 1, 2, 0, 1};
+    static const uint16_t expect[6] = {0x200, 0x400, 0x300, 0x150, 0x100, 0x050};
+    uint8_t data[8] = {0};
+    uint8_t before = can2_rec.count;
+    for (uint8_t i = 0; i < 6; i++) {
+        TEST_CHECK(CAN_SchedSend_hcan(&hcan2, ids[i], data, 8, prio[i], 0) == HAL_OK);
+    }
+    CAN_SchedFlush();
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(can2_rec.count == before + 6);
+    for (uint8_t i = 0; i < 6; i++) {
+        TEST_CHECK(can2_rec.id[before + i] == expect[i]);
+    }
+    CAN_SchedStats_t stats;
+    CAN_GetSchedStats(&hcan2, &stats);
+    TEST_CHECK(stats.sent == 6);
+    CAN_GetSchedStats(&hcan1, &stats);
+    TEST_CHECK(stats.sent == 0);
+}
+
+/* 回调在解码任务中执行,时间戳是接收中断的时刻,即帧传输结束的时刻 */
+static void TestDeferredRx(void)
+{
+    DeviceLog_t *log = &can1_log[4]; // 0x205
+    uint32_t before = log->count;
+    uint64_t start = VCAN_Now();
+    NodeSend(&hcan1, can1_node, 0x205);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(log->count == before + 1);
+    TEST_CHECK(log->stamp == start + FRAME8_CYCLES);
+    TEST_CHECK(strcmp(log->task, "canRxTask") == 0);
+
+    // 连续的报文: 每帧之间解码任务都能取完,环形缓冲区和FIFO都不会溢出
+    for (uint8_t i = 0; i < 40; i++) {
+        NodeSend(&hcan1, can1_node, 0x205);
+    }
+    VCAN_Advance(10 * MS_CYCLES);
+    TEST_CHECK(log->count == before + 41);
+    CAN_RxStats_t rx;
+    CAN_GetRxStats(&hcan1, &rx);
+    TEST_CHECK(rx.ring_overflow == 0);
+    TEST_CHECK(VCAN_GetRxOverrun(&hcan1, CAN_RX_FIFO0) == 0 && VCAN_GetRxOverrun(&hcan1, CAN_RX_FIFO1) == 0);
+}
+
+/* HAL每次错误中断都报告所有仍然置位的状态,只在进入时计数;退出时没有中断,由CAN_ErrorStateSync()清除 */
+static void TestErrorEdges(void)
+{
+    CAN_ErrStats_t err;
+    VCAN_SetErrorCounters(&hcan1, 100, 0, 3);
+    VCAN_SetErrorCounters(&hcan1, 110, 0, 3);
+    CAN_GetErrStats(&hcan1, &err);
+    TEST_CHECK(err.warning_count == 1 && err.passive_count == 0);
+
+    VCAN_SetErrorCounters(&hcan1, 130, 0, 3);
+    CAN_GetErrStats(&hcan1, &err);
+    TEST_CHECK(err.warning_count == 1 && err.passive_count == 1);
+
+    // 回落到警告线以下,同步之后再次进入才会被计数
+    VCAN_SetErrorCounters(&hcan1, 90, 0, 0);
+    VCAN_SetErrorCounters(&hcan1, 100, 0, 3);
+    CAN_GetErrStats(&hcan1, &err);
+    TEST_CHECK(err.warning_count == 1);
+    VCAN_SetErrorCounters(&hcan1, 90, 0, 0);
+    CAN_ErrorStateSync(&hcan1);
+    CAN_GetErrStats(&hcan1, &err);
+    TEST_CHECK(err.esr_state == 0);
+    VCAN_SetErrorCounters(&hcan1, 100, 0, 3);
+    CAN_GetErrStats(&hcan1, &err);
+    TEST_CHECK(err.warning_count == 2 && err.passive_count == 1);
+
+    // 离线: 邮箱中的报文发不出去
+    VCAN_SetErrorCounters(&hcan1, 256, 0, 3);
+    CAN_GetErrStats(&hcan1, &err);
+    TEST_CHECK(err.warning_count == 2 && err.passive_count == 2 && err.busoff_count == 1);
+    TEST_CHECK((err.last_error & (HAL_CAN_ERROR_EWG | HAL_CAN_ERROR_EPV | HAL_CAN_ERROR_BOF)) ==
+               (HAL_CAN_ERROR_EWG | HAL_CAN_ERROR_EPV | HAL_CAN_ERROR_BOF));
+    uint8_t before = can1_rec.count;
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_CHECK(SendFrame(&hcan1, (uint16_t)(0x111 + i)) == HAL_OK);
+    }
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(can1_rec.count == before);
+
+    // 恢复: 邮箱中离线前的报文被中止,队列中的报文补充进邮箱后发出
+    TEST_CHECK(CAN_BusRecover(&hcan1) == HAL_OK);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(can1_rec.count == before + 1);
+    TEST_CHECK(can1_rec.id[before] == 0x114);
+    CAN_ErrorStateSync(&hcan1);
+    CAN_GetErrStats(&hcan1, &err);
+    TEST_CHECK(err.recover_count == 1 && err.busoff_count == 1 && err.esr_state == 0);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    VCAN_Reset();
+    can1_node = VCAN_AttachNode(&hcan1, RecordRx, &can1_rec);
+    can2_node = VCAN_AttachNode(&hcan2, RecordRx, &can2_rec);
+
+    TestFilters();
+    TestTxQueue();
+    TestSchedOrder();
+    TestDeferredRx();
+    TestErrorEdges();
+
+    return HOST_TEST_RESULT();
+}
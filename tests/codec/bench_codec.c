@@ -0,0 +1,50 @@
+/**
+ * @file bench_codec.c
+ * @brief 生成的编解码在主机上每次编码+解码的耗时,用于修改gen_codec.py前后对比
+ * @note 只打印结果,不判断快慢.主机的数字不能换算到板上,只用来比较同一台机器上的两个版本
+ *       ./bench_codec [次数]
+ */
+
+#include "board_msg_codec.h"
+#include "vcom_msg_codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static volatile uint32_t sink; // 防止编译器把循环优化掉
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#define BENCH(name, type, prefix, len, init)                                              \
+    do {                                                                                  \
+        type in = init, out;                                                              \
+        uint8_t buf[len];                                                                 \
+        double start = NowNs();                                                           \
+        for (uint32_t i = 0; i < n; i++) {                                                \
+            prefix##_Encode(&in, buf);                                                    \
+            sink += prefix##_Decode(buf, len, &out);                                      \
+            buf[0] ^= (uint8_t)i; /* 让每次的输入不同 */                                  \
+        }                                                                                 \
+        printf("%-22s %3d bytes %8.1f ns\n", name, len, (NowNs() - start) / n);         \
+    } while (0)
+
+int main(int argc, char **argv)
+{
+    uint32_t n = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1000000;
+
+    BENCH("BoardGimbalCmd", Chassis_Ctrl_Cmd_s, BoardGimbalCmd, BOARD_GIMBAL_CMD_LEN,
+          ((Chassis_Ctrl_Cmd_s){1000.0f, -250.0f, 3.3f, 12.34f, CHASSIS_ROTATE}));
+    BENCH("BoardChassisReferee", Chassis_referee_Upload_Data_s, BoardChassisReferee, BOARD_CHASSIS_REFEREE_LEN,
+          ((Chassis_referee_Upload_Data_s){1, 750, 1, 200, 1200, 4000, 4, 300}));
+    BENCH("SentrySend", struct Sentry_Send_s, SentrySend, SENTRY_SEND_LEN,
+          ((struct Sentry_Send_s){500, 1, 100, 1500, 5000, 4, 300, 2, 0.1f, 0.2f, 0.3f}));
+    BENCH("VcomRecv", struct Recv_s, VcomRecv, VCOM_RECV_LEN,
+          ((struct Recv_s){1, 0.5f, -0.5f, 3.0f, 2, 1.0f, 0.0f, -1.0f}));
+    return 0;
+}
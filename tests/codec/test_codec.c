@@ -0,0 +1,198 @@
+/**
+ * @file test_codec.c
+ * @brief gen_codec.py生成的编解码: 定点字段往返误差不超过半个分辨率(整数成员再加0.5的取整),超出范围限幅,NaN按offset编码,
+ *        vcom的两条消息与原先packed结构体的字节布局完全一致,帧头帧尾或长度不对时解码失败
+ * @note 使用构建时由gen_codec.py重新生成的代码,与仓库中提交的文件是否一致由codec_up_to_date测试检查
+ */
+
+#include "board_msg_codec.h"
+#include "host_test.h"
+#include "vcom_msg_codec.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 引入描述文件之前vcom.c直接发送的结构体 */
+#pragma pack(1)
+struct Legacy_Sentry_Send_s {
+    uint8_t header;
+    uint16_t projectile_allowance_17mm;
+    uint8_t power_management_shooter_output;
+    uint16_t current_hp_percent;
+    uint16_t outpost_HP;
+    uint16_t base_HP;
+    uint8_t game_progess;
+    uint16_t game_time;
+    uint8_t mode;
+    float roll;
+    float pitch;
+    float yaw;
+    uint8_t end;
+};
+
+struct Legacy_Recv_s {
+    uint8_t header;
+    uint8_t fire_advice;
+    float pitch;
+    float yaw;
+    float distance;
+    uint8_t nav_state;
+    float vx;
+    float vy;
+    float wz;
+    uint8_t tail;
+};
+#pragma pack()
+
+_Static_assert(sizeof(struct Legacy_Sentry_Send_s) == SENTRY_SEND_LEN, "SentrySend length");
+_Static_assert(sizeof(struct Legacy_Recv_s) == VCOM_RECV_LEN, "VcomRecv length");
+
+static Chassis_Ctrl_Cmd_s GimbalRoundTrip(Chassis_Ctrl_Cmd_s in)
+{
+    uint8_t buf[BOARD_GIMBAL_CMD_LEN];
+    Chassis_Ctrl_Cmd_s out;
+    TEST_CHECK(BoardGimbalCmd_Encode(&in, buf) == BOARD_GIMBAL_CMD_LEN);
+    TEST_CHECK(BoardGimbalCmd_Decode(buf, BOARD_GIMBAL_CMD_LEN, &out));
+    return out;
+}
+
+static Chassis_referee_Upload_Data_s RefereeRoundTrip(Chassis_referee_Upload_Data_s in)
+{
+    uint8_t buf[BOARD_CHASSIS_REFEREE_LEN];
+    Chassis_referee_Upload_Data_s out;
+    TEST_CHECK(BoardChassisReferee_Encode(&in, buf) == BOARD_CHASSIS_REFEREE_LEN);
+    TEST_CHECK(BoardChassisReferee_Decode(buf, BOARD_CHASSIS_REFEREE_LEN, &out));
+    return out;
+}
+
+static void TestBoardGimbalCmd(void)
+{
+    uint32_t bad = 0;
+    for (int32_t v = -32767; v <= 32767; v += 7) {
+        Chassis_Ctrl_Cmd_s in = {.vx = (float)v + 0.3f, .vy = (float)-v - 0.3f};
+        Chassis_Ctrl_Cmd_s out = GimbalRoundTrip(in);
+        bad += fabsf(out.vx - in.vx) > 0.5f || fabsf(out.vy - in.vy) > 0.5f;
+    }
+    for (float a = -327.68f; a <= 327.67f; a += 0.037f) {
+        Chassis_Ctrl_Cmd_s in = {.offset_angle = a};
+        bad += fabsf(GimbalRoundTrip(in).offset_angle - a) > 0.005f + 1e-4f;
+    }
+    for (float w = -12.8f; w <= 12.7f; w += 0.013f) {
+        Chassis_Ctrl_Cmd_s in = {.wz = w};
+        bad += fabsf(GimbalRoundTrip(in).wz - w) > 0.05f + 1e-5f;
+    }
+    for (uint32_t m = CHASSIS_ZERO_FORCE; m <= CHASSIS_AUTO_MODE; m++) {
+        Chassis_Ctrl_Cmd_s in = {.chassis_mode = (chassis_mode_e)m};
+        bad += GimbalRoundTrip(in).chassis_mode != in.chassis_mode;
+    }
+    TEST_CHECK(bad == 0);
+
+    // 限幅和NaN
+    Chassis_Ctrl_Cmd_s in = {.vx = 1e6f, .vy = -1e6f, .offset_angle = NAN, .wz = 100.0f};
+    Chassis_Ctrl_Cmd_s out = GimbalRoundTrip(in);
+    TEST_CHECK(out.vx == 32767.0f && out.vy == -32768.0f);
+    TEST_CHECK(out.offset_angle == 0.0f);
+    TEST_CHECK(fabsf(out.wz - 12.7f) < 1e-5f);
+
+    uint8_t buf[BOARD_GIMBAL_CMD_LEN] = {0};
+    TEST_CHECK(!BoardGimbalCmd_Decode(buf, BOARD_GIMBAL_CMD_LEN - 1, &out));
+}
+
+static void TestBoardChassisReferee(void)
+{
+    uint32_t bad = 0;
+    for (uint16_t v = 0; v <= 1000; v++) {
+        Chassis_referee_Upload_Data_s in = {.projectile_allowance_17mm = v};
+        bad += abs(RefereeRoundTrip(in).projectile_allowance_17mm - v) > 4; // 分辨率1000/127
+    }
+    for (uint16_t v = 0; v <= 400; v++) {
+        Chassis_referee_Upload_Data_s in = {.current_hp_percent = v};
+        bad += abs(RefereeRoundTrip(in).current_hp_percent - v) > 2;
+    }
+    for (uint16_t v = 0; v <= 1500; v++) {
+        Chassis_referee_Upload_Data_s in = {.outpost_HP = v};
+        bad += abs(RefereeRoundTrip(in).outpost_HP - v) > 1;
+    }
+    for (uint16_t v = 0; v <= 5000; v++) {
+        Chassis_referee_Upload_Data_s in = {.base_HP = v};
+        bad += abs(RefereeRoundTrip(in).base_HP - v) > 1;
+    }
+    for (uint16_t v = 0; v <= 511; v++) {
+        Chassis_referee_Upload_Data_s in = {.Robot_Color = v & 1, .power_management_shooter_output = (v >> 1) & 1,
+                                            .game_progess = v & 7, .game_time = v};
+        Chassis_referee_Upload_Data_s out = RefereeRoundTrip(in);
+        bad += out.Robot_Color != in.Robot_Color || out.power_management_shooter_output != in.power_management_shooter_output;
+        bad += out.game_progess != in.game_progess || out.game_time != in.game_time;
+    }
+    TEST_CHECK(bad == 0);
+
+    // 各字段互不干扰,超出范围限幅
+    Chassis_referee_Upload_Data_s in = {1, 5000, 1, 999, 1500, 5000, 7, 420};
+    Chassis_referee_Upload_Data_s out = RefereeRoundTrip(in);
+    TEST_CHECK(out.Robot_Color == 1 && out.power_management_shooter_output == 1);
+    TEST_CHECK(out.projectile_allowance_17mm == 1000 && out.current_hp_percent == 400);
+    TEST_CHECK(out.outpost_HP == 1500 && out.base_HP == 5000);
+    TEST_CHECK(out.game_progess == 7 && out.game_time == 420);
+}
+
+static void TestSentrySend(void)
+{
+    struct Sentry_Send_s in = {
+        .projectile_allowance_17mm = 0x1234,
+        .power_management_shooter_output = 1,
+        .current_hp_percent = 0xBEEF,
+        .outpost_HP = 1500,
+        .base_HP = 5000,
+        .game_progess = 4,
+        .game_time = 300,
+        .mode = 0x5A,
+        .roll = 0.125f,
+        .pitch = -3.5f,
+        .yaw = 1e-20f,
+    };
+    struct Legacy_Sentry_Send_s legacy = {
+        0xAA, in.projectile_allowance_17mm, in.power_management_shooter_output, in.current_hp_percent, in.outpost_HP,
+        in.base_HP, in.game_progess, in.game_time, in.mode, in.roll, in.pitch, in.yaw, 0x0D,
+    };
+    uint8_t buf[SENTRY_SEND_LEN];
+    TEST_CHECK(SentrySend_Encode(&in, buf) == SENTRY_SEND_LEN);
+    TEST_CHECK(memcmp(buf, &legacy, SENTRY_SEND_LEN) == 0);
+
+    struct Sentry_Send_s out;
+    TEST_CHECK(SentrySend_Decode(buf, SENTRY_SEND_LEN, &out));
+    TEST_CHECK(out.projectile_allowance_17mm == in.projectile_allowance_17mm && out.current_hp_percent == in.current_hp_percent);
+    TEST_CHECK(out.power_management_shooter_output == in.power_management_shooter_output && out.mode == in.mode);
+    TEST_CHECK(out.outpost_HP == in.outpost_HP && out.base_HP == in.base_HP);
+    TEST_CHECK(out.game_progess == in.game_progess && out.game_time == in.game_time);
+    TEST_CHECK(out.roll == in.roll && out.pitch == in.pitch && out.yaw == in.yaw);
+    buf[SENTRY_SEND_LEN - 1] = 0;
+    TEST_CHECK(!SentrySend_Decode(buf, SENTRY_SEND_LEN, &out));
+}
+
+static void TestVcomRecv(void)
+{
+    struct Legacy_Recv_s legacy = {0xFF, 1, 0.5f, -180.0f, 7.25f, 3, 1.5f, -2.0f, 3.14159f, 0x0D};
+    struct Recv_s out;
+    TEST_CHECK(VcomRecv_Decode((const uint8_t *)&legacy, VCOM_RECV_LEN, &out));
+    TEST_CHECK(out.fire_advice == 1 && out.nav_state == 3);
+    TEST_CHECK(out.pitch == legacy.pitch && out.yaw == legacy.yaw && out.distance == legacy.distance);
+    TEST_CHECK(out.vx == legacy.vx && out.vy == legacy.vy && out.wz == legacy.wz);
+
+    uint8_t buf[VCOM_RECV_LEN];
+    TEST_CHECK(VcomRecv_Encode(&out, buf) == VCOM_RECV_LEN);
+    TEST_CHECK(memcmp(buf, &legacy, VCOM_RECV_LEN) == 0);
+
+    buf[0] = 0xFE;
+    TEST_CHECK(!VcomRecv_Decode(buf, VCOM_RECV_LEN, &out));
+    TEST_CHECK(!VcomRecv_Decode((const uint8_t *)&legacy, VCOM_RECV_LEN + 1, &out));
+}
+
+int main(void)
+{
+    TestBoardGimbalCmd();
+    TestBoardChassisReferee();
+    TestSentrySend();
+    TestVcomRecv();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,164 @@
+/**
+ * @file test_dwt.c
+ * @brief dwt.c的64位周期数: CYCCNT每半圈由DWT_TimerUpdate()推进一次epoch,读取时按CYCCNT最高位补上还没推进的半圈.
+ *        覆盖DWT_Extend()在每个半圈边界前后用旧的和新的epoch都得到正确的值,
+ *        模拟5小时的运行(TIM14中断偶尔推迟10s)每次DWT_GetCycle64()都与参考值相同且单调,
+ *        DWT_CycleToNs()的误差,微秒、毫秒和DWT_GetTime()的换算,以及DWT_GetDeltaT()和DWT_Delay()跨过CYCCNT回绕
+ * @note dwt.c由本文件直接包含,DWT和CoreDebug换成内存中的替身,主机测试的其他部分使用的host_dwt.c不参与.
+ *       dwt_step不为0时每次访问DWT寄存器CYCCNT前进dwt_step,用于DWT_Delay()中的等待
+ */
+
+#include "stm32f407xx.h"
+
+static DWT_Type dwt_regs;
+static CoreDebug_Type core_debug_regs;
+static uint32_t dwt_step;
+
+static DWT_Type *TestDwt(void)
+{
+    dwt_regs.CYCCNT += dwt_step;
+    return &dwt_regs;
+}
+
+#undef DWT
+#undef CoreDebug
+#define DWT (TestDwt())
+#define CoreDebug (&core_debug_regs)
+
+#include "dwt.c"
+#include "host_test.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define CPU_MHZ 168u
+#define CPU_HZ (CPU_MHZ * 1000000u)
+#define HALF_WRAP (1ull << 31)
+
+/* 参考的64位周期数,CYCCNT为它的低32位 */
+static uint64_t ref;
+
+static void SetCycle(uint64_t cycle)
+{
+    ref = cycle;
+    dwt_regs.CYCCNT = (uint32_t)cycle;
+}
+
+static uint64_t Rand64(uint64_t max)
+{
+    uint64_t r = ((uint64_t)rand() << 31) ^ (uint64_t)rand();
+    return r % max;
+}
+
+/* 半圈边界前后的CYCCNT与推进前后的epoch组合 */
+static void TestExtend(void)
+{
+    for (uint64_t half = 1; half < 64; half++) {
+        uint64_t boundary = half * HALF_WRAP;
+        for (int64_t d = -3; d <= 3; d++) {
+            uint64_t cycle = boundary + d;
+            uint32_t epoch = (uint32_t)(cycle >> 31); // 已推进
+            TEST_CHECK(DWT_Extend(epoch, (uint32_t)cycle) == cycle);
+            if (d >= 0) // CYCCNT刚过边界,TIM14中断还没推进
+                TEST_CHECK(DWT_Extend(epoch - 1, (uint32_t)cycle) == cycle);
+        }
+    }
+    // epoch的最后一个半圈(约1700年后),高32位为0x7FFFFFFF
+    uint64_t cycle = 0xFFFFFFFFull << 31;
+    TEST_CHECK(DWT_Extend(0xFFFFFFFEu, (uint32_t)(cycle - 1)) == cycle - 1);
+    TEST_CHECK(DWT_Extend(0xFFFFFFFEu, (uint32_t)cycle) == cycle);
+}
+
+/* 模拟5小时: 每步前进0~0.1s,TIM14中断通常每步都来,偶尔推迟到10s之后 */
+static void TestLongRun(void)
+{
+    const uint64_t end = 5ull * 3600 * CPU_HZ, max_delay = 10ull * CPU_HZ;
+    uint64_t last = 0, last_update = 0, delay = 0, max_err = 0;
+    uint32_t mismatches = 0, updates_late = 0;
+    DWT_Init(CPU_MHZ);
+    SetCycle(0);
+    while (ref < end) {
+        SetCycle(ref + 1 + Rand64(CPU_HZ / 10));
+        if (delay == 0 && rand() % 100 == 0) {
+            delay = max_delay - Rand64(CPU_HZ); // 9~10s内不推进
+            updates_late++;
+        }
+        if (ref - last_update >= delay) {
+            DWT_TimerUpdate();
+            last_update = ref;
+            delay = 0;
+        }
+        uint64_t now = DWT_GetCycle64();
+        mismatches += now != ref || now < last;
+        last = now;
+
+        uint64_t exact = (uint64_t)((unsigned __int128)ref * 1000u / CPU_MHZ);
+        uint64_t ns = DWT_CycleToNs(ref);
+        uint64_t err = ns > exact ? ns - exact : exact - ns;
+        if (err > max_err)
+            max_err = err;
+    }
+    TEST_CHECK(mismatches == 0);
+    TEST_CHECK(updates_late > 10);
+    // 每圈的纳秒数舍入误差不超过0.5ns,圈内的换算误差不超过1ns
+    TEST_CHECK(max_err <= 1 + (end >> 32) / 2);
+    printf("5 h simulated, %u late ticks, CycleToNs max error %llu ns\n", updates_late, (unsigned long long)max_err);
+}
+
+/* 从0开始按不超过半圈的步长推进到cycle,每步都推进epoch */
+static void RunTo(uint64_t cycle)
+{
+    DWT_Init(CPU_MHZ);
+    SetCycle(0);
+    while (ref < cycle) {
+        SetCycle(ref + HALF_WRAP / 2 < cycle ? ref + HALF_WRAP / 2 : cycle);
+        DWT_TimerUpdate();
+    }
+}
+
+static void TestConversions(void)
+{
+    TEST_CHECK((core_debug_regs.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) && (dwt_regs.CTRL & DWT_CTRL_CYCCNTENA_Msk));
+
+    // 约3小时25分,已经回绕多次
+    const uint64_t cycle = 2065ull * CPU_HZ * 6 + 123456789ull;
+    RunTo(cycle);
+    TEST_CHECK(DWT_GetCycle64() == cycle);
+    TEST_CHECK(DWT_GetUs() == cycle / CPU_MHZ);
+    TEST_CHECK(DWT_GetMs() == cycle / (CPU_HZ / 1000));
+    TEST_CHECK(DWT_GetNs() == DWT_CycleToNs(cycle));
+    DWT_Time_t t = DWT_GetTime();
+    uint64_t us = cycle / CPU_MHZ;
+    TEST_CHECK(t.s == us / 1000000 && t.ms == (us / 1000) % 1000 && t.us == us % 1000);
+    TEST_CHECK(DWT_GetTimeline_us() == us);
+    double ms = cycle / (CPU_HZ / 1000.0);
+    TEST_CHECK(fabs(DWT_Cycle64ToMs(cycle) - ms) < ms * 1e-6);
+    TEST_CHECK(fabsf(DWT_CycleToUs(CPU_MHZ * 250) - 250.0f) < 1e-3f);
+}
+
+/* CYCCNT回绕时的时间差和延时 */
+static void TestWrap(void)
+{
+    uint32_t last = 0xFFFFFF00u;
+    dwt_regs.CYCCNT = 0x100u;
+    TEST_CHECK(fabsf(DWT_GetDeltaT(&last) - 0x200 / (float)CPU_HZ) < 1e-9f && last == 0x100u);
+    last = 0xFFFFFF00u;
+    TEST_CHECK(fabs(DWT_GetDeltaT64(&last) - 0x200 / (double)CPU_HZ) < 1e-12);
+
+    dwt_regs.CYCCNT = 0xFFFF0000u;
+    dwt_step = 1000;
+    DWT_Delay(0.001f);
+    dwt_step = 0;
+    uint32_t waited = dwt_regs.CYCCNT - 0xFFFF0000u;
+    TEST_CHECK(waited >= CPU_HZ / 1000 && waited <= CPU_HZ / 1000 + 3 * 1000);
+}
+
+int main(void)
+{
+    srand(1);
+    TestExtend();
+    TestLongRun();
+    TestConversions();
+    TestWrap();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,146 @@
+/**
+ * @file test_dwt_prof.c
+ * @brief dwt_prof.c的耗时统计: 桶序号随周期数单调且连续到2^25,每个值落在prof_view.py按桶序号算出的区间内,
+ *        DWT_ProfRecord()的次数、最小/最大值、总和和直方图,DWT_ProfReset()清零,
+ *        以及输出任务收到'r'后经RTT通道发出的文本格式,输出后清零
+ * @note dwt_prof.c由本文件直接包含并打开DWT_PROF_ENABLE,以便检查静态的DWT_ProfBucket().
+ *       DWT_GetCycle()等使用host_dwt.c
+ */
+
+#define DWT_PROF_ENABLE 1
+#include "dwt_prof.c"
+#include "host_rtos.h"
+#include "host_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 替身 */
+uint32_t SystemCoreClock = 168000000u;
+
+/* 桶的下界,与tools/profiler/prof_view.py中的bucket_low()相同 */
+static uint32_t BucketLow(uint32_t idx)
+{
+    if (idx < (1u << (DWT_PROF_SUB_BITS + 1)))
+        return idx;
+    uint32_t msb = (idx >> DWT_PROF_SUB_BITS) + DWT_PROF_SUB_BITS - 1;
+    uint32_t mant = (idx & ((1u << DWT_PROF_SUB_BITS) - 1)) | (1u << DWT_PROF_SUB_BITS);
+    return mant << (msb - DWT_PROF_SUB_BITS);
+}
+
+static void TestBuckets(void)
+{
+    uint32_t last = 0, errors = 0;
+    for (uint32_t cycles = 0; cycles < (1u << 25); cycles++) {
+        uint32_t idx = DWT_ProfBucket(cycles);
+        errors += idx != last && idx != last + 1; // 单调且不跳过桶
+        errors += cycles < BucketLow(idx);
+        errors += idx < DWT_PROF_BUCKETS - 1 && cycles >= BucketLow(idx + 1);
+        last = idx;
+    }
+    TEST_CHECK(errors == 0);
+    TEST_CHECK(last == DWT_PROF_BUCKETS - 1);
+    TEST_CHECK(DWT_ProfBucket(1u << 25) == DWT_PROF_BUCKETS - 1);
+    TEST_CHECK(DWT_ProfBucket(UINT32_MAX) == DWT_PROF_BUCKETS - 1);
+    // 分辨率: 8个周期之后每个桶的宽度不超过下界的25%
+    for (uint32_t idx = 8; idx < DWT_PROF_BUCKETS - 1; idx++)
+        TEST_CHECK(BucketLow(idx + 1) - BucketLow(idx) <= BucketLow(idx) / 4);
+}
+
+static void TestRecord(void)
+{
+    static const uint32_t samples[] = {1000, 3, 250000, 1000, 1u << 30};
+    DWT_Prof_Stat_t stat;
+    uint64_t sum = 0;
+    DWT_ProfReset();
+    for (uint8_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        DWT_ProfRecord(PROF_PID_CALCULATE, samples[i]);
+        sum += samples[i];
+    }
+    TEST_CHECK(__get_PRIMASK() == 0);
+
+    DWT_ProfGet(PROF_PID_CALCULATE, &stat);
+    TEST_CHECK(stat.count == 5 && stat.min == 3 && stat.max == 1u << 30 && stat.sum == sum);
+    TEST_CHECK(stat.hist[3] == 1 && stat.hist[DWT_ProfBucket(1000)] == 2);
+    TEST_CHECK(stat.hist[DWT_ProfBucket(250000)] == 1 && stat.hist[DWT_PROF_BUCKETS - 1] == 1);
+    DWT_ProfGet(PROF_QEKF_UPDATE, &stat);
+    TEST_CHECK(stat.count == 0);
+
+    // 第一次记录的值同时是最小值,即使比清零后的0大
+    DWT_ProfReset();
+    DWT_ProfRecord(PROF_PID_CALCULATE, 500);
+    DWT_ProfGet(PROF_PID_CALCULATE, &stat);
+    TEST_CHECK(stat.count == 1 && stat.min == 500 && stat.max == 500 && stat.sum == 500);
+    DWT_ProfReset();
+    DWT_ProfGet(PROF_PID_CALCULATE, &stat);
+    TEST_CHECK(stat.count == 0 && stat.max == 0 && stat.hist[DWT_ProfBucket(500)] == 0);
+}
+
+/* 下行发送'r',读取任务输出的一次完整统计 */
+static unsigned ReadDump(char *text, unsigned size)
+{
+    unsigned len = 0;
+    // 下行缓冲区由输出任务开始运行时配置
+    for (int i = 0; i < 100 && _SEGGER_RTT.aDown[DWT_PROF_RTT_CHANNEL].pBuffer == NULL; i++)
+        osDelay(10);
+    SEGGER_RTT_WriteDownBuffer(DWT_PROF_RTT_CHANNEL, "r", 1);
+    for (int i = 0; i < 200 && !strstr(text, "#end\r\n"); i++) {
+        osDelay(10);
+        len += SEGGER_RTT_ReadUpBuffer(DWT_PROF_RTT_CHANNEL, text + len, size - 1 - len);
+        text[len] = '\0';
+    }
+    return len;
+}
+
+static void TestDump(void)
+{
+    static char text[4096];
+    DWT_Prof_Stat_t stat;
+
+    DWT_ProfInit();
+    TEST_CHECK(prof_task_handle != NULL);
+    TEST_CHECK(prof_overhead < 1000);
+    for (uint32_t i = 0; i < 90; i++)
+        DWT_ProfRecord(PROF_CAN_RX_ISR, 100);
+    for (uint32_t i = 0; i < 10; i++)
+        DWT_ProfRecord(PROF_CAN_RX_ISR, 5000);
+
+    ReadDump(text, sizeof(text));
+    fputs(text, stdout);
+    TEST_CHECK(strstr(text, "#end\r\n") != NULL);
+
+    unsigned mhz, overhead, window, sites;
+    TEST_CHECK(sscanf(text, "#prof mhz=%u overhead=%u window_ms=%u sites=%u", &mhz, &overhead, &window, &sites) == 4);
+    TEST_CHECK(mhz == 168 && overhead == prof_overhead && sites == PROF_SITE_COUNT);
+
+    // 每个测量点一行,没有记录的测量点直方图为空
+    unsigned lines = 0;
+    for (char *line = strstr(text, "site="); line; line = strstr(line + 1, "site="))
+        lines++;
+    TEST_CHECK(lines == PROF_SITE_COUNT);
+    TEST_CHECK(strstr(text, "site=PIDCalculate count=0 min=0 max=0 mean=0 hist=\r\n") != NULL);
+
+    char expected[128];
+    snprintf(expected, sizeof(expected), "site=CAN rx isr count=100 min=100 max=5000 mean=590 hist=%u:90,%u:10\r\n",
+             (unsigned)DWT_ProfBucket(100), (unsigned)DWT_ProfBucket(5000));
+    TEST_CHECK(strstr(text, expected) != NULL);
+
+    // 'r'在输出之后清零
+    for (int i = 0; i < 100; i++) {
+        DWT_ProfGet(PROF_CAN_RX_ISR, &stat);
+        if (stat.count == 0)
+            break;
+        osDelay(10);
+    }
+    TEST_CHECK(stat.count == 0);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    TestBuckets();
+    TestRecord();
+    TestDump();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,284 @@
+/**
+ * @file test_flash_kv.c
+ * @brief bsp_flash_kv.c的掉电保护: 在模拟的两个扇区上随机写入、删除参数,在任意一次擦除或写入字时掉电,
+ *        重新上电后每个key都是掉电前最后一次写成功的值(正在写的key也可以是新值);
+ *        整理写扇区头时掉电,重新上电后旧扇区的擦除在后台队列中,调度器启动前需要整理的写入返回忙,
+ *        不会整理到马上要被后台擦除的扇区中
+ * @note bsp_flash.c由本文件中的替身代替: flash是内存中的两个扇区,擦除中掉电时只擦了一半,写入字时掉电只写了部分位;
+ *       后台擦除放入队列后由测试决定什么时候执行.bsp_flash_kv.c的状态是静态变量,为了模拟重新上电直接包含进来
+ */
+
+#include "bsp_flash_kv.c"
+#include "host_rtos.h"
+#include "host_test.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+
+#define KEYS 20
+#define ITERATIONS 200000
+
+/* 替身 */
+static uint8_t flash[2][FLASHKV_SECTOR_SIZE];
+static long budget = -1; // 还能执行的擦除和写入字的次数,为0时掉电,-1表示不掉电
+static jmp_buf power_cut;
+static struct {
+    uint8_t pending;
+    uint32_t sector;
+    BSP_Flash_Callback callback;
+    void *arg;
+} erase_req;
+
+static uint8_t *FlashAt(uint32_t addr)
+{
+    return addr >= ADDR_FLASH_SECTOR_11 ? &flash[1][addr - ADDR_FLASH_SECTOR_11]
+                                        : &flash[0][addr - ADDR_FLASH_SECTOR_10];
+}
+
+static void Tick(void)
+{
+    if (budget == 0)
+        longjmp(power_cut, 1);
+    if (budget > 0)
+        budget--;
+}
+
+Flash_Status BSP_Flash_Erase(uint32_t sector, uint32_t pages)
+{
+    (void)pages;
+    uint8_t *f = flash[sector == FLASHKV_SECTOR_B];
+    Tick();
+    if (budget == 0) { // 擦除中掉电
+        memset(f, 0xFF, FLASHKV_SECTOR_SIZE / 2);
+        longjmp(power_cut, 1);
+    }
+    memset(f, 0xFF, FLASHKV_SECTOR_SIZE);
+    return FLASH_OK;
+}
+
+Flash_Status BSP_Flash_Write(uint32_t addr, uint8_t *data, uint16_t size)
+{
+    if (size % 4 || addr % 4)
+        return FLASH_ERR_PARAM;
+    for (uint16_t i = 0; i < size; i += 4) {
+        uint8_t *p = FlashAt(addr + i);
+        Tick();
+        if (budget == 0 && (rand() & 1)) { // 写入这个字时掉电,只写了部分位
+            for (uint8_t k = 0; k < 4; k++)
+                p[k] &= data[i + k] | (uint8_t)rand();
+            longjmp(power_cut, 1);
+        }
+        for (uint8_t k = 0; k < 4; k++)
+            p[k] &= data[i + k]; // flash只能把1写成0
+    }
+    return FLASH_OK;
+}
+
+Flash_Status BSP_Flash_Read(uint32_t addr, uint8_t *buf, uint16_t size)
+{
+    memcpy(buf, FlashAt(addr), size);
+    return FLASH_OK;
+}
+
+Flash_Status BSP_Flash_EraseAsync(uint32_t sector, BSP_Flash_Callback callback, void *arg)
+{
+    if (erase_req.pending)
+        return FLASH_ERR_BUSY;
+    erase_req.pending = 1;
+    erase_req.sector = sector;
+    erase_req.callback = callback;
+    erase_req.arg = arg;
+    return FLASH_OK;
+}
+
+/* flash任务执行队列中的擦除 */
+static void RunBackground(void)
+{
+    if (erase_req.pending) {
+        erase_req.pending = 0;
+        erase_req.callback(BSP_Flash_Erase(erase_req.sector, 1), erase_req.arg);
+    }
+}
+
+/* 重新上电,在调度器启动前初始化,RAM中的状态和后台队列都丢失 */
+static void PowerOn(void)
+{
+    budget = -1;
+    if (kv.mutex)
+        vSemaphoreDelete(kv.mutex);
+    memset(&kv, 0, sizeof(kv));
+    memset(&erase_req, 0, sizeof(erase_req));
+    Host_SchedulerSetRunning(0);
+    TEST_CHECK(FlashKV_Init() == FLASH_OK);
+}
+
+/* 模型: 每个key最后一次写成功的值 */
+static uint8_t model[KEYS][FLASHKV_VALUE_MAX_LEN];
+static uint16_t model_len[KEYS];
+
+static void ModelSet(uint16_t key, const uint8_t *value, uint16_t len)
+{
+    memcpy(model[key], value, len);
+    model_len[key] = len;
+}
+
+/* 检查所有key,正在写的key(in_flight)是新值时更新模型,返回不一致的key数 */
+static uint32_t Check(uint16_t in_flight, const uint8_t *value, uint16_t len)
+{
+    uint8_t buf[FLASHKV_VALUE_MAX_LEN];
+    uint32_t bad = 0;
+    for (uint16_t key = 1; key < KEYS; key++) {
+        uint16_t n = FlashKV_Get(key, buf, sizeof(buf));
+        uint8_t old = n == model_len[key] && memcmp(buf, model[key], n) == 0;
+        uint8_t new = key == in_flight && n == len && memcmp(buf, value, n) == 0;
+        if (!old && !new) {
+            fprintf(stderr, "key %u: len %u, expected %u\n", key, n, model_len[key]);
+            bad++;
+        } else if (!old) {
+            ModelSet(key, value, len);
+        }
+    }
+    return bad;
+}
+
+static Flash_Status Write(uint16_t key, const uint8_t *value, uint16_t len)
+{
+    return len ? FlashKV_Set(key, value, len) : FlashKV_Delete(key);
+}
+
+static void TestFormat(void)
+{
+    memset(flash, 0xFF, sizeof(flash));
+    flash[1][31] = 0xAA; // 扇区11中有旧版本直接写入的标定数据
+    PowerOn();
+    FlashKV_Stats_t stats;
+    FlashKV_GetStats(&stats);
+    TEST_CHECK(stats.formatted && stats.active_sector == FLASHKV_SECTOR_A && stats.keys == 0);
+    // 调度器启动前旧数据还在,可以迁移
+    TEST_CHECK(flash[1][31] == 0xAA && erase_req.pending && erase_req.sector == FLASHKV_SECTOR_B);
+    Host_SchedulerSetRunning(1);
+    RunBackground();
+    TEST_CHECK(flash[1][31] == 0xFF);
+}
+
+/* 随机写入和删除,随机掉电,偶尔在调度器启动前写入,偶尔执行后台擦除 */
+static void TestRandomPowerCuts(void)
+{
+    uint8_t value[FLASHKV_VALUE_MAX_LEN];
+    uint32_t bad = 0, cuts = 0, busy = 0;
+    for (uint32_t it = 0; it < ITERATIONS; it++) {
+        uint16_t key = (uint16_t)(1 + rand() % (KEYS - 1));
+        uint16_t len = rand() % 8 == 0 ? 0 : (uint16_t)(1 + rand() % (rand() % 4 ? 24 : FLASHKV_VALUE_MAX_LEN));
+        for (uint16_t i = 0; i < len; i++)
+            value[i] = (uint8_t)rand();
+        if (rand() % 400 == 0)
+            RunBackground();
+
+        budget = rand() % 50 == 0 ? rand() % 40 : -1;
+        if (setjmp(power_cut) == 0) {
+            Flash_Status ret = Write(key, value, len);
+            budget = -1;
+            if (ret == FLASH_OK)
+                ModelSet(key, value, len);
+            else if (ret == FLASH_ERR_BUSY)
+                busy++;
+            else
+                bad++;
+        } else {
+            cuts++;
+            PowerOn();
+            bad += Check(key, value, len);
+            // 调度器启动前写入,如BMI088_init()中保存标定结果,不能掉电
+            if (rand() % 2) {
+                key = (uint16_t)(1 + rand() % (KEYS - 1));
+                len = (uint16_t)(1 + rand() % FLASHKV_VALUE_MAX_LEN);
+                for (uint16_t i = 0; i < len; i++)
+                    value[i] = (uint8_t)rand();
+                Flash_Status ret = FlashKV_Set(key, value, len);
+                if (ret == FLASH_OK)
+                    ModelSet(key, value, len);
+                else if (ret == FLASH_ERR_BUSY)
+                    busy++;
+                else
+                    bad++;
+            }
+            Host_SchedulerSetRunning(1);
+        }
+        if (it % 1000 == 0) {
+            PowerOn();
+            Host_SchedulerSetRunning(1);
+            bad += Check(0, NULL, 0);
+        }
+    }
+    RunBackground();
+    bad += Check(0, NULL, 0);
+    PowerOn();
+    bad += Check(0, NULL, 0);
+    TEST_CHECK(bad == 0);
+    TEST_CHECK(cuts > 0 && busy > 0);
+}
+
+/* 整理写扇区头时掉电,重新上电后在调度器启动前保存需要整理的参数 */
+static void TestCutDuringCompactHead(void)
+{
+    uint8_t value[100], check[100];
+    FlashKV_Stats_t stats;
+
+    memset(flash, 0xFF, sizeof(flash));
+    PowerOn();
+    Host_SchedulerSetRunning(1);
+    memset(value, 0, sizeof(value));
+    for (;;) { // 写到当前扇区再也放不下一条
+        FlashKV_GetStats(&stats);
+        if (stats.used + FLASHKV_REC_LEN(sizeof(value)) > FLASHKV_SECTOR_SIZE)
+            break;
+        value[0]++;
+        TEST_CHECK(FlashKV_Set(FLASHKV_KEY_IMU_CALI, value, sizeof(value)) == FLASH_OK);
+    }
+    TEST_CHECK(stats.active_sector == FLASHKV_SECTOR_A);
+
+    // 整理时先搬一条记录,再写扇区头的seq和magic,写magic时掉电
+    uint8_t next[100];
+    memset(next, 0x5A, sizeof(next));
+    budget = FLASHKV_REC_LEN(sizeof(next)) / 4 + 1;
+    if (setjmp(power_cut) == 0) {
+        FlashKV_Set(FLASHKV_KEY_IMU_CALI, next, sizeof(next));
+        TEST_CHECK(0);
+    }
+    PowerOn();
+    FlashKV_GetStats(&stats);
+    TEST_CHECK(stats.active_sector == FLASHKV_SECTOR_A);
+    TEST_CHECK(erase_req.pending && erase_req.sector == FLASHKV_SECTOR_B);
+
+    // 调度器启动前: 擦除已经在队列中,不能整理到扇区B
+    TEST_CHECK(FlashKV_Set(FLASHKV_KEY_IMU_CALI, next, sizeof(next)) == FLASH_ERR_BUSY);
+    TEST_CHECK(FlashKV_Get(FLASHKV_KEY_IMU_CALI, check, sizeof(check)) == sizeof(value));
+    TEST_CHECK(memcmp(check, value, sizeof(value)) == 0);
+
+    // 调度器启动后执行后台擦除,原来的值还在
+    Host_SchedulerSetRunning(1);
+    RunBackground();
+    TEST_CHECK(FlashKV_Get(FLASHKV_KEY_IMU_CALI, check, sizeof(check)) == sizeof(value));
+    TEST_CHECK(memcmp(check, value, sizeof(value)) == 0);
+
+    // 之后的写入整理到扇区B
+    TEST_CHECK(FlashKV_Set(FLASHKV_KEY_IMU_CALI, next, sizeof(next)) == FLASH_OK);
+    RunBackground();
+    PowerOn();
+    FlashKV_GetStats(&stats);
+    TEST_CHECK(stats.active_sector == FLASHKV_SECTOR_B);
+    TEST_CHECK(FlashKV_Get(FLASHKV_KEY_IMU_CALI, check, sizeof(check)) == sizeof(next));
+    TEST_CHECK(memcmp(check, next, sizeof(next)) == 0);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    srand(1);
+
+    TEST_CHECK(BSP_Flash_Crc32(0, (const uint8_t *)"123456789", 9) == 0xCBF43926U);
+    TestFormat();
+    TestRandomPowerCuts();
+    TestCutDuringCompactHead();
+    return HOST_TEST_RESULT();
+}
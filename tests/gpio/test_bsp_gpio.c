@@ -0,0 +1,85 @@
+/**
+ * @file test_bsp_gpio.c
+ * @brief bsp_gpio.c的外部中断分发: HAL_GPIO_EXTI_Callback()按引脚调用注册的回调并带上注册时的参数,
+ *        未注册的引脚忽略;同一条中断线只能有一个回调,同一回调重复注册时更新参数,注销后可以被其他回调占用;
+ *        多个引脚或0不是有效的引脚
+ * @note 中断由测试在Host_IsrEnter()/Host_IsrExit()之间直接调用HAL_GPIO_EXTI_Callback()产生
+ */
+
+#include "bsp_gpio.h"
+#include "host_rtos.h"
+#include "host_test.h"
+
+#include <string.h>
+
+typedef struct {
+    uint32_t calls;
+    uint16_t pin;
+    void *arg;
+} Record_t;
+
+static Record_t acc, gyro, other;
+
+static void Record(Record_t *r, uint16_t pin, void *arg)
+{
+    r->calls++;
+    r->pin = pin;
+    r->arg = arg;
+}
+
+static void AccCallback(uint16_t pin, void *arg) { Record(&acc, pin, arg); }
+static void GyroCallback(uint16_t pin, void *arg) { Record(&gyro, pin, arg); }
+static void OtherCallback(uint16_t pin, void *arg) { Record(&other, pin, arg); }
+
+static void Exti(uint16_t pin)
+{
+    Host_IsrEnter();
+    HAL_GPIO_EXTI_Callback(pin);
+    Host_IsrExit();
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    int a = 1, g = 2, o = 3;
+
+    // BMI088的两个数据就绪引脚: 加速度计INT1(PC4),陀螺仪INT3(PC5)
+    TEST_CHECK(BSP_GPIO_EXTI_Register(GPIO_PIN_4, AccCallback, &a));
+    TEST_CHECK(BSP_GPIO_EXTI_Register(GPIO_PIN_5, GyroCallback, &g));
+
+    Exti(GPIO_PIN_4);
+    TEST_CHECK(acc.calls == 1 && acc.pin == GPIO_PIN_4 && acc.arg == &a && gyro.calls == 0);
+    Exti(GPIO_PIN_5);
+    Exti(GPIO_PIN_5);
+    TEST_CHECK(gyro.calls == 2 && gyro.pin == GPIO_PIN_5 && gyro.arg == &g && acc.calls == 1);
+
+    // 未注册的引脚和0忽略
+    Exti(GPIO_PIN_0);
+    Exti(GPIO_PIN_15);
+    Exti(0);
+    TEST_CHECK(acc.calls == 1 && gyro.calls == 2 && other.calls == 0);
+
+    // 无效的引脚
+    TEST_CHECK(!BSP_GPIO_EXTI_Register(0, OtherCallback, &o));
+    TEST_CHECK(!BSP_GPIO_EXTI_Register(GPIO_PIN_0 | GPIO_PIN_1, OtherCallback, &o));
+
+    // 中断线已被占用,原来的回调不受影响
+    TEST_CHECK(!BSP_GPIO_EXTI_Register(GPIO_PIN_4, OtherCallback, &o));
+    Exti(GPIO_PIN_4);
+    TEST_CHECK(acc.calls == 2 && acc.arg == &a && other.calls == 0);
+
+    // 同一回调重复注册更新参数
+    TEST_CHECK(BSP_GPIO_EXTI_Register(GPIO_PIN_4, AccCallback, &o));
+    Exti(GPIO_PIN_4);
+    TEST_CHECK(acc.calls == 3 && acc.arg == &o);
+
+    // 注销后不再调用,可以被其他回调占用
+    TEST_CHECK(BSP_GPIO_EXTI_Register(GPIO_PIN_4, NULL, NULL));
+    Exti(GPIO_PIN_4);
+    TEST_CHECK(acc.calls == 3);
+    TEST_CHECK(BSP_GPIO_EXTI_Register(GPIO_PIN_4, OtherCallback, &o));
+    Exti(GPIO_PIN_4);
+    TEST_CHECK(other.calls == 1 && other.pin == GPIO_PIN_4 && acc.calls == 3 && gyro.calls == 2);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,420 @@
+/**
+ * @file test_bmi088_fifo.c
+ * @brief BMI088.c的FIFO水位中断读取: 水位中断后先读FIFO中的数据量(加速度计顺带读温度),再一次读出所有帧,
+ *        按水位中断的时间戳和输出频率推算每帧的时间戳,由BMI088_GetBatch()取出.
+ *        覆盖陀螺仪和加速度计的水位中断,加速度计FIFO中的溢出和传感器时间帧,超过一次能读出的帧数时接着读且时间戳连续,
+ *        任务来不及取时丢弃最旧的样本,总线忙和DMA出错时重试且仍按原来的中断推算时间戳,等待超时后主动读一次
+ * @note SPI和GPIO用本文件中的替身代替: 阻塞读写访问模拟的寄存器,异步传输进入队列,由测试逐个完成并在中断中调用回调,
+ *       FIFO数据寄存器每读一个字节弹出一个字节.时间戳用手动推进的DWT周期数
+ */
+
+#include "BMI088.h"
+#include "BMI088_reg.h"
+#include "bsp_flash_kv.h"
+#include "bsp_gpio.h"
+#include "bsp_spi.h"
+#include "dwt.h"
+#include "host_dwt.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "main.h"
+#include "RGB.h"
+#include "tim.h"
+
+#include <math.h>
+#include <string.h>
+
+#define CPU_HZ 168000000u
+#define GYRO_PERIOD (CPU_HZ / 2000) // 陀螺仪2kHz
+#define ACC_PERIOD (CPU_HZ / 800)   // 加速度计800Hz
+#define START_CYCLE 1000000000ull
+#define XFER_QUEUE_LEN 8
+
+/* 替身 */
+uint32_t SystemCoreClock = CPU_HZ;
+TIM_HandleTypeDef htim10;
+static TIM_TypeDef tim10_regs;
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim)
+{
+    (void)htim;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+    (void)htim;
+    (void)Channel;
+    return HAL_OK;
+}
+void RGB_show(uint32_t aRGB) { (void)aRGB; }
+
+/* 参数存储中已有标定结果: 零偏为0,重力加速度模长9.81 */
+uint16_t FlashKV_Get(uint16_t key, void *buf, uint16_t size)
+{
+    const float cali[5] = {0.0f, 0.0f, 0.0f, 9.81f, 40.0f};
+    (void)key;
+    if (size != sizeof(cali))
+        return 0;
+    memcpy(buf, cali, sizeof(cali));
+    return sizeof(cali);
+}
+Flash_Status FlashKV_Set(uint16_t key, const void *data, uint16_t len)
+{
+    (void)key;
+    (void)data;
+    (void)len;
+    return FLASH_OK;
+}
+void FlashKV_GetStats(FlashKV_Stats_t *stats) { memset(stats, 0, sizeof(*stats)); }
+Flash_Status BSP_Flash_Read(uint32_t addr, uint8_t *buf, uint16_t size)
+{
+    (void)addr;
+    memset(buf, 0xFF, size);
+    return FLASH_OK;
+}
+
+static GPIO_EXTI_Callback exti_cb[16];
+static void *exti_arg[16];
+
+uint8_t BSP_GPIO_EXTI_Register(uint16_t pin, GPIO_EXTI_Callback callback, void *arg)
+{
+    uint8_t line = (uint8_t)__builtin_ctz(pin);
+    exti_cb[line] = callback;
+    exti_arg[line] = arg;
+    return 1;
+}
+
+/* 模拟的传感器: 寄存器和FIFO */
+typedef struct {
+    uint8_t dummy; // 读时命令之后的dummy字节数,加速度计1个,陀螺仪0个
+    uint8_t regs[128];
+    uint8_t fifo[1024];
+    uint16_t fifo_len;
+} Sensor_t;
+
+static Sensor_t acc = {.dummy = 1}, gyro = {.dummy = 0};
+static SPI_DeviceInstance_t devices[2];
+static uint8_t device_num;
+
+static Sensor_t *SensorOf(const SPI_DeviceInstance_t *dev)
+{
+    return dev->cs_port == GPIOB ? &gyro : &acc;
+}
+
+static uint8_t FifoPop(Sensor_t *s, uint8_t empty)
+{
+    if (s->fifo_len == 0)
+        return empty;
+    uint8_t byte = s->fifo[0];
+    memmove(s->fifo, s->fifo + 1, --s->fifo_len);
+    return byte;
+}
+
+static uint8_t IsFifoData(const Sensor_t *s, uint8_t addr)
+{
+    return addr == (s == &acc ? BMI088_ACC_FIFO_DATA : BMI088_GYRO_FIFO_DATA);
+}
+
+static uint8_t SensorRead(Sensor_t *s, uint8_t addr)
+{
+    if (s == &acc) {
+        if (addr == BMI088_ACC_FIFO_LENGTH_0)
+            return (uint8_t)s->fifo_len;
+        if (addr == BMI088_ACC_FIFO_LENGTH_1)
+            return (uint8_t)(s->fifo_len >> 8);
+        if (addr == BMI088_ACC_FIFO_DATA)
+            return FifoPop(s, 0x80); // FIFO空时读出0x80
+    } else {
+        if (addr == BMI088_GYRO_FIFO_STATUS)
+            return (uint8_t)(s->fifo_len / BMI088_GYRO_FIFO_FRAME_LEN);
+        if (addr == BMI088_GYRO_FIFO_DATA)
+            return FifoPop(s, 0);
+        if (addr == BMI088_GYRO_SELF_TEST)
+            return 0x02; // 自检完成,未失败
+    }
+    return s->regs[addr];
+}
+
+/* 一次片选内的读: 命令字节和dummy字节之后连续读出,FIFO数据寄存器的地址不自增 */
+static void SensorTransfer(Sensor_t *s, const uint8_t *tx, uint8_t *rx, uint16_t size)
+{
+    uint8_t addr = tx[0] & 0x7F;
+    memset(rx, 0, size);
+    for (uint16_t i = 1 + s->dummy; i < size; i++) {
+        rx[i] = SensorRead(s, addr);
+        if (!IsFifoData(s, addr))
+            addr++;
+    }
+}
+
+SPI_DeviceInstance_t *SPI_DeviceRegister(const SPI_DeviceInstance_t *config)
+{
+    if (device_num >= 2)
+        return NULL;
+    devices[device_num] = *config;
+    return &devices[device_num++];
+}
+HAL_StatusTypeDef BSP_SPI_TransReceive(SPI_DeviceInstance_t *dev, const uint8_t *tx_data, uint8_t *rx_data,
+                                       uint16_t size)
+{
+    SensorTransfer(SensorOf(dev), tx_data, rx_data, size);
+    return HAL_OK;
+}
+HAL_StatusTypeDef BSP_SPI_TransAndTrans(SPI_DeviceInstance_t *dev, const uint8_t *tx_data1, uint16_t size1,
+                                        const uint8_t *tx_data2, uint16_t size2)
+{
+    Sensor_t *s = SensorOf(dev);
+    uint8_t addr = tx_data1[0] & 0x7F;
+    (void)size1;
+    for (uint16_t i = 0; i < size2; i++)
+        s->regs[(addr + i) & 0x7F] = tx_data2[i];
+    return HAL_OK;
+}
+
+/* 异步传输队列,由测试调用Complete()按提交顺序逐个完成 */
+static SPI_Transfer_t *xfer_queue[XFER_QUEUE_LEN];
+static uint8_t xfer_head, xfer_count;
+static uint8_t bus_busy;  // 为1时拒绝提交
+static uint32_t submits;
+
+HAL_StatusTypeDef BSP_SPI_Submit(SPI_Transfer_t *xfer)
+{
+    if (bus_busy || xfer_count == XFER_QUEUE_LEN)
+        return HAL_BUSY;
+    xfer_queue[(xfer_head + xfer_count++) % XFER_QUEUE_LEN] = xfer;
+    submits++;
+    return HAL_OK;
+}
+
+/* 完成队列中最早的一次传输,出错时不访问传感器 */
+static uint8_t Complete(HAL_StatusTypeDef status)
+{
+    if (xfer_count == 0)
+        return 0;
+    SPI_Transfer_t *xfer = xfer_queue[xfer_head];
+    xfer_head = (xfer_head + 1) % XFER_QUEUE_LEN;
+    xfer_count--;
+    if (status == HAL_OK)
+        SensorTransfer(SensorOf(xfer->dev), xfer->tx_data, xfer->rx_data, xfer->size);
+    Host_IsrEnter();
+    xfer->callback(xfer, status);
+    Host_IsrExit();
+    return 1;
+}
+
+static void CompleteAll(void)
+{
+    while (Complete(HAL_OK))
+        ;
+}
+
+static void Exti(uint16_t pin)
+{
+    uint8_t line = (uint8_t)__builtin_ctz(pin);
+    Host_IsrEnter();
+    exti_cb[line](pin, exti_arg[line]);
+    Host_IsrExit();
+}
+
+/* 第k帧的原始数据 */
+static int16_t Raw(uint32_t k, uint8_t axis)
+{
+    return (int16_t)((axis - 1) * 1000 + (int32_t)k);
+}
+
+static void PutFrame(Sensor_t *s, uint32_t k)
+{
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        uint16_t v = (uint16_t)Raw(k, axis);
+        s->fifo[s->fifo_len++] = (uint8_t)v;
+        s->fifo[s->fifo_len++] = (uint8_t)(v >> 8);
+    }
+}
+
+static void PushGyro(uint32_t first, uint32_t n)
+{
+    for (uint32_t k = first; k < first + n; k++)
+        PutFrame(&gyro, k);
+}
+
+static void PushAcc(uint32_t k)
+{
+    acc.fifo[acc.fifo_len++] = BMI088_ACC_FIFO_HEADER_ACC;
+    PutFrame(&acc, k);
+}
+
+static uint8_t GyroEqual(const float v[3], uint32_t k)
+{
+    for (uint8_t axis = 0; axis < 3; axis++)
+        if (fabsf(v[axis] - BMI088_GYRO_2000_SEN * (float)Raw(k, axis)) > 1e-6f)
+            return 0;
+    return 1;
+}
+
+static uint8_t AccEqual(const float v[3], uint32_t k)
+{
+    for (uint8_t axis = 0; axis < 3; axis++)
+        if (fabsf(v[axis] - BMI088_ACCEL_6G_SEN * (float)Raw(k, axis)) > 1e-5f)
+            return 0;
+    return 1;
+}
+
+static BMI088_Batch_t batch;
+
+/* 等待超时时主动读一次,FIFO为空时什么也不取出 */
+static void TestWaitTimeout(void)
+{
+    uint32_t before = submits;
+    TEST_CHECK(BMI088_WaitData(1) == 0);
+    TEST_CHECK(submits == before + 2 && xfer_count == 2);
+    TEST_CHECK(xfer_queue[xfer_head]->tx_data[0] == (BMI088_SPI_READ_CODE | BMI088_GYRO_FIFO_STATUS)); // 陀螺仪先读
+    CompleteAll();
+    TEST_CHECK(submits == before + 2);
+    TEST_CHECK(BMI088_GetBatch(&batch) == 0 && batch.acc_num == 0);
+}
+
+/* 陀螺仪水位中断: 第wm帧在中断时刻写入,其余帧按2kHz前后推算 */
+static void TestGyroWatermark(void)
+{
+    PushGyro(0, BMI088_GYRO_FIFO_WM);
+    uint64_t t = DWT_GetCycle64();
+    Exti(INT_GYRO_Pin);
+    TEST_CHECK(xfer_count == 1);
+    CompleteAll();
+    TEST_CHECK(gyro.fifo_len == 0);
+    TEST_CHECK(BMI088_WaitData(BMI088_WAIT_TIMEOUT_MS) == 1);
+
+    TEST_CHECK(BMI088_GetBatch(&batch) == BMI088_GYRO_FIFO_WM && batch.acc_num == 0);
+    for (uint8_t i = 0; i < BMI088_GYRO_FIFO_WM; i++) {
+        TEST_CHECK(GyroEqual(batch.gyro[i], i));
+        TEST_CHECK(batch.gyro_cycle[i] == t - (uint64_t)(BMI088_GYRO_FIFO_WM - 1 - i) * GYRO_PERIOD);
+    }
+    BMI088_GET_Data_t data = BMI088_GET_DATA();
+    TEST_CHECK(data.gyro_cycle == t && GyroEqual(*data.gyro, BMI088_GYRO_FIFO_WM - 1));
+    TEST_CHECK(BMI088_GetBatch(&batch) == 0);
+}
+
+/* 加速度计水位中断: 跳过溢出帧和传感器时间帧,溢出计入统计,不唤醒任务 */
+static void TestAccWatermark(void)
+{
+    BMI088_IrqStats_t before, after;
+    BMI088_GetIrqStats(&before);
+    acc.fifo[acc.fifo_len++] = BMI088_ACC_FIFO_HEADER_SKIP;
+    acc.fifo[acc.fifo_len++] = 3;
+    PushAcc(100);
+    acc.fifo[acc.fifo_len++] = BMI088_ACC_FIFO_HEADER_TIME;
+    memset(&acc.fifo[acc.fifo_len], 0, 3);
+    acc.fifo_len += 3;
+    PushAcc(101);
+    uint64_t t = DWT_GetCycle64();
+    Exti(INT_ACC_Pin);
+    CompleteAll();
+    TEST_CHECK(acc.fifo_len == 0);
+    TEST_CHECK(BMI088_WaitData(1) == 0);
+    CompleteAll(); // 超时后的主动读取
+
+    TEST_CHECK(BMI088_GetBatch(&batch) == 0 && batch.acc_num == BMI088_ACC_FIFO_WM);
+    TEST_CHECK(AccEqual(batch.acc[0], 100) && AccEqual(batch.acc[1], 101));
+    TEST_CHECK(batch.acc_cycle[0] == t - ACC_PERIOD && batch.acc_cycle[1] == t);
+    BMI088_GetIrqStats(&after);
+    TEST_CHECK(after.overrun == before.overrun + 1 && after.acc_samples == before.acc_samples + 2);
+}
+
+/* FIFO中的帧超过一次能读出的32帧: 剩下的接着读,时间戳接着上一帧;任务来不及取时丢弃最旧的 */
+static void TestBacklog(void)
+{
+    const uint32_t frames = 36;
+    BMI088_IrqStats_t before, after;
+    BMI088_GetIrqStats(&before);
+    PushGyro(200, frames);
+    uint64_t t = DWT_GetCycle64();
+    uint32_t first = submits;
+    Exti(INT_GYRO_Pin);
+    CompleteAll();
+    TEST_CHECK(gyro.fifo_len == 0 && submits == first + 4); // 两次数据量加两次数据
+
+    TEST_CHECK(BMI088_GetBatch(&batch) == BMI088_BATCH_LEN);
+    uint32_t dropped = frames - BMI088_BATCH_LEN;
+    for (uint8_t i = 0; i < BMI088_BATCH_LEN; i++) {
+        uint32_t k = dropped + i;
+        TEST_CHECK(GyroEqual(batch.gyro[i], 200 + k));
+        TEST_CHECK(batch.gyro_cycle[i] == t + ((int64_t)k - (BMI088_GYRO_FIFO_WM - 1)) * GYRO_PERIOD);
+    }
+    BMI088_GetIrqStats(&after);
+    TEST_CHECK(after.dropped == before.dropped + dropped && after.gyro_samples == before.gyro_samples + frames);
+}
+
+/* 中断时总线忙: 记为待读取,下一次中断时一起读,时间戳仍按原来的中断推算 */
+static void TestBusBusy(void)
+{
+    BMI088_IrqStats_t before, after;
+    BMI088_GetIrqStats(&before);
+    PushGyro(300, BMI088_GYRO_FIFO_WM);
+    uint64_t t = DWT_GetCycle64();
+    bus_busy = 1;
+    Exti(INT_GYRO_Pin);
+    bus_busy = 0;
+    TEST_CHECK(xfer_count == 0);
+
+    Host_DwtAdvance(GYRO_PERIOD / 2);
+    PushAcc(400);
+    PushAcc(401);
+    uint64_t t_acc = DWT_GetCycle64();
+    Exti(INT_ACC_Pin);
+    TEST_CHECK(xfer_count == 2);
+    CompleteAll();
+
+    TEST_CHECK(BMI088_GetBatch(&batch) == BMI088_GYRO_FIFO_WM && batch.acc_num == 2);
+    TEST_CHECK(GyroEqual(batch.gyro[0], 300) && batch.gyro_cycle[BMI088_GYRO_FIFO_WM - 1] == t);
+    TEST_CHECK(AccEqual(batch.acc[1], 401) && batch.acc_cycle[1] == t_acc);
+    BMI088_GetIrqStats(&after);
+    TEST_CHECK(after.bus_busy == before.bus_busy + 1);
+}
+
+/* 读数据时DMA出错: 从读数据量开始重新读,时间戳仍按原来的中断推算 */
+static void TestSpiError(void)
+{
+    BMI088_IrqStats_t before, after;
+    BMI088_GetIrqStats(&before);
+    PushGyro(500, BMI088_GYRO_FIFO_WM);
+    uint64_t t = DWT_GetCycle64();
+    Exti(INT_GYRO_Pin);
+    TEST_CHECK(Complete(HAL_OK));    // 数据量
+    TEST_CHECK(Complete(HAL_ERROR)); // 数据
+    TEST_CHECK(xfer_count == 1 && gyro.fifo_len == BMI088_GYRO_FIFO_WM * BMI088_GYRO_FIFO_FRAME_LEN);
+    CompleteAll();
+
+    TEST_CHECK(BMI088_GetBatch(&batch) == BMI088_GYRO_FIFO_WM);
+    TEST_CHECK(GyroEqual(batch.gyro[0], 500) && batch.gyro_cycle[BMI088_GYRO_FIFO_WM - 1] == t);
+    BMI088_GetIrqStats(&after);
+    TEST_CHECK(after.spi_error == before.spi_error + 1);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    htim10.Instance = &tim10_regs;
+    acc.regs[BMI088_ACC_CHIP_ID] = BMI088_ACC_CHIP_ID_VALUE;
+    gyro.regs[BMI088_GYRO_CHIP_ID] = BMI088_GYRO_CHIP_ID_VALUE;
+
+    // 初始化中的延时按实际时间,之后改为手动推进
+    BMI088_init();
+    TEST_CHECK(device_num == 2);
+    TEST_CHECK(exti_cb[__builtin_ctz(INT_ACC_Pin)] && exti_cb[__builtin_ctz(INT_GYRO_Pin)]);
+    TEST_CHECK(gyro.regs[BMI088_GYRO_FIFO_CONFIG_0] == BMI088_GYRO_FIFO_WM);
+    TEST_CHECK(acc.regs[BMI088_ACC_FIFO_WTM_0] == BMI088_ACC_FIFO_WM * BMI088_ACC_FIFO_FRAME_LEN);
+    Host_DwtSetCycle(START_CYCLE);
+
+    TestWaitTimeout();
+    Host_DwtAdvance(CPU_HZ / 100);
+    TestGyroWatermark();
+    Host_DwtAdvance(CPU_HZ / 100);
+    TestAccWatermark();
+    Host_DwtAdvance(CPU_HZ / 100);
+    TestBacklog();
+    Host_DwtAdvance(CPU_HZ / 100);
+    TestBusBusy();
+    Host_DwtAdvance(CPU_HZ / 100);
+    TestSpiError();
+    return HOST_TEST_RESULT();
+}
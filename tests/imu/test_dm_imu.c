@@ -0,0 +1,149 @@
+/**
+ * @file test_dm_imu.c
+ * @brief dm_imu.c通过bsp_can.c在虚拟总线(CAN2)上收发: 请求帧的格式,加速度、角速度、欧拉角和四元数反馈的解码,
+ *        yaw跨过±180°时累计圈数
+ * @note 离线检测和systemwatch用本文件中的替身代替.DM_IMU_Init()创建的请求任务在注册systemwatch时被替身挂起,
+ *       请求由测试调用IMU_RequestData()发出,帧时序只由测试决定
+ */
+
+#include "bsp_can.h"
+#include "can.h"
+#include "dm_imu.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "offline.h"
+#include "systemwatch.h"
+#include "task.h"
+#include "vcan.h"
+
+#include <math.h>
+#include <string.h>
+
+#define MS_CYCLES (VCAN_CPU_HZ / 1000)
+#define IMU_RX_ID 0x11
+
+/* 替身 */
+static uint32_t offline_updates;
+
+uint8_t offline_device_register(const OfflineDeviceInit_t *init)
+{
+    (void)init;
+    return 0;
+}
+void offline_device_update(uint8_t device_index)
+{
+    (void)device_index;
+    offline_updates++;
+}
+int8_t SystemWatch_RegisterTask(osThreadId taskHandle, const char *taskName)
+{
+    (void)taskHandle;
+    (void)taskName;
+    for (;;)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // 挂起请求任务
+}
+void SystemWatch_ReportTaskAlive(osThreadId taskHandle) { (void)taskHandle; }
+
+/* 模拟IMU: 记录收到的最后一个请求 */
+typedef struct {
+    uint32_t frames;
+    uint16_t std_id;
+    uint8_t data[8];
+    uint8_t dlc;
+} ImuNode_t;
+
+static ImuNode_t node;
+static int8_t node_id;
+
+static void NodeRx(void *ctx, uint16_t std_id, const uint8_t *data, uint8_t dlc)
+{
+    ImuNode_t *n = ctx;
+    n->frames++;
+    n->std_id = std_id;
+    n->dlc = dlc;
+    memcpy(n->data, data, dlc);
+}
+
+static uint16_t Quantize(float x, float min, float max, uint8_t bits)
+{
+    return (uint16_t)((x - min) * (float)((1 << bits) - 1) / (max - min) + 0.5f);
+}
+
+/* 加速度、角速度和欧拉角的反馈: [rid] [保留] [3个16位小端] */
+static void Reply3(uint8_t rid, float v0, float v1, float v2, const float min[3], const float max[3])
+{
+    uint16_t q[3] = {Quantize(v0, min[0], max[0], 16), Quantize(v1, min[1], max[1], 16),
+                     Quantize(v2, min[2], max[2], 16)};
+    uint8_t data[8] = {rid, 0};
+    for (uint8_t i = 0; i < 3; i++) {
+        data[2 + 2 * i] = (uint8_t)q[i];
+        data[3 + 2 * i] = (uint8_t)(q[i] >> 8);
+    }
+    VCAN_NodeSend(&hcan2, node_id, IMU_RX_ID, data, 8);
+    VCAN_Advance(MS_CYCLES);
+}
+
+/* 四元数的反馈: [rid] 之后4个14位分量高位先行 */
+static void ReplyQuaternion(const float q[4])
+{
+    uint64_t bits = 0;
+    for (uint8_t i = 0; i < 4; i++)
+        bits = bits << 14 | Quantize(q[i], Quaternion_MIN, Quaternion_MAX, 14);
+    uint8_t data[8] = {DM_RID_Quaternion};
+    for (uint8_t i = 0; i < 7; i++)
+        data[1 + i] = (uint8_t)(bits >> (48 - 8 * i));
+    VCAN_NodeSend(&hcan2, node_id, IMU_RX_ID, data, 8);
+    VCAN_Advance(MS_CYCLES);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    VCAN_Reset();
+    node_id = VCAN_AttachNode(&hcan2, NodeRx, &node);
+
+    DM_IMU_Init();
+    TEST_CHECK(dm_imu.can_device != NULL);
+
+    // 请求帧: 0x6FF, [can_id低 高] [寄存器] 0xCC
+    IMU_RequestData(dm_imu.can_device->tx_id, DM_RID_GYRO);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(node.frames == 1 && node.std_id == 0x6FF && node.dlc == 4);
+    TEST_CHECK(node.data[0] == 0x01 && node.data[1] == 0x00 && node.data[2] == DM_RID_GYRO && node.data[3] == 0xCC);
+
+    const float accel_min[3] = {ACCEL_CAN_MIN, ACCEL_CAN_MIN, ACCEL_CAN_MIN};
+    const float accel_max[3] = {ACCEL_CAN_MAX, ACCEL_CAN_MAX, ACCEL_CAN_MAX};
+    Reply3(DM_RID_ACCEL, 0.1f, -0.2f, 9.8f, accel_min, accel_max);
+    TEST_CHECK(fabsf(dm_imu.accel[0] - 0.1f) < 0.01f && fabsf(dm_imu.accel[1] + 0.2f) < 0.01f);
+    TEST_CHECK(fabsf(dm_imu.accel[2] - 9.8f) < 0.01f);
+
+    const float gyro_min[3] = {GYRO_CAN_MIN, GYRO_CAN_MIN, GYRO_CAN_MIN};
+    const float gyro_max[3] = {GYRO_CAN_MAX, GYRO_CAN_MAX, GYRO_CAN_MAX};
+    Reply3(DM_RID_GYRO, 1.5f, -3.0f, 0.25f, gyro_min, gyro_max);
+    TEST_CHECK(fabsf(dm_imu.gyro[0] - 1.5f) < 0.01f && fabsf(dm_imu.gyro[1] + 3.0f) < 0.01f);
+    TEST_CHECK(fabsf(dm_imu.gyro[2] - 0.25f) < 0.01f);
+
+    // 欧拉角按pitch、yaw、roll的顺序,yaw从170°转到-170°是正转20°
+    const float euler_min[3] = {PITCH_CAN_MIN, YAW_CAN_MIN, ROLL_CAN_MIN};
+    const float euler_max[3] = {PITCH_CAN_MAX, YAW_CAN_MAX, ROLL_CAN_MAX};
+    Reply3(DM_RID_EULER, 10.0f, 170.0f, -5.0f, euler_min, euler_max);
+    TEST_CHECK(fabsf(dm_imu.pitch - 10.0f) < 0.01f && fabsf(dm_imu.roll + 5.0f) < 0.01f);
+    TEST_CHECK(fabsf(dm_imu.YawTotalAngle - 170.0f) < 0.01f);
+    Reply3(DM_RID_EULER, 10.0f, -170.0f, -5.0f, euler_min, euler_max);
+    TEST_CHECK(fabsf(dm_imu.yaw + 170.0f) < 0.01f);
+    TEST_CHECK(fabsf(dm_imu.YawTotalAngle - 190.0f) < 0.01f);
+    Reply3(DM_RID_EULER, 10.0f, 170.0f, -5.0f, euler_min, euler_max);
+    TEST_CHECK(fabsf(dm_imu.YawTotalAngle - 170.0f) < 0.01f);
+
+    const float q[4] = {0.7071f, 0.0f, -0.5f, 0.5f};
+    ReplyQuaternion(q);
+    for (uint8_t i = 0; i < 4; i++)
+        TEST_CHECK(fabsf(dm_imu.q[i] - q[i]) < 0.001f);
+
+    DM_IMU_DATA_T data = DMI_IMU_GetData();
+    TEST_CHECK(*data.Yaw == dm_imu.yaw && *data.YawTotalAngle == dm_imu.YawTotalAngle);
+    TEST_CHECK((*data.gyro)[1] == dm_imu.gyro[1]);
+    TEST_CHECK(offline_updates == 6);
+
+    return HOST_TEST_RESULT();
+}
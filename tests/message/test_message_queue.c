@@ -0,0 +1,67 @@
+/**
+ * @file test_message_queue.c
+ * @brief QUEUE_BLOCK策略: 订阅者取走消息时唤醒阻塞的发布者;发布者超时放弃后不再被登记,不会收到多余的通知
+ */
+
+#include "message_center.h"
+#include "host_rtos.h"
+#include "host_test.h"
+
+#include <pthread.h>
+#include <time.h>
+
+static Subscriber_t *block_sub;
+
+static void SleepMs(uint32_t ms)
+{
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = (long)ms * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static void *PopThread(void *arg)
+{
+    Shoot_Ctrl_Cmd_s cmd;
+    SleepMs((uint32_t)(uintptr_t)arg);
+    TEST_CHECK(SubGetMessage(block_sub, &cmd) == 1);
+    return NULL;
+}
+
+static void PopAfter(uint32_t ms, pthread_t *thread)
+{
+    pthread_create(thread, NULL, PopThread, (void *)(uintptr_t)ms);
+}
+
+int main(void)
+{
+    Publisher_t *pub = PubRegisterTopic(TOPIC_SHOOT_CMD, Shoot_Ctrl_Cmd_s);
+    block_sub = SubRegisterTopicQueue(TOPIC_SHOOT_CMD, Shoot_Ctrl_Cmd_s, 1, QUEUE_BLOCK);
+    Shoot_Ctrl_Cmd_s cmd = {.shoot_rate = 1};
+    pthread_t thread;
+    TEST_CHECK(block_sub != NULL);
+
+    // 队列有空位,直接放入
+    TEST_CHECK(PubPushMessage(pub, &cmd) == 1);
+
+    // 队列满,订阅者1ms后取走,发布者被唤醒后放入,不计溢出
+    PopAfter(1, &thread);
+    TickType_t start = xTaskGetTickCount();
+    TEST_CHECK(PubPushMessage(pub, &cmd) == 1);
+    TEST_CHECK(xTaskGetTickCount() - start < MESSAGE_BLOCK_TIMEOUT_MS);
+    TEST_CHECK(block_sub->overflow_count == 0);
+    pthread_join(thread, NULL);
+    xTaskNotifyWait(0, MESSAGE_NOTIFY_BIT, NULL, 0); // 取走唤醒发布者的那次通知
+
+    // 队列满且没有人读,等待MESSAGE_BLOCK_TIMEOUT_MS后丢弃新消息
+    start = xTaskGetTickCount();
+    TEST_CHECK(PubPushMessage(pub, &cmd) == 0);
+    TEST_CHECK(xTaskGetTickCount() - start >= MESSAGE_BLOCK_TIMEOUT_MS);
+    TEST_CHECK(block_sub->overflow_count == 1);
+    TEST_CHECK(block_sub->blocked_pub == NULL);
+
+    // 超时之后订阅者才取走消息,不能再通知已经放弃等待的发布者
+    PopAfter(0, &thread);
+    pthread_join(thread, NULL);
+    TEST_CHECK(xTaskNotifyWait(0, MESSAGE_NOTIFY_BIT, NULL, 0) == pdFALSE);
+
+    return HOST_TEST_RESULT();
+}
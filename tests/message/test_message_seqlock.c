@@ -0,0 +1,204 @@
+/**
+ * @file test_message_seqlock.c
+ * @brief message_center多线程压力测试: 发布者高速发布,多个订阅者用各种方式同时读取,
+ *        检查读到的每条消息都是某一次完整发布的内容(没有被撕裂),且版本单调递增,队列订阅者不丢失也不乱序
+ * @note 消息的前4字节为发布序号k,其余每个字节由k和位置决定,撕裂的消息无法通过检查
+ */
+
+#include "message_center.h"
+#include "host_log.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "elog.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#define PUB_COUNT 100000u
+
+typedef struct
+{
+    Subscriber_t *sub;
+    uint8_t len;
+    volatile uint8_t *done;   // 发布者已经发布完
+    uint8_t wait;             // 1为SubWaitMessage,0为SubGetMessage轮询
+    const char *name;
+    uint32_t received;
+    uint32_t last;            // 最后读到的序号
+    uint32_t torn;            // 内容不一致的消息数
+    uint32_t disorder;        // 序号没有递增的次数
+} Reader_t;
+
+static volatile uint8_t chassis_done, gimbal_done;
+
+static void Fill(uint8_t *msg, uint8_t len, uint32_t k)
+{
+    memcpy(msg, &k, sizeof(k));
+    for (uint8_t i = sizeof(k); i < len; i++)
+        msg[i] = (uint8_t)(k * 7u + i);
+}
+
+/* 返回消息的序号,内容不一致时返回0 */
+static uint32_t Verify(const uint8_t *msg, uint8_t len)
+{
+    uint32_t k;
+    memcpy(&k, msg, sizeof(k));
+    for (uint8_t i = sizeof(k); i < len; i++)
+        if (msg[i] != (uint8_t)(k * 7u + i))
+            return 0;
+    return k;
+}
+
+static void ReaderCheck(Reader_t *r, const uint8_t *msg)
+{
+    uint32_t k = Verify(msg, r->len);
+    r->received++;
+    if (k == 0)
+    {
+        r->torn++;
+        return;
+    }
+    if (k <= r->last)
+        r->disorder++;
+    r->last = k;
+}
+
+static void *ReaderThread(void *arg)
+{
+    Reader_t *r = arg;
+    uint8_t msg[64];
+    Host_TaskSetName(r->name);
+    for (;;)
+    {
+        uint8_t done = __atomic_load_n(r->done, __ATOMIC_ACQUIRE);
+        uint8_t got = r->wait ? SubWaitMessage(r->sub, msg, 10) : SubGetMessage(r->sub, msg);
+        if (got)
+            ReaderCheck(r, msg);
+        else if (done) // 发布结束之后又读了一次,已经没有新消息
+            break;
+        else
+            sched_yield(); // 相当于任务中的osDelay,单核主机上让出CPU给发布者
+    }
+    return NULL;
+}
+
+typedef struct
+{
+    Subscriber_t *sub;
+    uint8_t len;
+    uint32_t valid;
+    uint32_t retry;
+    uint32_t torn;
+} Peeker_t;
+
+static void *PeekThread(void *arg)
+{
+    Peeker_t *p = arg;
+    uint8_t msg[64];
+    while (!__atomic_load_n(&chassis_done, __ATOMIC_ACQUIRE))
+    {
+        uint32_t token;
+        const void *data = SubPeekMessage(p->sub, &token);
+        if (data == NULL)
+            continue;
+        memcpy(msg, data, p->len);
+        if (!SubPeekCheck(p->sub, token))
+        {
+            p->retry++;
+            continue;
+        }
+        p->valid++;
+        if (Verify(msg, p->len) == 0)
+            p->torn++;
+    }
+    return NULL;
+}
+
+static void *ChassisPubThread(void *arg)
+{
+    Publisher_t *pub = arg;
+    Chassis_Ctrl_Cmd_s cmd;
+    Host_TaskSetName("chassis_pub");
+    for (uint32_t k = 1; k <= PUB_COUNT; k++)
+    {
+        Fill((uint8_t *)&cmd, sizeof(cmd), k);
+        PubPushMessage(pub, &cmd);
+    }
+    __atomic_store_n(&chassis_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* 在"中断"中发布,QUEUE_BLOCK不会等待,通知走FromISR接口 */
+static void *GimbalIsrThread(void *arg)
+{
+    Publisher_t *pub = arg;
+    Gimbal_Ctrl_Cmd_s cmd;
+    Host_IsrEnter();
+    for (uint32_t k = 1; k <= PUB_COUNT; k++)
+    {
+        Fill((uint8_t *)&cmd, sizeof(cmd), k);
+        PubPushMessage(pub, &cmd);
+    }
+    Host_IsrExit();
+    __atomic_store_n(&gimbal_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int main(void)
+{
+    Publisher_t *chassis_pub = PubRegisterTopic(TOPIC_CHASSIS_CMD, Chassis_Ctrl_Cmd_s);
+    Publisher_t *gimbal_pub = PubRegisterTopic(TOPIC_GIMBAL_CMD, Gimbal_Ctrl_Cmd_s);
+    const uint8_t chassis_len = sizeof(Chassis_Ctrl_Cmd_s), gimbal_len = sizeof(Gimbal_Ctrl_Cmd_s);
+
+    Reader_t readers[] = {
+        {SubRegisterTopic(TOPIC_CHASSIS_CMD, Chassis_Ctrl_Cmd_s), chassis_len, &chassis_done, 0, "poll0"},
+        {SubRegisterTopic(TOPIC_CHASSIS_CMD, Chassis_Ctrl_Cmd_s), chassis_len, &chassis_done, 0, "poll1"},
+        {SubRegisterTopic(TOPIC_CHASSIS_CMD, Chassis_Ctrl_Cmd_s), chassis_len, &chassis_done, 1, "wait"},
+        {SubRegisterTopicQueue(TOPIC_CHASSIS_CMD, Chassis_Ctrl_Cmd_s, 4, QUEUE_DROP_OLDEST), chassis_len,
+         &chassis_done, 1, "q_oldest"},
+        {SubRegisterTopicQueue(TOPIC_CHASSIS_CMD, Chassis_Ctrl_Cmd_s, 2, QUEUE_BLOCK), chassis_len, &chassis_done,
+         1, "q_block"},
+        {SubRegisterTopic(TOPIC_GIMBAL_CMD, Gimbal_Ctrl_Cmd_s), gimbal_len, &gimbal_done, 0, "isr_poll"},
+        {SubRegisterTopic(TOPIC_GIMBAL_CMD, Gimbal_Ctrl_Cmd_s), gimbal_len, &gimbal_done, 1, "isr_wait"},
+        {SubRegisterTopicQueue(TOPIC_GIMBAL_CMD, Gimbal_Ctrl_Cmd_s, 4, QUEUE_BLOCK), gimbal_len, &gimbal_done, 1,
+         "isr_q_block"},
+    };
+    const size_t reader_num = sizeof(readers) / sizeof(readers[0]);
+    Peeker_t peeker = {SubRegisterTopic(TOPIC_CHASSIS_CMD, Chassis_Ctrl_Cmd_s), chassis_len};
+
+    pthread_t reader_thread[sizeof(readers) / sizeof(readers[0])], peek_thread, chassis_thread, gimbal_thread;
+    for (size_t i = 0; i < reader_num; i++)
+    {
+        TEST_CHECK(readers[i].sub != NULL);
+        pthread_create(&reader_thread[i], NULL, ReaderThread, &readers[i]);
+    }
+    pthread_create(&peek_thread, NULL, PeekThread, &peeker);
+    pthread_create(&chassis_thread, NULL, ChassisPubThread, chassis_pub);
+    pthread_create(&gimbal_thread, NULL, GimbalIsrThread, gimbal_pub);
+
+    pthread_join(chassis_thread, NULL);
+    pthread_join(gimbal_thread, NULL);
+    pthread_join(peek_thread, NULL);
+    for (size_t i = 0; i < reader_num; i++)
+        pthread_join(reader_thread[i], NULL);
+
+    for (size_t i = 0; i < reader_num; i++)
+    {
+        Reader_t *r = &readers[i];
+        Subscriber_t *sub = r->sub;
+        uint32_t lost = sub->depth ? sub->overflow_count : sub->overwrite_count;
+        printf("%-12s received %6u lost %6u last %6u torn %u disorder %u\n", r->name, r->received, lost, r->last,
+               r->torn, r->disorder);
+        TEST_CHECK(r->torn == 0);
+        TEST_CHECK(r->disorder == 0);
+        if (sub->depth == 0 || sub->policy == QUEUE_DROP_OLDEST) // 最后一条消息总能读到,其他策略可能丢弃新消息
+            TEST_CHECK(r->last == PUB_COUNT);
+        if (sub->depth) // 队列订阅者: 每条消息要么被读到,要么计入溢出
+            TEST_CHECK(r->received + sub->overflow_count == PUB_COUNT);
+    }
+    printf("peek valid %u retry %u torn %u\n", peeker.valid, peeker.retry, peeker.torn);
+    TEST_CHECK(peeker.torn == 0);
+    TEST_CHECK(Host_LogCount(ELOG_LVL_ERROR) == 0);
+    return HOST_TEST_RESULT();
+}
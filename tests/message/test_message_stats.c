@@ -0,0 +1,67 @@
+/**
+ * @file test_message_stats.c
+ * @brief 统计表经过SEGGER_RTT_printf()输出后各列对齐,RTT使用仓库中的SEGGER源码,宽度处理与固件一致
+ */
+
+#include "message_center.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "SEGGER_RTT.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* 按行切分RTT输出,返回行数 */
+static int SplitLines(char *text, char **lines, int max)
+{
+    int n = 0;
+    for (char *line = strtok(text, "\r\n"); line && n < max; line = strtok(NULL, "\r\n"))
+        lines[n++] = line;
+    return n;
+}
+
+int main(void)
+{
+    Publisher_t *pub = PubRegisterTopic(TOPIC_SHOOT_CMD, Shoot_Ctrl_Cmd_s);
+    Subscriber_t *last = SubRegisterTopic(TOPIC_SHOOT_CMD, Shoot_Ctrl_Cmd_s);
+    Subscriber_t *queue = SubRegisterTopicQueue(TOPIC_SHOOT_CMD, Shoot_Ctrl_Cmd_s, 4, QUEUE_DROP_OLDEST);
+    Shoot_Ctrl_Cmd_s cmd = {0};
+    Host_TaskSetName("shoot");
+    for (uint32_t i = 0; i < 12345; i++)
+        PubPushMessage(pub, &cmd);
+    SubWaitMessage(last, &cmd, 0); // 登记等待的任务,统计表中显示任务名
+    SubGetMessage(queue, &cmd);
+
+    MessageCenter_DumpStats();
+    static char text[1024];
+    unsigned len = SEGGER_RTT_ReadUpBuffer(MESSAGE_STATS_RTT_CHANNEL, text, sizeof(text) - 1);
+    text[len] = '\0';
+    fputs(text, stdout);
+
+    char *lines[16] = {0};
+    int n = SplitLines(text, lines, 16);
+    TEST_CHECK(n == 1 + TOPIC_COUNT + 2);
+    if (n != 1 + TOPIC_COUNT + 2)
+        return HOST_TEST_RESULT();
+    TEST_CHECK(strcmp(lines[0], "topic                  pubs  rate_hz subs") == 0);
+    for (int i = 1; i < n; i++)
+    {
+        char *line = lines[i];
+        if (strncmp(line, "  ", 2) == 0) // 订阅者行: 任务名14列,类型5列,读取次数10列
+        {
+            TEST_CHECK(strlen(line) > 34);
+            TEST_CHECK(line[16] == ' ' && line[22] == ' ');
+            TEST_CHECK(strncmp(line + 17, "queue", 5) == 0 || strncmp(line + 17, " last", 5) == 0);
+            TEST_CHECK(strtoul(line + 23, NULL, 10) == 1u); // 两个订阅者各读了一次
+            continue;
+        }
+        // 话题行: 话题名16列,发布次数10列
+        TEST_CHECK(strlen(line) > 27);
+        TEST_CHECK(line[16] == ' ' && line[27] == ' ');
+        if (strncmp(line, "shoot_cmd ", 10) == 0)
+            TEST_CHECK(strtoul(line + 17, NULL, 10) == 12345u);
+    }
+    TEST_CHECK(strncmp(lines[1 + TOPIC_SHOOT_CMD + 1], "  shoot          ", 17) == 0 ||
+               strncmp(lines[1 + TOPIC_SHOOT_CMD + 2], "  shoot          ", 17) == 0);
+    return HOST_TEST_RESULT();
+}
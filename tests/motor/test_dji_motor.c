@@ -0,0 +1,183 @@
+/**
+ * @file test_dji_motor.c
+ * @brief dji.c通过bsp_can.c在虚拟总线上收发: 反馈报文解码并带上接收中断的时间戳,
+ *        速度环输出经发送调度按分组帧(0x200)发出,反馈中断后只保持有限的周期再衰减到0,离线和停止时输出为0
+ * @note 离线检测、功率控制和LQR用本文件中的替身代替,离线状态由测试直接设置
+ */
+
+#include "bsp_can.h"
+#include "can.h"
+#include "dji.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "powercontroller.h"
+#include "vcan.h"
+
+#include <string.h>
+
+#define FRAME8_CYCLES ((47 + 64) * (VCAN_CPU_HZ / VCAN_DEFAULT_BITRATE)) // 1Mbps下8字节帧的传输时间
+#define MS_CYCLES (VCAN_CPU_HZ / 1000)
+
+/* 替身 */
+static uint8_t fake_offline;
+
+uint8_t offline_device_register(const OfflineDeviceInit_t *init)
+{
+    (void)init;
+    return 0;
+}
+void offline_device_update(uint8_t device_index) { (void)device_index; }
+uint8_t get_device_status(uint8_t device_index)
+{
+    (void)device_index;
+    return fake_offline;
+}
+void PowerControlDji(DJIMotor_t *motor, float control_output)
+{
+    (void)motor;
+    (void)control_output;
+}
+void PowerControlDjiFinalize(DJIMotor_t **motor_list, uint8_t motor_count)
+{
+    (void)motor_list;
+    (void)motor_count;
+}
+int16_t GetPowerControlOutput(uint8_t motor_num)
+{
+    (void)motor_num;
+    return 0;
+}
+void LQRInit(LQRInstance *lqr, LQR_Init_Config_s *config)
+{
+    (void)lqr;
+    (void)config;
+}
+float LQRCalculate(LQRInstance *lqr, float state0, float state1, float ref)
+{
+    (void)lqr;
+    (void)state0;
+    (void)state1;
+    (void)ref;
+    return 0;
+}
+
+/* 模拟电调: 记录收到的0x200分组帧中1号电机的电流指令 */
+typedef struct {
+    uint32_t frames;
+    int16_t current;
+} Esc_t;
+
+static Esc_t esc;
+static int8_t esc_node;
+
+static void EscRx(void *ctx, uint16_t std_id, const uint8_t *data, uint8_t dlc)
+{
+    Esc_t *e = ctx;
+    if (std_id == 0x200 && dlc == 8) {
+        e->frames++;
+        e->current = (int16_t)(data[0] << 8 | data[1]);
+    }
+}
+
+static void EscFeedback(uint16_t ecd, int16_t speed, int16_t current, uint8_t temp)
+{
+    uint8_t data[8] = {(uint8_t)(ecd >> 8), (uint8_t)ecd, (uint8_t)(speed >> 8), (uint8_t)speed,
+                       (uint8_t)(current >> 8), (uint8_t)current, temp, 0};
+    VCAN_NodeSend(&hcan1, esc_node, 0x201, data, 8);
+}
+
+/* 一个控制周期: 计算、暂存、统一发出,然后等报文传输完 */
+static int16_t ControlTick(void)
+{
+    DJIMotorControl();
+    CAN_SchedFlush();
+    VCAN_Advance(MS_CYCLES);
+    int16_t output, speed;
+    DJIMotorGetSnapshot(&output, &speed, 1);
+    return output;
+}
+
+static DJIMotor_t *MotorInit(void)
+{
+    Motor_Init_Config_s config = {
+        .controller_param_init_config = {
+            .speed_PID = {.Kp = 10.0f, .MaxOut = 16384.0f, .Improve = PID_IMPROVE_NONE},
+        },
+        .controller_setting_init_config = {
+            .outer_loop_type = SPEED_LOOP,
+            .close_loop_type = SPEED_LOOP,
+            .control_algorithm = CONTROL_PID,
+        },
+        .motor_type = M3508,
+        .can_init_config = {.can_handle = &hcan1, .tx_id = 1},
+        .offline_device_motor = {.name = "m3508", .timeout_ms = 50, .enable = OFFLINE_ENABLE},
+    };
+    return DJIMotorInit(&config);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    VCAN_Reset();
+    esc_node = VCAN_AttachNode(&hcan1, EscRx, &esc);
+
+    DJIMotor_t *motor = MotorInit();
+    TEST_CHECK(motor != NULL);
+    TEST_CHECK(motor->can_device->rx_id == 0x201 && motor->sender_group == 1 && motor->message_num == 0);
+    TEST_CHECK(DJIMotorFeedbackAge(motor) < 0);
+
+    // 反馈解码,时间戳为帧传输结束(接收中断)的时刻
+    uint64_t start = VCAN_Now();
+    EscFeedback(0x1234, 100, 200, 40);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(motor->measure.ecd == 0x1234);
+    TEST_CHECK(motor->measure.temperature == 40);
+    TEST_CHECK(motor->measure.speed_rpm > 89.9f && motor->measure.speed_rpm < 90.1f);
+    TEST_CHECK(motor->measure.stamp == start + FRAME8_CYCLES);
+
+    // 速度环: 10 * (1000 - 90),发出的分组帧与记录的输出一致
+    DJIMotorEnable(motor);
+    DJIMotorSetRef(motor, 1000.0f);
+    int16_t output = ControlTick();
+    TEST_CHECK(output >= 9099 && output <= 9101);
+    TEST_CHECK(esc.frames == 1 && esc.current == output);
+
+    // 反馈中断: 过期前照常计算,过期后保持DJI_FEEDBACK_STALE_HOLD个周期,然后逐周期衰减到0
+    uint8_t fresh = 0, hold = 0;
+    int16_t last = output;
+    for (uint8_t i = 0; i < 40; i++) {
+        int16_t out = ControlTick();
+        TEST_CHECK(out <= last && esc.current == out);
+        if (out == output) {
+            if (DJIMotorFeedbackAge(motor) <= DJI_FEEDBACK_STALE_MS + 1.0f)
+                fresh++;
+            else
+                hold++;
+        }
+        last = out;
+    }
+    TEST_CHECK(fresh >= 2 && hold == DJI_FEEDBACK_STALE_HOLD);
+    TEST_CHECK(last == 0);
+
+    // 反馈恢复后重新闭环: 10 * (1000 - (0.1 * 90 + 0.9 * 100))
+    EscFeedback(0x1234, 100, 200, 40);
+    VCAN_Advance(MS_CYCLES);
+    output = ControlTick();
+    TEST_CHECK(output >= 9009 && output <= 9011);
+
+    // 离线或停止时输出为0
+    fake_offline = 1;
+    EscFeedback(0x1234, 100, 200, 40);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(ControlTick() == 0);
+    TEST_CHECK(esc.current == 0);
+    fake_offline = 0;
+
+    DJIMotorStop(motor);
+    EscFeedback(0x1234, 100, 200, 40);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(ControlTick() == 0);
+    TEST_CHECK(esc.current == 0);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,167 @@
+/**
+ * @file test_dm_motor.c
+ * @brief damiao.c通过bsp_can.c在虚拟总线上收发: 反馈报文解码(位置、速度、力矩、温度、错误码)并带上接收中断的时间戳,
+ *        初始化时发出清除错误命令,MIT模式下LQR输出按12位力矩发出,离线或停止时发出失能命令
+ * @note 离线检测和LQR用本文件中的替身代替,离线状态由测试直接设置,LQR返回测试设定的力矩
+ */
+
+#include "bsp_can.h"
+#include "can.h"
+#include "damiao.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "vcan.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME8_CYCLES ((47 + 64) * (VCAN_CPU_HZ / VCAN_DEFAULT_BITRATE)) // 1Mbps下8字节帧的传输时间
+#define MS_CYCLES (VCAN_CPU_HZ / 1000)
+#define DM_TX_ID 0x01
+#define DM_RX_ID 0x11
+#define RAD_TO_DEG (180.0f / 3.14159265f)
+
+/* 替身 */
+static uint8_t fake_offline;
+static float fake_torque, lqr_state0, lqr_state1;
+
+uint8_t offline_device_register(const OfflineDeviceInit_t *init)
+{
+    (void)init;
+    return 0;
+}
+void offline_device_update(uint8_t device_index) { (void)device_index; }
+uint8_t get_device_status(uint8_t device_index)
+{
+    (void)device_index;
+    return fake_offline;
+}
+void LQRInit(LQRInstance *lqr, LQR_Init_Config_s *config)
+{
+    (void)lqr;
+    (void)config;
+}
+float LQRCalculate(LQRInstance *lqr, float state0, float state1, float ref)
+{
+    (void)lqr;
+    (void)ref;
+    lqr_state0 = state0;
+    lqr_state1 = state1;
+    return fake_torque;
+}
+
+/* 模拟电机: 记录收到的最后一帧 */
+typedef struct {
+    uint32_t frames;
+    uint16_t std_id;
+    uint8_t data[8];
+    uint8_t dlc;
+} DmNode_t;
+
+static DmNode_t node;
+static int8_t node_id;
+
+static void NodeRx(void *ctx, uint16_t std_id, const uint8_t *data, uint8_t dlc)
+{
+    DmNode_t *n = ctx;
+    n->frames++;
+    n->std_id = std_id;
+    n->dlc = dlc;
+    memcpy(n->data, data, dlc);
+}
+
+/* 与电机固件相同的定点映射 */
+static uint16_t Quantize(float x, float min, float max, uint8_t bits)
+{
+    return (uint16_t)((x - min) * (float)((1 << bits) - 1) / (max - min) + 0.5f);
+}
+
+/* 电机的MIT反馈帧: [err<<4|id] [pos 16] [vel 12|torque 12] [T_Mos] [T_Rotor] */
+static void Feedback(uint8_t err, float pos, float vel, float torque, uint8_t t_mos, uint8_t t_rotor)
+{
+    uint16_t p = Quantize(pos, DM_P_MIN, DM_P_MAX, 16);
+    uint16_t v = Quantize(vel, DM_V_MIN, DM_V_MAX, 12);
+    uint16_t t = Quantize(torque, DM_T_MIN, DM_T_MAX, 12);
+    uint8_t data[8] = {(uint8_t)(err << 4 | DM_TX_ID), (uint8_t)(p >> 8), (uint8_t)p, (uint8_t)(v >> 4),
+                       (uint8_t)((v & 0x0F) << 4 | t >> 8), (uint8_t)t, t_mos, t_rotor};
+    VCAN_NodeSend(&hcan1, node_id, DM_RX_ID, data, 8);
+}
+
+static DMMOTOR_t *MotorInit(void)
+{
+    Motor_Init_Config_s config = {
+        .controller_setting_init_config = {
+            .outer_loop_type = ANGLE_LOOP,
+            .close_loop_type = ANGLE_LOOP,
+            .control_algorithm = CONTROL_LQR,
+        },
+        .motor_type = DM4310,
+        .can_init_config = {.can_handle = &hcan1, .tx_id = DM_TX_ID, .rx_id = DM_RX_ID},
+        .offline_device_motor = {.name = "dm4310", .timeout_ms = 50, .enable = OFFLINE_ENABLE},
+    };
+    return DMMotorInit(&config, MIT_MODE);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    VCAN_Reset();
+    node_id = VCAN_AttachNode(&hcan1, NodeRx, &node);
+
+    // 初始化时清除错误
+    DMMOTOR_t *motor = MotorInit();
+    TEST_CHECK(motor != NULL);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(node.frames == 1 && node.std_id == DM_TX_ID + MIT_MODE && node.data[7] == DM_CMD_CLEAR_ERROR);
+    TEST_CHECK(DMMotorFeedbackAge(motor) < 0);
+
+    // 反馈解码,位置和速度换算成角度,时间戳为帧传输结束(接收中断)的时刻
+    uint64_t start = VCAN_Now();
+    Feedback(MOS_OVERTEMP_ERROR, 1.0f, -2.0f, 3.0f, 35, 40);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(motor->measure.id == DM_TX_ID);
+    TEST_CHECK(motor->measure.Error_Code == MOS_OVERTEMP_ERROR);
+    TEST_CHECK(fabsf(motor->measure.position - 1.0f * RAD_TO_DEG) < 0.05f);
+    TEST_CHECK(fabsf(motor->measure.velocity + 2.0f * RAD_TO_DEG) < 1.0f);
+    TEST_CHECK(fabsf(motor->measure.torque - 3.0f) < 0.01f);
+    TEST_CHECK(motor->measure.T_Mos == 35.0f && motor->measure.T_Rotor == 40.0f);
+    TEST_CHECK(motor->measure.stamp == start + FRAME8_CYCLES);
+    TEST_CHECK(DMMotorFeedbackAge(motor) >= 0);
+
+    // 上一次的位置保留在last_position,错误码之外的高4位不当作错误
+    Feedback(0x01, -1.5f, 0.0f, -4.0f, 36, 41);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(motor->measure.Error_Code == DM_NO_ERROR);
+    TEST_CHECK(fabsf(motor->measure.last_position - 1.0f * RAD_TO_DEG) < 0.05f);
+    TEST_CHECK(fabsf(motor->measure.position + 1.5f * RAD_TO_DEG) < 0.05f);
+    TEST_CHECK(fabsf(motor->measure.torque + 4.0f) < 0.01f);
+
+    // 使能后MIT帧只带力矩,LQR的状态为解码出的位置和速度
+    DMMotorEnable(motor);
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(node.std_id == DM_TX_ID + MIT_MODE && node.data[7] == DM_CMD_MOTOR_MODE);
+    fake_torque = 2.5f;
+    DMMotorcontrol();
+    CAN_SchedFlush();
+    VCAN_Advance(MS_CYCLES);
+    uint16_t torque = (uint16_t)((node.data[6] & 0x0F) << 8 | node.data[7]);
+    TEST_CHECK(node.std_id == DM_TX_ID + MIT_MODE && node.dlc == 8);
+    TEST_CHECK(abs((int)torque - Quantize(2.5f, DM_T_MIN, DM_T_MAX, 12)) <= 1);
+    TEST_CHECK(lqr_state0 == motor->measure.position && lqr_state1 == motor->measure.velocity);
+
+    // 离线或停止时发出失能命令
+    fake_offline = 1;
+    DMMotorcontrol();
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(node.data[7] == DM_CMD_RESET_MODE);
+    fake_offline = 0;
+
+    DMMotorStop(motor);
+    node.data[7] = 0;
+    DMMotorcontrol();
+    VCAN_Advance(MS_CYCLES);
+    TEST_CHECK(node.data[7] == DM_CMD_RESET_MODE);
+
+    return HOST_TEST_RESULT();
+}
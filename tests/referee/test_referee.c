@@ -0,0 +1,160 @@
+/**
+ * @file test_referee.c
+ * @brief referee.c的RefereeParseStream: 裁判系统帧夹杂噪声、CRC错误的帧和长度超限的帧头,被DMA按随机长度分段写入
+ *        1024字节的环形缓冲区,裁判系统任务解析出全部正确的帧,一帧也不多、不早于收完,跨过缓冲区末尾的帧同样解析;
+ *        哨兵可以免费复活时通过DMA发送带正确CRC的复活指令
+ * @note 串口由vuart.h模拟,离线检测用本文件中的替身代替,每解析一帧调用一次offline_device_update()
+ */
+
+#include "crc_rm.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "referee.h"
+#include "usart.h"
+#include "vuart.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define STREAM_LEN (64 * 1024)
+#define OTHER_CMD 0x0120 // referee.c不解析的命令码,只计数,用来产生长度不同的帧
+
+/* 替身 */
+static uint32_t frames_parsed;
+
+uint8_t offline_device_register(const OfflineDeviceInit_t *init)
+{
+    (void)init;
+    return 0;
+}
+void offline_device_update(uint8_t device_index)
+{
+    (void)device_index;
+    frames_parsed++;
+}
+
+static uint8_t stream[STREAM_LEN];
+static uint32_t frame_end[STREAM_LEN / 9]; // 每个正确帧最后一个字节之后的位置
+static uint32_t frame_count;
+
+static uint16_t PutFrame(uint8_t *out, uint16_t cmd, const uint8_t *data, uint16_t len)
+{
+    out[SOF] = REFEREE_SOF;
+    out[DATA_LENGTH] = (uint8_t)len;
+    out[DATA_LENGTH + 1] = (uint8_t)(len >> 8);
+    out[3] = (uint8_t)rand();
+    Append_CRC8_Check_Sum(out, LEN_HEADER);
+    out[5] = (uint8_t)cmd;
+    out[6] = (uint8_t)(cmd >> 8);
+    memcpy(out + DATA_Offset, data, len);
+    uint16_t frame_len = LEN_HEADER + LEN_CMDID + len + LEN_TAIL;
+    Append_CRC16_Check_Sum(out, frame_len);
+    return frame_len;
+}
+
+/* 随机的正确帧、噪声、CRC16错误的帧和长度超限的帧头,返回流的长度,最后一帧功率热量数据的序号写入last_seq */
+static uint32_t BuildStream(uint32_t *last_seq)
+{
+    uint32_t n = 0, seq = 0;
+    uint8_t data[256];
+    frame_count = 0;
+    while (n + 300 < STREAM_LEN) {
+        switch (rand() % 8) {
+        case 0: // 噪声,不含帧头字节
+            for (int k = rand() % 8; k >= 0; k--)
+                stream[n++] = (uint8_t)(rand() % REFEREE_SOF);
+            break;
+        case 1: { // CRC16错误
+            for (uint16_t i = 0; i < LEN_power_heat_data; i++)
+                data[i] = (uint8_t)(rand() % REFEREE_SOF);
+            uint16_t len = PutFrame(&stream[n], ID_power_heat_data, data, LEN_power_heat_data);
+            stream[n + DATA_Offset + 3] ^= 0x40;
+            n += len;
+            break;
+        }
+        case 2: { // 帧头CRC8正确但长度超过REFEREE_FRAME_MAX_LEN
+            stream[n] = REFEREE_SOF;
+            stream[n + 1] = 0x2C;
+            stream[n + 2] = 0x01;
+            stream[n + 3] = 0;
+            Append_CRC8_Check_Sum(&stream[n], LEN_HEADER);
+            n += LEN_HEADER;
+            break;
+        }
+        case 3:
+        case 4: { // 不解析的命令,长度1~200
+            uint16_t len = (uint16_t)(1 + rand() % 200);
+            for (uint16_t i = 0; i < len; i++)
+                data[i] = (uint8_t)rand();
+            n += PutFrame(&stream[n], OTHER_CMD, data, len);
+            frame_end[frame_count++] = n;
+            break;
+        }
+        default: { // 功率热量数据,前4字节为序号
+            for (uint16_t i = 0; i < LEN_power_heat_data; i++)
+                data[i] = (uint8_t)rand();
+            memcpy(data, &seq, 4);
+            *last_seq = seq++;
+            n += PutFrame(&stream[n], ID_power_heat_data, data, LEN_power_heat_data);
+            frame_end[frame_count++] = n;
+            break;
+        }
+        }
+    }
+    return n;
+}
+
+static void TestRandomSplits(void)
+{
+    uint32_t last_seq = 0;
+    uint32_t len = BuildStream(&last_seq);
+    uint32_t pos = 0, complete = 0, early = 0;
+    while (pos < len) {
+        uint16_t k = (uint16_t)(1 + rand() % 120);
+        if (k > len - pos)
+            k = (uint16_t)(len - pos);
+        TEST_CHECK(VUART_Receive(&huart6, stream + pos, k) == k);
+        pos += k;
+        while (complete < frame_count && frame_end[complete] <= pos)
+            complete++;
+        early += frames_parsed > complete; // 不能解析还没收完的帧
+    }
+    TEST_CHECK(early == 0);
+    TEST_CHECK(frames_parsed == frame_count);
+
+    uint16_t data_len;
+    const ext_power_heat_data_t *power = GetRefereeDataByCmd(ID_power_heat_data, &data_len);
+    uint32_t seq;
+    memcpy(&seq, power, 4);
+    TEST_CHECK(data_len == sizeof(*power) && seq == last_seq);
+}
+
+static void TestFreeRevive(void)
+{
+    uint8_t frame[64];
+    sentry_info_t info = {.sentry_can_free_revive = 1};
+    uint32_t before = frames_parsed;
+    uint16_t len = PutFrame(frame, ID_sentry_info, (const uint8_t *)&info, LEN_sentry_info);
+    VUART_Receive(&huart6, frame, len);
+    TEST_CHECK(frames_parsed == before + 1);
+
+    uint8_t tx[64];
+    uint16_t tx_len = VUART_TxDrain(&huart6, tx, sizeof(tx));
+    TEST_CHECK(tx_len > LEN_HEADER + LEN_CMDID + LEN_TAIL);
+    TEST_CHECK(tx[SOF] == REFEREE_SOF && Verify_CRC8_Check_Sum(tx, LEN_HEADER) == RM_TRUE);
+    TEST_CHECK(Verify_CRC16_Check_Sum(tx, tx_len) == RM_TRUE);
+    TEST_CHECK((tx[5] | tx[6] << 8) == ID_student_interactive);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    VUART_Reset();
+    srand(1);
+    RefereeInit();
+    TEST_CHECK(Host_WaitIdle(VUART_IDLE_TIMEOUT_MS));
+
+    TestRandomSplits();
+    TestFreeRevive();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,384 @@
+/**
+ * @file test_bsp_spi.c
+ * @brief bsp_spi.c的异步传输队列: 同一总线上的传输按提交顺序进行,DMA完成中断中先拉高CS并启动下一次传输,再调用回调;
+ *        回调中可以接着提交;队列满时拒绝提交;阻塞传输占用总线时提交的传输等它释放总线后再启动;
+ *        启动失败和DMA出错时以HAL_ERROR回调并继续后面的传输;只发送和只接收使用对应的DMA函数
+ * @note HAL的SPI和GPIO函数用本文件中的替身代替: DMA启动后由测试调用DmaComplete()在中断中结束传输,
+ *       收到的数据为发送数据按位取反.CS、DMA启动和回调按发生顺序记入events
+ */
+
+#include "bsp_spi.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "spi.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+/* 一次测试用的传输,name用于记录事件 */
+typedef struct {
+    SPI_Transfer_t xfer;
+    char name;
+    uint8_t tx[4];
+    uint8_t rx[4];
+    HAL_StatusTypeDef status; // 回调时的状态
+    uint32_t calls;
+} Xfer_t;
+
+static Xfer_t xfers[12];
+static SPI_DeviceInstance_t *dev1, *dev2;
+
+/* 事件记录: cs1/CS1为设备1的CS拉低/拉高,dmaA为传输A的DMA启动,cbA为A的回调(出错时cbA!) */
+static char events[512];
+
+static void Event(const char *fmt, ...)
+{
+    va_list ap;
+    size_t len = strlen(events);
+    va_start(ap, fmt);
+    vsnprintf(events + len, sizeof(events) - len, fmt, ap);
+    va_end(ap);
+}
+
+static char NameOf(const uint8_t *tx, const uint8_t *rx)
+{
+    for (uint8_t i = 0; i < sizeof(xfers) / sizeof(xfers[0]); i++)
+        if ((tx && tx == xfers[i].tx) || (rx && rx == xfers[i].rx))
+            return xfers[i].name;
+    return '?';
+}
+
+/* 替身 */
+SPI_HandleTypeDef hspi1, hspi2;
+
+typedef enum { DMA_NONE, DMA_TX, DMA_RX, DMA_TXRX } DmaKind_t;
+static struct {
+    DmaKind_t kind;
+    SPI_HandleTypeDef *hspi;
+    const uint8_t *tx;
+    uint8_t *rx;
+    uint16_t size;
+} dma;
+static uint8_t dma_fail;              // 接下来启动失败的次数
+static void (*blocking_hook)(void);   // 阻塞传输进行中调用,模拟此时到来的中断
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    (void)GPIOx;
+    (void)GPIO_Init;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    (void)GPIO_Pin;
+    Event("%s%d ", PinState == GPIO_PIN_SET ? "CS" : "cs", GPIOx == GPIOA ? 1 : 2);
+}
+
+static HAL_StatusTypeDef DmaStart(SPI_HandleTypeDef *hspi, DmaKind_t kind, const uint8_t *tx, uint8_t *rx,
+                                  uint16_t size)
+{
+    TEST_CHECK(dma.kind == DMA_NONE); // 上一次传输结束之前不会启动下一次
+    if (dma_fail) {
+        dma_fail--;
+        Event("fail%c ", NameOf(tx, rx));
+        return HAL_ERROR;
+    }
+    Event("dma%c ", NameOf(tx, rx));
+    dma.kind = kind;
+    dma.hspi = hspi;
+    dma.tx = tx;
+    dma.rx = rx;
+    dma.size = size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size)
+{
+    return DmaStart(hspi, DMA_TX, pData, NULL, Size);
+}
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+    return DmaStart(hspi, DMA_RX, NULL, pData, Size);
+}
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData,
+                                              uint16_t Size)
+{
+    return DmaStart(hspi, DMA_TXRX, pTxData, pRxData, Size);
+}
+HAL_StatusTypeDef HAL_SPI_Transmit_IT(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size)
+{
+    return HAL_SPI_Transmit_DMA(hspi, pData, Size);
+}
+HAL_StatusTypeDef HAL_SPI_Receive_IT(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+    return HAL_SPI_Receive_DMA(hspi, pData, Size);
+}
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_IT(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData,
+                                             uint16_t Size)
+{
+    return HAL_SPI_TransmitReceive_DMA(hspi, pTxData, pRxData, Size);
+}
+
+static HAL_StatusTypeDef Blocking(const uint8_t *tx, uint8_t *rx, uint16_t size)
+{
+    Event("blk ");
+    if (blocking_hook)
+        blocking_hook();
+    for (uint16_t i = 0; rx && i < size; i++)
+        rx[i] = tx ? (uint8_t)~tx[i] : 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)hspi;
+    (void)Timeout;
+    return Blocking(pData, NULL, Size);
+}
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)hspi;
+    (void)Timeout;
+    return Blocking(NULL, pData, Size);
+}
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData,
+                                          uint16_t Size, uint32_t Timeout)
+{
+    (void)hspi;
+    (void)Timeout;
+    return Blocking(pTxData, pRxData, Size);
+}
+
+/* 在中断中结束正在进行的DMA传输 */
+static void DmaComplete(HAL_StatusTypeDef status)
+{
+    TEST_CHECK(dma.kind != DMA_NONE);
+    DmaKind_t kind = dma.kind;
+    SPI_HandleTypeDef *hspi = dma.hspi;
+    for (uint16_t i = 0; dma.rx && i < dma.size; i++)
+        dma.rx[i] = dma.tx ? (uint8_t)~dma.tx[i] : 0x5A;
+    dma.kind = DMA_NONE;
+    Host_IsrEnter();
+    if (status != HAL_OK)
+        HAL_SPI_ErrorCallback(hspi);
+    else if (kind == DMA_TX)
+        HAL_SPI_TxCpltCallback(hspi);
+    else if (kind == DMA_RX)
+        HAL_SPI_RxCpltCallback(hspi);
+    else
+        HAL_SPI_TxRxCpltCallback(hspi);
+    Host_IsrExit();
+}
+
+static Xfer_t *resubmit; // 回调中再提交一次的传输
+
+static void Callback(SPI_Transfer_t *xfer, HAL_StatusTypeDef status)
+{
+    Xfer_t *x = xfer->arg;
+    x->status = status;
+    x->calls++;
+    Event(status == HAL_OK ? "cb%c " : "cb%c! ", x->name);
+    if (resubmit) {
+        Xfer_t *next = resubmit;
+        resubmit = NULL;
+        TEST_CHECK(BSP_SPI_Submit(&next->xfer) == HAL_OK);
+    }
+}
+
+static Xfer_t *NewXfer(uint8_t idx, SPI_DeviceInstance_t *dev, uint8_t has_tx, uint8_t has_rx)
+{
+    Xfer_t *x = &xfers[idx];
+    memset(x, 0, sizeof(*x));
+    x->name = (char)('A' + idx);
+    for (uint8_t i = 0; i < sizeof(x->tx); i++)
+        x->tx[i] = (uint8_t)(idx * 16 + i);
+    x->xfer = (SPI_Transfer_t){.dev = dev,
+                               .tx_data = has_tx ? x->tx : NULL,
+                               .rx_data = has_rx ? x->rx : NULL,
+                               .size = sizeof(x->tx),
+                               .callback = Callback,
+                               .arg = x};
+    return x;
+}
+
+static void Reset(void)
+{
+    events[0] = '\0';
+}
+
+/* 提交的传输依次进行,CS拉高后立即启动下一次,再回调上一次 */
+static void TestBackToBack(void)
+{
+    Xfer_t *a = NewXfer(0, dev1, 1, 1), *b = NewXfer(1, dev2, 1, 1), *c = NewXfer(2, dev1, 1, 1);
+    SPI_BusStats_t stats;
+    Reset();
+    TEST_CHECK(BSP_SPI_Submit(&a->xfer) == HAL_OK);
+    TEST_CHECK(BSP_SPI_Submit(&b->xfer) == HAL_OK);
+    TEST_CHECK(BSP_SPI_Submit(&c->xfer) == HAL_OK);
+    TEST_CHECK(strcmp(events, "cs1 dmaA ") == 0);
+    DmaComplete(HAL_OK);
+    DmaComplete(HAL_OK);
+    DmaComplete(HAL_OK);
+    TEST_CHECK(strcmp(events, "cs1 dmaA CS1 cs2 dmaB cbA CS2 cs1 dmaC cbB CS1 cbC ") == 0);
+    TEST_CHECK(a->calls == 1 && b->calls == 1 && c->calls == 1 && a->status == HAL_OK);
+    TEST_CHECK(a->rx[0] == (uint8_t)~a->tx[0] && c->rx[3] == (uint8_t)~c->tx[3]);
+    BSP_SPI_GetBusStats(SPI_BUS1, &stats);
+    TEST_CHECK(stats.submitted == 3 && stats.completed == 3 && stats.errors == 0 && stats.max_depth == 2);
+}
+
+/* 回调中提交的传输在回调返回前就已开始 */
+static void TestSubmitFromCallback(void)
+{
+    Xfer_t *a = NewXfer(0, dev1, 1, 1), *b = NewXfer(1, dev1, 1, 1);
+    Reset();
+    TEST_CHECK(BSP_SPI_Submit(&a->xfer) == HAL_OK);
+    resubmit = b;
+    DmaComplete(HAL_OK);
+    TEST_CHECK(strcmp(events, "cs1 dmaA CS1 cbA cs1 dmaB ") == 0);
+    DmaComplete(HAL_OK);
+    TEST_CHECK(b->calls == 1 && dma.kind == DMA_NONE);
+}
+
+/* 只发送和只接收 */
+static void TestDirections(void)
+{
+    Xfer_t *tx = NewXfer(0, dev1, 1, 0), *rx = NewXfer(1, dev2, 0, 1);
+    Reset();
+    TEST_CHECK(BSP_SPI_Submit(&tx->xfer) == HAL_OK);
+    TEST_CHECK(dma.kind == DMA_TX && dma.rx == NULL);
+    TEST_CHECK(BSP_SPI_Submit(&rx->xfer) == HAL_OK);
+    DmaComplete(HAL_OK);
+    TEST_CHECK(dma.kind == DMA_RX && dma.tx == NULL);
+    DmaComplete(HAL_OK);
+    TEST_CHECK(tx->calls == 1 && rx->calls == 1 && rx->rx[0] == 0x5A);
+}
+
+/* 队列满时拒绝提交,正在进行的传输不占队列 */
+static void TestQueueFull(void)
+{
+    SPI_BusStats_t before, after;
+    BSP_SPI_GetBusStats(SPI_BUS1, &before);
+    Reset();
+    for (uint8_t i = 0; i <= BSP_SPI_XFER_QUEUE_LEN; i++)
+        TEST_CHECK(BSP_SPI_Submit(&NewXfer(i, dev1, 1, 1)->xfer) == HAL_OK);
+    Xfer_t *extra = NewXfer(BSP_SPI_XFER_QUEUE_LEN + 1, dev1, 1, 1);
+    TEST_CHECK(BSP_SPI_Submit(&extra->xfer) == HAL_BUSY);
+    for (uint8_t i = 0; i <= BSP_SPI_XFER_QUEUE_LEN; i++)
+        DmaComplete(HAL_OK);
+    TEST_CHECK(dma.kind == DMA_NONE && extra->calls == 0);
+    for (uint8_t i = 0; i <= BSP_SPI_XFER_QUEUE_LEN; i++)
+        TEST_CHECK(xfers[i].calls == 1);
+    BSP_SPI_GetBusStats(SPI_BUS1, &after);
+    TEST_CHECK(after.queue_full == before.queue_full + 1 && after.max_depth == BSP_SPI_XFER_QUEUE_LEN);
+    TEST_CHECK(after.completed == before.completed + BSP_SPI_XFER_QUEUE_LEN + 1);
+}
+
+/* 阻塞传输进行中到来的提交等它拉高CS、释放总线后再启动 */
+static Xfer_t *pending;
+
+static void SubmitFromIsr(void)
+{
+    Host_IsrEnter();
+    TEST_CHECK(BSP_SPI_Submit(&pending->xfer) == HAL_OK);
+    Host_IsrExit();
+}
+
+static void TestBlockingHoldsBus(void)
+{
+    uint8_t tx[2] = {0x12, 0x34}, rx[2];
+    pending = NewXfer(0, dev1, 1, 1);
+    Reset();
+    blocking_hook = SubmitFromIsr;
+    TEST_CHECK(BSP_SPI_TransReceive(dev2, tx, rx, sizeof(tx)) == HAL_OK);
+    blocking_hook = NULL;
+    TEST_CHECK(rx[0] == (uint8_t)~0x12 && rx[1] == (uint8_t)~0x34);
+    TEST_CHECK(strcmp(events, "cs2 blk CS2 cs1 dmaA ") == 0);
+
+    // 异步传输占用总线时阻塞传输拿不到总线锁
+    TEST_CHECK(BSP_SPI_TransReceive(dev2, tx, rx, sizeof(tx)) == HAL_TIMEOUT);
+    DmaComplete(HAL_OK);
+    TEST_CHECK(pending->calls == 1);
+    TEST_CHECK(BSP_SPI_TransReceive(dev2, tx, rx, sizeof(tx)) == HAL_OK);
+}
+
+/* 启动失败时立即以HAL_ERROR回调,接着启动后面的传输 */
+static void TestStartError(void)
+{
+    Xfer_t *a = NewXfer(0, dev1, 1, 1), *b = NewXfer(1, dev2, 1, 1), *c = NewXfer(2, dev1, 1, 1);
+    SPI_BusStats_t before, after;
+    BSP_SPI_GetBusStats(SPI_BUS1, &before);
+    Reset();
+    dma_fail = 1;
+    TEST_CHECK(BSP_SPI_Submit(&a->xfer) == HAL_OK);
+    TEST_CHECK(a->calls == 1 && a->status == HAL_ERROR && dma.kind == DMA_NONE);
+
+    TEST_CHECK(BSP_SPI_Submit(&a->xfer) == HAL_OK);
+    TEST_CHECK(BSP_SPI_Submit(&b->xfer) == HAL_OK);
+    TEST_CHECK(BSP_SPI_Submit(&c->xfer) == HAL_OK);
+    dma_fail = 1;
+    DmaComplete(HAL_OK);
+    TEST_CHECK(strcmp(events, "cs1 failA CS1 cbA! cs1 dmaA CS1 cs2 failB CS2 cbB! cs1 dmaC cbA ") == 0);
+    DmaComplete(HAL_OK);
+    TEST_CHECK(b->status == HAL_ERROR && c->calls == 1 && c->status == HAL_OK);
+    BSP_SPI_GetBusStats(SPI_BUS1, &after);
+    TEST_CHECK(after.errors == before.errors + 2 && after.completed == before.completed + 2);
+}
+
+/* DMA出错时以HAL_ERROR回调,总线释放,后面的传输照常进行 */
+static void TestDmaError(void)
+{
+    Xfer_t *a = NewXfer(0, dev1, 1, 1), *b = NewXfer(1, dev2, 1, 1);
+    Reset();
+    TEST_CHECK(BSP_SPI_Submit(&a->xfer) == HAL_OK);
+    TEST_CHECK(BSP_SPI_Submit(&b->xfer) == HAL_OK);
+    DmaComplete(HAL_ERROR);
+    DmaComplete(HAL_OK);
+    TEST_CHECK(strcmp(events, "cs1 dmaA CS1 cs2 dmaB cbA! CS2 cbB ") == 0);
+    TEST_CHECK(a->status == HAL_ERROR && b->status == HAL_OK);
+}
+
+static void TestInvalid(void)
+{
+    Xfer_t *a = NewXfer(0, dev1, 0, 0);
+    TEST_CHECK(BSP_SPI_Submit(NULL) == HAL_ERROR);
+    TEST_CHECK(BSP_SPI_Submit(&a->xfer) == HAL_ERROR); // 既不发送也不接收
+    a = NewXfer(0, dev1, 1, 1);
+    a->xfer.size = 0;
+    TEST_CHECK(BSP_SPI_Submit(&a->xfer) == HAL_ERROR);
+
+    // 没有注册过设备的总线
+    SPI_DeviceInstance_t other = {.target_bus = SPI_BUS2, .cs_port = GPIOB, .cs_pin = GPIO_PIN_12};
+    a = NewXfer(0, &other, 1, 1);
+    TEST_CHECK(BSP_SPI_Submit(&a->xfer) == HAL_ERROR);
+    TEST_CHECK(dma.kind == DMA_NONE);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+
+    // BMI088的两个片选: 加速度计PA4,陀螺仪PB0
+    SPI_DeviceInstance_t config = {
+        .target_bus = SPI_BUS1,
+        .cs_port = GPIOA,
+        .cs_pin = GPIO_PIN_4,
+        .tx_mode = BSP_SPI_MODE_BLOCKING,
+        .rx_mode = BSP_SPI_MODE_BLOCKING,
+        .timeout = 1000,
+    };
+    dev1 = SPI_DeviceRegister(&config);
+    config.cs_port = GPIOB;
+    config.cs_pin = GPIO_PIN_0;
+    dev2 = SPI_DeviceRegister(&config);
+    TEST_CHECK(dev1 && dev2);
+
+    TestBackToBack();
+    TestSubmitFromCallback();
+    TestDirections();
+    TestQueueFull();
+    TestBlockingHoldsBus();
+    TestStartError();
+    TestDmaError();
+    TestInvalid();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,37 @@
+/**
+ * @file FreeRTOS.h
+ * @brief 主机测试用的FreeRTOS替身,只提供被测模块用到的类型和宏,实现见host_rtos.c
+ * @note 任务即pthread线程,临界区为一把全局递归锁,tick为启动以来的毫秒数
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configASSERT(x) assert(x)
+
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+#define portEND_SWITCHING_ISR(woken) ((void)(woken))
+
+void *pvPortMalloc(size_t size);
+void vPortFree(void *ptr);
+
+/* 当前线程是否处于Host_IsrEnter()/Host_IsrExit()之间 */
+BaseType_t xPortIsInsideInterrupt(void);
+
+#endif // !HOST_FREERTOS_H
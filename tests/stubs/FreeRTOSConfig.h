@@ -0,0 +1,11 @@
+/**
+ * @file FreeRTOSConfig.h
+ * @brief Inc/FreeRTOSConfig.h替身,被测代码直接包含它时使用FreeRTOS.h替身中的配置
+ */
+
+#ifndef HOST_FREERTOS_CONFIG_H
+#define HOST_FREERTOS_CONFIG_H
+
+#include "FreeRTOS.h"
+
+#endif // !HOST_FREERTOS_CONFIG_H
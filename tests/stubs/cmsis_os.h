@@ -0,0 +1,58 @@
+/**
+ * @file cmsis_os.h
+ * @brief CMSIS-RTOS v1替身,只提供被测模块用到的线程接口,线程即pthread,实现见host_rtos.c
+ */
+
+#ifndef HOST_CMSIS_OS_H
+#define HOST_CMSIS_OS_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef enum
+{
+    osPriorityIdle = -3,
+    osPriorityLow = -2,
+    osPriorityBelowNormal = -1,
+    osPriorityNormal = 0,
+    osPriorityAboveNormal = +1,
+    osPriorityHigh = +2,
+    osPriorityRealtime = +3,
+    osPriorityError = 0x84,
+} osPriority;
+
+typedef enum
+{
+    osOK = 0,
+    osEventTimeout = 0x40,
+    osErrorParameter = 0x80,
+    osErrorResource = 0x81,
+} osStatus;
+
+#define osWaitForever 0xFFFFFFFF
+
+typedef TaskHandle_t osThreadId;
+typedef void (*os_pthread)(void const *argument);
+
+typedef struct os_thread_def
+{
+    char *name;
+    os_pthread pthread;
+    osPriority tpriority;
+    uint32_t instances;
+    uint32_t stacksize;
+} osThreadDef_t;
+
+#define osThreadDef(name, thread, priority, instances, stacksz) \
+    const osThreadDef_t os_thread_def_##name = {#name, (thread), (priority), (instances), (stacksz)}
+#define osThread(name) &os_thread_def_##name
+
+/**
+ * @brief 创建一个pthread运行线程函数,线程被计入Host_WaitIdle()等待的任务
+ */
+osThreadId osThreadCreate(const osThreadDef_t *thread_def, void *argument);
+osThreadId osThreadGetId(void);
+osStatus osDelay(uint32_t millisec);
+uint32_t osKernelSysTick(void);
+
+#endif // !HOST_CMSIS_OS_H
@@ -0,0 +1,76 @@
+/**
+ * @file cmsis_gcc.h
+ * @brief 替换Drivers/CMSIS/Include/cmsis_gcc.h,让core_cm4.h和HAL头文件可以在主机gcc上编译
+ * @note core_cm4.h经cmsis_compiler.h按相对路径包含cmsis_gcc.h,不能通过包含路径替换,
+ *       因此由CMake用-include在每个源文件之前包含本文件,之后真正的cmsis_gcc.h因包含保护而被跳过
+ * @note 内存屏障为原子栅栏,关中断为host_rtos.c中的全局临界区锁,其他指令给出等效的C实现
+ */
+
+#ifndef __CMSIS_GCC_H
+#define __CMSIS_GCC_H
+
+#include <stdint.h>
+
+#define __ASM                   __asm
+#define __INLINE                inline
+#define __STATIC_INLINE         static inline
+#define __STATIC_FORCEINLINE    __attribute__((always_inline)) static inline
+#define __NO_RETURN             __attribute__((__noreturn__))
+#define __USED                  __attribute__((used))
+#define __WEAK                  __attribute__((weak))
+#define __PACKED                __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT         struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION          union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)            __attribute__((aligned(x)))
+#define __RESTRICT              __restrict
+#define __COMPILER_BARRIER()    __ASM volatile("" ::: "memory")
+
+__PACKED_STRUCT T_UINT16_WRITE { uint16_t v; };
+__PACKED_STRUCT T_UINT16_READ { uint16_t v; };
+__PACKED_STRUCT T_UINT32_WRITE { uint32_t v; };
+__PACKED_STRUCT T_UINT32_READ { uint32_t v; };
+#define __UNALIGNED_UINT16_WRITE(addr, val) (void)((((struct T_UINT16_WRITE *)(void *)(addr))->v) = (val))
+#define __UNALIGNED_UINT16_READ(addr)       (((const struct T_UINT16_READ *)(const void *)(addr))->v)
+#define __UNALIGNED_UINT32_WRITE(addr, val) (void)((((struct T_UINT32_WRITE *)(void *)(addr))->v) = (val))
+#define __UNALIGNED_UINT32_READ(addr)       (((const struct T_UINT32_READ *)(const void *)(addr))->v)
+
+#define __NOP()         __COMPILER_BARRIER()
+#define __WFI()         __COMPILER_BARRIER()
+#define __WFE()         __COMPILER_BARRIER()
+#define __SEV()         __COMPILER_BARRIER()
+#define __BKPT(value)   __builtin_trap()
+
+__STATIC_FORCEINLINE void __ISB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+__STATIC_FORCEINLINE void __DSB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+__STATIC_FORCEINLINE void __DMB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+__STATIC_FORCEINLINE uint32_t __REV(uint32_t value) { return __builtin_bswap32(value); }
+__STATIC_FORCEINLINE uint32_t __REV16(uint32_t value)
+{
+    return ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8);
+}
+__STATIC_FORCEINLINE uint8_t __CLZ(uint32_t value) { return value ? (uint8_t)__builtin_clz(value) : 32u; }
+
+__STATIC_FORCEINLINE int32_t __SSAT(int32_t val, uint32_t sat)
+{
+    const int32_t max = (int32_t)((1u << (sat - 1u)) - 1u);
+    const int32_t min = -1 - max;
+    return val > max ? max : val < min ? min : val;
+}
+
+__STATIC_FORCEINLINE uint32_t __USAT(int32_t val, uint32_t sat)
+{
+    const uint32_t max = (1u << sat) - 1u;
+    return val > (int32_t)max ? max : val < 0 ? 0u : (uint32_t)val;
+}
+
+/* PRIMASK: 1表示当前线程持有临界区锁,嵌套由递归锁计数 */
+uint32_t Host_PrimaskGet(void);
+void Host_PrimaskSet(uint32_t primask);
+
+__STATIC_FORCEINLINE void __disable_irq(void) { Host_PrimaskSet(1u); }
+__STATIC_FORCEINLINE void __enable_irq(void) { Host_PrimaskSet(0u); }
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void) { return Host_PrimaskGet(); }
+__STATIC_FORCEINLINE void __set_PRIMASK(uint32_t primask) { Host_PrimaskSet(primask); }
+
+#endif // !__CMSIS_GCC_H
@@ -0,0 +1,22 @@
+/**
+ * @file main.h
+ * @brief 在Inc/main.h之后把被测代码直接访问的外设寄存器换成主机内存中的替身
+ * @note CAN1/CAN2的寄存器由hal_can_host.c维护(ESR等),DWT->CYCCNT每次访问时从host_dwt.c取当前周期数
+ */
+
+#ifndef HOST_MAIN_H
+#define HOST_MAIN_H
+
+#include_next "main.h"
+
+extern CAN_TypeDef host_can_regs[2];
+DWT_Type *Host_DwtRegs(void);
+
+#undef CAN1
+#undef CAN2
+#undef DWT
+#define CAN1 (&host_can_regs[0])
+#define CAN2 (&host_can_regs[1])
+#define DWT (Host_DwtRegs())
+
+#endif // !HOST_MAIN_H
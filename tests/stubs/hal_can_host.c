@@ -0,0 +1,642 @@
+/**
+ * @file hal_can_host.c
+ * @brief HAL_CAN_*在主机上的实现,外设换成vcan.h中的虚拟总线,hcan1/hcan2也由本文件定义,代替Src/can.c
+ * @note 所有接口都在临界区锁中访问总线状态,模拟中断的回调也在锁中执行,与板上中断和关中断的关系一致
+ */
+
+#include "vcan.h"
+
+#include <string.h>
+#include "host_dwt.h"
+#include "host_rtos.h"
+
+#if defined(CAN_HOST_SOCKETCAN)
+#include <fcntl.h>
+#include <linux/can.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define LOG_TAG "vcan"
+#include "elog.h"
+
+#define VCAN_SRC_FIRMWARE  (-1) // 固件通过发送邮箱发出的报文
+#define VCAN_SRC_SOCKET    (-2) // 从SocketCAN接口注入的报文
+#define VCAN_FRAME_OVERHEAD_BITS 47 // 标准数据帧除数据段外的位数,含帧间隔,不计位填充
+#define VCAN_TX_MAILBOXES  3
+#define VCAN_RX_FIFO_LEN   3
+#define VCAN_FILTER_BANKS  28
+#define VCAN_STD_ID_MASK   0x7FF
+
+CAN_TypeDef host_can_regs[2];
+CAN_HandleTypeDef hcan1;
+CAN_HandleTypeDef hcan2;
+
+/* 等待仲裁或正在传输的一帧 */
+typedef struct {
+    uint16_t std_id;
+    uint8_t dlc;
+    uint8_t data[8];
+    int8_t src;     // 发送者,节点编号或VCAN_SRC_*
+    uint8_t mailbox;// 固件报文所在的邮箱
+    uint64_t ready; // 进入仲裁的时刻
+    uint32_t seq;   // 同一发送者按请求顺序发送
+} VCAN_Frame_t;
+
+typedef struct {
+    VCAN_NodeRx_t rx;
+    void *ctx;
+} VCAN_Node_t;
+
+typedef struct {
+    CAN_RxHeaderTypeDef header;
+    uint8_t data[8];
+} VCAN_RxEntry_t;
+
+typedef struct {
+    CAN_HandleTypeDef *hcan;
+    uint32_t bitrate;
+    uint64_t idle_at; // 总线空闲的时刻,即上一帧传输结束的时刻
+    VCAN_Frame_t pending[VCAN_PENDING_LEN];
+    uint16_t pending_len;
+    uint32_t seq;
+    VCAN_Node_t nodes[VCAN_MAX_NODES];
+    uint8_t node_count;
+    int sock;
+
+    uint32_t it_enabled;    // HAL_CAN_ActivateNotification()打开的中断
+    uint8_t mailbox_used;   // 按位表示邮箱中有待发送的报文
+    uint8_t abort_irq;      // 已中止、等待进入中止中断的邮箱
+    VCAN_RxEntry_t fifo[2][VCAN_RX_FIFO_LEN];
+    uint8_t fifo_len[2];
+    uint32_t fifo_overrun[2];
+} VCAN_Bus_t;
+
+/* 过滤器组由两条总线共用,SlaveStartFilterBank之前属于CAN1 */
+typedef struct {
+    CAN_FilterTypeDef conf;
+    uint8_t active;
+} VCAN_Filter_t;
+
+static VCAN_Bus_t vcan_bus[2];
+static VCAN_Filter_t vcan_filter[VCAN_FILTER_BANKS];
+static uint32_t vcan_slave_start = 14;
+static uint64_t vcan_now;
+
+static VCAN_Bus_t *VCAN_GetBus(const CAN_HandleTypeDef *hcan)
+{
+    return &vcan_bus[hcan->Instance == CAN2 ? 1 : 0];
+}
+
+void VCAN_Reset(void)
+{
+    Host_CriticalEnter();
+    memset(vcan_bus, 0, sizeof(vcan_bus));
+    memset(vcan_filter, 0, sizeof(vcan_filter));
+    memset(host_can_regs, 0, sizeof(host_can_regs));
+    vcan_slave_start = 14;
+    for (uint8_t i = 0; i < 2; i++) {
+        CAN_HandleTypeDef *hcan = i ? &hcan2 : &hcan1;
+        memset(hcan, 0, sizeof(*hcan));
+        hcan->Instance = i ? CAN2 : CAN1;
+        hcan->State = HAL_CAN_STATE_READY; // MX_CANx_Init()之后的状态
+        vcan_bus[i].hcan = hcan;
+        vcan_bus[i].bitrate = VCAN_DEFAULT_BITRATE;
+        vcan_bus[i].sock = -1;
+    }
+    vcan_now = 0;
+    Host_DwtSetCycle(0);
+    Host_CriticalExit(0);
+}
+
+void VCAN_SetBitrate(CAN_HandleTypeDef *hcan, uint32_t bitrate)
+{
+    VCAN_GetBus(hcan)->bitrate = bitrate;
+}
+
+uint64_t VCAN_Now(void)
+{
+    return vcan_now;
+}
+
+int8_t VCAN_AttachNode(CAN_HandleTypeDef *hcan, VCAN_NodeRx_t rx, void *ctx)
+{
+    VCAN_Bus_t *bus = VCAN_GetBus(hcan);
+    if (bus->node_count >= VCAN_MAX_NODES) {
+        log_e("Too many virtual CAN nodes");
+        return -1;
+    }
+    bus->nodes[bus->node_count].rx = rx;
+    bus->nodes[bus->node_count].ctx = ctx;
+    return (int8_t)bus->node_count++;
+}
+
+static uint8_t VCAN_Submit(VCAN_Bus_t *bus, int8_t src, uint16_t std_id, const uint8_t *data, uint8_t dlc)
+{
+    if (bus->pending_len >= VCAN_PENDING_LEN) {
+        return HAL_BUSY;
+    }
+    VCAN_Frame_t *frame = &bus->pending[bus->pending_len++];
+    frame->std_id = std_id & VCAN_STD_ID_MASK;
+    frame->dlc = dlc > 8 ? 8 : dlc;
+    memcpy(frame->data, data, frame->dlc);
+    frame->src = src;
+    frame->mailbox = 0;
+    frame->ready = vcan_now;
+    frame->seq = bus->seq++;
+    return HAL_OK;
+}
+
+uint8_t VCAN_NodeSend(CAN_HandleTypeDef *hcan, int8_t node, uint16_t std_id, const uint8_t *data, uint8_t dlc)
+{
+    Host_CriticalEnter();
+    uint8_t ret = VCAN_Submit(VCAN_GetBus(hcan), node, std_id, data, dlc);
+    Host_CriticalExit(0);
+    return ret;
+}
+
+/* 固件是否在总线上: 已启动且没有离线 */
+static uint8_t VCAN_FirmwareOnBus(const VCAN_Bus_t *bus)
+{
+    return bus->hcan->State == HAL_CAN_STATE_LISTENING && !(bus->hcan->Instance->ESR & CAN_ESR_BOFF);
+}
+
+/* 该帧是否是发送者当前参与仲裁的帧: 每个发送者按请求顺序一次只发一帧 */
+static uint8_t VCAN_IsHeadOfSource(const VCAN_Bus_t *bus, uint16_t index)
+{
+    const VCAN_Frame_t *f = &bus->pending[index];
+    for (uint16_t i = 0; i < bus->pending_len; i++) {
+        if (i != index && bus->pending[i].src == f->src && (int32_t)(bus->pending[i].seq - f->seq) < 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* 计算总线上下一帧的开始时刻和帧序号,没有可发送的帧时返回0 */
+static uint8_t VCAN_NextFrame(VCAN_Bus_t *bus, uint64_t *start, uint16_t *index)
+{
+    uint8_t fw_on_bus = VCAN_FirmwareOnBus(bus);
+    uint64_t earliest = UINT64_MAX;
+    for (uint16_t i = 0; i < bus->pending_len; i++) {
+        if ((bus->pending[i].src != VCAN_SRC_FIRMWARE || fw_on_bus) && bus->pending[i].ready < earliest) {
+            earliest = bus->pending[i].ready;
+        }
+    }
+    if (earliest == UINT64_MAX) {
+        return 0;
+    }
+    uint64_t t = earliest > bus->idle_at ? earliest : bus->idle_at;
+    // 仲裁: 开始时刻已经就绪的各发送者的首帧中ID最小的获胜
+    uint16_t best = UINT16_MAX;
+    for (uint16_t i = 0; i < bus->pending_len; i++) {
+        VCAN_Frame_t *f = &bus->pending[i];
+        if (f->ready > t || (f->src == VCAN_SRC_FIRMWARE && !fw_on_bus) || !VCAN_IsHeadOfSource(bus, i)) {
+            continue;
+        }
+        if (best == UINT16_MAX || f->std_id < bus->pending[best].std_id ||
+            (f->std_id == bus->pending[best].std_id && (int32_t)(f->seq - bus->pending[best].seq) < 0)) {
+            best = i;
+        }
+    }
+    *start = t;
+    *index = best;
+    return 1;
+}
+
+static uint64_t VCAN_FrameCycles(VCAN_Bus_t *bus, uint8_t dlc)
+{
+    uint64_t bits = VCAN_FRAME_OVERHEAD_BITS + 8 * dlc;
+    return bits * VCAN_CPU_HZ / bus->bitrate;
+}
+
+/* 按16位或32位过滤器格式匹配一帧标准数据帧,返回匹配的FIFO,都不匹配返回-1 */
+static int8_t VCAN_FilterMatch(uint8_t bus_idx, uint16_t std_id, uint32_t *match)
+{
+    uint32_t v16 = (uint32_t)std_id << 5;
+    uint32_t v32 = (uint32_t)std_id << 21;
+    for (uint8_t b = 0; b < VCAN_FILTER_BANKS; b++) {
+        const CAN_FilterTypeDef *f = &vcan_filter[b].conf;
+        if (!vcan_filter[b].active || (b >= vcan_slave_start) != bus_idx) {
+            continue;
+        }
+        uint8_t hit;
+        if (f->FilterScale == CAN_FILTERSCALE_16BIT) {
+            if (f->FilterMode == CAN_FILTERMODE_IDLIST) {
+                hit = v16 == f->FilterIdLow || v16 == f->FilterIdHigh ||
+                      v16 == f->FilterMaskIdLow || v16 == f->FilterMaskIdHigh;
+            } else {
+                hit = !((v16 ^ f->FilterIdLow) & f->FilterMaskIdLow) ||
+                      !((v16 ^ f->FilterIdHigh) & f->FilterMaskIdHigh);
+            }
+        } else {
+            uint32_t id = (f->FilterIdHigh << 16) | f->FilterIdLow;
+            uint32_t mask = (f->FilterMaskIdHigh << 16) | f->FilterMaskIdLow;
+            hit = f->FilterMode == CAN_FILTERMODE_IDLIST ? (v32 == id || v32 == mask) : !((v32 ^ id) & mask);
+        }
+        if (hit) {
+            *match = b;
+            return f->FilterFIFOAssignment == CAN_FILTER_FIFO1 ? 1 : 0;
+        }
+    }
+    return -1;
+}
+
+/* 以中断上下文调用回调 */
+static void VCAN_Irq(void (*callback)(CAN_HandleTypeDef *), CAN_HandleTypeDef *hcan)
+{
+    Host_IsrEnter();
+    callback(hcan);
+    Host_IsrExit();
+}
+
+static void VCAN_TxIrq(VCAN_Bus_t *bus, uint8_t mailbox, uint8_t abort)
+{
+    static void (*const complete[VCAN_TX_MAILBOXES])(CAN_HandleTypeDef *) = {
+        HAL_CAN_TxMailbox0CompleteCallback, HAL_CAN_TxMailbox1CompleteCallback, HAL_CAN_TxMailbox2CompleteCallback};
+    static void (*const aborted[VCAN_TX_MAILBOXES])(CAN_HandleTypeDef *) = {
+        HAL_CAN_TxMailbox0AbortCallback, HAL_CAN_TxMailbox1AbortCallback, HAL_CAN_TxMailbox2AbortCallback};
+    if (bus->it_enabled & CAN_IT_TX_MAILBOX_EMPTY) {
+        VCAN_Irq(abort ? aborted[mailbox] : complete[mailbox], bus->hcan);
+    }
+}
+
+/* 与HAL_CAN_IRQHandler()相同,FIFO中有报文时反复进入中断,回调没有取走报文时停止 */
+static void VCAN_RxIrq(VCAN_Bus_t *bus, uint8_t fifo)
+{
+    uint32_t it = fifo ? CAN_IT_RX_FIFO1_MSG_PENDING : CAN_IT_RX_FIFO0_MSG_PENDING;
+    while (bus->fifo_len[fifo] && (bus->it_enabled & it)) {
+        uint8_t before = bus->fifo_len[fifo];
+        VCAN_Irq(fifo ? HAL_CAN_RxFifo1MsgPendingCallback : HAL_CAN_RxFifo0MsgPendingCallback, bus->hcan);
+        if (bus->fifo_len[fifo] >= before) {
+            break;
+        }
+    }
+}
+
+/* 帧传输完成,投递给固件、除发送者外的节点和桥接的接口 */
+static void VCAN_Deliver(VCAN_Bus_t *bus, const VCAN_Frame_t *frame)
+{
+    if (frame->src == VCAN_SRC_FIRMWARE) {
+        bus->mailbox_used &= ~(1u << frame->mailbox);
+        VCAN_TxIrq(bus, frame->mailbox, 0);
+    } else if (VCAN_FirmwareOnBus(bus)) {
+        uint32_t match = 0;
+        int8_t fifo = VCAN_FilterMatch(bus - vcan_bus, frame->std_id, &match);
+        if (fifo >= 0) {
+            if (bus->fifo_len[fifo] >= VCAN_RX_FIFO_LEN) {
+                bus->fifo_overrun[fifo]++; // FIFO未锁定,新报文被丢弃
+            } else {
+                VCAN_RxEntry_t *entry = &bus->fifo[fifo][bus->fifo_len[fifo]++];
+                entry->header = (CAN_RxHeaderTypeDef){
+                    .StdId = frame->std_id,
+                    .IDE = CAN_ID_STD,
+                    .RTR = CAN_RTR_DATA,
+                    .DLC = frame->dlc,
+                    .Timestamp = (uint32_t)(vcan_now * bus->bitrate / VCAN_CPU_HZ) & 0xFFFF,
+                    .FilterMatchIndex = match,
+                };
+                memcpy(entry->data, frame->data, frame->dlc);
+                VCAN_RxIrq(bus, (uint8_t)fifo);
+            }
+        }
+    }
+    for (uint8_t i = 0; i < bus->node_count; i++) {
+        if (i != frame->src && bus->nodes[i].rx) {
+            bus->nodes[i].rx(bus->nodes[i].ctx, frame->std_id, frame->data, frame->dlc);
+        }
+    }
+#if defined(CAN_HOST_SOCKETCAN)
+    if (bus->sock >= 0 && frame->src != VCAN_SRC_SOCKET) {
+        struct can_frame out = {.can_id = frame->std_id, .can_dlc = frame->dlc};
+        memcpy(out.data, frame->data, frame->dlc);
+        if (write(bus->sock, &out, sizeof(out)) != sizeof(out)) {
+            log_w("SocketCAN write failed");
+        }
+    }
+#endif
+}
+
+#if defined(CAN_HOST_SOCKETCAN)
+int VCAN_BridgeSocketCAN(CAN_HandleTypeDef *hcan, const char *ifname)
+{
+    VCAN_Bus_t *bus = VCAN_GetBus(hcan);
+    int sock = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (sock < 0) {
+        log_e("SocketCAN socket failed");
+        return -1;
+    }
+    struct ifreq ifr = {0};
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    struct sockaddr_can addr = {.can_family = AF_CAN};
+    if (ioctl(sock, SIOCGIFINDEX, &ifr) < 0 ||
+        (addr.can_ifindex = ifr.ifr_ifindex, bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)) {
+        log_e("SocketCAN bind to %s failed", ifname);
+        close(sock);
+        return -1;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+    bus->sock = sock;
+    return 0;
+}
+
+/* 把接口上收到的标准数据帧注入总线 */
+static void VCAN_PollSocket(VCAN_Bus_t *bus)
+{
+    struct can_frame in;
+    while (bus->sock >= 0 && read(bus->sock, &in, sizeof(in)) == sizeof(in)) {
+        if (in.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) {
+            continue;
+        }
+        VCAN_Submit(bus, VCAN_SRC_SOCKET, in.can_id & CAN_SFF_MASK, in.data, in.can_dlc);
+    }
+}
+#endif
+
+/* 进入被中止邮箱的中断,HAL_CAN_AbortTxRequest()在任务中调用,中断在下一次推进时间时处理 */
+static uint8_t VCAN_AbortIrqs(void)
+{
+    uint8_t fired = 0;
+    for (uint8_t b = 0; b < 2; b++) {
+        VCAN_Bus_t *bus = &vcan_bus[b];
+        for (uint8_t m = 0; m < VCAN_TX_MAILBOXES; m++) {
+            if (bus->abort_irq & (1u << m)) {
+                bus->abort_irq &= ~(1u << m);
+                VCAN_TxIrq(bus, m, 1);
+                fired = 1;
+            }
+        }
+    }
+    return fired;
+}
+
+void VCAN_Advance(uint64_t cycles)
+{
+    uint64_t target = vcan_now + cycles;
+    Host_CriticalEnter();
+#if defined(CAN_HOST_SOCKETCAN)
+    VCAN_PollSocket(&vcan_bus[0]);
+    VCAN_PollSocket(&vcan_bus[1]);
+#endif
+    uint8_t fired = VCAN_AbortIrqs();
+    Host_CriticalExit(0);
+    if (fired) {
+        Host_WaitIdle(VCAN_IDLE_TIMEOUT_MS);
+    }
+    for (;;) {
+        Host_CriticalEnter();
+        // 两条总线中最先完成传输的帧先投递,回调中发出的报文可能改变之后的仲裁结果
+        VCAN_Bus_t *next_bus = NULL;
+        uint16_t next_index = 0;
+        uint64_t next_end = UINT64_MAX;
+        for (uint8_t b = 0; b < 2; b++) {
+            uint64_t start;
+            uint16_t index;
+            if (!VCAN_NextFrame(&vcan_bus[b], &start, &index)) {
+                continue;
+            }
+            uint64_t end = start + VCAN_FrameCycles(&vcan_bus[b], vcan_bus[b].pending[index].dlc);
+            if (end < next_end) {
+                next_end = end;
+                next_bus = &vcan_bus[b];
+                next_index = index;
+            }
+        }
+        if (next_bus == NULL || next_end > target) {
+            Host_CriticalExit(0);
+            break;
+        }
+        VCAN_Frame_t frame = next_bus->pending[next_index];
+        next_bus->pending[next_index] = next_bus->pending[--next_bus->pending_len];
+        next_bus->idle_at = next_end;
+        vcan_now = next_end;
+        Host_DwtSetCycle(vcan_now);
+        VCAN_Deliver(next_bus, &frame);
+        Host_CriticalExit(0);
+        // 中断中唤醒的任务在下一帧之前处理完,与板上高优先级任务立即抢占的行为一致
+        Host_WaitIdle(VCAN_IDLE_TIMEOUT_MS);
+    }
+    vcan_now = target;
+    Host_DwtSetCycle(vcan_now);
+}
+
+void VCAN_SetErrorCounters(CAN_HandleTypeDef *hcan, uint16_t tec, uint8_t rec, uint8_t lec)
+{
+    VCAN_Bus_t *bus = VCAN_GetBus(hcan);
+    Host_CriticalEnter();
+    uint32_t esr = hcan->Instance->ESR & CAN_ESR_BOFF; // 离线只能由重新启动退出
+    if (tec > 255) {
+        esr |= CAN_ESR_BOFF;
+        tec = 255;
+    }
+    if (tec >= 96 || rec >= 96) {
+        esr |= CAN_ESR_EWGF;
+    }
+    if (tec >= 128 || rec >= 128) {
+        esr |= CAN_ESR_EPVF;
+    }
+    esr |= ((uint32_t)tec << CAN_ESR_TEC_Pos) | ((uint32_t)rec << CAN_ESR_REC_Pos) |
+           (((uint32_t)lec << CAN_ESR_LEC_Pos) & CAN_ESR_LEC);
+    hcan->Instance->ESR = esr;
+
+    // 与HAL_CAN_IRQHandler()相同,报告所有打开了中断且仍然置位的状态
+    uint32_t code = HAL_CAN_ERROR_NONE;
+    if (bus->it_enabled & CAN_IT_ERROR) {
+        if ((bus->it_enabled & CAN_IT_ERROR_WARNING) && (esr & CAN_ESR_EWGF)) {
+            code |= HAL_CAN_ERROR_EWG;
+        }
+        if ((bus->it_enabled & CAN_IT_ERROR_PASSIVE) && (esr & CAN_ESR_EPVF)) {
+            code |= HAL_CAN_ERROR_EPV;
+        }
+        if ((bus->it_enabled & CAN_IT_BUSOFF) && (esr & CAN_ESR_BOFF)) {
+            code |= HAL_CAN_ERROR_BOF;
+        }
+        if ((bus->it_enabled & CAN_IT_LAST_ERROR_CODE) && lec) {
+            static const uint32_t lec_code[8] = {0, HAL_CAN_ERROR_STF, HAL_CAN_ERROR_FOR, HAL_CAN_ERROR_ACK,
+                                                 HAL_CAN_ERROR_BR, HAL_CAN_ERROR_BD, HAL_CAN_ERROR_CRC, 0};
+            code |= lec_code[lec & 7];
+        }
+    }
+    if (code != HAL_CAN_ERROR_NONE) {
+        hcan->ErrorCode |= code;
+        VCAN_Irq(HAL_CAN_ErrorCallback, hcan);
+    }
+    Host_CriticalExit(0);
+    Host_WaitIdle(VCAN_IDLE_TIMEOUT_MS);
+}
+
+uint32_t VCAN_GetRxOverrun(CAN_HandleTypeDef *hcan, uint32_t fifo)
+{
+    return VCAN_GetBus(hcan)->fifo_overrun[fifo == CAN_RX_FIFO1 ? 1 : 0];
+}
+
+/****************** HAL_CAN接口 ******************/
+HAL_StatusTypeDef HAL_CAN_ConfigFilter(CAN_HandleTypeDef *hcan, const CAN_FilterTypeDef *sFilterConfig)
+{
+    if (hcan->State != HAL_CAN_STATE_READY && hcan->State != HAL_CAN_STATE_LISTENING) {
+        hcan->ErrorCode |= HAL_CAN_ERROR_NOT_INITIALIZED;
+        return HAL_ERROR;
+    }
+    if (sFilterConfig->FilterBank >= VCAN_FILTER_BANKS) {
+        hcan->ErrorCode |= HAL_CAN_ERROR_PARAM;
+        return HAL_ERROR;
+    }
+    Host_CriticalEnter();
+    vcan_slave_start = sFilterConfig->SlaveStartFilterBank;
+    vcan_filter[sFilterConfig->FilterBank].conf = *sFilterConfig;
+    vcan_filter[sFilterConfig->FilterBank].active = sFilterConfig->FilterActivation == CAN_FILTER_ENABLE;
+    Host_CriticalExit(0);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CAN_Start(CAN_HandleTypeDef *hcan)
+{
+    if (hcan->State != HAL_CAN_STATE_READY) {
+        hcan->ErrorCode |= HAL_CAN_ERROR_NOT_READY;
+        return HAL_ERROR;
+    }
+    Host_CriticalEnter();
+    hcan->State = HAL_CAN_STATE_LISTENING;
+    hcan->Instance->ESR = 0; // 退出初始化模式时错误计数器清零
+    hcan->ErrorCode = HAL_CAN_ERROR_NONE;
+    Host_CriticalExit(0);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CAN_Stop(CAN_HandleTypeDef *hcan)
+{
+    if (hcan->State != HAL_CAN_STATE_LISTENING) {
+        hcan->ErrorCode |= HAL_CAN_ERROR_NOT_STARTED;
+        return HAL_ERROR;
+    }
+    hcan->State = HAL_CAN_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CAN_ActivateNotification(CAN_HandleTypeDef *hcan, uint32_t ActiveITs)
+{
+    if (hcan->State != HAL_CAN_STATE_READY && hcan->State != HAL_CAN_STATE_LISTENING) {
+        hcan->ErrorCode |= HAL_CAN_ERROR_NOT_INITIALIZED;
+        return HAL_ERROR;
+    }
+    VCAN_GetBus(hcan)->it_enabled |= ActiveITs;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CAN_DeactivateNotification(CAN_HandleTypeDef *hcan, uint32_t InactiveITs)
+{
+    VCAN_GetBus(hcan)->it_enabled &= ~InactiveITs;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CAN_AddTxMessage(CAN_HandleTypeDef *hcan, const CAN_TxHeaderTypeDef *pHeader,
+                                       const uint8_t aData[], uint32_t *pTxMailbox)
+{
+    VCAN_Bus_t *bus = VCAN_GetBus(hcan);
+    if (hcan->State != HAL_CAN_STATE_READY && hcan->State != HAL_CAN_STATE_LISTENING) {
+        hcan->ErrorCode |= HAL_CAN_ERROR_NOT_INITIALIZED;
+        return HAL_ERROR;
+    }
+    HAL_StatusTypeDef ret = HAL_ERROR;
+    Host_CriticalEnter();
+    for (uint8_t m = 0; m < VCAN_TX_MAILBOXES; m++) {
+        if (bus->mailbox_used & (1u << m)) {
+            continue;
+        }
+        // 邮箱满时发送中的报文不会超过VCAN_PENDING_LEN,这里只有节点报文太多时才会失败
+        if (VCAN_Submit(bus, VCAN_SRC_FIRMWARE, (uint16_t)pHeader->StdId, aData, (uint8_t)pHeader->DLC) != HAL_OK) {
+            break;
+        }
+        bus->pending[bus->pending_len - 1].mailbox = m;
+        bus->mailbox_used |= 1u << m;
+        *pTxMailbox = CAN_TX_MAILBOX0 << m;
+        ret = HAL_OK;
+        break;
+    }
+    if (ret != HAL_OK) {
+        hcan->ErrorCode |= HAL_CAN_ERROR_PARAM;
+    }
+    Host_CriticalExit(0);
+    return ret;
+}
+
+HAL_StatusTypeDef HAL_CAN_AbortTxRequest(CAN_HandleTypeDef *hcan, uint32_t TxMailboxes)
+{
+    VCAN_Bus_t *bus = VCAN_GetBus(hcan);
+    Host_CriticalEnter();
+    for (uint16_t i = 0; i < bus->pending_len;) {
+        VCAN_Frame_t *f = &bus->pending[i];
+        if (f->src == VCAN_SRC_FIRMWARE && (TxMailboxes & (CAN_TX_MAILBOX0 << f->mailbox))) {
+            bus->mailbox_used &= ~(1u << f->mailbox);
+            bus->abort_irq |= 1u << f->mailbox;
+            *f = bus->pending[--bus->pending_len];
+        } else {
+            i++;
+        }
+    }
+    Host_CriticalExit(0);
+    return HAL_OK;
+}
+
+uint32_t HAL_CAN_GetTxMailboxesFreeLevel(const CAN_HandleTypeDef *hcan)
+{
+    uint8_t used = VCAN_GetBus(hcan)->mailbox_used;
+    return VCAN_TX_MAILBOXES - (uint32_t)__builtin_popcount(used);
+}
+
+uint32_t HAL_CAN_IsTxMessagePending(const CAN_HandleTypeDef *hcan, uint32_t TxMailboxes)
+{
+    return (VCAN_GetBus(hcan)->mailbox_used & TxMailboxes) ? 1u : 0u;
+}
+
+HAL_StatusTypeDef HAL_CAN_GetRxMessage(CAN_HandleTypeDef *hcan, uint32_t RxFifo, CAN_RxHeaderTypeDef *pHeader,
+                                       uint8_t aData[])
+{
+    VCAN_Bus_t *bus = VCAN_GetBus(hcan);
+    uint8_t fifo = RxFifo == CAN_RX_FIFO1 ? 1 : 0;
+    Host_CriticalEnter();
+    if (bus->fifo_len[fifo] == 0) {
+        hcan->ErrorCode |= HAL_CAN_ERROR_PARAM;
+        Host_CriticalExit(0);
+        return HAL_ERROR;
+    }
+    *pHeader = bus->fifo[fifo][0].header;
+    memcpy(aData, bus->fifo[fifo][0].data, pHeader->DLC);
+    memmove(&bus->fifo[fifo][0], &bus->fifo[fifo][1], (--bus->fifo_len[fifo]) * sizeof(VCAN_RxEntry_t));
+    Host_CriticalExit(0);
+    return HAL_OK;
+}
+
+uint32_t HAL_CAN_GetRxFifoFillLevel(const CAN_HandleTypeDef *hcan, uint32_t RxFifo)
+{
+    return VCAN_GetBus(hcan)->fifo_len[RxFifo == CAN_RX_FIFO1 ? 1 : 0];
+}
+
+HAL_CAN_StateTypeDef HAL_CAN_GetState(const CAN_HandleTypeDef *hcan)
+{
+    return hcan->State;
+}
+
+uint32_t HAL_CAN_GetError(const CAN_HandleTypeDef *hcan)
+{
+    return hcan->ErrorCode;
+}
+
+HAL_StatusTypeDef HAL_CAN_ResetError(CAN_HandleTypeDef *hcan)
+{
+    hcan->ErrorCode = HAL_CAN_ERROR_NONE;
+    return HAL_OK;
+}
+
+/* 与HAL相同的弱定义,bsp_can.c中的实现会覆盖它们 */
+__weak void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan) { UNUSED(hcan); }
+__weak void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan) { UNUSED(hcan); }
+__weak void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan) { UNUSED(hcan); }
+__weak void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan) { UNUSED(hcan); }
+__weak void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan) { UNUSED(hcan); }
+__weak void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan) { UNUSED(hcan); }
+__weak void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) { UNUSED(hcan); }
+__weak void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan) { UNUSED(hcan); }
+__weak void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan) { UNUSED(hcan); }
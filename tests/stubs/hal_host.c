@@ -0,0 +1,14 @@
+/**
+ * @file hal_host.c
+ * @brief 被测代码直接访问的内核寄存器在主机上的替身,见stubs/main.h
+ */
+
+#include "main.h"
+#include "dwt.h"
+
+DWT_Type *Host_DwtRegs(void)
+{
+    static _Thread_local DWT_Type regs;
+    regs.CYCCNT = DWT_GetCycle(); // 与DWT_GetCycle64()使用同一个时间源
+    return &regs;
+}
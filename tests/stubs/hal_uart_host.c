@@ -0,0 +1,251 @@
+/**
+ * @file hal_uart_host.c
+ * @brief HAL_UART_*在主机上的实现,外设换成vuart.h中的虚拟串口,huart1/huart3/huart6和DMA句柄也由本文件定义,代替Src/usart.c
+ * @note 模拟中断的回调在临界区锁中执行,与板上中断和关中断的关系一致
+ */
+
+#include "vuart.h"
+
+#include <string.h>
+#include "host_rtos.h"
+
+UART_HandleTypeDef huart1;
+UART_HandleTypeDef huart3;
+UART_HandleTypeDef huart6;
+DMA_HandleTypeDef hdma_usart1_tx;
+DMA_HandleTypeDef hdma_usart1_rx;
+DMA_HandleTypeDef hdma_usart3_rx;
+DMA_HandleTypeDef hdma_usart6_rx;
+DMA_HandleTypeDef hdma_usart6_tx;
+
+/* 每个串口的接收DMA和发送状态 */
+typedef struct {
+    UART_HandleTypeDef *huart;
+    DMA_Stream_TypeDef rx_stream; // 只使用NDTR
+    uint8_t *rx_buf;
+    uint16_t rx_size;
+    uint16_t rx_pos;              // DMA下一个写入的位置
+    uint8_t rx_active;
+    uint16_t tx_inflight;         // 正在发送的字节数,0表示空闲
+    uint8_t tx_capture[VUART_TX_CAPTURE_LEN];
+    uint16_t tx_len;
+} VUART_Port_t;
+
+static VUART_Port_t ports[3];
+
+static VUART_Port_t *Port(UART_HandleTypeDef *huart)
+{
+    for (uint8_t i = 0; i < 3; i++) {
+        if (ports[i].huart == huart)
+            return &ports[i];
+    }
+    return NULL;
+}
+
+void VUART_Reset(void)
+{
+    UART_HandleTypeDef *handles[3] = {&huart1, &huart3, &huart6};
+    memset(ports, 0, sizeof(ports));
+    for (uint8_t i = 0; i < 3; i++) {
+        memset(handles[i], 0, sizeof(*handles[i]));
+        handles[i]->gState = HAL_UART_STATE_READY;
+        handles[i]->RxState = HAL_UART_STATE_READY;
+        ports[i].huart = handles[i];
+    }
+    // DMA连接与Src/usart.c一致
+    DMA_HandleTypeDef *rx[3] = {&hdma_usart1_rx, &hdma_usart3_rx, &hdma_usart6_rx};
+    uint32_t rx_mode[3] = {DMA_NORMAL, DMA_CIRCULAR, DMA_CIRCULAR};
+    for (uint8_t i = 0; i < 3; i++) {
+        memset(rx[i], 0, sizeof(*rx[i]));
+        rx[i]->Instance = &ports[i].rx_stream;
+        rx[i]->Init.Mode = rx_mode[i];
+        rx[i]->Parent = handles[i];
+        handles[i]->hdmarx = rx[i];
+    }
+    memset(&hdma_usart1_tx, 0, sizeof(hdma_usart1_tx));
+    memset(&hdma_usart6_tx, 0, sizeof(hdma_usart6_tx));
+    hdma_usart1_tx.Init.Mode = DMA_NORMAL;
+    hdma_usart6_tx.Init.Mode = DMA_NORMAL;
+    huart1.hdmatx = &hdma_usart1_tx;
+    huart6.hdmatx = &hdma_usart6_tx;
+}
+
+/* 以中断上下文执行接收事件回调,然后等待被唤醒的任务处理完 */
+static void RxEventIrq(UART_HandleTypeDef *huart, uint16_t size)
+{
+    UBaseType_t mask = Host_CriticalEnter();
+    Host_IsrEnter();
+    HAL_UARTEx_RxEventCallback(huart, size);
+    Host_IsrExit();
+    Host_CriticalExit(mask);
+    Host_WaitIdle(VUART_IDLE_TIMEOUT_MS);
+}
+
+uint16_t VUART_Receive(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t n)
+{
+    VUART_Port_t *port = Port(huart);
+    uint16_t written = 0;
+    if (port == NULL)
+        return 0;
+    uint8_t circular = huart->hdmarx && huart->hdmarx->Init.Mode == DMA_CIRCULAR;
+    while (written < n && port->rx_active) {
+        port->rx_buf[port->rx_pos++] = data[written++];
+        port->rx_stream.NDTR = port->rx_size - port->rx_pos;
+        if (port->rx_pos == port->rx_size / 2) {
+            RxEventIrq(huart, port->rx_size / 2);
+        }
+        if (port->rx_pos == port->rx_size) {
+            port->rx_pos = 0;
+            if (circular) {
+                port->rx_stream.NDTR = port->rx_size;
+            } else {
+                port->rx_active = 0;
+                huart->RxState = HAL_UART_STATE_READY;
+            }
+            RxEventIrq(huart, port->rx_size);
+        }
+    }
+    // 空闲事件,HAL只在剩余计数不为0且小于缓冲区大小时回调
+    uint32_t remaining = port->rx_stream.NDTR;
+    if (written && port->rx_active && remaining > 0 && remaining < port->rx_size) {
+        if (!circular) {
+            port->rx_active = 0;
+            huart->RxState = HAL_UART_STATE_READY;
+        }
+        RxEventIrq(huart, (uint16_t)(port->rx_size - remaining));
+    }
+    return written;
+}
+
+void VUART_Error(UART_HandleTypeDef *huart)
+{
+    VUART_Port_t *port = Port(huart);
+    if (port == NULL)
+        return;
+    port->rx_active = 0;
+    huart->RxState = HAL_UART_STATE_READY;
+    huart->ErrorCode = HAL_UART_ERROR_NE;
+    UBaseType_t mask = Host_CriticalEnter();
+    Host_IsrEnter();
+    HAL_UART_ErrorCallback(huart);
+    Host_IsrExit();
+    Host_CriticalExit(mask);
+    Host_WaitIdle(VUART_IDLE_TIMEOUT_MS);
+}
+
+uint16_t VUART_TxDrain(UART_HandleTypeDef *huart, uint8_t *out, uint16_t max)
+{
+    VUART_Port_t *port = Port(huart);
+    if (port == NULL)
+        return 0;
+    while (port->tx_inflight) {
+        UBaseType_t mask = Host_CriticalEnter();
+        port->tx_inflight = 0;
+        huart->gState = HAL_UART_STATE_READY;
+        Host_IsrEnter();
+        HAL_UART_TxCpltCallback(huart);
+        Host_IsrExit();
+        Host_CriticalExit(mask);
+        Host_WaitIdle(VUART_IDLE_TIMEOUT_MS);
+    }
+    uint16_t len = port->tx_len < max ? port->tx_len : max;
+    memcpy(out, port->tx_capture, len);
+    memmove(port->tx_capture, port->tx_capture + len, port->tx_len - len);
+    port->tx_len -= len;
+    return len;
+}
+
+static void TxCapture(VUART_Port_t *port, const uint8_t *data, uint16_t size)
+{
+    uint16_t room = VUART_TX_CAPTURE_LEN - port->tx_len;
+    if (size > room)
+        size = room;
+    memcpy(port->tx_capture + port->tx_len, data, size);
+    port->tx_len += size;
+}
+
+/* 以下为bsp_uart.c使用的HAL接口 */
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    VUART_Port_t *port = Port(huart);
+    if (port == NULL || pData == NULL || Size == 0)
+        return HAL_ERROR;
+    if (huart->RxState != HAL_UART_STATE_READY)
+        return HAL_BUSY;
+    port->rx_buf = pData;
+    port->rx_size = Size;
+    port->rx_pos = 0;
+    port->rx_stream.NDTR = Size;
+    port->rx_active = 1;
+    huart->RxXferSize = Size;
+    huart->ReceptionType = HAL_UART_RECEPTION_TOIDLE;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    return HAL_UARTEx_ReceiveToIdle_DMA(huart, pData, Size); // 对虚拟串口来说与DMA相同
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)huart;
+    (void)pData;
+    (void)Size;
+    (void)Timeout;
+    return HAL_TIMEOUT; // 阻塞接收不模拟
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    VUART_Port_t *port = Port(huart);
+    if (port)
+        port->rx_active = 0;
+    huart->RxState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart)
+{
+    VUART_Port_t *port = Port(huart);
+    if (port)
+        port->tx_inflight = 0;
+    huart->gState = HAL_UART_STATE_READY;
+    return HAL_UART_AbortReceive(huart);
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)Timeout;
+    VUART_Port_t *port = Port(huart);
+    if (port == NULL)
+        return HAL_ERROR;
+    TxCapture(port, pData, Size);
+    return HAL_OK;
+}
+
+/* 中断和DMA发送都在VUART_TxDrain()中完成 */
+static HAL_StatusTypeDef TransmitAsync(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    VUART_Port_t *port = Port(huart);
+    if (port == NULL || Size == 0)
+        return HAL_ERROR;
+    if (huart->gState != HAL_UART_STATE_READY)
+        return HAL_BUSY;
+    TxCapture(port, pData, Size);
+    port->tx_inflight = Size;
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    return TransmitAsync(huart, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    return TransmitAsync(huart, pData, Size);
+}
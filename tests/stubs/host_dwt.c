@@ -0,0 +1,148 @@
+/**
+ * @file host_dwt.c
+ * @brief BSP/DWT/dwt.h在主机上的实现,CYCCNT由CLOCK_MONOTONIC换算,也可以由测试手动推进
+ */
+
+#include "dwt.h"
+#include "host_dwt.h"
+
+#include <time.h>
+
+static uint32_t cpu_mhz = 168;
+static uint8_t manual;
+static uint64_t manual_cycle;
+static uint8_t wall_time;     // 手动模式下加上自上次设置以来的实际时间
+static uint64_t wall_base_ns; // 上次设置手动周期数的实际时间
+
+static uint64_t MonotonicNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void Host_DwtSetCycle(uint64_t cycle)
+{
+    manual = 1;
+    if (wall_time)
+        __atomic_store_n(&wall_base_ns, MonotonicNs(), __ATOMIC_RELEASE);
+    __atomic_store_n(&manual_cycle, cycle, __ATOMIC_RELEASE);
+}
+
+void Host_DwtAdvance(uint64_t cycles)
+{
+    manual = 1;
+    if (wall_time)
+        __atomic_store_n(&wall_base_ns, MonotonicNs(), __ATOMIC_RELEASE);
+    __atomic_add_fetch(&manual_cycle, cycles, __ATOMIC_ACQ_REL);
+}
+
+void Host_DwtAddWallTime(uint8_t enable)
+{
+    wall_base_ns = MonotonicNs();
+    wall_time = enable;
+}
+
+void DWT_Init(uint32_t CPU_Freq_mHz)
+{
+    cpu_mhz = CPU_Freq_mHz;
+}
+
+uint64_t DWT_GetCycle64(void)
+{
+    if (manual && wall_time) {
+        uint64_t base = __atomic_load_n(&wall_base_ns, __ATOMIC_ACQUIRE);
+        return __atomic_load_n(&manual_cycle, __ATOMIC_ACQUIRE) + (MonotonicNs() - base) * cpu_mhz / 1000u;
+    }
+    if (manual)
+        return __atomic_load_n(&manual_cycle, __ATOMIC_ACQUIRE);
+    return MonotonicNs() * cpu_mhz / 1000u;
+}
+
+uint32_t DWT_GetCycle(void)
+{
+    return (uint32_t)DWT_GetCycle64();
+}
+
+void DWT_TimerUpdate(void)
+{
+}
+
+void DWT_SysTimeUpdate(void)
+{
+}
+
+float DWT_GetDeltaT(uint32_t *cnt_last)
+{
+    uint32_t cnt_now = DWT_GetCycle();
+    float dt = (uint32_t)(cnt_now - *cnt_last) / (cpu_mhz * 1e6f);
+    *cnt_last = cnt_now;
+    return dt;
+}
+
+double DWT_GetDeltaT64(uint32_t *cnt_last)
+{
+    uint32_t cnt_now = DWT_GetCycle();
+    double dt = (uint32_t)(cnt_now - *cnt_last) / (cpu_mhz * 1e6);
+    *cnt_last = cnt_now;
+    return dt;
+}
+
+uint64_t DWT_CycleToNs(uint64_t cycles)
+{
+    return cycles * 1000u / cpu_mhz;
+}
+
+uint64_t DWT_GetNs(void)
+{
+    return DWT_CycleToNs(DWT_GetCycle64());
+}
+
+uint64_t DWT_GetUs(void)
+{
+    return DWT_GetCycle64() / cpu_mhz;
+}
+
+uint32_t DWT_GetMs(void)
+{
+    return (uint32_t)(DWT_GetCycle64() / (cpu_mhz * 1000u));
+}
+
+float DWT_Cycle64ToMs(uint64_t cycles)
+{
+    return (float)cycles / (cpu_mhz * 1000.0f);
+}
+
+float DWT_CycleToUs(uint32_t cycles)
+{
+    return (float)cycles / cpu_mhz;
+}
+
+DWT_Time_t DWT_GetTime(void)
+{
+    uint64_t us = DWT_GetUs();
+    DWT_Time_t t = {.s = (uint32_t)(us / 1000000u), .ms = (us / 1000u) % 1000u, .us = us % 1000u};
+    return t;
+}
+
+float DWT_GetTimeline_s(void)
+{
+    return DWT_GetUs() * 1e-6f;
+}
+
+float DWT_GetTimeline_ms(void)
+{
+    return DWT_GetUs() * 1e-3f;
+}
+
+uint64_t DWT_GetTimeline_us(void)
+{
+    return DWT_GetUs();
+}
+
+void DWT_Delay(float Delay)
+{
+    uint64_t end = DWT_GetCycle64() + (uint64_t)(Delay * cpu_mhz * 1e6f);
+    while (DWT_GetCycle64() < end)
+        ;
+}
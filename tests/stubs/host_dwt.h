@@ -0,0 +1,29 @@
+/**
+ * @file host_dwt.h
+ * @brief 测试程序控制host_dwt.c的接口
+ */
+
+#ifndef HOST_DWT_H
+#define HOST_DWT_H
+
+#include <stdint.h>
+
+/**
+ * @brief 改为手动推进的周期计数,之后DWT_GetCycle64()返回cycle,直到下一次调用
+ * @note 缺省按CLOCK_MONOTONIC换算为168MHz的周期数
+ */
+void Host_DwtSetCycle(uint64_t cycle);
+
+/**
+ * @brief 手动模式下推进周期计数
+ */
+void Host_DwtAdvance(uint64_t cycles);
+
+/**
+ * @brief 手动模式下再加上自上次设置或推进以来经过的实际时间(按cpu频率换算),
+ *        用于在虚拟总线上测量中断处理本身的耗时,如bsp_can接收统计中的isr_cycles_max
+ * @note 打开后同样的输入不再得到完全相同的时间戳,只在基准测试中使用
+ */
+void Host_DwtAddWallTime(uint8_t enable);
+
+#endif // !HOST_DWT_H
@@ -0,0 +1,33 @@
+/**
+ * @file host_log.c
+ * @brief elog输出到stderr,并按级别计数,供测试检查被测代码是否报错
+ */
+
+#include "elog.h"
+#include "host_log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+static uint32_t log_count[ELOG_LVL_TOTAL_NUM];
+static const char level_char[ELOG_LVL_TOTAL_NUM] = {'A', 'E', 'W', 'I', 'D', 'V'};
+
+void (*elog_assert_hook)(const char *expr, const char *func, size_t line);
+
+void elog_output(uint8_t level, const char *tag, const char *file, const char *func, const long line,
+                 const char *format, ...)
+{
+    va_list args;
+    (void)file;
+    __atomic_add_fetch(&log_count[level], 1, __ATOMIC_RELAXED);
+    fprintf(stderr, "%c/%s [%s:%ld] ", level_char[level], tag, func, line);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+uint32_t Host_LogCount(uint8_t level)
+{
+    return __atomic_load_n(&log_count[level], __ATOMIC_RELAXED);
+}
@@ -0,0 +1,11 @@
+#ifndef HOST_LOG_H
+#define HOST_LOG_H
+
+#include <stdint.h>
+
+/**
+ * @brief 返回某一级别(ELOG_LVL_ERROR等)的日志输出次数
+ */
+uint32_t Host_LogCount(uint8_t level);
+
+#endif // !HOST_LOG_H
@@ -0,0 +1,536 @@
+#include "host_rtos.h"
+#include "cmsis_os.h"
+#include "event_groups.h"
+#include "semphr.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct tskTaskControlBlock
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t value;  // 通知值
+    uint8_t pending; // 有未取走的通知
+    uint8_t counted; // 由osThreadCreate()创建,计入Host_WaitIdle()
+    uint8_t blocked; // 正在等待通知,不计入运行中的任务数
+    char name[16];
+    os_pthread entry;
+    void *argument;
+};
+
+struct HostSemaphore
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t count;
+    uint32_t max;
+};
+
+/* 只支持一个任务等待,与固件中的用法一致 */
+struct HostEventGroup
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+    TaskHandle_t waiter;    // 正在等待的任务
+    EventBits_t wait_bits;
+    BaseType_t wait_all;
+};
+
+static pthread_mutex_t critical_lock; // 递归锁,临界区可以嵌套
+static _Thread_local struct tskTaskControlBlock *current_task;
+static _Thread_local uint8_t in_isr;
+static _Thread_local uint8_t primask;
+
+/* osThreadCreate()创建的任务中没有在等待通知的数量,为0时Host_WaitIdle()返回 */
+static pthread_mutex_t sched_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sched_cond;
+static uint32_t running_tasks;
+static volatile uint8_t scheduler_running = 1;
+
+static uint64_t MonotonicNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t start_ns; // tick的零点
+
+__attribute__((constructor)) static void HostRtosInit(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sched_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    start_ns = MonotonicNs();
+}
+
+/* CLOCK_MONOTONIC上ticks毫秒之后的时刻 */
+static struct timespec Deadline(TickType_t ticks)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t ns = (uint64_t)deadline.tv_nsec + (uint64_t)(ticks % 1000) * 1000000ull;
+    deadline.tv_sec += ticks / 1000 + (time_t)(ns / 1000000000ull);
+    deadline.tv_nsec = (long)(ns % 1000000000ull);
+    return deadline;
+}
+
+UBaseType_t Host_CriticalEnter(void)
+{
+    pthread_mutex_lock(&critical_lock);
+    return 0;
+}
+
+void Host_CriticalExit(UBaseType_t mask)
+{
+    (void)mask;
+    pthread_mutex_unlock(&critical_lock);
+}
+
+uint32_t Host_PrimaskGet(void)
+{
+    return primask;
+}
+
+void Host_PrimaskSet(uint32_t value)
+{
+    // PRIMASK不嵌套,重复关中断只持有一次锁
+    if (value && !primask)
+        pthread_mutex_lock(&critical_lock);
+    else if (!value && primask)
+        pthread_mutex_unlock(&critical_lock);
+    primask = value ? 1 : 0;
+}
+
+BaseType_t xPortIsInsideInterrupt(void)
+{
+    return in_isr ? pdTRUE : pdFALSE;
+}
+
+void Host_IsrEnter(void)
+{
+    in_isr = 1;
+}
+
+void Host_IsrExit(void)
+{
+    in_isr = 0;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)((MonotonicNs() - start_ns) / 1000000ull);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (current_task == NULL)
+    {
+        current_task = calloc(1, sizeof(*current_task));
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&current_task->cond, &attr);
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_init(&current_task->lock, NULL);
+        strcpy(current_task->name, "host");
+    }
+    return current_task;
+}
+
+void Host_TaskSetName(const char *name)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    strncpy(task->name, name, sizeof(task->name) - 1);
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+    return task ? task->name : xTaskGetCurrentTaskHandle()->name;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = {.tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+void Host_SchedulerSetRunning(uint8_t running)
+{
+    scheduler_running = running;
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    return scheduler_running ? taskSCHEDULER_RUNNING : taskSCHEDULER_NOT_STARTED;
+}
+
+/* 标记任务开始/结束等待,调用者持有task->lock */
+static void TaskSetBlocked(TaskHandle_t task, uint8_t blocked)
+{
+    if (!task->counted)
+        return;
+    pthread_mutex_lock(&sched_lock);
+    if (blocked && !task->blocked)
+        running_tasks--;
+    else if (!blocked && task->blocked)
+        running_tasks++;
+    task->blocked = blocked;
+    pthread_cond_broadcast(&sched_cond);
+    pthread_mutex_unlock(&sched_lock);
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    BaseType_t ret = pdPASS;
+    pthread_mutex_lock(&task->lock);
+    switch (action)
+    {
+    case eSetBits:
+        task->value |= value;
+        break;
+    case eIncrement:
+        task->value++;
+        break;
+    case eSetValueWithOverwrite:
+        task->value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->pending)
+            ret = pdFAIL;
+        else
+            task->value = value;
+        break;
+    default:
+        break;
+    }
+    task->pending = 1;
+    TaskSetBlocked(task, 0); // 通知时就计为运行,Host_WaitIdle()不会在任务处理之前返回
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return ret;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdTRUE;
+    return xTaskNotify(task, value, action);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyFromISR(task, 0, eIncrement, woken);
+}
+
+/* 等待到pending置位或超时,返回时持有锁 */
+static void NotifyWaitLocked(TaskHandle_t task, uint8_t (*ready)(TaskHandle_t), TickType_t ticks)
+{
+    struct timespec deadline = Deadline(ticks);
+    if (!ready(task))
+        TaskSetBlocked(task, 1);
+    while (!ready(task))
+    {
+        if (ticks == portMAX_DELAY)
+            pthread_cond_wait(&task->cond, &task->lock);
+        else if (pthread_cond_timedwait(&task->cond, &task->lock, &deadline) == ETIMEDOUT)
+            break;
+    }
+    TaskSetBlocked(task, 0);
+}
+
+static uint8_t Pending(TaskHandle_t task)
+{
+    return task->pending;
+}
+
+static uint8_t NonZero(TaskHandle_t task)
+{
+    return task->value != 0;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    BaseType_t ret = pdFALSE;
+    pthread_mutex_lock(&task->lock);
+    if (!task->pending)
+    {
+        task->value &= ~clear_on_entry;
+        NotifyWaitLocked(task, Pending, ticks);
+    }
+    if (value)
+        *value = task->value;
+    if (task->pending)
+    {
+        task->value &= ~clear_on_exit;
+        ret = pdTRUE;
+    }
+    task->pending = 0;
+    pthread_mutex_unlock(&task->lock);
+    return ret;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    pthread_mutex_lock(&task->lock);
+    NotifyWaitLocked(task, NonZero, ticks);
+    uint32_t value = task->value;
+    if (value)
+        task->value = clear_on_exit ? 0 : value - 1;
+    task->pending = 0;
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+void *pvPortMalloc(size_t size)
+{
+    return malloc(size);
+}
+
+void vPortFree(void *ptr)
+{
+    free(ptr);
+}
+
+static SemaphoreHandle_t SemaphoreCreate(uint32_t count)
+{
+    SemaphoreHandle_t sem = calloc(1, sizeof(*sem));
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sem->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&sem->lock, NULL);
+    sem->count = count;
+    sem->max = 1;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return SemaphoreCreate(0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return SemaphoreCreate(1);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    BaseType_t ret = pdFAIL;
+    pthread_mutex_lock(&sem->lock);
+    if (sem->count < sem->max)
+    {
+        sem->count++;
+        ret = pdPASS;
+        pthread_cond_signal(&sem->cond);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdTRUE;
+    return xSemaphoreGive(sem);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    struct timespec deadline = Deadline(ticks);
+    BaseType_t ret = pdFAIL;
+    pthread_mutex_lock(&sem->lock);
+    while (sem->count == 0 && ticks != 0)
+    {
+        if (ticks == portMAX_DELAY)
+            pthread_cond_wait(&sem->cond, &sem->lock);
+        else if (pthread_cond_timedwait(&sem->cond, &sem->lock, &deadline) == ETIMEDOUT)
+            break;
+    }
+    if (sem->count)
+    {
+        sem->count--;
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreTakeFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    (void)woken;
+    return xSemaphoreTake(sem, 0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    free(sem);
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    EventGroupHandle_t group = calloc(1, sizeof(*group));
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&group->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&group->lock, NULL);
+    return group;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    free(group);
+}
+
+static uint8_t EventBitsReady(EventGroupHandle_t group, EventBits_t bits, BaseType_t wait_all)
+{
+    return wait_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    group->bits |= bits;
+    EventBits_t ret = group->bits;
+    if (group->waiter && EventBitsReady(group, group->wait_bits, group->wait_all))
+    {
+        TaskSetBlocked(group->waiter, 0); // 与通知相同,置位时就计为运行
+        pthread_cond_broadcast(&group->cond);
+    }
+    pthread_mutex_unlock(&group->lock);
+    return ret;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group, EventBits_t bits, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdTRUE;
+    xEventGroupSetBits(group, bits);
+    return pdPASS;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline = Deadline(ticks);
+    pthread_mutex_lock(&group->lock);
+    if (!EventBitsReady(group, bits, wait_for_all) && ticks != 0)
+    {
+        group->waiter = task;
+        group->wait_bits = bits;
+        group->wait_all = wait_for_all;
+        TaskSetBlocked(task, 1);
+        while (!EventBitsReady(group, bits, wait_for_all))
+        {
+            if (ticks == portMAX_DELAY)
+                pthread_cond_wait(&group->cond, &group->lock);
+            else if (pthread_cond_timedwait(&group->cond, &group->lock, &deadline) == ETIMEDOUT)
+                break;
+        }
+        group->waiter = NULL;
+        TaskSetBlocked(task, 0);
+    }
+    EventBits_t ret = group->bits;
+    if (clear_on_exit && EventBitsReady(group, bits, wait_for_all))
+        group->bits &= ~bits;
+    pthread_mutex_unlock(&group->lock);
+    return ret;
+}
+
+static void *ThreadEntry(void *arg)
+{
+    TaskHandle_t task = arg;
+    current_task = task;
+    task->entry(task->argument);
+    pthread_mutex_lock(&sched_lock);
+    running_tasks--;
+    pthread_cond_broadcast(&sched_cond);
+    pthread_mutex_unlock(&sched_lock);
+    return NULL;
+}
+
+osThreadId osThreadCreate(const osThreadDef_t *thread_def, void *argument)
+{
+    pthread_t thread;
+    TaskHandle_t task = calloc(1, sizeof(*task));
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&task->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&task->lock, NULL);
+    strncpy(task->name, thread_def->name, sizeof(task->name) - 1);
+    task->entry = thread_def->pthread;
+    task->argument = argument;
+    task->counted = 1;
+    pthread_mutex_lock(&sched_lock);
+    running_tasks++;
+    pthread_mutex_unlock(&sched_lock);
+    if (pthread_create(&thread, NULL, ThreadEntry, task) != 0)
+    {
+        pthread_mutex_lock(&sched_lock);
+        running_tasks--;
+        pthread_mutex_unlock(&sched_lock);
+        free(task);
+        return NULL;
+    }
+    pthread_detach(thread);
+    return task;
+}
+
+osThreadId osThreadGetId(void)
+{
+    return xTaskGetCurrentTaskHandle();
+}
+
+osStatus osDelay(uint32_t millisec)
+{
+    vTaskDelay(millisec);
+    return osOK;
+}
+
+uint32_t osKernelSysTick(void)
+{
+    return xTaskGetTickCount();
+}
+
+uint8_t Host_WaitIdle(uint32_t timeout_ms)
+{
+    struct timespec deadline = Deadline(timeout_ms);
+    uint8_t idle = 1;
+    pthread_mutex_lock(&sched_lock);
+    while (running_tasks > 0)
+    {
+        if (pthread_cond_timedwait(&sched_cond, &sched_lock, &deadline) == ETIMEDOUT)
+        {
+            idle = running_tasks == 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sched_lock);
+    return idle;
+}
@@ -0,0 +1,35 @@
+/**
+ * @file host_rtos.h
+ * @brief 测试程序控制host_rtos.c的接口
+ */
+
+#ifndef HOST_RTOS_H
+#define HOST_RTOS_H
+
+#include "task.h"
+
+/**
+ * @brief 给当前线程对应的任务命名,pcTaskGetName()返回该名字,缺省为"host"
+ */
+void Host_TaskSetName(const char *name);
+
+/**
+ * @brief 标记当前线程进入/退出"中断",期间xPortIsInsideInterrupt()返回pdTRUE
+ */
+void Host_IsrEnter(void);
+void Host_IsrExit(void);
+
+/**
+ * @brief 设置xTaskGetSchedulerState()的返回值,缺省为调度器已经启动,用于测试调度器启动前的初始化流程
+ */
+void Host_SchedulerSetRunning(uint8_t running);
+
+/**
+ * @brief 等待osThreadCreate()创建的任务都阻塞在通知上,用于在模拟中断之后让被唤醒的任务先处理完
+ * @note 任务在osDelay()中睡眠时算作运行,这类周期任务不要在测试中创建
+ *
+ * @return uint8_t 1所有任务都在等待, 0超时
+ */
+uint8_t Host_WaitIdle(uint32_t timeout_ms);
+
+#endif // !HOST_RTOS_H
@@ -0,0 +1,25 @@
+/**
+ * @file host_test.h
+ * @brief 主机测试的检查宏,失败时打印位置并计数,main()返回HOST_TEST_RESULT()
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int host_test_failures;
+
+#define TEST_CHECK(cond)                                                             \
+    do                                                                               \
+    {                                                                                \
+        if (!(cond))                                                                 \
+        {                                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++;                                                    \
+        }                                                                            \
+    } while (0)
+
+#define HOST_TEST_RESULT() (host_test_failures ? 1 : 0)
+
+#endif // !HOST_TEST_H
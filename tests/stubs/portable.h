@@ -0,0 +1,11 @@
+/**
+ * @file portable.h
+ * @brief FreeRTOS portable.h替身,pvPortMalloc()/vPortFree()已在FreeRTOS.h中声明
+ */
+
+#ifndef HOST_PORTABLE_H
+#define HOST_PORTABLE_H
+
+#include "FreeRTOS.h"
+
+#endif // !HOST_PORTABLE_H
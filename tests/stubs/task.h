@@ -0,0 +1,44 @@
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+
+typedef enum
+{
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite,
+} eNotifyAction;
+
+UBaseType_t Host_CriticalEnter(void);
+void Host_CriticalExit(UBaseType_t mask);
+
+#define taskENTER_CRITICAL() ((void)Host_CriticalEnter())
+#define taskEXIT_CRITICAL() Host_CriticalExit(0)
+#define taskENTER_CRITICAL_FROM_ISR() Host_CriticalEnter()
+#define taskEXIT_CRITICAL_FROM_ISR(mask) Host_CriticalExit(mask)
+#define taskDISABLE_INTERRUPTS() ((void)Host_CriticalEnter())
+#define taskENABLE_INTERRUPTS() Host_CriticalExit(0)
+
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char *pcTaskGetName(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+
+#define taskSCHEDULER_SUSPENDED ((BaseType_t)0)
+#define taskSCHEDULER_NOT_STARTED ((BaseType_t)1)
+#define taskSCHEDULER_RUNNING ((BaseType_t)2)
+BaseType_t xTaskGetSchedulerState(void);
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+
+#endif // !HOST_TASK_H
@@ -0,0 +1,93 @@
+/**
+ * @file vcan.h
+ * @brief 主机上的虚拟CAN总线,hal_can_host.c用它实现HAL_CAN_*接口,被测的bsp_can.c不需要任何改动
+ *
+ * @note 虚拟总线按位时间模拟仲裁和帧传输时间,时间单位为CPU周期(与板上DWT时间戳一致),
+ *       只有调用VCAN_Advance()时时间才会前进,DWT_GetCycle64()同步返回总线时间,因此同样的输入总能得到同样的帧时序
+ * @note 外设行为与Src/can.c的配置一致: 每条总线3个发送邮箱按请求顺序发送(TransmitFifoPriority),
+ *       两个3级接收FIFO,28个过滤器组由CAN1和CAN2按SlaveStartFilterBank划分,不自动退出离线状态
+ * @note 节点(模拟的电机、IMU、另一块板子)通过VCAN_AttachNode()挂到总线上,收到除自己以外的所有报文,不经过过滤器
+ */
+
+#ifndef VCAN_H
+#define VCAN_H
+
+#include <stdint.h>
+#include "main.h"
+
+#define VCAN_CPU_HZ          168000000 // 虚拟时钟频率,与板上CPU频率一致
+#define VCAN_DEFAULT_BITRATE 1000000   // 与Src/can.c中的配置一致
+#define VCAN_MAX_NODES       16        // 每条总线最多挂载的模拟节点数
+#define VCAN_PENDING_LEN     64        // 每条总线等待仲裁的报文数上限,含3个邮箱中的报文
+#define VCAN_IDLE_TIMEOUT_MS 2000      // 每次模拟中断后等待被唤醒任务处理完的最长时间
+
+/* 节点接收回调,ctx为挂载时传入的指针 */
+typedef void (*VCAN_NodeRx_t)(void *ctx, uint16_t std_id, const uint8_t *data, uint8_t dlc);
+
+/**
+ * @brief 清空两条总线的邮箱、FIFO、过滤器和节点,外设回到初始化完成(READY)状态,时间归零
+ * @note bsp_can.c中的设备表等静态状态不会被清除,每个测试程序只在开始时调用一次
+ */
+void VCAN_Reset(void);
+
+/**
+ * @brief 设置总线波特率,影响每帧占用总线的时间
+ */
+void VCAN_SetBitrate(CAN_HandleTypeDef *hcan, uint32_t bitrate);
+
+/**
+ * @brief 在总线上挂载一个模拟节点
+ *
+ * @param rx 接收回调,可以为NULL(只发送的节点)
+ * @return int8_t 节点编号,用于VCAN_NodeSend(),失败返回-1
+ */
+int8_t VCAN_AttachNode(CAN_HandleTypeDef *hcan, VCAN_NodeRx_t rx, void *ctx);
+
+/**
+ * @brief 节点发送一帧,在当前虚拟时刻进入仲裁,传输完成后才会被固件和其他节点收到
+ *
+ * @return uint8_t HAL_OK成功, HAL_BUSY等待队列已满
+ */
+uint8_t VCAN_NodeSend(CAN_HandleTypeDef *hcan, int8_t node, uint16_t std_id, const uint8_t *data, uint8_t dlc);
+
+/**
+ * @brief 推进虚拟时间,期间完成传输的报文按完成时刻依次投递
+ * @note 发送完成、接收和错误中断在调用线程中以中断上下文执行,每次中断之后等待osThreadCreate()创建的任务
+ *       (如bsp_can的解码任务)处理完,再继续下一帧,因此返回时所有回调都已经执行
+ *
+ * @param cycles 推进的CPU周期数
+ */
+void VCAN_Advance(uint64_t cycles);
+
+/**
+ * @brief 当前虚拟时间,单位CPU周期
+ */
+uint64_t VCAN_Now(void);
+
+/**
+ * @brief 设置错误计数器并触发一次错误中断,模拟总线上发生了一次错误
+ * @note 与bxCAN相同,TEC/REC达到96置位EWGF,达到128置位EPVF,TEC超过255置位BOFF.
+ *       计数器下降时标志自动清除,但不会产生中断.离线后固件的报文不再发出,直到HAL_CAN_Stop()/HAL_CAN_Start()
+ *
+ * @param tec 发送错误计数,大于255表示离线
+ * @param lec 最近错误码(ESR.LEC),0表示没有
+ */
+void VCAN_SetErrorCounters(CAN_HandleTypeDef *hcan, uint16_t tec, uint8_t rec, uint8_t lec);
+
+/**
+ * @brief 接收FIFO满而被丢弃的报文数
+ */
+uint32_t VCAN_GetRxOverrun(CAN_HandleTypeDef *hcan, uint32_t fifo);
+
+#if defined(CAN_HOST_SOCKETCAN)
+/**
+ * @brief 把虚拟总线桥接到Linux的CAN接口(如vcan0),总线上完成的报文会写到该接口,
+ *        接口上收到的报文在VCAN_Advance()中注入总线,可以用candump/cansend观察和干预
+ *
+ * @param ifname 接口名
+ * @return int 0成功,-1失败
+ */
+int VCAN_BridgeSocketCAN(CAN_HandleTypeDef *hcan, const char *ifname);
+#endif
+
+#endif // !VCAN_H
@@ -0,0 +1,47 @@
+/**
+ * @file vuart.h
+ * @brief 主机上的虚拟串口,hal_uart_host.c用它实现HAL_UART_*接口,被测的bsp_uart.c不需要任何改动
+ *
+ * @note 接收按HAL的ReceiveToIdle_DMA模拟: DMA逐字节写入缓冲区,写到一半和写满时分别产生半满和全满事件,
+ *       一次VUART_Receive()的数据写完后产生空闲事件,剩余计数为0或等于缓冲区大小时HAL不报空闲事件,这里也不报.
+ *       DMA是否循环由hdmarx->Init.Mode决定,与Src/usart.c的配置一致(USART3/USART6接收为循环模式)
+ * @note 发送只记录数据,发送完成中断在VUART_TxDrain()中产生
+ */
+
+#ifndef VUART_H
+#define VUART_H
+
+#include <stdint.h>
+#include "main.h"
+
+#define VUART_TX_CAPTURE_LEN 4096 // 每个串口记录的发送数据上限,超出的部分丢弃
+#define VUART_IDLE_TIMEOUT_MS 2000 // 每次模拟中断后等待被唤醒任务处理完的最长时间
+
+/**
+ * @brief 复位huart1/huart3/huart6和它们的DMA,按Src/usart.c连接DMA句柄,清空记录的发送数据
+ * @note bsp_uart.c中的设备表等静态状态不会被清除,每个测试程序只在开始时调用一次
+ */
+void VUART_Reset(void);
+
+/**
+ * @brief 对端发来n个字节,由DMA写入接收缓冲区
+ * @note 半满、全满和空闲事件在调用线程中以中断上下文执行,每次中断之后等待osThreadCreate()创建的任务处理完,
+ *       因此返回时所有回调都已经执行.没有启动接收或普通模式DMA已经写满时,后面的字节丢弃
+ *
+ * @return uint16_t 写入缓冲区的字节数
+ */
+uint16_t VUART_Receive(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t n);
+
+/**
+ * @brief 产生一次接收错误中断(如噪声或溢出),HAL此时已经停止DMA接收
+ */
+void VUART_Error(UART_HandleTypeDef *huart);
+
+/**
+ * @brief 完成所有正在进行的发送(产生发送完成中断,回调中启动的发送也一并完成),取出记录的数据
+ *
+ * @return uint16_t 取出的字节数
+ */
+uint16_t VUART_TxDrain(UART_HandleTypeDef *huart, uint8_t *out, uint16_t max);
+
+#endif // !VUART_H
@@ -0,0 +1,321 @@
+/**
+ * @file test_bsp_uart.c
+ * @brief bsp_uart.c的环形接收: 变长帧被DMA按随机长度分段写入,跨过半满、全满和环形缓冲区末尾时
+ *        UART_RxPeek/UART_RxCommit解析出的帧完整有序,连续的帧原地返回,跨末尾的帧拷贝到scratch;
+ *        消费者落后一整圈时丢弃并计入rx_overrun,之后重新同步;接收出错重启DMA后丢弃未读的数据.
+ *        另外检查DMA双缓冲模式两个缓冲区的地址.
+ *        DMA发送: UART_Send()把数据拷贝进发送环形缓冲区后立即返回,DMA进行中放入的数据合并到下一次DMA,
+ *        跨缓冲区末尾的数据分两次DMA发出,第二次在发送完成中断中启动,放不下时整条丢弃,UART_GetTxStats()的计数与之一致
+ * @note DMA由vuart.h模拟,按HAL的ReceiveToIdle_DMA产生半满、全满和空闲事件,发送完成中断在VUART_TxDrain()中产生
+ */
+
+#include "bsp_uart.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "usart.h"
+#include "vuart.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RING_SIZE 128
+#define STREAM_LEN (1 << 20)
+#define MAX_PAYLOAD 40
+
+/* 测试帧: 0xA5 len payload[len] sum,payload的前4字节为序号 */
+typedef struct {
+    uint32_t frames;
+    uint32_t next_seq;
+    uint32_t bad;       // 校验和或序号不对
+    uint32_t in_place;  // UART_RxPeek直接返回缓冲区中的地址
+    uint32_t copied;    // 跨末尾拷贝到scratch
+} Consumer_t;
+
+static uint8_t ring[RING_SIZE];
+static uint8_t stream[STREAM_LEN];
+
+static uint32_t BuildStream(uint8_t *out, uint32_t size, uint32_t first_seq, uint32_t *frames)
+{
+    uint32_t n = 0, seq = first_seq;
+    while (n + MAX_PAYLOAD + 3 <= size) {
+        uint8_t len = (uint8_t)(4 + rand() % (MAX_PAYLOAD - 3));
+        out[n] = 0xA5;
+        out[n + 1] = len;
+        memcpy(&out[n + 2], &seq, 4);
+        uint8_t sum = 0;
+        for (uint8_t i = 0; i < len; i++) {
+            if (i >= 4)
+                out[n + 2 + i] = (uint8_t)rand();
+            sum += out[n + 2 + i];
+        }
+        out[n + 2 + len] = sum;
+        n += len + 3u;
+        seq++;
+    }
+    *frames = seq - first_seq;
+    return n;
+}
+
+static void Consume(UART_Device *uart, Consumer_t *c)
+{
+    static uint8_t scratch[MAX_PAYLOAD + 3];
+    uint16_t avail = UART_RxAvailable(uart);
+    while (avail >= 2) {
+        uint8_t len = UART_RxPeekByte(uart, 1);
+        if (UART_RxPeekByte(uart, 0) != 0xA5 || len > MAX_PAYLOAD) {
+            UART_RxCommit(uart, 1);
+            avail--;
+            continue;
+        }
+        uint16_t frame_len = len + 3u;
+        if (avail < frame_len)
+            break;
+        const uint8_t *f = UART_RxPeek(uart, 0, frame_len, scratch);
+        if (f == scratch)
+            c->copied++;
+        else if (f >= ring && f + frame_len <= ring + RING_SIZE)
+            c->in_place++;
+        uint8_t sum = 0;
+        for (uint8_t i = 0; i < len; i++)
+            sum += f[2 + i];
+        if (sum != f[2 + len]) {
+            c->bad++;
+            UART_RxCommit(uart, 1);
+            avail--;
+            continue;
+        }
+        uint32_t seq;
+        memcpy(&seq, f + 2, 4);
+        c->bad += seq != c->next_seq;
+        c->next_seq = seq + 1;
+        c->frames++;
+        UART_RxCommit(uart, frame_len);
+        avail -= frame_len;
+    }
+}
+
+/* 按1~max_chunk字节的随机长度分段写入,每段之后消费一次 */
+static void Feed(UART_Device *uart, Consumer_t *c, const uint8_t *data, uint32_t len, uint16_t max_chunk)
+{
+    uint32_t pos = 0;
+    while (pos < len) {
+        uint16_t k = (uint16_t)(1 + rand() % max_chunk);
+        if (k > len - pos)
+            k = (uint16_t)(len - pos);
+        TEST_CHECK(VUART_Receive(&huart3, data + pos, k) == k);
+        pos += k;
+        Consume(uart, c);
+    }
+}
+
+static UART_Device *RingInit(void)
+{
+    UART_Device_init_config config = {
+        .huart = &huart3,
+        .rx_buf = (uint8_t (*)[2])ring,
+        .rx_buf_size = RING_SIZE,
+        .rx_mode = UART_MODE_DMA_CIRCULAR,
+        .tx_mode = UART_MODE_BLOCKING,
+        .cb_type = UART_CALLBACK_EVENT,
+        .event_flag = UART_RX_DONE_EVENT,
+    };
+    return UART_Init(&config);
+}
+
+static void TestRandomSplits(UART_Device *uart)
+{
+    Consumer_t c = {0};
+    uint32_t frames;
+    uint32_t len = BuildStream(stream, STREAM_LEN, 0, &frames);
+    Feed(uart, &c, stream, len, 80);
+    TEST_CHECK(c.frames == frames);
+    TEST_CHECK(c.bad == 0);
+    TEST_CHECK(uart->rx_overrun == 0);
+    TEST_CHECK(c.in_place > 0 && c.copied > 0);
+    TEST_CHECK(UART_RxAvailable(uart) == 0);
+}
+
+static void TestOverrun(UART_Device *uart)
+{
+    // 不消费时写入超过一整圈,全部丢弃
+    uint8_t junk[300];
+    memset(junk, 0x11, sizeof(junk));
+    TEST_CHECK(VUART_Receive(&huart3, junk, sizeof(junk)) == sizeof(junk));
+    TEST_CHECK(UART_RxAvailable(uart) == 0);
+    TEST_CHECK(uart->rx_overrun == sizeof(junk));
+
+    // 之后的帧照常解析
+    Consumer_t c = {.next_seq = 1000};
+    uint32_t frames;
+    uint32_t len = BuildStream(stream, 4096, 1000, &frames);
+    Feed(uart, &c, stream, len, 60);
+    TEST_CHECK(c.frames == frames && c.bad == 0);
+}
+
+static void TestErrorRestart(UART_Device *uart)
+{
+    // 半帧之后出错,DMA从缓冲区开头重新写入,未读的半帧丢弃
+    uint32_t overrun = uart->rx_overrun;
+    uint32_t frames;
+    uint32_t len = BuildStream(stream, 4096, 2000, &frames);
+    TEST_CHECK(VUART_Receive(&huart3, stream, 5) == 5);
+    VUART_Error(&huart3);
+    Consumer_t c = {.next_seq = 2000};
+    Feed(uart, &c, stream, len, 60);
+    TEST_CHECK(uart->rx_overrun == overrun + 5);
+    TEST_CHECK(c.frames == frames && c.bad == 0);
+}
+
+/* DMA双缓冲: 两次接收分别写入rx_buf的前后两半 */
+static uint8_t pingpong[2][16];
+static const uint8_t *last_data;
+static uint16_t last_len;
+
+static void PingPongRx(uint8_t *data, uint16_t len)
+{
+    last_data = data;
+    last_len = len;
+}
+
+static void TestPingPong(void)
+{
+    UART_Device_init_config config = {
+        .huart = &huart1,
+        .rx_buf = (uint8_t (*)[2])pingpong,
+        .rx_buf_size = sizeof(pingpong[0]),
+        .rx_mode = UART_MODE_DMA,
+        .tx_mode = UART_MODE_BLOCKING,
+        .rx_complete_cb = PingPongRx,
+        .cb_type = UART_CALLBACK_DIRECT,
+    };
+    UART_Device *uart = UART_Init(&config);
+    TEST_CHECK(uart != NULL);
+
+    const uint8_t a[5] = {1, 2, 3, 4, 5}, b[3] = {6, 7, 8};
+    VUART_Receive(&huart1, a, sizeof(a));
+    TEST_CHECK(last_data == pingpong[1] && last_len == sizeof(a));
+    TEST_CHECK(memcmp(pingpong[1], a, sizeof(a)) == 0);
+    VUART_Receive(&huart1, b, sizeof(b));
+    TEST_CHECK(last_data == pingpong[0] && last_len == sizeof(b));
+    TEST_CHECK(memcmp(pingpong[0], b, sizeof(b)) == 0);
+    TEST_CHECK(memcmp(pingpong[1], a, sizeof(a)) == 0); // 上一次的数据没有被覆盖
+    UART_Deinit(uart);
+}
+
+static void Fill(uint8_t *buf, uint16_t len, uint8_t seed)
+{
+    for (uint16_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)(seed + i * 13);
+}
+
+static UART_Device *TxInit(void)
+{
+    UART_Device_init_config config = {
+        .huart = &huart1,
+        .rx_mode = UART_MODE_DMA,
+        .tx_mode = UART_MODE_DMA,
+        .cb_type = UART_CALLBACK_DIRECT,
+    };
+    return UART_Init(&config);
+}
+
+static void TestTxRing(UART_Device *uart)
+{
+    static uint8_t a[400], b[50], c[30], d[40], e[100], expect[480], out[UART_TX_BUF_SIZE];
+    UART_TxStats_t stats;
+    Fill(a, sizeof(a), 1);
+    Fill(b, sizeof(b), 2);
+    Fill(c, sizeof(c), 3);
+    Fill(d, sizeof(d), 4);
+    Fill(e, sizeof(e), 5);
+    memcpy(expect, a, sizeof(a));
+    memcpy(expect + sizeof(a), b, sizeof(b));
+    memcpy(expect + sizeof(a) + sizeof(b), c, sizeof(c));
+
+    // 拷贝进缓冲区后调用者的数据可以马上复用,DMA进行中放入的两条等下一次DMA
+    TEST_CHECK(UART_Send(uart, a, sizeof(a)) == HAL_OK);
+    memset(a, 0, sizeof(a));
+    TEST_CHECK(UART_Send(uart, b, sizeof(b)) == HAL_OK);
+    TEST_CHECK(UART_Send(uart, c, sizeof(c)) == HAL_OK);
+    UART_GetTxStats(uart, &stats);
+    TEST_CHECK(stats.dma_starts == 1 && stats.pending == 480 && stats.high_water == 480);
+    TEST_CHECK(stats.queued_bytes == 480 && stats.sent_bytes == 0);
+
+    // 只剩32字节,40字节的消息整条丢弃
+    TEST_CHECK(UART_Send(uart, d, sizeof(d)) == HAL_BUSY);
+    UART_GetTxStats(uart, &stats);
+    TEST_CHECK(stats.dropped_msgs == 1 && stats.dropped_bytes == sizeof(d) && stats.pending == 480);
+
+    TEST_CHECK(VUART_TxDrain(&huart1, out, sizeof(out)) == 480);
+    TEST_CHECK(memcmp(out, expect, 480) == 0);
+    UART_GetTxStats(uart, &stats);
+    TEST_CHECK(stats.dma_starts == 2 && stats.sent_bytes == 480 && stats.pending == 0);
+
+    // 从480开始的100字节跨过末尾: 先发到末尾的32字节,发送完成中断中接着发开头的68字节
+    TEST_CHECK(UART_Send(uart, e, sizeof(e)) == HAL_OK);
+    UART_GetTxStats(uart, &stats);
+    TEST_CHECK(stats.dma_starts == 3 && stats.pending == sizeof(e));
+    TEST_CHECK(VUART_TxDrain(&huart1, out, sizeof(out)) == sizeof(e));
+    TEST_CHECK(memcmp(out, e, sizeof(e)) == 0);
+    UART_GetTxStats(uart, &stats);
+    TEST_CHECK(stats.dma_starts == 4 && stats.sent_bytes == 480 + sizeof(e) && stats.pending == 0);
+}
+
+/* 随机长度的发送和随机时刻的发送完成,收到的字节流与接受的消息依次拼接一致 */
+static void TestTxRandom(UART_Device *uart)
+{
+    static uint8_t sent[1 << 18], got[(1 << 18) + UART_TX_BUF_SIZE];
+    uint8_t msg[120];
+    uint32_t n_sent = 0, n_got = 0, dropped = 0;
+    UART_TxStats_t before, after;
+    UART_GetTxStats(uart, &before);
+    while (n_sent + sizeof(msg) <= sizeof(sent)) {
+        uint16_t len = (uint16_t)(1 + rand() % sizeof(msg));
+        Fill(msg, len, (uint8_t)rand());
+        if (UART_Send(uart, msg, len) == HAL_OK) {
+            memcpy(&sent[n_sent], msg, len);
+            n_sent += len;
+        } else {
+            dropped += len;
+        }
+        if (rand() % 8 == 0)
+            n_got += VUART_TxDrain(&huart1, &got[n_got], UART_TX_BUF_SIZE);
+    }
+    n_got += VUART_TxDrain(&huart1, &got[n_got], UART_TX_BUF_SIZE);
+    UART_GetTxStats(uart, &after);
+    TEST_CHECK(n_got == n_sent && memcmp(got, sent, n_sent) == 0);
+    TEST_CHECK(after.queued_bytes - before.queued_bytes == n_sent);
+    TEST_CHECK(after.sent_bytes - before.sent_bytes == n_sent);
+    TEST_CHECK(after.dropped_bytes - before.dropped_bytes == dropped && dropped > 0);
+    TEST_CHECK(after.pending == 0 && after.high_water <= UART_TX_BUF_SIZE);
+}
+
+int main(void)
+{
+    Host_TaskSetName("test");
+    VUART_Reset();
+    srand(1);
+
+    UART_Device *uart = RingInit();
+    TEST_CHECK(uart != NULL);
+    TestRandomSplits(uart);
+    TestOverrun(uart);
+    TestErrorRestart(uart);
+
+    // 接收DMA不是循环模式时拒绝环形模式
+    UART_Device_init_config config = {
+        .huart = &huart1,
+        .rx_buf = (uint8_t (*)[2])ring,
+        .rx_buf_size = RING_SIZE,
+        .rx_mode = UART_MODE_DMA_CIRCULAR,
+    };
+    TEST_CHECK(UART_Init(&config) == NULL);
+
+    TestPingPong();
+
+    uart = TxInit();
+    TEST_CHECK(uart != NULL);
+    TestTxRing(uart);
+    TestTxRandom(uart);
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""
+把黑匣子flash区域的dump转换为csv, 格式见 modules/blackbox/blackbox.h
+
+    python3 tools/blackbox/blackbox_decode.py blackbox.bin -o blackbox.csv
+    python3 tools/blackbox/blackbox_decode.py blackbox.bin --session 12      只输出一次开机的数据
+
+读出flash区域(扇区8/9, 0x08080000开始256KB):
+    openocd:  openocd -f interface/cmsis-dap.cfg -f target/stm32f4x.cfg \\
+                  -c "init; halt; dump_image blackbox.bin 0x08080000 0x40000; resume; exit"
+    J-Link:   JLinkExe -device STM32F407IG -if SWD -speed 4000, 然后 savebin blackbox.bin 0x08080000 0x40000
+
+块按seq排序后输出, crc校验失败的块(写入时掉电)跳过, 空白和不完整的块不计入.
+读出后在RTT通道3发送'c'解除冻结.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import zlib
+
+BLOCK_SIZE = 2048
+BLOCK_MAGIC = 0x5842424D
+BLOCK_RESET = 0x01
+BLOCK_FROZEN = 0x02
+MOTOR_NUM = 4
+
+HEAD = struct.Struct('<IIHHIIIII')
+SAMPLE = struct.Struct('<H3h%dh%dhBBHBBBB' % (MOTOR_NUM, MOTOR_NUM))
+SAMPLES_PER_BLOCK = (BLOCK_SIZE - HEAD.size) // SAMPLE.size
+CRC_HEAD_LEN = HEAD.size - 4
+
+assert HEAD.size == 32 and SAMPLE.size == 32
+
+
+def parse_blocks(data):
+    """返回 (有效块列表, crc错误数), 有效块按seq排序"""
+    blocks = []
+    crc_errors = 0
+    for off in range(0, len(data) - BLOCK_SIZE + 1, BLOCK_SIZE):
+        raw = data[off:off + BLOCK_SIZE]
+        magic, seq, session, count, start_ms, dropped, flags, _, crc = HEAD.unpack_from(raw)
+        if magic != BLOCK_MAGIC:
+            continue
+        body = raw[HEAD.size:HEAD.size + SAMPLES_PER_BLOCK * SAMPLE.size]
+        if count > SAMPLES_PER_BLOCK or zlib.crc32(body, zlib.crc32(raw[:CRC_HEAD_LEN])) != crc:
+            crc_errors += 1
+            continue
+        blocks.append({
+            'slot': off // BLOCK_SIZE, 'seq': seq, 'session': session, 'count': count,
+            'start_ms': start_ms, 'dropped': dropped, 'flags': flags,
+            'samples': [SAMPLE.unpack_from(body, i * SAMPLE.size) for i in range(count)],
+        })
+    # seq跨开机递增, 按与最大seq的差值排序可以处理回绕
+    if blocks:
+        newest = max(b['seq'] for b in blocks)
+        blocks.sort(key=lambda b: -((newest - b['seq']) & 0xFFFFFFFF))
+    return blocks, crc_errors
+
+
+def header():
+    cols = ['session', 'seq', 'time_ms', 'yaw', 'pitch', 'roll']
+    cols += ['motor%d_out' % i for i in range(MOTOR_NUM)]
+    cols += ['motor%d_rpm' % i for i in range(MOTOR_NUM)]
+    cols += ['power_limit', 'buffer_energy', 'shooter_heat', 'chassis_mode', 'gimbal_mode',
+             'shoot', 'friction', 'load', 'flags', 'dropped_before', 'block_reset', 'block_frozen']
+    return cols
+
+
+def rows(block):
+    start = block['start_ms']
+    for i, s in enumerate(block['samples']):
+        t16, yaw, pitch, roll = s[0:4]
+        out = s[4:4 + MOTOR_NUM]
+        rpm = s[4 + MOTOR_NUM:4 + 2 * MOTOR_NUM]
+        power_limit, buffer_energy, shooter_heat, chassis_mode, gimbal_mode, shoot_mode, flags = s[4 + 2 * MOTOR_NUM:]
+        # 采样中只有时间的低16位, 用块头的完整时间恢复
+        t = start + ((t16 - (start & 0xFFFF)) & 0xFFFF)
+        yield ([block['session'], block['seq'], t, yaw / 100.0, pitch / 100.0, roll / 100.0] + list(out) + list(rpm) +
+               [power_limit, buffer_energy, shooter_heat, chassis_mode, gimbal_mode,
+                shoot_mode & 0x01, (shoot_mode >> 1) & 0x01, (shoot_mode >> 2) & 0x07, flags,
+                block['dropped'] if i == 0 else 0,
+                int(bool(block['flags'] & BLOCK_RESET)), int(bool(block['flags'] & BLOCK_FROZEN))])
+
+
+def main():
+    parser = argparse.ArgumentParser(description='黑匣子dump转csv')
+    parser.add_argument('dump', help='flash区域的bin文件')
+    parser.add_argument('-o', '--output', help='输出csv, 缺省输出到stdout')
+    parser.add_argument('--session', type=int, help='只输出指定开机序号的数据')
+    args = parser.parse_args()
+
+    with open(args.dump, 'rb') as f:
+        data = f.read()
+    blocks, crc_errors = parse_blocks(data)
+    if args.session is not None:
+        blocks = [b for b in blocks if b['session'] == args.session]
+
+    out = open(args.output, 'w', newline='') if args.output else sys.stdout
+    try:
+        writer = csv.writer(out)
+        writer.writerow(header())
+        for b in blocks:
+            writer.writerows(rows(b))
+    finally:
+        if out is not sys.stdout:
+            out.close()
+
+    sessions = sorted({b['session'] for b in blocks})
+    print('%d blocks, %d samples, %d crc errors, %d dropped, sessions %s, %d reset blocks' % (
+        len(blocks), sum(b['count'] for b in blocks), crc_errors, sum(b['dropped'] for b in blocks),
+        sessions, sum(1 for b in blocks if b['flags'] & BLOCK_RESET)), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
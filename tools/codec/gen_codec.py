@@ -0,0 +1,412 @@
+#!/usr/bin/env python3
+"""
+根据消息描述文件(json)生成位打包编解码代码
+
+    生成C代码:  python3 tools/codec/gen_codec.py gen modules/board_com/board_msg.json
+    主机端解码: python3 tools/codec/gen_codec.py decode modules/board_com/board_msg.json BoardGimbalCmd 00 64 ff 9c ...
+
+生成的 <schema名>_codec.{c,h} 与描述文件放在同一目录,只依赖 stdint.h/string.h 和消息结构体所在头文件,
+两块板子和主机上的工具使用同一份代码.生成的文件需要提交,修改描述文件后重新运行本脚本.
+
+描述文件格式:
+{
+  "name": "board_msg",                      生成文件名前缀
+  "includes": ["robotdef.h"],               消息结构体所在头文件
+  "messages": [{
+    "name": "BoardGimbalCmd",               函数名前缀, 长度宏为 BOARD_GIMBAL_CMD_LEN
+    "struct": "Chassis_Ctrl_Cmd_s",         对应的C结构体
+    "endian": "big",                        big: 高位先行的位流, 与旧的手写打包一致
+                                            little: 低位先行, 按字节对齐的字段即小端, 与packed结构体内存布局一致
+    "max_len": 8,                           可选, 编码长度上限(例如CAN单帧)
+    "fields": [...]                         按传输顺序排列
+  }]
+}
+
+字段:
+  {"member": "vx", "ctype": "float", "bits": 16, "signed": true, "scale": 0.01, "offset": 0, "min": -100, "max": 100}
+      定点数, raw = round((clamp(value, min, max) - offset) / scale), 解码 value = raw * scale + offset
+      只给min/max不给scale时, 把[min, max]均匀映射到无符号的全部bits位
+      min/max缺省为bits位能表示的范围, 给出时取两者的交集
+  {"member": "roll", "type": "f32"}                  原样传输的32位浮点数
+  {"type": "const", "bits": 8, "value": 255}         帧头帧尾等常量, 解码时不一致则整帧无效
+  {"type": "pad", "bits": 5}                         保留位, 编码为0
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+INT_TYPES = {
+    "uint8_t": (8, False), "int8_t": (8, True),
+    "uint16_t": (16, False), "int16_t": (16, True),
+    "uint32_t": (32, False), "int32_t": (32, True),
+}
+
+
+class SchemaError(Exception):
+    pass
+
+
+def upper_snake(name):
+    return re.sub(r"(?<=[a-z0-9])(?=[A-Z])", "_", name).upper()
+
+
+def c_float(v):
+    s = "%.9g" % v
+    if "." not in s and "e" not in s:
+        s += ".0"
+    return s + "f"
+
+
+def normalize_field(msg, f):
+    kind = f.get("type", "int")
+    name = f.get("member", kind)
+    where = "%s.%s" % (msg["name"], name)
+    if kind == "f32":
+        f["bits"] = 32
+        f["ctype"] = "float"
+    elif kind == "const":
+        if "value" not in f:
+            raise SchemaError("%s: const field needs value" % where)
+    elif kind == "pad":
+        pass
+    elif kind == "int":
+        if "member" not in f or "ctype" not in f:
+            raise SchemaError("%s: needs member and ctype" % where)
+    else:
+        raise SchemaError("%s: unknown type %s" % (where, kind))
+    f["type"] = kind
+    bits = f.get("bits")
+    if not isinstance(bits, int) or not 1 <= bits <= 32:
+        raise SchemaError("%s: bits must be 1..32" % where)
+    if kind == "const" and not 0 <= f["value"] < (1 << bits):
+        raise SchemaError("%s: const value does not fit in %d bits" % (where, bits))
+    if kind != "int":
+        return
+
+    signed = bool(f.get("signed", False))
+    raw_min = -(1 << (bits - 1)) if signed else 0
+    raw_max = (1 << (bits - 1)) - 1 if signed else (1 << bits) - 1
+    if "scale" not in f and "min" in f and "max" in f:
+        if signed or "offset" in f:
+            raise SchemaError("%s: derived scale needs an unsigned field without offset" % where)
+        f["offset"] = f["min"]
+        f["scale"] = (f["max"] - f["min"]) / float(raw_max)
+    scale = float(f.get("scale", 1))
+    offset = float(f.get("offset", 0))
+    if scale <= 0:
+        raise SchemaError("%s: scale must be positive" % where)
+    lo = offset + scale * raw_min
+    hi = offset + scale * raw_max
+    if "min" in f:
+        lo = max(lo, f["min"])
+    if "max" in f:
+        hi = min(hi, f["max"])
+    if lo > hi:
+        raise SchemaError("%s: empty range" % where)
+    f.update(signed=signed, raw_min=raw_min, raw_max=raw_max, scale=scale, offset=offset, lo=lo, hi=hi)
+    f["direct"] = f["ctype"] != "float" and scale == 1 and offset == 0
+    if f["direct"]:
+        f["lo"], f["hi"] = int(-(-lo // 1)), int(hi // 1)
+    # 解码结果必须能放进成员类型
+    if f["ctype"] in INT_TYPES:
+        cbits, csigned = INT_TYPES[f["ctype"]]
+        cmin = -(1 << (cbits - 1)) if csigned else 0
+        cmax = (1 << (cbits - 1)) - 1 if csigned else (1 << cbits) - 1
+        if lo < cmin or hi > cmax:
+            raise SchemaError("%s: range [%g, %g] does not fit %s" % (where, lo, hi, f["ctype"]))
+
+
+def load_schema(path):
+    with open(path, encoding="utf-8") as fp:
+        schema = json.load(fp)
+    for msg in schema["messages"]:
+        msg.setdefault("endian", "big")
+        if msg["endian"] not in ("big", "little"):
+            raise SchemaError("%s: endian must be big or little" % msg["name"])
+        offset = 0
+        for f in msg["fields"]:
+            normalize_field(msg, f)
+            f["bit_offset"] = offset
+            offset += f["bits"]
+        msg["bits"] = offset
+        msg["len"] = (offset + 7) // 8
+        if "max_len" in msg and msg["len"] > msg["max_len"]:
+            raise SchemaError("%s: %d bytes exceeds max_len %d" % (msg["name"], msg["len"], msg["max_len"]))
+    return schema
+
+
+def byte_shifts(msg, f):
+    """字段覆盖的每个字节及其移位量: 编码时 byte |= raw << sh (sh<0时右移), 解码时反过来"""
+    o, n = f["bit_offset"], f["bits"]
+    for b in range(o // 8, (o + n - 1) // 8 + 1):
+        if msg["endian"] == "big":
+            yield b, 8 * b + 8 - o - n
+        else:
+            yield b, o - 8 * b
+
+
+def mask_literal(bits):
+    return "0x%Xu" % ((1 << bits) - 1)
+
+
+def describe(f):
+    if f["type"] == "const":
+        return "常量 0x%X" % f["value"]
+    if f["type"] == "pad":
+        return "保留"
+    if f["type"] == "f32":
+        return "float"
+    s = "有符号" if f["signed"] else "无符号"
+    if not f["direct"]:
+        s += ", x%g" % f["scale"] + ("%+g" % f["offset"] if f["offset"] else "")
+    return s + ", 范围[%g, %g]" % (f["lo"], f["hi"])
+
+
+def gen_encode(msg):
+    out = []
+    written = set()
+    for f in msg["fields"]:
+        if f["type"] == "pad":
+            continue
+        m = f.get("member")
+        if f["type"] == "const":
+            value = "0x%Xu" % f["value"]
+        elif f["type"] == "f32":
+            out.append("    memcpy(&raw, &msg->%s, sizeof(raw));" % m)
+            value = "raw"
+        elif f["direct"]:
+            out.append("    raw = (uint32_t)codec_clamp_int((int32_t)msg->%s, %d, %d);" % (m, f["lo"], f["hi"]))
+            value = "raw"
+        else:
+            out.append("    raw = (uint32_t)codec_quantize((float)msg->%s, %s, %s, %s, %s);" % (
+                m, c_float(f["lo"]), c_float(f["hi"]), c_float(f["offset"]), c_float(1.0 / f["scale"])))
+            value = "raw"
+        if value == "raw" and f.get("signed") and f["bits"] < 32:
+            out.append("    raw &= %s;" % mask_literal(f["bits"]))
+        for b, sh in byte_shifts(msg, f):
+            op = "|=" if b in written else "="
+            written.add(b)
+            expr = value if sh == 0 else ("(%s << %d)" % (value, sh) if sh > 0 else "(%s >> %d)" % (value, -sh))
+            out.append("    buf[%d] %s (uint8_t)%s;" % (b, op, expr))
+    for b in range(msg["len"]):
+        if b not in written:
+            out.append("    buf[%d] = 0;" % b)
+    return out
+
+
+def gen_decode(msg):
+    out = []
+    for f in msg["fields"]:
+        if f["type"] == "pad":
+            continue
+        parts = []
+        for b, sh in byte_shifts(msg, f):
+            if sh == 0:
+                parts.append("(uint32_t)buf[%d]" % b)
+            elif sh > 0:
+                parts.append("((uint32_t)buf[%d] >> %d)" % (b, sh))
+            else:
+                parts.append("((uint32_t)buf[%d] << %d)" % (b, -sh))
+        expr = " | ".join(parts)
+        if f["bits"] % 8 or f["bit_offset"] % 8:
+            expr = "(%s) & %s" % (expr, mask_literal(f["bits"])) if len(parts) > 1 else "%s & %s" % (expr, mask_literal(f["bits"]))
+        out.append("    raw = %s;" % expr)
+        m = f.get("member")
+        if f["type"] == "const":
+            out.append("    if (raw != 0x%Xu) {" % f["value"])
+            out.append("        return 0;")
+            out.append("    }")
+            continue
+        if f["type"] == "f32":
+            out.append("    memcpy(&msg->%s, &raw, sizeof(raw));" % m)
+            continue
+        value = "codec_sext(raw, %d)" % f["bits"] if f["signed"] else "raw"
+        if f["direct"]:
+            out.append("    msg->%s = (%s)%s;" % (m, f["ctype"], value))
+            continue
+        real = "(float)%s" % value
+        if f["scale"] != 1:
+            real += " * %s" % c_float(f["scale"])
+        if f["offset"]:
+            real += " + %s" % c_float(f["offset"])
+        if f["ctype"] == "float":
+            out.append("    msg->%s = %s;" % (m, real))
+        else:
+            out.append("    msg->%s = (%s)codec_round(%s);" % (m, f["ctype"], real))
+    return out
+
+
+def gen_c(schema, schema_file):
+    base = schema["name"]
+    hdr = []
+    guard = "%s_CODEC_H" % base.upper()
+    note = "由 tools/codec/gen_codec.py 根据 %s 生成,请勿手动修改" % schema_file
+    hdr += ["/**", " * @file %s_codec.h" % base, " * @brief %s" % note, " */", "",
+            "#ifndef %s" % guard, "#define %s" % guard, "", "#include <stdint.h>"]
+    hdr += ['#include "%s"' % inc for inc in schema.get("includes", [])]
+    hdr.append("")
+    for msg in schema["messages"]:
+        prefix = upper_snake(msg["name"])
+        hdr.append("#define %s_LEN %d // %d bit" % (prefix, msg["len"], msg["bits"]))
+    hdr.append("")
+    for msg in schema["messages"]:
+        prefix = upper_snake(msg["name"])
+        hdr.append("/**")
+        if msg.get("doc"):
+            hdr.append(" * @brief %s" % msg["doc"])
+        hdr.append(" * @note %s位流, 字段(起始位:位数):" % ("高位先行的" if msg["endian"] == "big" else "低位先行的"))
+        for f in msg["fields"]:
+            hdr.append(" *       %-34s %3d:%-2d %s" % (f.get("member", "-"), f["bit_offset"], f["bits"], describe(f)))
+        hdr.append(" */")
+        hdr.append("uint16_t %s_Encode(const %s *msg, uint8_t buf[%s_LEN]);" % (msg["name"], msg["struct"], prefix))
+        hdr.append("uint8_t %s_Decode(const uint8_t *buf, uint16_t len, %s *msg);" % (msg["name"], msg["struct"]))
+        hdr.append("")
+    hdr += ["#endif // %s" % guard, ""]
+
+    src = ["/**", " * @file %s_codec.c" % base, " * @brief %s" % note, " */", "",
+           '#include "%s_codec.h"' % base, "#include <string.h>", ""]
+    for msg in schema["messages"]:
+        prefix = upper_snake(msg["name"])
+        if "max_len" in msg:
+            src.append('_Static_assert(%s_LEN <= %d, "%s too long");' % (prefix, msg["max_len"], msg["name"]))
+        for f in msg["fields"]:
+            if "member" in f:
+                src.append('_Static_assert(sizeof(((%s *)0)->%s) == sizeof(%s), "%s.%s changed, regenerate codec");' % (
+                    msg["struct"], f["member"], f["ctype"], msg["struct"], f["member"]))
+    src += ["",
+            "static inline int32_t codec_round(float v)",
+            "{",
+            "    return (int32_t)(v >= 0.0f ? v + 0.5f : v - 0.5f);",
+            "}",
+            "",
+            "/* 限幅到[lo, hi]后换算成定点数, NaN按offset处理 */",
+            "static inline int32_t codec_quantize(float v, float lo, float hi, float offset, float inv_scale)",
+            "{",
+            "    if (!(v >= lo)) {",
+            "        v = (v != v) ? offset : lo;",
+            "    }",
+            "    if (v > hi) {",
+            "        v = hi;",
+            "    }",
+            "    return codec_round((v - offset) * inv_scale);",
+            "}",
+            "",
+            "static inline int32_t codec_clamp_int(int32_t v, int32_t lo, int32_t hi)",
+            "{",
+            "    return v < lo ? lo : (v > hi ? hi : v);",
+            "}",
+            "",
+            "static inline int32_t codec_sext(uint32_t raw, uint8_t bits)",
+            "{",
+            "    uint32_t m = 1u << (bits - 1);",
+            "    return (int32_t)((raw ^ m) - m);",
+            "}",
+            ""]
+    for msg in schema["messages"]:
+        prefix = upper_snake(msg["name"])
+        src.append("uint16_t %s_Encode(const %s *msg, uint8_t buf[%s_LEN])" % (msg["name"], msg["struct"], prefix))
+        src.append("{")
+        body = gen_encode(msg)
+        if any("raw" in line for line in body):
+            src.append("    uint32_t raw;")
+            src.append("")
+        src += body
+        src.append("    return %s_LEN;" % prefix)
+        src.append("}")
+        src.append("")
+        src.append("uint8_t %s_Decode(const uint8_t *buf, uint16_t len, %s *msg)" % (msg["name"], msg["struct"]))
+        src.append("{")
+        src.append("    uint32_t raw;")
+        src.append("")
+        src.append("    if (len != %s_LEN) {" % prefix)
+        src.append("        return 0;")
+        src.append("    }")
+        src += gen_decode(msg)
+        src.append("    return 1;")
+        src.append("}")
+        src.append("")
+    return "\n".join(hdr), "\n".join(src).rstrip("\n") + "\n"
+
+
+def decode(msg, data):
+    """与生成的C代码相同的解码规则,返回 {成员: 值}"""
+    if len(data) != msg["len"]:
+        raise ValueError("%s needs %d bytes, got %d" % (msg["name"], msg["len"], len(data)))
+    total = msg["len"] * 8
+    word = int.from_bytes(bytes(data), msg["endian"])
+    result = {}
+    for f in msg["fields"]:
+        o, n = f["bit_offset"], f["bits"]
+        shift = total - o - n if msg["endian"] == "big" else o
+        raw = (word >> shift) & ((1 << n) - 1)
+        if f["type"] == "pad":
+            continue
+        if f["type"] == "const":
+            if raw != f["value"]:
+                raise ValueError("%s: expected 0x%X, got 0x%X" % (msg["name"], f["value"], raw))
+            continue
+        if f["type"] == "f32":
+            result[f["member"]] = struct.unpack("<f", struct.pack("<I", raw))[0]
+            continue
+        if f["signed"] and raw & (1 << (n - 1)):
+            raw -= 1 << n
+        if f["direct"]:
+            result[f["member"]] = raw
+        else:
+            value = raw * f["scale"] + f["offset"]
+            result[f["member"]] = value if f["ctype"] == "float" else int(round(value))
+    return result
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    g = sub.add_parser("gen", help="生成C代码")
+    g.add_argument("schema")
+    g.add_argument("-o", "--outdir", help="输出目录,默认与描述文件同目录")
+    d = sub.add_parser("decode", help="按描述文件解码一帧,字节以十六进制给出,不给时从标准输入逐行读取")
+    d.add_argument("schema")
+    d.add_argument("message")
+    d.add_argument("bytes", nargs="*")
+    args = ap.parse_args()
+
+    try:
+        schema = load_schema(args.schema)
+    except SchemaError as e:
+        sys.exit("%s: %s" % (args.schema, e))
+
+    if args.cmd == "gen":
+        outdir = args.outdir or os.path.dirname(os.path.abspath(args.schema))
+        root = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+        rel = os.path.relpath(os.path.abspath(args.schema), root).replace(os.sep, "/")
+        h, c = gen_c(schema, rel)
+        for ext, text in (("h", h), ("c", c)):
+            path = os.path.join(outdir, "%s_codec.%s" % (schema["name"], ext))
+            with open(path, "w", encoding="utf-8", newline="\n") as fp:
+                fp.write(text)
+            print(path)
+        return
+
+    msgs = {m["name"]: m for m in schema["messages"]}
+    if args.message not in msgs:
+        sys.exit("unknown message %s, have: %s" % (args.message, ", ".join(msgs)))
+    msg = msgs[args.message]
+    lines = [" ".join(args.bytes)] if args.bytes else sys.stdin
+    for line in lines:
+        hexstr = re.sub(r"[^0-9a-fA-F]", "", line)
+        if not hexstr:
+            continue
+        try:
+            fields = decode(msg, bytes.fromhex(hexstr))
+        except ValueError as e:
+            print("error: %s" % e)
+            continue
+        print(" ".join("%s=%s" % (k, ("%.6g" % v) if isinstance(v, float) else v) for k, v in fields.items()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""
+显示BSP/DWT/dwt_prof.c通过RTT通道4输出的周期统计, 根据直方图计算p50/p90/p99
+
+    从openocd的RTT服务读取, 发送's'开启每秒输出:
+        openocd ... -c "rtt setup 0x20000000 0x30000 \\"SEGGER RTT\\"; rtt start; rtt server start 9094 4"
+        python3 tools/profiler/prof_view.py --tcp localhost:9094 --send s
+    从J-Link记录的文件读取, 只显示最后一次:
+        JLinkRTTLogger -Device STM32F407IG -If SWD -Speed 4000 -RTTChannel 4 prof.log
+        python3 tools/profiler/prof_view.py prof.log
+    优化前后对比:
+        python3 tools/profiler/prof_view.py before.log --save before.json
+        python3 tools/profiler/prof_view.py after.log --baseline before.json
+
+固件需要定义DWT_PROF_ENABLE为1. 时间按输出中的CPU频率换算为微秒, 直方图分辨率约25%, 百分位在桶内线性插值.
+"""
+
+import argparse
+import json
+import socket
+import sys
+
+SUB_BITS = 2  # 与DWT_PROF_SUB_BITS一致
+
+
+def bucket_low(idx):
+    """桶的下界(周期), 与DWT_ProfBucket()互逆"""
+    if idx < (1 << (SUB_BITS + 1)):
+        return idx
+    msb = (idx >> SUB_BITS) + SUB_BITS - 1
+    mant = (idx & ((1 << SUB_BITS) - 1)) | (1 << SUB_BITS)
+    return mant << (msb - SUB_BITS)
+
+
+def percentile(site, q):
+    total = site['count']
+    if total == 0:
+        return 0.0
+    target = q * total
+    seen = 0
+    for idx, n in sorted(site['hist'].items()):
+        if seen + n >= target:
+            low, high = bucket_low(idx), bucket_low(idx + 1)
+            value = low + (high - low) * (target - seen) / n
+            return min(max(value, site['min']), site['max'])
+        seen += n
+    return float(site['max'])
+
+
+def parse_kv(tokens):
+    out = {}
+    for tok in tokens:
+        if '=' in tok:
+            k, v = tok.split('=', 1)
+            out[k] = v
+    return out
+
+
+def parse_lines(lines):
+    """逐行解析, 每得到一次完整的输出就产生一个快照"""
+    snap = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith('#prof'):
+            head = parse_kv(line.split()[1:])
+            snap = {'mhz': int(head.get('mhz', 168)), 'overhead': int(head.get('overhead', 0)),
+                    'window_ms': int(head.get('window_ms', 0)), 'sites': {}}
+        elif line.startswith('site=') and snap is not None:
+            # 名称中可能有空格, 按已知字段切分
+            name, rest = line[5:].split(' count=', 1)
+            kv = parse_kv(('count=' + rest).split())
+            hist = {}
+            for item in kv.get('hist', '').split(','):
+                if ':' in item:
+                    b, n = item.split(':')
+                    hist[int(b)] = int(n)
+            snap['sites'][name] = {'count': int(kv['count']), 'min': int(kv['min']), 'max': int(kv['max']),
+                                   'mean': int(kv['mean']), 'hist': hist}
+        elif line.startswith('#end') and snap is not None:
+            yield snap
+            snap = None
+
+
+def summarize(snap):
+    mhz = snap['mhz']
+    rows = {}
+    for name, s in snap['sites'].items():
+        rows[name] = {
+            'count': s['count'],
+            'rate': s['count'] * 1000.0 / snap['window_ms'] if snap['window_ms'] else 0.0,
+            'min': s['min'] / mhz, 'mean': s['mean'] / mhz,
+            'p50': percentile(s, 0.50) / mhz, 'p90': percentile(s, 0.90) / mhz,
+            'p99': percentile(s, 0.99) / mhz, 'max': s['max'] / mhz,
+        }
+    return rows
+
+
+def show(snap, baseline=None):
+    rows = summarize(snap)
+    print('window %.1f s, %d MHz, probe overhead %d cycles, times in us' % (
+        snap['window_ms'] / 1000.0, snap['mhz'], snap['overhead']))
+    cols = ['count', 'rate', 'min', 'mean', 'p50', 'p90', 'p99', 'max']
+    head = '%-26s' % 'site' + ''.join('%10s' % c for c in cols)
+    if baseline:
+        head += '%10s%10s' % ('d_mean', 'd_p99')
+    print(head)
+    for name, r in rows.items():
+        line = '%-26s%10d%10.1f' % (name, r['count'], r['rate'])
+        line += ''.join('%10.2f' % r[c] for c in cols[2:])
+        if baseline and name in baseline and r['count']:
+            b = baseline[name]
+            line += ''.join('%+9.1f%%' % ((r[c] - b[c]) * 100.0 / b[c]) if b[c] else '%10s' % '-'
+                            for c in ('mean', 'p99'))
+        print(line)
+    print()
+
+
+def socket_lines(addr, send):
+    host, port = addr.rsplit(':', 1)
+    sock = socket.create_connection((host, int(port)))
+    if send:
+        sock.sendall(send.encode())
+    buf = b''
+    while True:
+        data = sock.recv(4096)
+        if not data:
+            break
+        buf += data
+        while b'\n' in buf:
+            line, buf = buf.split(b'\n', 1)
+            yield line.decode(errors='replace')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='显示dwt_prof周期统计')
+    parser.add_argument('log', nargs='?', help='RTT通道4的记录文件, 缺省从stdin读取')
+    parser.add_argument('--tcp', help='RTT服务地址host:port, 持续显示每次输出')
+    parser.add_argument('--send', default='', help='连接后发送的命令: s开关周期输出, r输出后清零, 其他字符输出一次')
+    parser.add_argument('--save', help='把最后一次的结果保存为json, 作为之后对比的基线')
+    parser.add_argument('--baseline', help='与保存的基线对比mean和p99')
+    args = parser.parse_args()
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    if args.tcp:
+        last = None
+        try:
+            for snap in parse_lines(socket_lines(args.tcp, args.send or 'x')):
+                last = snap
+                show(snap, baseline)
+        except KeyboardInterrupt:
+            pass
+    else:
+        src = open(args.log, errors='replace') if args.log else sys.stdin
+        last = None
+        for snap in parse_lines(src):
+            last = snap
+        if last is None:
+            sys.exit('no complete snapshot found')
+        show(last, baseline)
+
+    if args.save and last is not None:
+        with open(args.save, 'w') as f:
+            json.dump(summarize(last), f, indent=2)
+
+
+if __name__ == '__main__':
+    main()